@@ -1,455 +1,530 @@
 #include "afaire.h"
 
-typedef uint8_t u8;
-typedef uint16_t u16;
-typedef int32_t b32;
-typedef int32_t i32;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef float f32;
-typedef double f64;
-typedef uintptr_t uptr;
-typedef char byte;
-typedef ptrdiff_t size;
-typedef size_t usize;
-
-#define min(a, b) (((a) < (b)) ? (a) : (b))
-#define max(a, b) (((a) > (b)) ? (a) : (b))
-
-#define DEFAULT_FILE_PANE_SIZE 150
-#define MAX_FILES 64
-#define MAX_EDITORS 16
-#define MAX_STRING_LENGTH 256
-#define BUFFER_SIZE 1024
-
-char folder[MAX_STRING_LENGTH] = {'\0'};
-
-typedef struct {
-    bool display;
-} markdown_renderer_t;
-
-typedef struct {
-    bool active;
-    bool dirty;
-    u8 file_index;
-    char buf[BUFFER_SIZE];
-    char filename[MAX_STRING_LENGTH];
-    char selected_filename[MAX_STRING_LENGTH];
-} editor_t;
-
+#include <pthread.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "app.h"
+#include "base.h"
+#include "ctl.h"
+#include "draw_copy.h"
+#include "fileio.h"
+#include "latency.h"
+#include "prof.h"
+#include "scan.h"
+#include "vfs.h"
+
+const char *roots[SCAN_MAX_ROOTS];
+i32 root_count = 0;
+
+// Refresh interval assumed when a frame isn't presented, and so doesn't block on vsync.
+#define SKIPPED_FRAME_NS (1000000000ll / 60)
+#define EVENT_QUEUE_SIZE 256
+// Just-in-time frames start this long before the frame is due, on top of the slowest recent frame.
+#define JIT_MARGIN_MS 2.0f
+#define JIT_HISTORY 32
+// Unfocused, frames are capped at --unfocused-fps; minimized, or at 0 fps, nothing is drawn and frames only tick this
+// often for scan results and file reloads. Input to the window lifts the cap for INPUT_HOLD_NS.
+#define DEFAULT_UNFOCUSED_FPS 10
+#define PAUSED_TICK_NS 1000000000ll
+#define INPUT_HOLD_NS 1000000000ll
+
+// A frame built by the UI thread, submitted by the main thread while the UI thread builds the next one.
 typedef struct {
-    bool display;
-    bool new_file_popup;
-    bool fuzzy_finder_popup;
-    char files[MAX_FILES][MAX_STRING_LENGTH];
-} file_pane_t;
+    draw_copy_t draw;
+    u64 fingerprint;
+    bool quit;
+    f32 build_ms;
+    latency_batch_t keys;
+} ui_frame_t;
 
 static struct {
-    char error_message[MAX_STRING_LENGTH];
     sg_pass_action pass_action;
-    markdown_renderer_t markdown_renderer;
-    editor_t editor[MAX_EDITORS];
-    file_pane_t file_pane;
+    u64 fingerprint;  // of the last presented frame
+    bool redraw;      // the window's contents may be stale: present the next frame regardless
+    i64 frame_start_ns;
+    latency_batch_t keys;        // pressed since the last frame
+    latency_batch_t shown_keys;  // read by the frame presented last
+    // --jit: sleep after the present so the next frame reads input as late as it can and still make the vblank
+    bool jit;
+    f32 work_ms[JIT_HISTORY];  // frame callback times, as a ring
+    u32 work_count;
+    app_window_state_t window;
+    i32 unfocused_fps;
+    i64 last_input_ns;
+    bool posix_io;  // --no-uring
+    bool ctl;       // --ctl: take commands from scripts on the control socket
+    i64 cpu_sample_ns;
+    i64 wall_sample_ns;
+    // --pipeline: the main thread keeps the GL context, events and sokol_app calls, the UI thread runs app_frame().
+    // Everything below is handed over while the UI thread is idle, between two frames.
+    bool pipelined;
+    pthread_t ui_thread;
+    pthread_mutex_t ui_lock;
+    pthread_cond_t ui_cond;
+    bool ui_busy;  // building frames[building]
+    bool ui_stop;
+    ui_frame_t frames[2];
+    i32 building;
+    sapp_event events[EVENT_QUEUE_SIZE];  // queued for the next frame, ImGui's input belongs to the UI thread
+    i32 event_count;
+    bool clipboard_stale;
+    char *clipboard_get;  // what the UI thread's igGetClipboardText sees
+    char *clipboard_set;  // copied on the UI thread, passed to sokol_app by the main thread
+    app_render_stats_t stats;
 } state;
 
-editor_t *current_editor;
+static i64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (i64)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static f32 ms_since(i64 start_ns) {
+    return (f32)(now_ns() - start_ns) / 1e6f;
+}
+
+static i64 cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (i64)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+// Sleeps until interval_ns after the frame started, waking early on input.
+static void wait_until(i64 interval_ns) {
+    i64 left = state.frame_start_ns + interval_ns - now_ns();
+    if (left > 0) {
+        sapp_wait_event((f64)left / 1e9);
+    }
+}
+
+static bool throttled(void) {
+    return state.window != APP_WINDOW_FOCUSED && now_ns() - state.last_input_ns >= INPUT_HOLD_NS;
+}
+
+static bool paused(void) {
+    return throttled() && (state.window == APP_WINDOW_MINIMIZED || state.unfocused_fps <= 0);
+}
+
+// Minimum time between frame starts in the current window state, 0 when uncapped.
+static i64 frame_interval_ns(void) {
+    if (!throttled()) {
+        return 0;
+    }
+    return paused() ? PAUSED_TICK_NS : 1000000000ll / state.unfocused_fps;
+}
+
+static void *ui_thread(void *arg);
+static const char *ui_get_clipboard(void *user);
+static void ui_set_clipboard(void *user, const char *text);
+
+static bool start_pipeline(void) {
+    pthread_mutex_init(&state.ui_lock, NULL);
+    pthread_cond_init(&state.ui_cond, NULL);
+    if (!draw_copy_init(&state.frames[0].draw) || !draw_copy_init(&state.frames[1].draw) ||
+        pthread_create(&state.ui_thread, NULL, ui_thread, NULL) != 0) {
+        draw_copy_free(&state.frames[0].draw);
+        draw_copy_free(&state.frames[1].draw);
+        pthread_cond_destroy(&state.ui_cond);
+        pthread_mutex_destroy(&state.ui_lock);
+        return false;
+    }
+    ImGuiIO *io = igGetIO();
+    io->GetClipboardTextFn = ui_get_clipboard;
+    io->SetClipboardTextFn = ui_set_clipboard;
+    state.clipboard_stale = true;
+    return true;
+}
 
 static void init(void) {
+    prof_init();
+    prof_thread_name("main");
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
         .logger.func = slog_func,
+        .allocator = {.alloc_fn = alloc_sokol, .free_fn = alloc_sokol_free},
+    });
+    // before simgui_setup, which creates the ImGui context
+    igSetAllocatorFunctions(alloc_imgui, alloc_imgui_free, NULL);
+    simgui_setup(&(simgui_desc_t){
+        .no_default_font = true,
+        .allocator = {.alloc_fn = alloc_sokol, .free_fn = alloc_sokol_free},
     });
-    simgui_setup(&(simgui_desc_t){.no_default_font = true});
 
     ImGuiIO *io = igGetIO();
     ImFontAtlas *fonts = io->Fonts;
     ImFontAtlas_AddFontFromFileTTF(fonts, "../ibm.ttf", 18.0f, NULL, NULL);
     init_style();
 
-    state.error_message[0] = '\0';
     state.pass_action =
         (sg_pass_action){.colors[0] = {.load_action = SG_LOADACTION_CLEAR, .clear_value = {0.0f, 0.5f, 1.0f, 1.0}}};
-    state.markdown_renderer = (markdown_renderer_t){.display = true};
-    state.file_pane =
-        (file_pane_t){.display = true, .new_file_popup = false, .fuzzy_finder_popup = false, .files = {0}};
-    for (u8 i = 0; i < MAX_EDITORS; i++) {
-        state.editor[i] = (editor_t){.active = false,
-                                     .dirty = false,
-                                     .file_index = -1,
-                                     .buf = {0},
-                                     .filename = {0},
-                                     .selected_filename = {0}};
-    }
-    current_editor = &state.editor[0];
-    strncpy(current_editor->filename, "*scratch*", MAX_STRING_LENGTH);
-    current_editor->active = true;
-
-    if (folder[0] == '\0') {
-        printf("Usage: afaire <folder>\n");
+    state.redraw = true;
+    fileio_init(state.posix_io);
+    vfs_t *vfs[SCAN_MAX_ROOTS];
+    for (i32 i = 0; i < root_count; i++) {
+        vfs[i] = vfs_open(roots[i]);
+    }
+#if defined(__EMSCRIPTEN__)
+    // built with -sNO_FILESYSTEM: without a folder, notes are kept in memory for the session
+    if (root_count == 0 && (vfs[0] = vfs_memory_open()) != NULL) {
+        static const char welcome[] =
+            "# Welcome\n\nNotes written here last until the page is closed.\n\n- [ ] try afaire\n";
+        vfs_memory_put(vfs[0], "welcome.md", welcome, (i32)sizeof(welcome) - 1);
+        roots[root_count++] = "notes";
+    }
+#endif
+    app_init(roots, vfs, root_count);
+    if (root_count == 0) {
+        printf("Usage: afaire [--pipeline] [--jit] [--unfocused-fps N] [--no-uring] [--ctl] <folder|archive.tar> "
+               "[...]\n");
         sapp_quit();
+    } else if (state.ctl) {
+        char path[256];
+        ctl_default_path(path, sizeof(path));
+        if (!ctl_start(path, sapp_wake)) {
+            fprintf(stderr, "afaire: can't listen on %s\n", path);
+        }
+    }
+    if (state.pipelined && !start_pipeline()) {
+        fprintf(stderr, "afaire: can't start the UI thread, rendering serially\n");
+        state.pipelined = false;
     }
 }
 
-static void set_dirty(bool dirty, const char *filename, bool force) {
-    if (force || current_editor->dirty != dirty) {
-        current_editor->dirty = dirty;
-        snprintf(current_editor->selected_filename, sizeof(current_editor->selected_filename), "%s%s",
-                 dirty ? "* " : "  ", filename);
-    }
+static void new_frame(void) {
+    simgui_new_frame(&(simgui_frame_desc_t){
+        .width = sapp_width(),
+        .height = sapp_height(),
+        .delta_time = sapp_frame_duration(),
+        .dpi_scale = sapp_dpi_scale(),
+    });
 }
 
-static void read_file(const char *path) {
-    FILE *file;
-    char fullpath[BUFFER_SIZE];
-    strncpy(current_editor->filename, state.file_pane.files[current_editor->file_index], MAX_STRING_LENGTH);
-    snprintf(fullpath, sizeof(fullpath), "%s/%s", path, current_editor->filename);
-    file = fopen(fullpath, "r");
-    if (file) {
-        memset(current_editor->buf, 0, BUFFER_SIZE);
-        fread(current_editor->buf, 1, BUFFER_SIZE, file);
-        fclose(file);
-        set_dirty(0, current_editor->filename, true);
-    } else {
-        snprintf(state.error_message, sizeof(state.error_message), "Could not open file %s", current_editor->filename);
+// Uploads and draws the frame unless it's the one on screen. Returns true when the frame was skipped.
+static bool submit(ImDrawData *draw_data, u64 fingerprint, latency_batch_t *keys, app_render_stats_t *stats) {
+    i64 start = now_ns();
+    stats->frames++;
+    if (paused() || (fingerprint == state.fingerprint && !state.redraw)) {
+        // same pixels as on screen, or none wanted: no upload, no draw, and the previous frame stays presented
+        stats->skipped_frames++;
+        sapp_skip_present();
+        // nothing the keys did shows, so there's no latency to measure
+        keys->count = 0;
+        return true;
     }
+    latency_move(&state.shown_keys, keys);
+    state.fingerprint = fingerprint;
+    state.redraw = false;
+    // uploads, and buffer growth, happen before the pass
+    prof_begin("upload");
+    simgui_prepare_render_draw_data(draw_data);
+    prof_end();
+    simgui_stats_t simgui_stats = simgui_query_stats();
+    stats->draw_lists = simgui_stats.draw_lists;
+    stats->uploaded_draw_lists = simgui_stats.uploaded_draw_lists;
+    stats->uploaded_bytes = simgui_stats.uploaded_bytes;
+    stats->vertices = simgui_stats.vertices;
+    stats->peak_vertices = simgui_stats.peak_vertices;
+    stats->vertex_capacity = simgui_stats.vertex_capacity;
+    sg_begin_pass(&(sg_pass){.action = state.pass_action, .swapchain = sglue_swapchain()});
+    prof_begin("simgui_render");
+    simgui_render_draw_data(draw_data);
+    prof_end();
+    sg_end_pass();
+    sg_commit();
+    stats->submit_ms = ms_since(start);
+    return false;
 }
 
-static void new_file(const char *path, const char *filename) {
-    char fullpath[BUFFER_SIZE];
-    snprintf(fullpath, sizeof(fullpath), "%s/%s", path, filename);
-    FILE *file = fopen(fullpath, "w");
-    if (file) {
-        fclose(file);
-        set_dirty(0, filename, true);
-    } else {
-        snprintf(state.error_message, sizeof(state.error_message), "Could not create file %s", filename);
+// After a presented, uncapped frame: sleeps out the part of the next refresh interval that the next frame won't need,
+// so it reads input as late as it can. The swap already waited for the vblank.
+static void delay_next_frame(app_render_stats_t *stats) {
+    state.work_ms[state.work_count++ % JIT_HISTORY] = ms_since(state.frame_start_ns);
+    if (!state.jit) {
+        return;
+    }
+    f32 slowest = 0.0f;
+    for (u32 i = 0; i < min(state.work_count, (u32)JIT_HISTORY); i++) {
+        slowest = max(slowest, state.work_ms[i]);
+    }
+    f32 delay_ms = (f32)sapp_frame_duration() * 1000.0f - slowest - JIT_MARGIN_MS;
+    stats->frame_delay_ms = max(delay_ms, 0.0f);
+    if (delay_ms > 0.0f) {
+        sapp_delay_next_frame(delay_ms / 1000.0);
     }
 }
 
-static void delete_file(const char *path, int i) {
-    char fullpath[BUFFER_SIZE];
-    char *filename;
-    filename = state.file_pane.files[i];
-    snprintf(fullpath, sizeof(fullpath), "%s/%s", path, filename);
-    remove(fullpath);
+// Charges the process CPU time since the last call to the current window state.
+static void account_cpu(app_render_stats_t *stats) {
+    i64 cpu = cpu_ns(), wall = now_ns();
+    if (state.wall_sample_ns) {
+        stats->cpu_seconds[state.window] += (f64)(cpu - state.cpu_sample_ns) / 1e9;
+        stats->wall_seconds[state.window] += (f64)(wall - state.wall_sample_ns) / 1e9;
+    }
+    state.cpu_sample_ns = cpu;
+    state.wall_sample_ns = wall;
 }
 
-static void read_dir(const char *path) {
-    u16 i;
-    DIR *d;
-    struct dirent *dir;
-    for (i = 0; state.file_pane.files[i][0] != '\0'; i++) {
-        state.file_pane.files[i][0] = '\0';
-    }
-    d = opendir(path);
-    if (d) {
-        i = 0;
-        while ((dir = readdir(d)) != NULL) {
-            if (dir->d_type == DT_REG) {
-                strncpy(state.file_pane.files[i++], dir->d_name, MAX_STRING_LENGTH);
-            }
-        }
-        closedir(d);
+// Paces the loop after the frame: capped by the window state, else a skipped frame sleeps out the refresh interval
+// and a presented one may start the next just in time. Every wait ends early on input.
+static void pace_frame(bool skipped, app_render_stats_t *stats) {
+    account_cpu(stats);
+    i64 interval = frame_interval_ns();
+    stats->window_state = state.window;
+    stats->paused = paused();
+    stats->frame_rate_cap = interval > 0 && !stats->paused ? state.unfocused_fps : 0;
+    if (interval > 0) {
+        wait_until(interval);
+    } else if (skipped) {
+        wait_until(SKIPPED_FRAME_NS);
     } else {
-        snprintf(state.error_message, sizeof(state.error_message), "Could not open directory %s", path);
+        delay_next_frame(stats);
     }
 }
 
-static void save_file(const char *path) {
-    if (!current_editor->dirty) {
-        return;
-    }
-    char fullpath[BUFFER_SIZE];
-    char *filename;
-    filename = current_editor->filename;
-    snprintf(fullpath, sizeof(fullpath), "%s/%s", path, filename);
-    FILE *file = fopen(fullpath, "w");
-    if (file) {
-        fwrite(&current_editor->buf, 1, strlen(current_editor->buf), file);
-        fclose(file);
-        set_dirty(0, filename, true);
-        read_dir(path);
-    } else {
-        snprintf(state.error_message, sizeof(state.error_message), "Could not save file %s", filename);
+static void frame_serial(void) {
+    state.frame_start_ns = now_ns();
+    latency_presented(&state.shown_keys, sapp_present_time());
+    prof_frame_begin();
+    alloc_frame_begin();
+    prof_begin("new frame");
+    new_frame();
+    prof_end();
+    app_frame();
+    if (app_quit_requested()) {
+        sapp_request_quit();
     }
+
+    prof_begin("render");
+    igRender();
+    prof_begin("fingerprint");
+    u64 fingerprint = app_draw_fingerprint();
+    prof_end();
+    app_render_stats_t *stats = app_render_stats();
+    stats->build_ms = ms_since(state.frame_start_ns);
+    bool skip = submit(igGetDrawData(), fingerprint, &state.keys, stats);
+    prof_end();
+    alloc_frame_end();
+    prof_frame_end();
+    pace_frame(skip, stats);
 }
 
-static void open_file_handler(const char *filename) {
-    u8 first_free, file_index;
-    first_free = file_index = (u8)-1;
-    for (u8 i = 0; i < MAX_FILES; i++) {
-        if (state.file_pane.files[i][0] == '\0') {
-            break;
+// UI thread: one app_frame() per hand-over, from igNewFrame (called by the main thread) to a copy of the draw data.
+static void build_frame(ui_frame_t *f) {
+    i64 start = now_ns();
+    prof_frame_begin();
+    alloc_frame_begin();
+    app_frame();
+    f->quit = app_quit_requested();
+    prof_begin("render");
+    igRender();
+    prof_begin("fingerprint");
+    f->fingerprint = app_draw_fingerprint();
+    prof_end();
+    prof_begin("copy");
+    draw_copy_update(&f->draw, igGetDrawData());
+    prof_end();
+    prof_end();
+    f->build_ms = ms_since(start);
+    alloc_frame_end();
+    prof_frame_end();
+}
+
+static void *ui_thread(void *arg) {
+    (void)arg;
+    prof_thread_name("ui");
+    pthread_mutex_lock(&state.ui_lock);
+    for (;;) {
+        while (!state.ui_busy && !state.ui_stop) {
+            pthread_cond_wait(&state.ui_cond, &state.ui_lock);
         }
-        if (strcmp(state.file_pane.files[i], filename) == 0) {
-            file_index = i;
+        if (state.ui_stop) {
             break;
         }
+        ui_frame_t *f = &state.frames[state.building];
+        pthread_mutex_unlock(&state.ui_lock);
+        build_frame(f);
+        pthread_mutex_lock(&state.ui_lock);
+        state.ui_busy = false;
+        pthread_cond_broadcast(&state.ui_cond);
     }
-    for (u8 i = 0; i < MAX_EDITORS; i++) {
-        if (first_free == (u8)-1 && !state.editor[i].active || strcmp(state.editor[i].filename, "*scratch*") == 0) {
-            first_free = i;
-        }
-        if (strcmp(state.editor[i].filename, filename) == 0) {
-            current_editor = &state.editor[i];
-            current_editor->active = true;
-            current_editor->file_index = file_index;
-            read_file(folder);
-            return;
-        }
-    }
-    if (first_free != (u8)-1) {
-        current_editor = &state.editor[first_free];
-        current_editor->active = true;
-        current_editor->file_index = file_index;
-        strncpy(current_editor->filename, filename, MAX_STRING_LENGTH);
-        read_file(folder);
-    }
+    pthread_mutex_unlock(&state.ui_lock);
+    return NULL;
 }
 
-static int editor_callback(ImGuiInputTextCallbackData *data) {
-    (void)data;
-    set_dirty(1, current_editor->filename, false);
-    return 0;
+static void ui_wait(void) {
+    pthread_mutex_lock(&state.ui_lock);
+    while (state.ui_busy) {
+        pthread_cond_wait(&state.ui_cond, &state.ui_lock);
+    }
+    pthread_mutex_unlock(&state.ui_lock);
 }
 
-static void frame(void) {
-    simgui_new_frame(&(simgui_frame_desc_t){
-        .width = sapp_width(),
-        .height = sapp_height(),
-        .delta_time = sapp_frame_duration(),
-        .dpi_scale = sapp_dpi_scale(),
-    });
+static void ui_start(void) {
+    pthread_mutex_lock(&state.ui_lock);
+    state.ui_busy = true;
+    pthread_cond_broadcast(&state.ui_cond);
+    pthread_mutex_unlock(&state.ui_lock);
+}
 
-    ImGuiViewport *viewport = igGetMainViewport();
-    igSetNextWindowPos(viewport->Pos, ImGuiCond_Always, (ImVec2){0, 0});
-    igSetNextWindowSize(viewport->Size, ImGuiCond_Always);
+static const char *ui_get_clipboard(void *user) {
+    (void)user;
+    return state.clipboard_get ? state.clipboard_get : "";
+}
 
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_N)) {
-        state.file_pane.new_file_popup = true;
-    }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_P)) {
-        state.file_pane.fuzzy_finder_popup = true;
-    }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_S)) {
-        save_file(folder);
-    }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_Q)) {
-        sapp_request_quit();
-    }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_B)) {
-        state.file_pane.display = !state.file_pane.display;
-    }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_V)) {
-        state.markdown_renderer.display = !state.markdown_renderer.display;
+static void ui_set_clipboard(void *user, const char *text) {
+    (void)user;
+    mem_free(state.clipboard_set);
+    state.clipboard_set = mem_alloc(strlen(text) + 1);
+    if (state.clipboard_set) {
+        strcpy(state.clipboard_set, text);
     }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_Equal)) {
-        ImGuiIO *io = igGetIO();
-        io->FontGlobalScale += 0.1f;
-    }
-    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_Minus)) {
-        ImGuiIO *io = igGetIO();
-        io->FontGlobalScale -= 0.1f;
+}
+
+// Main thread, UI thread idle: feed the queued input to ImGui and start its next frame.
+static void flush_events(void) {
+    for (i32 i = 0; i < state.event_count; i++) {
+        simgui_handle_event(&state.events[i]);
     }
+    state.event_count = 0;
+}
 
-    igBegin("afaire", 0, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_MenuBar);
-    igBeginMenuBar();
-    if (igBeginMenu("File", true)) {
-        if (igMenuItem_Bool("New", "Ctrl+N", false, true)) {
-            state.file_pane.new_file_popup = true;
-        }
-        if (igMenuItem_Bool("Open", "Ctrl+P", false, true)) {
-            state.file_pane.fuzzy_finder_popup = true;
-        }
-        if (igMenuItem_Bool("Save", "Ctrl+S", false, true)) {
-            save_file(folder);
-        }
-        if (igMenuItem_Bool("Quit", "Ctrl+Q", false, true)) {
-            sapp_request_quit();
-        }
-        igEndMenu();
+static void hand_over(void) {
+    if (state.clipboard_set) {
+        sapp_set_clipboard_string(state.clipboard_set);
+        mem_free(state.clipboard_set);
+        state.clipboard_set = NULL;
+        state.clipboard_stale = true;
     }
-    if (igBeginMenu("View", true)) {
-        if (igMenuItem_Bool("File Pane", "Ctrl+B", state.file_pane.display, true)) {
-            state.file_pane.display = !state.file_pane.display;
-        }
-        if (igMenuItem_Bool("Markdown Preview", "Ctrl+V", state.markdown_renderer.display, true)) {
-            state.markdown_renderer.display = !state.markdown_renderer.display;
+    if (state.clipboard_stale) {
+        const char *text = sapp_get_clipboard_string();
+        mem_free(state.clipboard_get);
+        state.clipboard_get = mem_alloc(strlen(text) + 1);
+        if (state.clipboard_get) {
+            strcpy(state.clipboard_get, text);
         }
-        igEndMenu();
+        state.clipboard_stale = false;
     }
-    igEndMenuBar();
+    flush_events();
+    latency_move(&state.frames[state.building].keys, &state.keys);
+    state.stats.pipelined = true;
+    *app_render_stats() = state.stats;
+    new_frame();
+}
 
-    if (state.file_pane.display) {
-        igBeginChild_Str(
-            "files_pane", (ImVec2){DEFAULT_FILE_PANE_SIZE, -1},
-            ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX,
-            false);
-        if (state.file_pane.files[0][0] == '\0') {
-            read_dir(folder);
-        }
-        for (u16 i = 0; state.file_pane.files[i][0] != '\0'; i++) {
-            bool is_current_file = strcmp(state.file_pane.files[i], current_editor->filename) == 0;
-            if (igSelectable_Bool((is_current_file) ? current_editor->selected_filename : state.file_pane.files[i],
-                                  is_current_file, 0, (ImVec2){0, 0})) {
-                open_file_handler(state.file_pane.files[i]);
-            }
-            if (igBeginPopupContextItem(NULL, ImGuiPopupFlags_MouseButtonRight)) {
-                if (igSmallButton("Rename")) {
-                    // TODO: rename function
-                    igCloseCurrentPopup();
-                }
-                if (igSmallButton("Delete")) {
-                    if (current_editor->file_index == i) {
-                        current_editor->buf[0] = '\0';
-                        current_editor->file_index = (u8)-1;
-                    }
-                    delete_file(folder, i);
-                    read_dir(folder);
-                    igCloseCurrentPopup();
-                }
-                igEndPopup();
-            }
-        }
-        igEndChild();
-        igSameLine(0, 0);
-    }
-    ImVec2 avail;
-    igGetContentRegionAvail(&avail);
-    igBeginGroup();
-    if (igBeginTabBar("## tabs", ImGuiTabBarFlags_None)) {
-        for (u8 i = 0; i < MAX_EDITORS; i++) {
-            if (igBeginTabItem(state.editor[i].filename, &state.editor[i].active, 0)) {
-                if (igIsItemClicked(0)) {
-                    current_editor = &state.editor[i];
-                }
-                igInputTextMultiline(
-                    "## editor", current_editor->buf, sizeof(current_editor->buf), (ImVec2){avail.x, -1},
-                    ImGuiInputTextFlags_AllowTabInput | ImGuiInputTextFlags_CallbackEdit, &editor_callback, 0);
-                igEndTabItem();
-            }
-        }
-        igEndTabBar();
-        igEndGroup();
-    }
-    if (state.markdown_renderer.display) {
-        igSameLine(0, 0);
-        igBeginChild_Str(
-            "files_pane2", (ImVec2){avail.x, -1},
-            ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX,
-            false);
-        igText("Markdown Preview");
-        igEndChild();
-    }
-    if (igBeginPopupModal("new_file", NULL, 0)) {
-        igText("New filename:");
-        igSameLine(0, 0);
-        char new_filename[MAX_STRING_LENGTH] = {'\0'};
-        bool enter = igInputText("##new_filename", new_filename, sizeof(new_filename),
-                                 ImGuiInputTextFlags_EnterReturnsTrue, NULL, NULL);
-        if (enter || igButton("Create", (ImVec2){0, 0})) {
-            new_file(folder, new_filename);
-            read_dir(folder);
-            new_filename[0] = '\0';
-            igCloseCurrentPopup();
-        }
-        igSameLine(0, 0);
-        if (igIsKeyPressed_Bool(ImGuiKey_Escape, 0) || igButton("Cancel", (ImVec2){0, 0})) {
-            new_filename[0] = '\0';
-            igCloseCurrentPopup();
-        }
-        igEndPopup();
-    }
-    if (state.file_pane.new_file_popup) {
-        igOpenPopup_Str("new_file", 0);
-        state.file_pane.new_file_popup = false;
-    }
-    static bool focus = true;
-    static u16 selected = (u16)-1;
-    if (state.file_pane.fuzzy_finder_popup) {
-        igBegin("## fuzzy_finder", 0, 0);
-        static ImGuiTextFilter filter;
-        u16 i, j;
-
-        if (igBeginListBox("## search_results", (ImVec2){0, 0})) {
-            for (i = 0, j = 0; i < MAX_FILES && state.file_pane.files[i][0] != '\0'; i++) {
-                if (ImGuiTextFilter_PassFilter(&filter, state.file_pane.files[i], NULL)) {
-                    if (igSelectable_Bool(state.file_pane.files[i], selected == j, 0, (ImVec2){0, 0})) {
-                        open_file_handler(state.file_pane.files[i]);
-                        state.file_pane.fuzzy_finder_popup = false;
-                    }
-                    j++;
-                }
-            }
-            igEndListBox();
-        }
-        if (igIsKeyPressed_Bool(ImGuiKey_UpArrow, 0)) {
-            selected = max(0, selected - 1);
-        }
-        if (igIsKeyPressed_Bool(ImGuiKey_DownArrow, 0)) {
-            selected = min(j - 1, selected + 1);
-        }
-        if (igIsKeyPressed_Bool(ImGuiKey_Enter, 0) && selected >= 0 && selected < j) {
-            for (i = 0, j = 0; i < MAX_FILES && state.file_pane.files[i][0] != '\0'; i++) {
-                if (ImGuiTextFilter_PassFilter(&filter, state.file_pane.files[i], NULL)) {
-                    if (j == selected) {
-                        current_editor->file_index = i;
-                        break;
-                    }
-                    j++;
-                }
-            }
-            open_file_handler(state.file_pane.files[i]);
-            state.file_pane.fuzzy_finder_popup = false;
-        }
-        if (igIsKeyPressed_Bool(ImGuiKey_Escape, 0)) {
-            state.file_pane.fuzzy_finder_popup = false;
-        }
+// Frame N is submitted while the UI thread builds frame N+1, which is submitted by the next call: input reaches the
+// screen at most one frame later than when serial.
+static void frame_pipelined(void) {
+    state.frame_start_ns = now_ns();
+    prof_begin("wait ui");
+    ui_wait();
+    prof_end();
+    latency_presented(&state.shown_keys, sapp_present_time());
+    ui_frame_t *f = &state.frames[state.building];
+    state.building ^= 1;
+    if (f->quit) {
+        sapp_request_quit();
+    }
+    prof_begin("hand over");
+    hand_over();
+    prof_end();
+    ui_start();
+
+    prof_begin("submit");
+    state.stats.build_ms = f->build_ms;
+    bool skip = submit(f->draw.data, f->fingerprint, &f->keys, &state.stats);
+    prof_end();
+    pace_frame(skip, &state.stats);
+}
 
-        ImGuiTextFilter_Draw(&filter, "##search", MAX_STRING_LENGTH);
-        if (focus) {
-            igSetKeyboardFocusHere(-1);
-            focus = false;
-        }
-        igEnd();
+static void frame(void) {
+    if (state.pipelined) {
+        frame_pipelined();
     } else {
-        focus = true;
-        selected = -1;
-    }
-    if (igBeginPopupModal("## error", NULL, 0)) {
-        igText("Error: %s", state.error_message);
-        if (igIsKeyPressed_Bool(ImGuiKey_Escape, 0) || igButton("Close", (ImVec2){0, 0})) {
-            igCloseCurrentPopup();
-            state.error_message[0] = '\0';
-        }
-        igEndPopup();
+        frame_serial();
     }
-    if (state.error_message[0] != '\0') {
-        igOpenPopup_Str("## error", 0);
-    }
-
-    igEnd();
+}
 
-    sg_begin_pass(&(sg_pass){.action = state.pass_action, .swapchain = sglue_swapchain()});
-    simgui_render();
-    sg_end_pass();
-    sg_commit();
+static void stop_pipeline(void) {
+    ui_wait();
+    pthread_mutex_lock(&state.ui_lock);
+    state.ui_stop = true;
+    pthread_cond_broadcast(&state.ui_cond);
+    pthread_mutex_unlock(&state.ui_lock);
+    pthread_join(state.ui_thread, NULL);
+    pthread_cond_destroy(&state.ui_cond);
+    pthread_mutex_destroy(&state.ui_lock);
+    for (i32 i = 0; i < 2; i++) {
+        draw_copy_free(&state.frames[i].draw);
+    }
+    mem_free(state.clipboard_get);
+    mem_free(state.clipboard_set);
 }
 
 static void cleanup(void) {
+    if (state.pipelined) {
+        stop_pipeline();
+    }
+    ctl_stop();
+    app_shutdown();
     simgui_shutdown();
     sg_shutdown();
+    alloc_shutdown();
+    prof_shutdown();
 }
 
 static void event(const sapp_event *ev) {
-    simgui_handle_event(ev);
+    if (ev->type == SAPP_EVENTTYPE_RESIZED || ev->type == SAPP_EVENTTYPE_RESTORED ||
+        ev->type == SAPP_EVENTTYPE_RESUMED) {
+        state.redraw = true;
+    }
+    if (ev->type == SAPP_EVENTTYPE_FOCUSED || ev->type == SAPP_EVENTTYPE_RESTORED ||
+        ev->type == SAPP_EVENTTYPE_RESUMED) {
+        state.window = APP_WINDOW_FOCUSED;
+    } else if (ev->type == SAPP_EVENTTYPE_UNFOCUSED && state.window == APP_WINDOW_FOCUSED) {
+        state.window = APP_WINDOW_UNFOCUSED;
+    } else if (ev->type == SAPP_EVENTTYPE_ICONIFIED || ev->type == SAPP_EVENTTYPE_SUSPENDED) {
+        state.window = APP_WINDOW_MINIMIZED;
+    }
+    if ((ev->type >= SAPP_EVENTTYPE_KEY_DOWN && ev->type <= SAPP_EVENTTYPE_TOUCHES_CANCELLED) ||
+        ev->type == SAPP_EVENTTYPE_FILES_DROPPED) {
+        state.last_input_ns = now_ns();
+    }
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        latency_input(&state.keys, ev->timestamp);
+    }
+    if (!state.pipelined) {
+        simgui_handle_event(ev);
+        return;
+    }
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN || ev->type == SAPP_EVENTTYPE_CLIPBOARD_PASTED) {
+        // a paste shortcut may follow; sokol_app's clipboard is only read on the main thread
+        state.clipboard_stale = true;
+    }
+    if (state.event_count == EVENT_QUEUE_SIZE) {
+        // a burst of input between two frames: hand it to ImGui now, ahead of the rest
+        ui_wait();
+        flush_events();
+    }
+    state.events[state.event_count++] = *ev;
 }
 
 sapp_desc sokol_main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
-    if (argc == 2) {
-        strncpy(folder, argv[1], sizeof(folder));
+    state.unfocused_fps = DEFAULT_UNFOCUSED_FPS;
+    for (i32 i = 1; i < argc && root_count < SCAN_MAX_ROOTS; i++) {
+        if (strcmp(argv[i], "--pipeline") == 0) {
+            state.pipelined = true;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            state.jit = true;
+        } else if (strcmp(argv[i], "--unfocused-fps") == 0 && i + 1 < argc) {
+            state.unfocused_fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-uring") == 0) {
+            state.posix_io = true;
+        } else if (strcmp(argv[i], "--ctl") == 0) {
+            state.ctl = true;
+        } else {
+            roots[root_count++] = argv[i];
+        }
     }
 
     return (sapp_desc){
@@ -462,6 +537,7 @@ sapp_desc sokol_main(int argc, char *argv[]) {
         .height = 720,
         .icon.sokol_default = true,
         .logger.func = slog_func,
+        .allocator = {.alloc_fn = alloc_sokol, .free_fn = alloc_sokol_free},
         .high_dpi = true,
     };
 }
@@ -3,7 +3,6 @@
 #include "sokol_glue.h"
 #include "sokol_log.h"
 #define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
-#include <dirent.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
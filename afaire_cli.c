@@ -0,0 +1,396 @@
+// afaire-cli: the tasks of one or more folders, without a window, for cron jobs and shell pipelines.
+//
+//   afaire-cli notes/                        # every open task, as path:line:task
+//   afaire-cli --tag '#ops' --json notes/    # one JSON object per line
+//   afaire-cli --tag '#done-today' --check notes/
+//
+// The folders are scanned on the job pool like the app does, and each batch of files found is read and searched by a
+// worker while the scan goes on. The matches are printed once all are in, sorted by path: workers finish in any
+// order, and a cron job diffing two runs, or a script reading line numbers, needs the same output for the same notes.
+// Searching is most of the work, so holding the output back costs little. Exits 1 when a file can't be read or written.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "base.h"
+#include "fileio.h"
+#include "jobs.h"
+#include "task.h"
+#include "vfs.h"
+#include "workspace.h"
+
+// Files read by one job, in one vfs batch: one submission under io_uring.
+#define CLI_BATCH 32
+// Between polls the main loop sleeps until a job finishes. A running afaire's index is written by another process,
+// which doesn't wake it: until caught up with it, the loop polls every CLI_SYNC_WAIT_NS, for CLI_SYNC_TRIES polls.
+#define CLI_SYNC_WAIT_NS 1000000
+#define CLI_SYNC_TRIES 2000
+#define CLI_IDLE_WAIT_NS 100000000
+
+typedef enum {
+    SHOW_OPEN,
+    SHOW_DONE,
+    SHOW_ALL,
+} show_t;
+
+typedef struct {
+    char *path;     // within the root
+    char *display;  // as the app's finder shows it
+    char *out;      // the file's matches, formatted
+    i32 out_len;
+    i32 out_cap;
+    i32 error;
+    bool changed;
+    bool conflict;  // --check: changed on disk since it was read, left as it was
+} cli_file_t;
+
+typedef struct {
+    vfs_t *vfs;
+    cli_file_t *files[CLI_BATCH];
+    i32 count;
+} cli_batch_t;
+
+static struct {
+    show_t show;
+    const char *tag;
+    i32 tag_len;
+    bool json;
+    bool check;  // mark the matching open tasks done
+    cli_file_t **files;
+    i32 file_count;
+    i32 file_cap;
+    i32 failed;
+} cli;
+
+static void out_append(cli_file_t *f, const char *data, i32 len) {
+    if (f->out_len + len > f->out_cap) {
+        i32 cap = max(f->out_len + len, max(256, f->out_cap * 2));
+        char *out = mem_realloc(f->out, (usize)cap);
+        if (!out) {
+            return;
+        }
+        f->out = out;
+        f->out_cap = cap;
+    }
+    memcpy(f->out + f->out_len, data, (usize)len);
+    f->out_len += len;
+}
+
+static void out_json_string(cli_file_t *f, const char *s, i32 len) {
+    out_append(f, "\"", 1);
+    for (i32 i = 0; i < len; i++) {
+        char esc[8];
+        u8 c = (u8)s[i];
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)c;
+            out_append(f, esc, 2);
+        } else if (c < 0x20) {
+            out_append(f, esc, snprintf(esc, sizeof(esc), "\\u%04x", c));
+        } else {
+            out_append(f, s + i, 1);
+        }
+    }
+    out_append(f, "\"", 1);
+}
+
+static void report(cli_file_t *f, i32 line, const char *task, i32 len, bool done) {
+    char num[32];
+    if (cli.json) {
+        out_append(f, "{\"file\":", 8);
+        out_json_string(f, f->display, (i32)strlen(f->display));
+        const char *state = done ? "true" : "false";
+        out_append(f, num, snprintf(num, sizeof(num), ",\"line\":%d,\"done\":%s,\"text\":", line, state));
+        out_json_string(f, task, len);
+        out_append(f, "}\n", 2);
+    } else {
+        out_append(f, f->display, (i32)strlen(f->display));
+        out_append(f, num, snprintf(num, sizeof(num), ":%d:- [%c] ", line, done ? 'x' : ' '));
+        out_append(f, task, len);
+        out_append(f, "\n", 1);
+    }
+}
+
+// The file's tasks that match, the way the highlighter reads them: fenced code blocks hold no tasks.
+static void search(cli_file_t *f, char *data, i32 len) {
+    bool fence = false;
+    i32 line = 1;
+    for (i32 start = 0; start < len; line++) {
+        const char *nl = memchr(data + start, '\n', (usize)(len - start));
+        i32 end = nl ? (i32)(nl - data) : len;
+        i32 next = end + 1;
+        if (end > start && data[end - 1] == '\r') {
+            end--;
+        }
+        i32 mark = task_mark(data + start, end - start);
+        if (task_is_fence(data + start, data + end)) {
+            fence = !fence;
+        } else if (!fence && mark >= 0) {
+            i32 text = min(start + mark + 3, end);
+            bool done = data[start + mark] != ' ';
+            bool shown = cli.show == SHOW_ALL || done == (cli.show == SHOW_DONE);
+            if (shown && (!cli.tag || task_has_tag(data + text, end - text, cli.tag, cli.tag_len))) {
+                if (cli.check && !done) {
+                    data[start + mark] = 'x';
+                    f->changed = true;
+                }
+                report(f, line, data + text, end - text, done || cli.check);
+            }
+        }
+        start = next;
+    }
+}
+
+// Writes `read` back with the tasks checked, under the lock afaire takes around its saves, unless the file changed on
+// disk since it was read: an afaire saving it meanwhile keeps its version.
+static void write_back(vfs_t *vfs, cli_file_t *f, const fileio_req_t *read) {
+    i32 lock = vfs_lock(vfs, f->path);
+    fileio_req_t req = {.op = FILEIO_STAT, .path = f->path};
+    vfs_run(vfs, &req, 1);
+    f->conflict = req.error == 0 && (req.mtime != read->mtime || req.size != read->len);
+    if (req.error == 0 && !f->conflict) {
+        req = (fileio_req_t){.op = FILEIO_WRITE, .path = f->path, .data = read->data, .len = read->len};
+        vfs_run(vfs, &req, 1);
+    }
+    f->error = req.error;
+    vfs_unlock(vfs, lock);
+}
+
+static void batch_job(void *data) {
+    cli_batch_t *b = data;
+    fileio_req_t reqs[CLI_BATCH];
+    for (i32 i = 0; i < b->count; i++) {
+        reqs[i] = (fileio_req_t){.op = FILEIO_READ, .path = b->files[i]->path};
+    }
+    vfs_run(b->vfs, reqs, b->count);
+    for (i32 i = 0; i < b->count; i++) {
+        cli_file_t *f = b->files[i];
+        f->error = reqs[i].error;
+        if (f->error == 0) {
+            search(f, reqs[i].data, reqs[i].len);
+        }
+        if (f->changed) {
+            write_back(b->vfs, f, &reqs[i]);
+        }
+        mem_free(reqs[i].data);
+    }
+}
+
+static void file_free(cli_file_t *f) {
+    mem_free(f->out);
+    mem_free(f->path);
+    mem_free(f->display);
+    mem_free(f);
+}
+
+static void batch_done(void *data) {
+    cli_batch_t *b = data;
+    for (i32 i = 0; i < b->count; i++) {
+        if (cli.file_count == cli.file_cap) {
+            i32 cap = max(256, cli.file_cap * 2);
+            cli_file_t **files = mem_realloc(cli.files, (usize)cap * sizeof(*files));
+            if (!files) {
+                cli.failed++;
+                file_free(b->files[i]);
+                continue;
+            }
+            cli.files = files;
+            cli.file_cap = cap;
+        }
+        cli.files[cli.file_count++] = b->files[i];
+    }
+    mem_free(b);
+}
+
+static void submit(cli_batch_t **batch) {
+    cli_batch_t *b = *batch;
+    *batch = NULL;
+    if (b && !jobs_submit(JOB_INTERACTIVE, batch_job, batch_done, b)) {
+        cli.failed += b->count;
+        for (i32 i = 0; i < b->count; i++) {
+            file_free(b->files[i]);
+        }
+        mem_free(b);
+    }
+}
+
+static char *copy(const char *s) {
+    usize len = strlen(s) + 1;
+    char *p = mem_alloc(len);
+    if (p) {
+        memcpy(p, s, len);
+    }
+    return p;
+}
+
+// Queues a file found by the scan, in a batch of files from the same root.
+static void add_file(workspace_t *ws, i32 node, cli_batch_t **batch) {
+    vfs_t *vfs = workspace_vfs(ws, node);
+    if (*batch && ((*batch)->vfs != vfs || (*batch)->count == CLI_BATCH)) {
+        submit(batch);
+    }
+    if (!*batch && (*batch = mem_alloc(sizeof(**batch))) != NULL) {
+        **batch = (cli_batch_t){.vfs = vfs};
+    }
+    cli_file_t *f = *batch ? mem_alloc(sizeof(*f)) : NULL;
+    if (f) {
+        // the workspace's string pool moves as the scan goes on
+        *f = (cli_file_t){.path = copy(workspace_rel_path(ws, node)), .display = copy(workspace_display(ws, node))};
+    }
+    if (!f || !f->path || !f->display) {
+        cli.failed++;
+        if (f) {
+            file_free(f);
+        }
+        return;
+    }
+    (*batch)->files[(*batch)->count++] = f;
+}
+
+static void add_node(workspace_t *ws, i32 node, cli_batch_t **batch) {
+    if (workspace_is_file(ws, node)) {
+        add_file(ws, node, batch);
+    }
+}
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp((*(cli_file_t *const *)a)->display, (*(cli_file_t *const *)b)->display);
+}
+
+static i32 usage(void) {
+    fprintf(stderr,
+            "Usage: afaire-cli [--done | --all] [--tag #tag] [--check] [--json] [--no-uring] <folder|archive.tar> "
+            "[...]\n"
+            "Lists the open tasks, or the done ones, or all; --check marks the open ones listed as done.\n");
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    const char *roots[SCAN_MAX_ROOTS];
+    i32 root_count = 0;
+    bool posix_io = false;
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--done") == 0) {
+            cli.show = SHOW_DONE;
+        } else if (strcmp(argv[i], "--all") == 0) {
+            cli.show = SHOW_ALL;
+        } else if (strcmp(argv[i], "--tag") == 0 && i + 1 < argc) {
+            cli.tag = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0) {
+            cli.check = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            cli.json = true;
+        } else if (strcmp(argv[i], "--no-uring") == 0) {
+            posix_io = true;
+        } else if (argv[i][0] == '-' || root_count == SCAN_MAX_ROOTS) {
+            return usage();
+        } else {
+            roots[root_count++] = argv[i];
+        }
+    }
+    if (root_count == 0 || (cli.check && cli.show != SHOW_OPEN)) {
+        return usage();
+    }
+    cli.tag_len = cli.tag ? (i32)strlen(cli.tag) : 0;
+
+    fileio_init(posix_io);
+    jobs_init();
+    vfs_t *vfs[SCAN_MAX_ROOTS];
+    for (i32 i = 0; i < root_count; i++) {
+        vfs[i] = vfs_open(roots[i]);
+        if (!vfs[i]) {
+            fprintf(stderr, "afaire-cli: could not open %s\n", roots[i]);
+            cli.failed++;
+        } else if (cli.check && vfs[i]->read_only) {
+            fprintf(stderr, "afaire-cli: %s is read-only\n", roots[i]);
+            vfs_close(vfs[i]);
+            vfs[i] = NULL;
+            cli.failed++;
+        }
+    }
+    // a running afaire's index of the same folders saves the scan
+    workspace_t ws;
+    workspace_open(&ws, roots, vfs, root_count, true);
+
+    // nodes are scan keys, handed out to workers in any order: a node below `scanned` may still be missing, and is
+    // looked at again each poll until it shows up
+    i32 *missing = NULL;
+    i32 missing_count = 0, missing_cap = 0, scanned = 0;
+    cli_batch_t *batch = NULL;
+    // a running afaire's index is copied in whole, unless its writer held it through workspace_open()'s tries:
+    // then the polls below catch up, like the app's do
+    bool caught_up = !ws.shared;
+    i32 sync_tries = 0;
+    // at least once: the scan may have finished in workspace_open()'s own poll, or the index been copied there
+    do {
+        u32 finished = jobs_finished();
+        bool progress = workspace_poll(&ws);
+        caught_up = caught_up || ws.share_seq == share_seq(ws.share);
+        if (!caught_up && ++sync_tries == CLI_SYNC_TRIES) {
+            fprintf(stderr, "afaire-cli: the shared index kept changing, some files may be missing\n");
+            cli.failed++;
+            caught_up = true;
+        }
+        i32 kept = 0;
+        for (i32 k = 0; k < missing_count; k++) {
+            i32 i = missing[k];
+            if (i < ws.node_count && (ws.nodes[i].flags & WS_PRESENT)) {
+                add_node(&ws, i, &batch);
+            } else {
+                missing[kept++] = i;
+            }
+        }
+        missing_count = kept;
+        for (; scanned < ws.node_count; scanned++) {
+            if (ws.nodes[scanned].flags & WS_PRESENT) {
+                add_node(&ws, scanned, &batch);
+                continue;
+            }
+            if (missing_count == missing_cap) {
+                i32 cap = max(64, missing_cap * 2);
+                i32 *grown = mem_realloc(missing, (usize)cap * sizeof(*grown));
+                if (!grown) {
+                    cli.failed++;
+                    continue;
+                }
+                missing = grown;
+                missing_cap = cap;
+            }
+            missing[missing_count++] = scanned;
+        }
+        // a partial batch waits for more files, until the scan is over
+        if (batch && (!ws.scanning || batch->count == CLI_BATCH)) {
+            submit(&batch);
+        }
+        progress |= jobs_poll() > 0;
+        if (!progress) {
+            // scan listings and file batches are jobs, so whatever comes next comes with a job finishing
+            jobs_wait(finished, caught_up ? CLI_IDLE_WAIT_NS : CLI_SYNC_WAIT_NS);
+        }
+    } while (ws.scanning || !caught_up || batch || jobs_pending() > 0);
+    jobs_shutdown();
+    mem_free(missing);
+
+    // the same order every run, whichever worker finished first
+    if (cli.file_count > 1) {
+        qsort(cli.files, (usize)cli.file_count, sizeof(*cli.files), compare_files);
+    }
+    for (i32 i = 0; i < cli.file_count; i++) {
+        cli_file_t *f = cli.files[i];
+        if (f->conflict) {
+            // its tasks weren't checked: listing them as done would be wrong
+            fprintf(stderr, "afaire-cli: %s changed on disk while it was read, left as it was\n", f->display);
+            cli.failed++;
+        } else if (f->error != 0) {
+            fprintf(stderr, "afaire-cli: could not %s %s\n", f->changed ? "write" : "read", f->display);
+            cli.failed++;
+        } else if (f->out_len > 0) {
+            fwrite(f->out, 1, (usize)f->out_len, stdout);
+        }
+        file_free(f);
+    }
+    mem_free(cli.files);
+    workspace_free(&ws);
+    return cli.failed > 0 ? 1 : 0;
+}
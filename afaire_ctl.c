@@ -0,0 +1,121 @@
+// afaire-ctl: sends commands to a running `afaire --ctl` and prints the replies.
+//
+//   afaire-ctl add "project 1/todo.md" call the bank
+//   afaire-ctl tasks todo.md
+//   printf 'toggle todo.md 3\ntoggle todo.md 4\n' | afaire-ctl
+//
+// Exits 1 when a command fails, 2 when afaire can't be reached.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "base.h"
+#include "ctl.h"
+
+static bool write_all(int fd, const char *data, usize len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            return false;
+        }
+        data += n;
+        len -= (usize)n;
+    }
+    return true;
+}
+
+// The command from the arguments, quoting those with spaces the way afaire splits them.
+static bool send_args(int fd, char **argv, i32 argc) {
+    char line[CTL_MAX_LINE];
+    usize len = 0;
+    for (i32 i = 0; i < argc; i++) {
+        bool quote = argv[i][0] == '\0' || strpbrk(argv[i], " \t\"") != NULL;
+        if (len + 2 >= sizeof(line)) {
+            return false;
+        }
+        if (i > 0) {
+            line[len++] = ' ';
+        }
+        if (quote) {
+            line[len++] = '"';
+        }
+        for (const char *c = argv[i]; *c; c++) {
+            if (len + 4 >= sizeof(line) || *c == '\n') {
+                return false;
+            }
+            if (quote && (*c == '"' || *c == '\\')) {
+                line[len++] = '\\';
+            }
+            line[len++] = *c;
+        }
+        if (quote) {
+            line[len++] = '"';
+        }
+    }
+    line[len++] = '\n';
+    return write_all(fd, line, len);
+}
+
+static bool send_stdin(int fd) {
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+        if (!write_all(fd, buf, (usize)n)) {
+            return false;
+        }
+    }
+    return n == 0;
+}
+
+int main(int argc, char *argv[]) {
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    ctl_default_path(path, sizeof(path));
+    i32 first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        snprintf(path, sizeof(path), "%s", argv[2]);
+        first = 3;
+    } else if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf("Usage: afaire-ctl [-s socket] [add <file> <text> | toggle <file> <line> | tasks <file> | open <file>]\n"
+               "Without a command, sends the commands read from stdin, one per line.\n");
+        return 0;
+    }
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "afaire-ctl: can't connect to %s, is afaire running with --ctl?\n", path);
+        return 2;
+    }
+    // everything is sent before the replies are read: afaire answers a batch at once
+    bool sent = first < argc ? send_args(fd, argv + first, argc - first) : send_stdin(fd);
+    shutdown(fd, SHUT_WR);
+    if (!sent) {
+        fprintf(stderr, "afaire-ctl: can't send the command\n");
+        close(fd);
+        return 2;
+    }
+
+    // a reply line may straddle two reads: its first bytes are matched as they come
+    static const char error[] = "error";
+    bool failed = false;
+    i32 matched = 0;  // of `error` at the start of the current line, -1 once it can't match
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                matched = 0;
+            } else if (matched >= 0 && matched < 5) {
+                matched = buf[i] == error[matched] ? matched + 1 : -1;
+                failed |= matched == 5;
+            }
+        }
+        fwrite(buf, 1, (usize)n, stdout);
+    }
+    close(fd);
+    return failed ? 1 : 0;
+}
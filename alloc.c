@@ -0,0 +1,150 @@
+#include "alloc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_CAP (64 * 1024)
+
+// Allocations that didn't fit in the arena, freed at the next reset.
+typedef struct overflow {
+    struct overflow *next;
+} overflow_t;
+
+#define OVERFLOW_HEADER ((sizeof(overflow_t) + ARENA_ALIGN - 1) & ~(usize)(ARENA_ALIGN - 1))
+
+static struct {
+    u8 *base;
+    usize cap;
+    usize used;
+    usize demand;  // bytes asked for this frame, overflow included
+    overflow_t *overflow;
+} arena;
+
+static alloc_stats_t stats;
+
+static _Thread_local u32 counts[ALLOC_SOURCE_COUNT];
+static _Thread_local u64 bytes;
+
+static inline void count(alloc_source_t source, usize size) {
+    counts[source]++;
+    bytes += size;
+}
+
+void *mem_alloc(usize size) {
+    count(ALLOC_APP, size);
+    return malloc(size);
+}
+
+void *mem_realloc(void *p, usize size) {
+    count(ALLOC_APP, size);
+    return realloc(p, size);
+}
+
+void mem_free(void *p) {
+    free(p);
+}
+
+void *alloc_imgui(usize size, void *user) {
+    (void)user;
+    count(ALLOC_IMGUI, size);
+    return malloc(size);
+}
+
+void alloc_imgui_free(void *p, void *user) {
+    (void)user;
+    free(p);
+}
+
+void *alloc_sokol(usize size, void *user) {
+    (void)user;
+    count(ALLOC_SOKOL, size);
+    return malloc(size);
+}
+
+void alloc_sokol_free(void *p, void *user) {
+    (void)user;
+    free(p);
+}
+
+void *frame_alloc(usize size) {
+    size = (size + ARENA_ALIGN - 1) & ~(usize)(ARENA_ALIGN - 1);
+    arena.demand += size;
+    if (arena.used + size <= arena.cap) {
+        void *p = arena.base + arena.used;
+        arena.used += size;
+        return p;
+    }
+    overflow_t *o = mem_alloc(OVERFLOW_HEADER + size);
+    if (!o) {
+        return NULL;
+    }
+    o->next = arena.overflow;
+    arena.overflow = o;
+    return (u8 *)o + OVERFLOW_HEADER;
+}
+
+char *frame_printf(const char *fmt, ...) {
+    va_list args, copy;
+    va_start(args, fmt);
+    va_copy(copy, args);
+    i32 len = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    char *s = len >= 0 ? frame_alloc((usize)len + 1) : NULL;
+    if (s) {
+        vsnprintf(s, (usize)len + 1, fmt, args);
+    }
+    va_end(args);
+    return s;
+}
+
+static void arena_reset(void) {
+    while (arena.overflow) {
+        overflow_t *next = arena.overflow->next;
+        mem_free(arena.overflow);
+        arena.overflow = next;
+    }
+    if (arena.demand > arena.cap) {
+        usize cap = max(arena.demand + arena.demand / 2, (usize)ARENA_MIN_CAP);
+        u8 *base = mem_alloc(cap);
+        if (base) {
+            mem_free(arena.base);
+            arena.base = base;
+            arena.cap = cap;
+        }
+    }
+    stats.arena_cap = arena.cap;
+    stats.arena_peak = max(stats.arena_peak, arena.demand);
+    arena.used = 0;
+    arena.demand = 0;
+}
+
+void alloc_frame_begin(void) {
+    arena_reset();
+}
+
+void alloc_frame_end(void) {
+    alloc_frame_t f = {.frame = stats.frames++, .bytes = bytes};
+    memcpy(f.count, counts, sizeof(counts));
+    stats.last = f;
+    if (f.count[ALLOC_APP] + f.count[ALLOC_IMGUI] + f.count[ALLOC_SOKOL] > 0) {
+        stats.allocating_frames++;
+        stats.log[stats.log_count++ % ALLOC_LOG_SIZE] = f;
+    }
+    // allocations made between frames, in event callbacks, go to the next one
+    memset(counts, 0, sizeof(counts));
+    bytes = 0;
+}
+
+const alloc_stats_t *alloc_stats(void) {
+    return &stats;
+}
+
+void alloc_shutdown(void) {
+    arena.demand = 0;
+    arena_reset();
+    mem_free(arena.base);
+    memset(&arena, 0, sizeof(arena));
+}
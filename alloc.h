@@ -0,0 +1,53 @@
+#ifndef AFAIRE_ALLOC_H
+#define AFAIRE_ALLOC_H
+
+#include "base.h"
+
+#define ALLOC_LOG_SIZE 8
+
+typedef enum {
+    ALLOC_APP,
+    ALLOC_IMGUI,
+    ALLOC_SOKOL,
+    ALLOC_SOURCE_COUNT,
+} alloc_source_t;
+
+// Heap allocations made on the UI thread during one frame.
+typedef struct {
+    u64 frame;
+    u32 count[ALLOC_SOURCE_COUNT];
+    u64 bytes;
+} alloc_frame_t;
+
+typedef struct {
+    u64 frames;
+    u64 allocating_frames;
+    alloc_frame_t last;
+    alloc_frame_t log[ALLOC_LOG_SIZE];  // the most recent frames that allocated, as a ring
+    i32 log_count;
+    usize arena_cap;
+    usize arena_peak;
+} alloc_stats_t;
+
+// afaire's own heap allocations; counted per thread, reported for the UI thread.
+void *mem_alloc(usize size);
+void *mem_realloc(void *p, usize size);
+void mem_free(void *p);
+
+// Counting hooks for igSetAllocatorFunctions() and the sokol allocator descriptors.
+void *alloc_imgui(usize size, void *user);
+void alloc_imgui_free(void *p, void *user);
+void *alloc_sokol(usize size, void *user);
+void alloc_sokol_free(void *p, void *user);
+
+// UI-thread scratch that lives until the next alloc_frame_begin(). The arena grows to the busiest frame seen, so a
+// steady workload stops touching the heap after a frame.
+void *frame_alloc(usize size);
+char *frame_printf(const char *fmt, ...);
+
+void alloc_frame_begin(void);
+void alloc_frame_end(void);
+const alloc_stats_t *alloc_stats(void);
+void alloc_shutdown(void);
+
+#endif
@@ -0,0 +1,2104 @@
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include "app.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "cimgui.h"
+#include "crdt.h"
+#include "ctl.h"
+#include "diff.h"
+#include "fileio.h"
+#include "hash.h"
+#include "history.h"
+#include "jobs.h"
+#include "latency.h"
+#include "prefetch.h"
+#include "prof.h"
+#include "prof_overlay.h"
+#include "share.h"
+#include "task.h"
+#include "text.h"
+#include "text_edit.h"
+#include "vfs.h"
+#include "workspace.h"
+
+#define DEFAULT_FILE_PANE_SIZE 150
+#define MAX_EDITORS 16
+#define MAX_STRING_LENGTH 256
+#define FINDER_PREFETCH 3  // finder results read ahead, from the top
+#define CTL_FILES 8        // files without an editor a batch of control commands keeps loaded
+#define BUFFER_SIZE 1024
+// backgrounds of the diff view's removed and added lines
+#define DIFF_REMOVED_BG 0x603c3cc8u
+#define DIFF_ADDED_BG 0x6050aa3cu
+
+typedef struct {
+    bool display;
+} markdown_renderer_t;
+
+typedef struct {
+    bool active;
+    bool dirty;
+    i32 node;
+    text_t text;
+    u32 changes;  // bumped by every change to `text`, for the views that follow it
+    edit_state_t edit;
+    highlight_t highlight;
+    // what `path` held when it was last read or written, to skip redundant saves and reloads
+    bool on_disk;
+    u64 disk_hash;
+    i64 disk_mtime;
+    i64 disk_size;
+    // reads and saves run on the job pool; a result for an older serial is dropped, the editor moved to another file
+    u32 io_serial;
+    bool io_busy;
+    bool save_queued;  // asked to save while busy
+    bool io_reading;   // the job in flight is a read, which will replace the buffer
+    bool ctl_save;     // clean until a control command changed it: saved once the batch has run
+    // edits exchanged with the other afaire windows that have the file open, NULL when none can
+    share_log_t *log;
+    crdt_t crdt;
+    char filename[MAX_STRING_LENGTH];
+    char selected_filename[MAX_STRING_LENGTH];
+    vfs_t *vfs;  // the root holding the file, NULL for scratch
+    char path[BUFFER_SIZE];  // within `vfs`
+} editor_t;
+
+typedef struct {
+    i32 node;
+    i32 depth;
+} file_row_t;
+
+typedef struct {
+    bool display;
+    bool new_file_popup;
+    bool fuzzy_finder_popup;
+    workspace_t workspace;
+    file_row_t *rows;  // expanded part of the tree, flattened for clipping
+    i32 row_count;
+    i32 row_cap;
+    u32 rows_generation;
+    bool rows_dirty;
+} file_pane_t;
+
+typedef struct {
+    bool display;
+    bool profiler;
+    u32 writes;
+    u32 skipped_writes;
+    u32 reloads;
+    u32 skipped_reloads;
+    u64 shared_sent;
+    u64 shared_received;
+    u32 shared_restarts;  // logs this window started over from its state
+    u32 shared_rejoins;   // logs another window started over
+    app_render_stats_t render_shown;  // refreshed once a second, so an open panel doesn't redraw every frame
+    app_render_stats_t render_last;
+    f64 render_shown_at;
+} debug_panel_t;
+
+typedef struct ctl_io ctl_io_t;
+
+// A file the control socket changes while no editor has it open: read on first use, written back after the batch,
+// both on the job pool.
+typedef struct {
+    i32 node;
+    text_t text;
+    ctl_io_t *io;  // the read or save in flight
+    bool loading;
+    bool failed;   // could not be read
+    bool changed;  // since the last save started
+    // the file as read or last saved, for the save to find out whether it changed on disk since
+    u64 disk_hash;
+    i64 disk_mtime;
+    i64 disk_size;
+} ctl_file_t;
+
+// The saved versions of the current editor's file, newest first, and the one shown.
+typedef struct {
+    bool display;
+    editor_t *editor;  // listed for
+    i32 node;
+    u64 disk_hash;  // the editor's when listed: a save relists
+    // of the last jobs submitted, older results are dropped
+    u32 list_serial;
+    u32 read_serial;
+    history_version_t *versions;
+    i32 count;
+    u32 selected;  // version ids, UINT32_MAX for none
+    u32 shown;     // of `text`
+    char *text;
+    i32 len;
+} history_view_t;
+
+typedef enum {
+    DIFF_DISK,
+    DIFF_VERSION,  // the one selected in the history
+} diff_base_t;
+
+typedef struct diff_job diff_job_t;
+
+// The current editor's buffer against its file on disk or a saved version, redone on a worker as it changes.
+typedef struct {
+    bool display;
+    i32 base;  // diff_base_t, as the radio buttons take it
+    // what `diff` compares
+    editor_t *editor;
+    i32 node;
+    u32 changes;
+    i32 shown_base;
+    u64 base_key;  // the disk hash or the version id
+    bool failed;   // the base couldn't be read
+    char *old;
+    i32 old_len;
+    char *new;  // a copy of the buffer
+    i32 new_len;
+    diff_t diff;
+    diff_job_t *job;  // in flight
+    i32 hunk;         // the last jumped to
+    i32 scroll_row;   // to bring into view next frame, -1 for none
+} diff_view_t;
+
+typedef struct {
+    ctl_file_t files[CTL_FILES];
+    i32 file_count;
+    // the last path looked up: scripts tend to send many commands for one file
+    char last_path[BUFFER_SIZE];
+    i32 last_node;
+    u32 last_generation;
+    u64 commands;
+} ctl_state_t;
+
+static struct {
+    char error_message[MAX_STRING_LENGTH];
+    bool quit;
+    markdown_renderer_t markdown_renderer;
+    debug_panel_t debug;
+    app_render_stats_t render;
+    editor_t editor[MAX_EDITORS];
+    file_pane_t file_pane;
+    ctl_state_t ctl;
+    history_t *history[SCAN_MAX_ROOTS];  // saved versions, for the roots that are folders on disk; NULL otherwise
+    history_view_t history_view;
+    diff_view_t diff_view;
+} state;
+
+// One read or save of an editor's file. A worker does the disk access and fills in the result, which is applied
+// when the job completes, at the start of a frame.
+typedef struct {
+    editor_t *editor;
+    u32 serial;
+    vfs_t *vfs;
+    char path[BUFFER_SIZE];
+    // what the editor knew of the file when the job was submitted
+    bool on_disk;
+    u64 disk_hash;
+    i64 disk_mtime;
+    i64 disk_size;
+    // read: the file's contents; save: a copy of the text to write
+    char *data;
+    i32 len;
+    u64 hash;
+    i64 mtime;
+    bool unchanged;  // nothing needed reading or writing
+    bool conflict;   // save: the file changed on disk since it was read, and wasn't overwritten
+    i64 conflict_size;
+    bool failed;
+    bool too_large;
+    history_t *history;  // save: where the overwritten and the written versions go, NULL when they're not kept
+    // read: the file's edit log when it's shared with other windows, set to join it, and the text with their unsaved
+    // edits when it differs from the file
+    char share_path[BUFFER_SIZE];
+    share_log_t *log;
+    crdt_t crdt;
+    char *merged;
+} file_io_t;
+
+static editor_t *current_editor;
+
+void app_init(const char *const *roots, vfs_t *const *vfs, i32 root_count) {
+    jobs_init();
+    state.error_message[0] = '\0';
+    state.quit = false;
+    state.markdown_renderer = (markdown_renderer_t){.display = true};
+    state.file_pane = (file_pane_t){.display = true, .new_file_popup = false, .fuzzy_finder_popup = false};
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        state.editor[i] = (editor_t){.active = false,
+                                     .dirty = false,
+                                     .node = WS_NONE,
+                                     .filename = {0},
+                                     .selected_filename = {0},
+                                     .path = {0}};
+        text_init(&state.editor[i].text);
+        edit_state_reset(&state.editor[i].edit);
+        highlight_reset(&state.editor[i].highlight, &state.editor[i].text);
+    }
+    current_editor = &state.editor[0];
+    strncpy(current_editor->filename, "*scratch*", MAX_STRING_LENGTH);
+    current_editor->active = true;
+
+    if (root_count > 0 && !workspace_open(&state.file_pane.workspace, roots, vfs, root_count, true)) {
+        snprintf(state.error_message, sizeof(state.error_message), "Could not scan %s", roots[0]);
+    }
+    for (i32 i = 0; i < root_count; i++) {
+        if (!vfs[i]) {
+            snprintf(state.error_message, sizeof(state.error_message), "Could not open %s", roots[i]);
+        } else if (vfs[i]->lock) {
+            // NULL when the store can't be created: saving goes on without it
+            state.history[i] = history_open(roots[i]);
+        }
+    }
+    state.history_view = (history_view_t){.node = WS_NONE, .selected = UINT32_MAX, .shown = UINT32_MAX};
+    state.diff_view = (diff_view_t){.node = WS_NONE, .hunk = -1, .scroll_row = -1};
+}
+
+static const char *editor_name(const editor_t *editor) {
+    if (workspace_is_file(&state.file_pane.workspace, editor->node)) {
+        return workspace_name(&state.file_pane.workspace, editor->node);
+    }
+    return editor->filename;
+}
+
+static void set_dirty(editor_t *editor, bool dirty, bool force) {
+    if (force || editor->dirty != dirty) {
+        editor->dirty = dirty;
+        snprintf(editor->selected_filename, sizeof(editor->selected_filename), "%s%s", dirty ? "* " : "  ",
+                 editor_name(editor));
+    }
+}
+
+// Only a buffer as long as the file can match it, so most keystrokes never hash.
+static bool buffer_differs(const editor_t *editor) {
+    if (editor->on_disk && editor->text.len == editor->disk_size) {
+        return hash64(editor->text.data, (usize)editor->text.len, 0) != editor->disk_hash;
+    }
+    return true;
+}
+
+//=== Shared editing
+
+// Another window saved the file: what it wrote is the file as this one knows it, so saving here isn't a conflict.
+// Appended to the file's log next to the edits.
+#define SAVED_RECORD 's'
+typedef struct {
+    u8 kind;
+    u8 pad[7];
+    i64 mtime;
+    i64 size;
+    u64 hash;
+} saved_record_t;
+
+typedef struct {
+    editor_t *editor;
+    crdt_t *crdt;
+    bool replay;  // catching up on joining, maybe on a worker: the buffer is set from the result
+    bool failed;
+} share_ctx_t;
+
+static void share_stop(editor_t *editor) {
+    share_log_close(editor->log);
+    editor->log = NULL;
+    crdt_free(&editor->crdt);
+}
+
+static void share_failed(editor_t *editor) {
+    snprintf(state.error_message, sizeof(state.error_message),
+             "Stopped sharing the edits of %s with other windows, the last save wins", editor->filename);
+    share_stop(editor);
+}
+
+static void share_emit(void *user, const u8 *op, i32 len) {
+    share_ctx_t *ctx = user;
+    ctx->failed |= !share_log_append(ctx->editor->log, op, (u32)len);
+    state.debug.shared_sent++;
+}
+
+// A change made in this window, which the others merge into theirs.
+static void share_edit(editor_t *editor, i32 pos, i32 removed, i32 inserted) {
+    if (!editor->log) {
+        return;
+    }
+    share_ctx_t ctx = {.editor = editor, .crdt = &editor->crdt};
+    const char *ins = editor->text.data + pos;
+    if (!crdt_replace(&editor->crdt, pos, removed, ins, inserted, share_emit, &ctx) || ctx.failed) {
+        share_failed(editor);
+    }
+}
+
+static void share_change(void *user, i32 pos, i32 removed, const char *ins, i32 ins_len) {
+    share_ctx_t *ctx = user;
+    editor_t *editor = ctx->editor;
+    if (ctx->replay) {
+        return;
+    }
+    if (!text_replace(&editor->text, pos, removed, ins, ins_len)) {
+        ctx->failed = true;
+        return;
+    }
+    highlight_edit(&editor->highlight, &editor->text, pos, removed, ins_len);
+    edit_state_external(&editor->edit, pos, removed, ins_len);
+    editor->changes++;
+}
+
+static void share_record(void *user, const u8 *rec, u32 len) {
+    share_ctx_t *ctx = user;
+    if (len == sizeof(saved_record_t) && rec[0] == SAVED_RECORD) {
+        saved_record_t saved;
+        memcpy(&saved, rec, sizeof(saved));
+        // the file as read on joining is newer than any save before
+        if (!ctx->replay) {
+            editor_t *editor = ctx->editor;
+            editor->on_disk = true;
+            editor->disk_hash = saved.hash;
+            editor->disk_mtime = saved.mtime;
+            editor->disk_size = saved.size;
+        }
+        return;
+    }
+    ctx->failed |= !crdt_apply(ctx->crdt, rec, (i32)len, share_change, ctx);
+    if (!ctx->replay) {
+        state.debug.shared_received++;
+    }
+}
+
+// Joins the windows already editing `path`, or starts its log with `data` as just read, filling in `crdt`. Sets
+// `merged` to the text with their unsaved edits when it isn't `data`, `crdt->len` bytes. This copies the whole file a
+// few times, so it runs on the worker that read it.
+static share_log_t *share_join(const char *path, const char *data, i32 len, crdt_t *crdt, char **merged) {
+    *merged = NULL;
+    // the first record holds the whole file, from client 0
+    crdt_init(crdt, 0);
+    share_log_t *log = NULL;
+    bool created = false;
+    if (crdt_replace(crdt, 0, 0, data, len, NULL, NULL)) {
+        log = share_log_open(path, crdt->op, (u32)crdt->op_len, &created);
+    }
+    if (!log) {
+        crdt_free(crdt);
+        return NULL;
+    }
+    u32 client = share_log_client(log);
+    if (created) {
+        // the log's first record is this document, which the replay skips
+        crdt->client = client;
+        crdt->clock = 0;
+    } else {
+        crdt_free(crdt);
+        crdt_init(crdt, client);
+    }
+    share_ctx_t ctx = {.crdt = crdt, .replay = true};
+    ctx.failed = share_log_replay(log, share_record, &ctx) < 0;
+    char *text = !ctx.failed && !created ? mem_alloc((usize)crdt->len + 1) : NULL;
+    if (text) {
+        crdt_text(crdt, text);
+        if (crdt->len != len || memcmp(text, data, (usize)len) != 0) {
+            *merged = text;
+        } else {
+            mem_free(text);
+        }
+    }
+    if (ctx.failed || (!created && !text)) {
+        share_log_close(log);
+        crdt_free(crdt);
+        return NULL;
+    }
+    return log;
+}
+
+// For a file whose read didn't join the log. Only roots other processes can write are shared, those with save
+// locks.
+static void share_start(editor_t *editor) {
+    if (editor->log || !editor->vfs->lock) {
+        return;
+    }
+    char *merged;
+    const char *path = workspace_path(&state.file_pane.workspace, editor->node);
+    editor->log = share_join(path, editor->text.data, editor->text.len, &editor->crdt, &merged);
+    if (merged) {
+        text_set(&editor->text, merged, editor->crdt.len);
+        editor->changes++;
+        mem_free(merged);
+    }
+}
+
+// Another window started the log over from its state, which holds every edit this one made: the replica is rebuilt
+// from the log, and the edits this window hadn't read yet go into the buffer as one change.
+static bool share_rejoin(editor_t *editor) {
+    crdt_t crdt;
+    crdt_init(&crdt, editor->crdt.client);
+    crdt.clock = editor->crdt.clock;
+    share_ctx_t ctx = {.crdt = &crdt, .replay = true};
+    ctx.failed = share_log_replay(editor->log, share_record, &ctx) < 0;
+    char *text = !ctx.failed ? mem_alloc((usize)crdt.len + 1) : NULL;
+    if (!text) {
+        crdt_free(&crdt);
+        return false;
+    }
+    crdt_text(&crdt, text);
+    const text_t *t = &editor->text;
+    i32 prefix = 0, suffix = 0;
+    while (prefix < min(t->len, crdt.len) && t->data[prefix] == text[prefix]) {
+        prefix++;
+    }
+    while (suffix < min(t->len, crdt.len) - prefix && t->data[t->len - 1 - suffix] == text[crdt.len - 1 - suffix]) {
+        suffix++;
+    }
+    i32 removed = t->len - prefix - suffix, ins_len = crdt.len - prefix - suffix;
+    bool ok = (removed == 0 && ins_len == 0) || text_replace(&editor->text, prefix, removed, text + prefix, ins_len);
+    if (ok && (removed > 0 || ins_len > 0)) {
+        highlight_edit(&editor->highlight, &editor->text, prefix, removed, ins_len);
+        edit_state_external(&editor->edit, prefix, removed, ins_len);
+        editor->changes++;
+    }
+    mem_free(text);
+    if (!ok) {
+        crdt_free(&crdt);
+        return false;
+    }
+    crdt_free(&editor->crdt);
+    editor->crdt = crdt;
+    return true;
+}
+
+// Merges what the other windows did since the last frame, and starts the log over from this window's state once it
+// holds a lot more than the text.
+static void share_poll(void) {
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        editor_t *editor = &state.editor[i];
+        share_ctx_t ctx = {.editor = editor, .crdt = &editor->crdt};
+        i32 read = editor->log ? share_log_read(editor->log, share_record, &ctx) : 0;
+        if (read == SHARE_LOG_RESTARTED) {
+            ctx.failed = !share_rejoin(editor);
+            state.debug.shared_rejoins++;
+        }
+        if (ctx.failed) {
+            share_failed(editor);
+        } else if (editor->log && share_log_crowded(editor->log, (u32)crdt_saved_size(&editor->crdt)) &&
+                   crdt_save(&editor->crdt) &&
+                   share_log_restart(editor->log, editor->crdt.op, (u32)editor->crdt.op_len)) {
+            state.debug.shared_restarts++;
+        }
+        if (read != 0) {
+            set_dirty(editor, buffer_differs(editor), false);
+        }
+    }
+}
+
+static void share_saved(editor_t *editor) {
+    saved_record_t saved = {SAVED_RECORD, {0}, editor->disk_mtime, editor->disk_size, editor->disk_hash};
+    if (editor->log && !share_log_append(editor->log, &saved, sizeof(saved))) {
+        share_failed(editor);
+    }
+}
+
+static bool disk_unchanged(const file_io_t *io, i64 mtime, i64 size) {
+    return io->on_disk && io->disk_mtime == mtime && io->disk_size == size;
+}
+
+static file_io_t *file_io_new(editor_t *editor) {
+    file_io_t *io = mem_alloc(sizeof(*io));
+    if (io) {
+        *io = (file_io_t){.editor = editor,
+                          .serial = editor->io_serial,
+                          .vfs = editor->vfs,
+                          .on_disk = editor->on_disk,
+                          .disk_hash = editor->disk_hash,
+                          .disk_mtime = editor->disk_mtime,
+                          .disk_size = editor->disk_size};
+        snprintf(io->path, sizeof(io->path), "%s", editor->path);
+    }
+    return io;
+}
+
+static void read_job(void *data) {
+    file_io_t *io = data;
+    fileio_req_t req = {.op = FILEIO_STAT, .path = io->path};
+    vfs_run(io->vfs, &req, 1);
+    if (req.error == 0 && disk_unchanged(io, req.mtime, req.size)) {
+        io->mtime = req.mtime;
+        io->unchanged = true;
+        return;
+    }
+    // a prefetched copy stands for the file as long as its size and mtime are those it was read with
+    if (!io->data || req.error != 0 || req.mtime != io->mtime || req.size != io->len) {
+        mem_free(io->data);
+        req.op = FILEIO_READ;
+        vfs_run(io->vfs, &req, 1);
+        io->failed = req.error != 0 && req.error != EFBIG;
+        io->too_large = req.error == EFBIG;
+        io->data = req.data;
+        io->len = req.len;
+        io->mtime = req.mtime;
+        if (req.data) {
+            io->hash = hash64(req.data, (usize)req.len, 0);
+        }
+    }
+    if (io->data && io->share_path[0]) {
+        io->log = share_join(io->share_path, io->data, io->len, &io->crdt, &io->merged);
+    }
+}
+
+static void save_job(void *data) {
+    file_io_t *io = data;
+    // another afaire saving the same file waits here, and sees below what this save wrote
+    i32 lock = vfs_lock(io->vfs, io->path);
+    fileio_req_t req = {.op = FILEIO_STAT, .path = io->path};
+    vfs_run(io->vfs, &req, 1);
+    bool same = req.error == 0 && disk_unchanged(io, req.mtime, req.size);
+    if (same && io->hash == io->disk_hash) {
+        io->mtime = req.mtime;
+        io->unchanged = true;
+    } else if (io->on_disk && req.error == 0 && !same) {
+        io->conflict = true;
+        io->mtime = req.mtime;
+        io->conflict_size = req.size;
+    } else {
+        // what's about to be overwritten, when the history doesn't have it yet: written by another program, or
+        // before afaire kept versions
+        if (io->history && req.error == 0 && !(same && history_has(io->history, io->path, io->disk_hash))) {
+            fileio_req_t old = {.op = FILEIO_READ, .path = io->path};
+            vfs_run(io->vfs, &old, 1);
+            if (old.error == 0) {
+                history_add(io->history, io->path, old.data, old.len);
+            }
+            mem_free(old.data);
+        }
+        req = (fileio_req_t){.op = FILEIO_WRITE, .path = io->path, .data = io->data, .len = io->len};
+        vfs_run(io->vfs, &req, 1);
+        io->failed = req.error != 0;
+        io->mtime = req.mtime;
+        if (io->history && !io->failed) {
+            history_add(io->history, io->path, io->data, io->len);
+        }
+    }
+    vfs_unlock(io->vfs, lock);
+}
+
+static void apply_read(editor_t *editor, file_io_t *io) {
+    if (io->failed) {
+        snprintf(state.error_message, sizeof(state.error_message), "Could not open file %s", editor->filename);
+        return;
+    }
+    if (io->too_large) {
+        snprintf(state.error_message, sizeof(state.error_message), "File %s is too large", editor->filename);
+        return;
+    }
+    // a touch or an identical rewrite changes the stat but not the content; keep the buffer and its undo history
+    if (io->unchanged || (editor->on_disk && io->hash == editor->disk_hash)) {
+        editor->disk_mtime = io->mtime;
+        state.debug.skipped_reloads++;
+        return;
+    }
+    // written by another window sharing the file: the buffer already has those edits, and maybe newer ones
+    if (editor->log) {
+        if (io->len == editor->text.len && io->hash == hash64(editor->text.data, (usize)editor->text.len, 0)) {
+            editor->on_disk = true;
+            editor->disk_hash = io->hash;
+            editor->disk_mtime = io->mtime;
+            editor->disk_size = io->len;
+            set_dirty(editor, false, false);
+        }
+        state.debug.skipped_reloads++;
+        return;
+    }
+    editor->on_disk = true;
+    editor->disk_hash = io->hash;
+    editor->disk_mtime = io->mtime;
+    editor->disk_size = io->len;
+    if (!text_set(&editor->text, io->merged ? io->merged : io->data, io->merged ? io->crdt.len : io->len)) {
+        snprintf(state.error_message, sizeof(state.error_message), "File %s is too large", editor->filename);
+    }
+    editor->changes++;
+    if (io->log) {
+        editor->log = io->log;
+        editor->crdt = io->crdt;
+        io->log = NULL;
+    } else {
+        share_start(editor);
+    }
+    edit_state_reset(&editor->edit);
+    highlight_reset(&editor->highlight, &editor->text);
+    // another window's unsaved edits leave it dirty
+    set_dirty(editor, editor->log && buffer_differs(editor), true);
+    state.debug.reloads++;
+}
+
+static void apply_save(editor_t *editor, file_io_t *io) {
+    if (io->failed) {
+        snprintf(state.error_message, sizeof(state.error_message), "Could not save file %s", editor->filename);
+        return;
+    }
+    if (io->conflict) {
+        // written by another instance or program since it was read: the next save overwrites that version
+        editor->disk_hash = 0;
+        editor->disk_mtime = io->mtime;
+        editor->disk_size = io->conflict_size;
+        snprintf(state.error_message, sizeof(state.error_message),
+                 "File %s changed on disk since it was opened, save again to overwrite it", editor->filename);
+        return;
+    }
+    if (io->unchanged) {
+        state.debug.skipped_writes++;
+    } else {
+        editor->on_disk = true;
+        editor->disk_hash = io->hash;
+        editor->disk_mtime = io->mtime;
+        editor->disk_size = io->len;
+        state.debug.writes++;
+        share_saved(editor);
+    }
+    // typing since the copy was taken leaves the buffer dirty
+    bool same = editor->text.len == io->len && hash64(editor->text.data, (usize)editor->text.len, 0) == io->hash;
+    set_dirty(editor, !same, true);
+}
+
+static void save_file(editor_t *editor);
+
+static void io_done(file_io_t *io, void (*apply)(editor_t *, file_io_t *)) {
+    editor_t *editor = io->editor;
+    if (io->serial == editor->io_serial) {
+        editor->io_busy = false;
+        apply(editor, io);
+        if (editor->save_queued) {
+            editor->save_queued = false;
+            save_file(editor);
+        }
+    }
+    // joined for an editor that moved on
+    if (io->log) {
+        share_log_close(io->log);
+        crdt_free(&io->crdt);
+    }
+    mem_free(io->merged);
+    mem_free(io->data);
+    mem_free(io);
+}
+
+static void read_done(void *data) {
+    io_done(data, apply_read);
+}
+
+static void save_done(void *data) {
+    io_done(data, apply_save);
+}
+
+static void read_file(editor_t *editor) {
+    workspace_t *ws = &state.file_pane.workspace;
+    snprintf(editor->filename, sizeof(editor->filename), "%s", workspace_display(ws, editor->node));
+    editor->vfs = workspace_vfs(ws, editor->node);
+    snprintf(editor->path, sizeof(editor->path), "%s", workspace_rel_path(ws, editor->node));
+    // the read or save in flight brings the buffer up to date
+    if (editor->io_busy) {
+        return;
+    }
+    // a tab brought back to the front only stats its file, skipping the read when nothing changed, and so does a file
+    // in the prefetch cache
+    prefetch_file_t file = {0};
+    if (!editor->on_disk) {
+        prefetch_take(editor->vfs, editor->path, &file);
+    }
+    file_io_t *io = file_io_new(editor);
+    if (io && file.data) {
+        io->data = file.data;
+        io->len = file.len;
+        io->hash = file.hash;
+        io->mtime = file.mtime;
+    }
+    if (io && !editor->log && editor->vfs->lock) {
+        snprintf(io->share_path, sizeof(io->share_path), "%s", workspace_path(ws, editor->node));
+    }
+    if (!io || !jobs_submit(JOB_INTERACTIVE, read_job, read_done, io)) {
+        mem_free(file.data);
+        mem_free(io);
+        snprintf(state.error_message, sizeof(state.error_message), "Could not open file %s", editor->filename);
+        return;
+    }
+    editor->io_busy = true;
+    editor->io_reading = true;
+}
+
+// Drops the results of reads and saves still in flight for the editor's previous file.
+static void editor_switch_file(editor_t *editor, i32 node) {
+    share_stop(editor);
+    editor->node = node;
+    editor->on_disk = false;
+    editor->io_serial++;
+    editor->io_busy = false;
+    editor->save_queued = false;
+}
+
+static void new_file(const char *filename) {
+    workspace_t *ws = &state.file_pane.workspace;
+    vfs_t *vfs = ws->root_count > 0 ? workspace_vfs(ws, 0) : NULL;
+    fileio_req_t req = {.op = FILEIO_WRITE, .path = filename, .data = "", .len = 0};
+    if (vfs) {
+        prefetch_forget(vfs, filename);
+        vfs_run(vfs, &req, 1);
+    }
+    if (vfs && req.error == 0) {
+        workspace_add(ws, 0, filename, false);
+    } else {
+        snprintf(state.error_message, sizeof(state.error_message), "Could not create file %s", filename);
+    }
+}
+
+static bool delete_file(i32 node) {
+    workspace_t *ws = &state.file_pane.workspace;
+    vfs_t *vfs = workspace_vfs(ws, node);
+    if (!vfs || vfs_remove(vfs, workspace_rel_path(ws, node)) != 0) {
+        snprintf(state.error_message, sizeof(state.error_message), "Could not delete file %s",
+                 workspace_name(ws, node));
+        return false;
+    }
+    prefetch_forget(vfs, workspace_rel_path(ws, node));
+    workspace_remove(ws, node);
+    return true;
+}
+
+static void save_file(editor_t *editor) {
+    if (!editor->dirty || !editor->vfs) {
+        return;
+    }
+    if (editor->io_busy) {
+        editor->save_queued = true;
+        return;
+    }
+    prefetch_forget(editor->vfs, editor->path);
+    // the worker writes a copy, so typing can go on during the save
+    text_t *text = &editor->text;
+    file_io_t *io = file_io_new(editor);
+    char *copy = io ? mem_alloc((usize)text->len + 1) : NULL;
+    if (copy) {
+        memcpy(copy, text->data, (usize)text->len);
+        io->data = copy;
+        io->len = text->len;
+        io->hash = hash64(text->data, (usize)text->len, 0);
+        io->history = state.history[state.file_pane.workspace.nodes[editor->node].root];
+    }
+    if (!copy || !jobs_submit(JOB_INTERACTIVE, save_job, save_done, io)) {
+        mem_free(copy);
+        mem_free(io);
+        snprintf(state.error_message, sizeof(state.error_message), "Could not save file %s", editor->filename);
+        return;
+    }
+    editor->io_busy = true;
+    editor->io_reading = false;
+}
+
+static void open_file_handler(i32 node) {
+    u8 first_free = (u8)-1;
+    if (!workspace_is_file(&state.file_pane.workspace, node)) {
+        return;
+    }
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        if (first_free == (u8)-1 && !state.editor[i].active || strcmp(state.editor[i].filename, "*scratch*") == 0) {
+            first_free = i;
+        }
+        if (state.editor[i].node == node) {
+            current_editor = &state.editor[i];
+            current_editor->active = true;
+            read_file(current_editor);
+            return;
+        }
+    }
+    if (first_free != (u8)-1) {
+        current_editor = &state.editor[first_free];
+        current_editor->active = true;
+        editor_switch_file(current_editor, node);
+        // empty until the read completes, rather than showing what the tab held before
+        text_set(&current_editor->text, "", 0);
+        edit_state_reset(&current_editor->edit);
+        highlight_reset(&current_editor->highlight, &current_editor->text);
+        read_file(current_editor);
+    }
+}
+
+static void prefetch_node(i32 node) {
+    workspace_t *ws = &state.file_pane.workspace;
+    prefetch_request(workspace_vfs(ws, node), workspace_rel_path(ws, node));
+}
+
+static void push_row(file_pane_t *pane, i32 node, i32 depth) {
+    if (pane->row_count == pane->row_cap) {
+        i32 cap = max(256, pane->row_cap * 2);
+        file_row_t *rows = mem_realloc(pane->rows, (usize)cap * sizeof(*rows));
+        if (!rows) {
+            return;
+        }
+        pane->rows = rows;
+        pane->row_cap = cap;
+    }
+    pane->rows[pane->row_count++] = (file_row_t){node, depth};
+}
+
+static void add_rows(file_pane_t *pane, i32 node, i32 depth) {
+    workspace_t *ws = &pane->workspace;
+    push_row(pane, node, depth);
+    if ((ws->nodes[node].flags & (WS_DIR | WS_EXPANDED)) != (WS_DIR | WS_EXPANDED)) {
+        return;
+    }
+    workspace_sort_children(ws, node);
+    for (i32 c = ws->nodes[node].first_child; c != WS_NONE; c = ws->nodes[c].next_sibling) {
+        add_rows(pane, c, depth + 1);
+    }
+}
+
+// Only expanded directories contribute rows, so collapsed subtrees cost nothing however large they are.
+static void rebuild_rows(file_pane_t *pane) {
+    workspace_t *ws = &pane->workspace;
+    pane->row_count = 0;
+    for (i32 i = 0; i < ws->root_count && i < ws->node_count; i++) {
+        if (ws->nodes[i].flags & WS_PRESENT) {
+            add_rows(pane, i, 0);
+        }
+    }
+    pane->rows_generation = ws->generation;
+    pane->rows_dirty = false;
+}
+
+static void draw_file_row(const file_row_t *row) {
+    workspace_t *ws = &state.file_pane.workspace;
+    ws_node_t *node = &ws->nodes[row->node];
+    igPushID_Int(row->node);
+    igSetCursorPosX(igGetCursorPosX() + (f32)row->depth * igGetStyle()->IndentSpacing * 0.5f);
+    if (node->flags & WS_DIR) {
+        bool expanded = (node->flags & WS_EXPANDED) != 0;
+        igSetNextItemOpen(expanded, ImGuiCond_Always);
+        if (igTreeNodeEx_Str(workspace_name(ws, row->node), ImGuiTreeNodeFlags_NoTreePushOnOpen) != expanded) {
+            node->flags ^= WS_EXPANDED;
+            state.file_pane.rows_dirty = true;
+        }
+    } else {
+        bool is_current_file = current_editor->node == row->node;
+        const char *label = frame_printf("%s###file", is_current_file ? current_editor->selected_filename
+                                                                       : workspace_name(ws, row->node));
+        if (label && igSelectable_Bool(label, is_current_file, 0, (ImVec2){0, 0})) {
+            open_file_handler(row->node);
+        }
+        if (label && igIsItemHovered(ImGuiHoveredFlags_None)) {
+            prefetch_node(row->node);
+        }
+        if (igBeginPopupContextItem(NULL, ImGuiPopupFlags_MouseButtonRight)) {
+            if (igSmallButton("Rename")) {
+                // TODO: rename function
+                igCloseCurrentPopup();
+            }
+            if (igSmallButton("Delete")) {
+                i32 node = row->node;
+                if (delete_file(node) && current_editor->node == node) {
+                    text_set(&current_editor->text, "", 0);
+                    edit_state_reset(&current_editor->edit);
+                    highlight_reset(&current_editor->highlight, &current_editor->text);
+                    editor_switch_file(current_editor, WS_NONE);
+                    current_editor->vfs = NULL;
+                    current_editor->path[0] = '\0';
+                }
+                igCloseCurrentPopup();
+            }
+            igEndPopup();
+        }
+    }
+    igPopID();
+}
+
+static void editor_callback(void *user, i32 pos, i32 removed, i32 inserted) {
+    editor_t *editor = user;
+    editor->changes++;
+    share_edit(editor, pos, removed, inserted);
+    set_dirty(editor, buffer_differs(editor), false);
+}
+
+//=== History
+
+// Lists the versions of a file, or reads one back, on a worker.
+typedef struct {
+    u32 serial;
+    history_t *history;
+    char path[BUFFER_SIZE];
+    u32 id;  // the version to read, UINT32_MAX to list
+    history_version_t *versions;
+    i32 count;
+    char *data;
+    i32 len;
+} history_job_t;
+
+static void history_job(void *data) {
+    history_job_t *job = data;
+    if (job->id == UINT32_MAX) {
+        job->count = history_list(job->history, job->path, &job->versions);
+    } else {
+        job->data = history_read(job->history, job->id, &job->len);
+    }
+}
+
+static void history_done(void *data) {
+    history_job_t *job = data;
+    history_view_t *v = &state.history_view;
+    if (job->serial == (job->id == UINT32_MAX ? v->list_serial : v->read_serial)) {
+        if (job->id == UINT32_MAX) {
+            mem_free(v->versions);
+            v->versions = job->versions;
+            v->count = max(job->count, 0);
+            job->versions = NULL;
+            if (job->count < 0) {
+                snprintf(state.error_message, sizeof(state.error_message), "Could not read the history of %s",
+                         v->editor->filename);
+            }
+        } else {
+            mem_free(v->text);
+            v->text = job->data;
+            v->len = job->len;
+            v->shown = job->data ? job->id : UINT32_MAX;
+            job->data = NULL;
+            if (!v->text) {
+                snprintf(state.error_message, sizeof(state.error_message), "Could not read that version of %s",
+                         v->editor->filename);
+            }
+        }
+    }
+    mem_free(job->versions);
+    mem_free(job->data);
+    mem_free(job);
+}
+
+static history_t *editor_history(const editor_t *editor) {
+    const workspace_t *ws = &state.file_pane.workspace;
+    return workspace_is_file(ws, editor->node) ? state.history[ws->nodes[editor->node].root] : NULL;
+}
+
+static void history_submit(editor_t *editor, u32 id) {
+    history_view_t *v = &state.history_view;
+    history_job_t *job = mem_alloc(sizeof(*job));
+    if (!job) {
+        return;
+    }
+    u32 serial = id == UINT32_MAX ? ++v->list_serial : ++v->read_serial;
+    *job = (history_job_t){.serial = serial, .history = editor_history(editor), .id = id};
+    snprintf(job->path, sizeof(job->path), "%s", editor->path);
+    if (!jobs_submit(JOB_INTERACTIVE, history_job, history_done, job)) {
+        mem_free(job);
+    }
+}
+
+// Replaces the buffer with the version shown, as one undoable edit of the part that differs.
+static void history_restore(editor_t *editor) {
+    history_view_t *v = &state.history_view;
+    const text_t *text = &editor->text;
+    i32 prefix = diff_prefix(text->data, v->text, min(text->len, v->len));
+    i32 suffix = diff_suffix(text->data + text->len, v->text + v->len, min(text->len, v->len) - prefix);
+    text_edit_replace(&editor->text, &editor->edit, &editor->highlight, prefix, text->len - prefix - suffix,
+                      v->text + prefix, v->len - prefix - suffix, editor_callback, editor);
+}
+
+static void draw_history(void) {
+    history_view_t *v = &state.history_view;
+    if (!v->display) {
+        // listed again when shown: other windows may have saved since
+        v->editor = NULL;
+        return;
+    }
+    editor_t *editor = current_editor;
+    if (!editor_history(editor)) {
+        v->editor = NULL;
+        v->node = WS_NONE;
+        v->count = 0;
+        v->selected = v->shown = UINT32_MAX;
+        v->list_serial++;
+        v->read_serial++;
+    } else if (v->editor != editor || v->node != editor->node || v->disk_hash != editor->disk_hash) {
+        // another file, or a new version of this one
+        if (v->editor != editor || v->node != editor->node) {
+            v->count = 0;
+            v->selected = v->shown = UINT32_MAX;
+            v->read_serial++;
+        }
+        v->editor = editor;
+        v->node = editor->node;
+        v->disk_hash = editor->disk_hash;
+        history_submit(editor, UINT32_MAX);
+    }
+
+    igSetNextWindowSize((ImVec2){600, 400}, ImGuiCond_FirstUseEver);
+    if (igBegin("History", &v->display, 0)) {
+        if (!v->editor) {
+            igText("No versions kept for %s", editor->filename);
+        } else {
+            igBeginChild_Str("## versions", (ImVec2){180, 0}, ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX, 0);
+            ImGuiListClipper clipper = {0};
+            ImGuiListClipper_Begin(&clipper, v->count, -1.0f);
+            while (ImGuiListClipper_Step(&clipper)) {
+                for (i32 i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    const history_version_t *version = &v->versions[i];
+                    time_t seconds = (time_t)(version->time / 1000000000);
+                    struct tm tm;
+                    char label[64];
+                    usize n = localtime_r(&seconds, &tm) ? strftime(label, sizeof(label), "%Y-%m-%d %H:%M:%S", &tm)
+                                                         : 0;
+                    snprintf(label + n, sizeof(label) - n, "  %lld B##%u", (long long)version->size, version->id);
+                    bool selected = v->selected == version->id;
+                    if (igSelectable_Bool(label, selected, 0, (ImVec2){0, 0}) && !selected) {
+                        v->selected = version->id;
+                        history_submit(editor, version->id);
+                    }
+                }
+            }
+            ImGuiListClipper_End(&clipper);
+            igEndChild();
+            igSameLine(0, -1);
+            igBeginGroup();
+            bool shown = v->text && v->selected != UINT32_MAX && v->shown == v->selected;
+            igBeginDisabled(!shown || (editor->io_busy && editor->io_reading));
+            if (igButton("Restore", (ImVec2){0, 0})) {
+                history_restore(editor);
+            }
+            igEndDisabled();
+            igSameLine(0, -1);
+            igBeginDisabled(v->selected == UINT32_MAX);
+            if (igButton("Compare", (ImVec2){0, 0})) {
+                state.diff_view.display = true;
+                state.diff_view.base = DIFF_VERSION;
+            }
+            igEndDisabled();
+            igBeginChild_Str("## version", (ImVec2){0, 0}, ImGuiChildFlags_Border,
+                             ImGuiWindowFlags_HorizontalScrollbar);
+            if (shown) {
+                igTextUnformatted(v->text, v->text + v->len);
+            }
+            igEndChild();
+            igEndGroup();
+        }
+    }
+    igEnd();
+}
+
+//=== Diff
+
+struct diff_job {
+    atomic_bool cancel;  // set when the result won't be shown
+    // what's compared
+    editor_t *editor;
+    i32 node;
+    u32 changes;
+    i32 base;
+    u64 base_key;
+    vfs_t *vfs;
+    char path[BUFFER_SIZE];
+    history_t *history;
+    // the base, borrowed from the view when it already has it, else read here
+    const char *old;
+    i32 old_len;
+    char *old_read;
+    char *new;
+    i32 new_len;
+    diff_t diff;
+    bool read_failed;
+    bool ok;
+};
+
+static void diff_job(void *data) {
+    diff_job_t *job = data;
+    prof_begin("diff");
+    if (!job->old && job->base == DIFF_DISK) {
+        fileio_req_t req = {.op = FILEIO_READ, .path = job->path};
+        vfs_run(job->vfs, &req, 1);
+        job->old_read = req.data;
+        job->old_len = req.len;
+    } else if (!job->old) {
+        job->old_read = history_read(job->history, (u32)job->base_key, &job->old_len);
+    }
+    job->old = job->old ? job->old : job->old_read;
+    job->read_failed = !job->old;
+    job->ok = job->old && diff_lines(job->old, job->old_len, job->new, job->new_len, &job->cancel, &job->diff);
+    prof_end();
+}
+
+// Frees what the view shows; it then waits for the next result.
+static void diff_clear(diff_view_t *v) {
+    mem_free(v->old);
+    mem_free(v->new);
+    diff_free(&v->diff);
+    v->old = v->new = NULL;
+    v->editor = NULL;
+    v->node = WS_NONE;
+    v->failed = false;
+}
+
+static void diff_done(void *data) {
+    diff_job_t *job = data;
+    diff_view_t *v = &state.diff_view;
+    v->job = NULL;
+    if (!atomic_load(&job->cancel) && (job->ok || job->read_failed)) {
+        bool same_base = v->editor == job->editor && v->node == job->node && v->shown_base == job->base &&
+                         v->base_key == job->base_key;
+        if (job->old_read || job->read_failed) {
+            mem_free(v->old);
+            v->old = job->old_read;
+            v->old_len = job->old_len;
+            job->old_read = NULL;
+        }
+        mem_free(v->new);
+        diff_free(&v->diff);
+        v->new = job->ok ? job->new : NULL;
+        v->new_len = job->new_len;
+        v->diff = job->diff;
+        job->new = NULL;
+        v->editor = job->editor;
+        v->node = job->node;
+        v->changes = job->changes;
+        v->shown_base = job->base;
+        v->base_key = job->base_key;
+        v->failed = job->read_failed;
+        // a new comparison opens on its first change
+        if (!same_base) {
+            v->hunk = v->diff.hunk_count > 0 ? 0 : -1;
+            v->scroll_row = v->hunk >= 0 ? v->diff.hunks[0] : 0;
+        } else if (v->hunk >= v->diff.hunk_count) {
+            v->hunk = v->diff.hunk_count - 1;
+        }
+    } else {
+        diff_free(&job->diff);
+    }
+    if (!v->display && !v->job) {
+        diff_clear(v);
+    }
+    mem_free(job->old_read);
+    mem_free(job->new);
+    mem_free(job);
+}
+
+static void diff_submit(editor_t *editor, u64 base_key) {
+    diff_view_t *v = &state.diff_view;
+    diff_job_t *job = mem_alloc(sizeof(*job));
+    char *copy = job ? mem_alloc((usize)editor->text.len + 1) : NULL;
+    if (!copy) {
+        mem_free(job);
+        return;
+    }
+    memcpy(copy, editor->text.data, (usize)editor->text.len);
+    *job = (diff_job_t){
+        .editor = editor,
+        .node = editor->node,
+        .changes = editor->changes,
+        .base = v->base,
+        .base_key = base_key,
+        .vfs = editor->vfs,
+        .history = editor_history(editor),
+        .new = copy,
+        .new_len = editor->text.len,
+    };
+    atomic_init(&job->cancel, false);
+    snprintf(job->path, sizeof(job->path), "%s", editor->path);
+    // the base is only read again when it changed
+    if (v->old && v->editor == editor && v->node == editor->node && v->shown_base == v->base &&
+        v->base_key == base_key) {
+        job->old = v->old;
+        job->old_len = v->old_len;
+    }
+    if (!jobs_submit(JOB_INTERACTIVE, diff_job, diff_done, job)) {
+        mem_free(copy);
+        mem_free(job);
+        return;
+    }
+    v->job = job;
+}
+
+static void draw_diff_row(const diff_view_t *v, const diff_row_t *row, f32 width, f32 line_height) {
+    const diff_t *d = &v->diff;
+    ImVec2 pos;
+    igGetCursorScreenPos(&pos);
+    if (row->old_line < 0 || row->new_line < 0) {
+        ImDrawList_AddRectFilled(igGetWindowDrawList(), pos, (ImVec2){pos.x + width, pos.y + line_height},
+                                 row->old_line < 0 ? DIFF_ADDED_BG : DIFF_REMOVED_BG, 0.0f, 0);
+    }
+    char gutter[32], old_no[12] = "", new_no[12] = "";
+    if (row->old_line >= 0) {
+        snprintf(old_no, sizeof(old_no), "%d", row->old_line + 1);
+    }
+    if (row->new_line >= 0) {
+        snprintf(new_no, sizeof(new_no), "%d", row->new_line + 1);
+    }
+    snprintf(gutter, sizeof(gutter), "%6s %6s %c ", old_no, new_no,
+             row->old_line < 0 ? '+' : row->new_line < 0 ? '-' : ' ');
+    igTextUnformatted(gutter, NULL);
+    igSameLine(0, 0);
+    const char *text = row->new_line >= 0 ? v->new : v->old;
+    const i32 *starts = row->new_line >= 0 ? d->new_starts : d->old_starts;
+    i32 line = row->new_line >= 0 ? row->new_line : row->old_line;
+    igTextUnformatted(text + starts[line], text + starts[line + 1] - 1);
+}
+
+static void draw_diff(void) {
+    diff_view_t *v = &state.diff_view;
+    if (!v->display) {
+        if (v->job) {
+            atomic_store(&v->job->cancel, true);
+        } else if (v->editor) {
+            diff_clear(v);
+        }
+        return;
+    }
+    editor_t *editor = current_editor;
+    u64 key = v->base == DIFF_DISK ? editor->disk_hash : state.history_view.selected;
+    bool possible = v->base == DIFF_DISK ? editor->vfs && editor->on_disk
+                                         : editor_history(editor) && key != UINT32_MAX &&
+                                               state.history_view.editor == editor;
+    bool same_base = v->editor == editor && v->node == editor->node && v->shown_base == v->base && v->base_key == key;
+    if (v->job && (!possible || v->job->editor != editor || v->job->node != editor->node || v->job->base != v->base ||
+                   v->job->base_key != key)) {
+        // for something no longer shown; the next one goes once it has stopped
+        atomic_store(&v->job->cancel, true);
+    } else if (possible && !v->job && (!same_base || v->changes != editor->changes)) {
+        // typing goes on while the diff is worked out: the next one starts from where it got to
+        diff_submit(editor, key);
+    }
+
+    igSetNextWindowSize((ImVec2){700, 500}, ImGuiCond_FirstUseEver);
+    if (igBegin("Diff", &v->display, 0)) {
+        igRadioButton_IntPtr("Disk", &v->base, DIFF_DISK);
+        igSameLine(0, -1);
+        igRadioButton_IntPtr("Selected version", &v->base, DIFF_VERSION);
+        if (!possible) {
+            igText(v->base == DIFF_DISK ? "%s isn't on disk" : "Select a version of %s in the history",
+                   editor->filename);
+        } else if (!same_base) {
+            igText("Comparing...");
+        } else if (v->failed) {
+            igText("Could not read the %s", v->base == DIFF_DISK ? "file on disk" : "version");
+        } else {
+            const diff_t *d = &v->diff;
+            igSameLine(0, -1);
+            igText("%d added, %d removed in %d changes", d->added, d->removed, d->hunk_count);
+            igSameLine(0, -1);
+            igBeginDisabled(d->hunk_count == 0);
+            if (igArrowButton("## previous", ImGuiDir_Up)) {
+                v->hunk = v->hunk <= 0 ? d->hunk_count - 1 : v->hunk - 1;
+                v->scroll_row = d->hunks[v->hunk];
+            }
+            igSameLine(0, -1);
+            if (igArrowButton("## next", ImGuiDir_Down)) {
+                v->hunk = v->hunk + 1 >= d->hunk_count ? 0 : v->hunk + 1;
+                v->scroll_row = d->hunks[v->hunk];
+            }
+            igEndDisabled();
+            igBeginChild_Str("## diff", (ImVec2){0, 0}, ImGuiChildFlags_Border, ImGuiWindowFlags_HorizontalScrollbar);
+            f32 line_height = igGetTextLineHeightWithSpacing();
+            if (v->scroll_row >= 0) {
+                // a few lines of context above
+                igSetScrollY_Float((f32)max(v->scroll_row - 3, 0) * line_height);
+                v->scroll_row = -1;
+            }
+            ImVec2 avail;
+            igGetContentRegionAvail(&avail);
+            f32 width = avail.x + igGetScrollX();
+            // only the rows in view are laid out, however long the files
+            ImGuiListClipper clipper = {0};
+            ImGuiListClipper_Begin(&clipper, d->row_count, line_height);
+            while (ImGuiListClipper_Step(&clipper)) {
+                for (i32 i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    draw_diff_row(v, &d->rows[i], width, line_height);
+                }
+            }
+            ImGuiListClipper_End(&clipper);
+            igEndChild();
+        }
+    }
+    igEnd();
+}
+
+//=== Control socket commands
+
+// One word of a command, double-quoted when it holds spaces ("project 1/todo.md"), with \" and \\ inside quotes.
+// Returns what follows it, or NULL when it's unterminated or doesn't fit.
+static const char *ctl_word(const char *s, char *word, usize size) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    usize n = 0;
+    if (*s == '"') {
+        for (s++; *s != '"'; s++) {
+            if (*s == '\\' && (s[1] == '"' || s[1] == '\\')) {
+                s++;
+            }
+            if (*s == '\0' || n + 1 >= size) {
+                return NULL;
+            }
+            word[n++] = *s;
+        }
+        s++;
+    } else {
+        for (; *s && *s != ' ' && *s != '\t'; s++) {
+            if (n + 1 >= size) {
+                return NULL;
+            }
+            word[n++] = *s;
+        }
+    }
+    word[n] = '\0';
+    return s;
+}
+
+// A file by its path on disk or as the finder shows it.
+static i32 ctl_find(const char *path) {
+    workspace_t *ws = &state.file_pane.workspace;
+    ctl_state_t *c = &state.ctl;
+    if (c->last_generation == ws->generation && strcmp(c->last_path, path) == 0) {
+        return c->last_node;
+    }
+    i32 node = WS_NONE;
+    for (i32 i = 0; i < ws->node_count && node == WS_NONE; i++) {
+        if (workspace_is_file(ws, i) && (strcmp(workspace_path(ws, i), path) == 0 ||
+                                         strcmp(workspace_display(ws, i), path) == 0)) {
+            node = i;
+        }
+    }
+    snprintf(c->last_path, sizeof(c->last_path), "%s", path);
+    c->last_node = node;
+    c->last_generation = ws->generation;
+    return node;
+}
+
+static editor_t *ctl_editor(i32 node) {
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        if (state.editor[i].active && state.editor[i].node == node) {
+            return &state.editor[i];
+        }
+    }
+    return NULL;
+}
+
+struct ctl_io {
+    i32 node;
+    file_io_t io;
+    atomic_bool finished;  // the disk access is over, the completion not delivered yet
+};
+
+static ctl_file_t *ctl_slot(i32 node) {
+    ctl_state_t *c = &state.ctl;
+    for (i32 i = 0; i < c->file_count; i++) {
+        if (c->files[i].node == node) {
+            return &c->files[i];
+        }
+    }
+    return NULL;
+}
+
+static void ctl_remove(ctl_file_t *f) {
+    ctl_state_t *c = &state.ctl;
+    text_free(&f->text);
+    *f = c->files[--c->file_count];
+}
+
+static void ctl_read_job(void *data) {
+    ctl_io_t *job = data;
+    read_job(&job->io);
+    atomic_store(&job->finished, true);
+    ctl_wake();
+}
+
+static void ctl_save_job(void *data) {
+    ctl_io_t *job = data;
+    save_job(&job->io);
+    atomic_store(&job->finished, true);
+    ctl_wake();
+}
+
+static void ctl_read_done(void *data) {
+    ctl_io_t *job = data;
+    ctl_file_t *f = ctl_slot(job->node);
+    if (f && f->io == job) {
+        f->io = NULL;
+        f->loading = false;
+        f->failed = job->io.failed || job->io.too_large || !text_set(&f->text, job->io.data, job->io.len);
+        f->disk_hash = job->io.hash;
+        f->disk_mtime = job->io.mtime;
+        f->disk_size = job->io.len;
+    }
+    mem_free(job->io.data);
+    mem_free(job);
+}
+
+static void ctl_save_done(void *data) {
+    ctl_io_t *job = data;
+    ctl_file_t *f = ctl_slot(job->node);
+    const file_io_t *io = &job->io;
+    if (f && f->io == job) {
+        f->io = NULL;
+        if (io->failed || io->conflict) {
+            snprintf(state.error_message, sizeof(state.error_message),
+                     io->conflict ? "File %s changed on disk during control commands, their edits weren't saved"
+                                  : "Could not save file %s",
+                     workspace_display(&state.file_pane.workspace, f->node));
+            // read again by the next command that needs it
+            ctl_remove(f);
+        } else if (!io->unchanged) {
+            f->disk_hash = io->hash;
+            f->disk_mtime = io->mtime;
+            f->disk_size = io->len;
+        }
+    }
+    mem_free(job->io.data);
+    mem_free(job);
+}
+
+static ctl_io_t *ctl_io_new(ctl_file_t *f) {
+    workspace_t *ws = &state.file_pane.workspace;
+    ctl_io_t *job = mem_alloc(sizeof(*job));
+    if (job) {
+        *job = (ctl_io_t){.node = f->node,
+                          .io = {.vfs = workspace_vfs(ws, f->node),
+                                 .on_disk = !f->loading,
+                                 .disk_hash = f->disk_hash,
+                                 .disk_mtime = f->disk_mtime,
+                                 .disk_size = f->disk_size}};
+        atomic_init(&job->finished, false);
+        snprintf(job->io.path, sizeof(job->io.path), "%s", workspace_rel_path(ws, f->node));
+    }
+    return job;
+}
+
+// The file's text, or NULL: with `wait` set while it's being read, or no slot is free yet, for the command to wait.
+static ctl_file_t *ctl_load(i32 node, bool *wait) {
+    ctl_state_t *c = &state.ctl;
+    ctl_file_t *f = ctl_slot(node);
+    *wait = f && f->loading;
+    if (f) {
+        return f->loading || f->failed ? NULL : f;
+    }
+    // a file read for an earlier command and not changed since makes room
+    for (i32 i = 0; i < c->file_count && c->file_count == CTL_FILES; i++) {
+        if (!c->files[i].io && !c->files[i].changed) {
+            ctl_remove(&c->files[i]);
+        }
+    }
+    *wait = true;
+    if (c->file_count == CTL_FILES) {
+        return NULL;
+    }
+    f = &c->files[c->file_count];
+    *f = (ctl_file_t){.node = node, .loading = true};
+    text_init(&f->text);
+    f->io = ctl_io_new(f);
+    if (!f->io || !jobs_submit(JOB_INTERACTIVE, ctl_read_job, ctl_read_done, f->io)) {
+        mem_free(f->io);
+        text_free(&f->text);
+        *wait = false;
+        return NULL;
+    }
+    c->file_count++;
+    return NULL;
+}
+
+// Writes back what the commands changed in `f`, as an editor's save does: under the save lock, not over a version
+// written since the read, into the history.
+static void ctl_save(ctl_file_t *f) {
+    workspace_t *ws = &state.file_pane.workspace;
+    ctl_io_t *job = ctl_io_new(f);
+    char *copy = job ? mem_alloc((usize)f->text.len + 1) : NULL;
+    if (copy) {
+        memcpy(copy, f->text.data, (usize)f->text.len);
+        job->io.data = copy;
+        job->io.len = f->text.len;
+        job->io.hash = hash64(copy, (usize)f->text.len, 0);
+        job->io.history = state.history[ws->nodes[f->node].root];
+        prefetch_forget(job->io.vfs, job->io.path);
+    }
+    f->changed = false;
+    if (!copy || !jobs_submit(JOB_INTERACTIVE, ctl_save_job, ctl_save_done, job)) {
+        mem_free(copy);
+        mem_free(job);
+        snprintf(state.error_message, sizeof(state.error_message), "Could not save file %s",
+                 workspace_display(ws, f->node));
+        ctl_remove(f);
+        return;
+    }
+    f->io = job;
+}
+
+// Control edits append lines or flip a checkbox in place. In an open editor they move the caret and selection like a
+// remote edit and drop the undo history, whose records no longer match the text.
+static void ctl_replace(editor_t *editor, ctl_file_t *file, i32 pos, i32 removed, const char *ins, i32 ins_len) {
+    if (file) {
+        file->changed |= text_replace(&file->text, pos, removed, ins, ins_len);
+        return;
+    }
+    bool clean = !editor->dirty && editor->on_disk;
+    if (text_replace(&editor->text, pos, removed, ins, ins_len)) {
+        highlight_edit(&editor->highlight, &editor->text, pos, removed, ins_len);
+        edit_state_external(&editor->edit, pos, removed, ins_len);
+        editor_callback(editor, pos, removed, ins_len);
+        editor->ctl_save |= clean;
+    }
+}
+
+static bool ctl_command(char *line, ctl_reply_t *reply, void *user) {
+    (void)user;
+    char cmd[16], path[BUFFER_SIZE];
+    const char *rest = ctl_word(line, cmd, sizeof(cmd));
+    rest = rest ? ctl_word(rest, path, sizeof(path)) : NULL;
+    if (!rest || !cmd[0] || !path[0]) {
+        ctl_printf(reply, "error usage: add|toggle|tasks|open <file> [...]\n");
+        return true;
+    }
+    i32 node = ctl_find(path);
+    if (node == WS_NONE) {
+        ctl_printf(reply, "error no such file: %s\n", path);
+        return true;
+    }
+    editor_t *editor = ctl_editor(node);
+    bool open = strcmp(cmd, "open") == 0;
+    bool edit = strcmp(cmd, "add") == 0 || strcmp(cmd, "toggle") == 0;
+    bool read_only = edit && workspace_vfs(&state.file_pane.workspace, node)->read_only;
+    // the buffer is about to be replaced by what the read finds, or a file no editor has is being read
+    bool wait = editor && editor->io_busy && editor->io_reading;
+    ctl_file_t *file = editor || open || read_only || wait ? NULL : ctl_load(node, &wait);
+    if (wait) {
+        return false;
+    }
+    state.ctl.commands++;
+    if (open) {
+        open_file_handler(node);
+        ctl_printf(reply, "ok\n");
+        return true;
+    }
+    if (read_only) {
+        ctl_printf(reply, "error read-only: %s\n", path);
+        return true;
+    }
+    text_t *text = editor ? &editor->text : file ? &file->text : NULL;
+    if (!text) {
+        ctl_printf(reply, "error could not read %s\n", path);
+        return true;
+    }
+
+    if (strcmp(cmd, "add") == 0) {
+        char task[CTL_MAX_LINE];
+        while (*rest == ' ' || *rest == '\t') {
+            rest++;
+        }
+        // the rest of the line, or one quoted word
+        if (*rest != '"') {
+            snprintf(task, sizeof(task), "%s", rest);
+        } else if (!ctl_word(rest, task, sizeof(task))) {
+            ctl_printf(reply, "error unterminated quote\n");
+            return true;
+        }
+        bool newline = text->len > 0 && text->data[text->len - 1] != '\n';
+        char *ins = frame_printf("%s- [ ] %s\n", newline ? "\n" : "", task);
+        if (!ins) {
+            ctl_printf(reply, "error out of memory\n");
+            return true;
+        }
+        ctl_replace(editor, file, text->len, 0, ins, (i32)strlen(ins));
+        ctl_printf(reply, "ok %d\n", text_line_count(text) - 1);
+    } else if (strcmp(cmd, "toggle") == 0) {
+        char number[16];
+        i32 n = ctl_word(rest, number, sizeof(number)) ? atoi(number) : 0;
+        i32 start = n >= 1 && n <= text_line_count(text) ? text_line_start(text, n - 1) : -1;
+        i32 mark = start >= 0 ? task_mark(text->data + start, text_line_end(text, n - 1) - start) : -1;
+        if (mark < 0) {
+            ctl_printf(reply, "error line %s is not a task\n", number);
+            return true;
+        }
+        bool done = text->data[start + mark] == ' ';
+        ctl_replace(editor, file, start + mark, 1, done ? "x" : " ", 1);
+        ctl_printf(reply, "ok %s\n", done ? "done" : "open");
+    } else if (strcmp(cmd, "tasks") == 0) {
+        i32 count = 0;
+        for (i32 l = 0; l < text_line_count(text); l++) {
+            i32 start = text_line_start(text, l), end = text_line_end(text, l);
+            i32 mark = task_mark(text->data + start, end - start);
+            if (mark >= 0 && text->data[start + mark] == ' ') {
+                i32 from = min(start + mark + 3, end);
+                ctl_printf(reply, "%d %.*s\n", l + 1, end - from, text->data + from);
+                count++;
+            }
+        }
+        ctl_printf(reply, "ok %d\n", count);
+    } else {
+        ctl_printf(reply, "error unknown command: %s\n", cmd);
+    }
+    return true;
+}
+
+// Before the batch's replies go out, so a script that reads the file after its reply finds the change. The saves of
+// open editors go on without holding them back, as they do when the user saves.
+static bool ctl_finish(void *user) {
+    (void)user;
+    ctl_state_t *c = &state.ctl;
+    // backwards, as removing moves the last file into the slot
+    for (i32 i = c->file_count - 1; i >= 0; i--) {
+        ctl_file_t *f = &c->files[i];
+        if (f->changed && !f->io) {
+            // or changed again during its save: this one starts from that
+            ctl_save(f);
+        } else if (!f->io) {
+            // read again by the next batch, which may come after another program changed it
+            ctl_remove(f);
+        }
+    }
+    bool written = true;
+    for (i32 i = 0; i < c->file_count; i++) {
+        written &= c->files[i].loading || !c->files[i].io;
+    }
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        if (state.editor[i].ctl_save) {
+            state.editor[i].ctl_save = false;
+            save_file(&state.editor[i]);
+        }
+    }
+    return written;
+}
+
+// A frame woken by a finished read or save can start just before its completion is queued: this one is next.
+static void ctl_rewake(void) {
+    for (i32 i = 0; i < state.ctl.file_count; i++) {
+        ctl_io_t *job = state.ctl.files[i].io;
+        if (job && atomic_load(&job->finished)) {
+            ctl_wake();
+            return;
+        }
+    }
+}
+
+static void draw_debug_panel(void) {
+    if (!state.debug.display) {
+        return;
+    }
+    igSetNextWindowSize((ImVec2){220, 0}, ImGuiCond_FirstUseEver);
+    if (igBegin("Debug", &state.debug.display, 0)) {
+        igText("Writes: %u", state.debug.writes);
+        igText("Skipped writes: %u", state.debug.skipped_writes);
+        igText("Reloads: %u", state.debug.reloads);
+        igText("Skipped reloads: %u", state.debug.skipped_reloads);
+        igText("Jobs: %d pending on %d workers, %s I/O", jobs_pending(), jobs_worker_count(),
+               fileio_backend_name(fileio_backend()));
+        const prefetch_stats_t *p = prefetch_stats();
+        igText("Prefetch: %llu of %llu opens hit (%.0f%%), %llu late, %llu of %llu reads wasted",
+               (unsigned long long)p->hits, (unsigned long long)p->opens,
+               p->opens ? 100.0 * (f64)p->hits / (f64)p->opens : 0.0, (unsigned long long)p->late,
+               (unsigned long long)p->wasted, (unsigned long long)p->requests);
+        if (ctl_running()) {
+            igText("Control socket: %llu commands", (unsigned long long)state.ctl.commands);
+        }
+        igText("Shared edits: %llu sent, %llu merged, logs compacted %u here and %u elsewhere",
+               (unsigned long long)state.debug.shared_sent, (unsigned long long)state.debug.shared_received,
+               state.debug.shared_restarts, state.debug.shared_rejoins);
+        for (i32 i = 0; i < SCAN_MAX_ROOTS; i++) {
+            if (state.history[i]) {
+                history_stats_t h;
+                history_stats(state.history[i], &h);
+                igText("History of %s: %u versions, %u chunks, %llu KB, last save added %llu KB",
+                       workspace_name(&state.file_pane.workspace, i), h.versions, h.chunks,
+                       (unsigned long long)h.pack_bytes / 1024, (unsigned long long)h.last_added / 1024);
+            }
+        }
+        igSeparator();
+        debug_panel_t *d = &state.debug;
+        if (igGetTime() - d->render_shown_at >= 1.0) {
+            d->render_last = d->render_shown;
+            d->render_shown = state.render;
+            d->render_shown_at = igGetTime();
+        }
+        u64 frames = d->render_shown.frames - d->render_last.frames;
+        u64 skipped = d->render_shown.skipped_frames - d->render_last.skipped_frames;
+        igText("Skipped frames: %llu of %llu", (unsigned long long)d->render_shown.skipped_frames,
+               (unsigned long long)d->render_shown.frames);
+        igText("Last second: %.0f%% of %llu", frames ? 100.0 * (f64)skipped / (f64)frames : 0.0,
+               (unsigned long long)frames);
+        igText("Uploaded: %d of %d draw lists, %llu KB", d->render_shown.uploaded_draw_lists,
+               d->render_shown.draw_lists, (unsigned long long)d->render_shown.uploaded_bytes / 1024);
+        igText("Vertices: %d, peak %d, buffer %d", d->render_shown.vertices, d->render_shown.peak_vertices,
+               d->render_shown.vertex_capacity);
+        igText("%s: build %.2f ms, submit %.2f ms", d->render_shown.pipelined ? "Pipelined" : "Serial",
+               d->render_shown.build_ms, d->render_shown.submit_ms);
+        if (d->render_shown.frame_delay_ms > 0.0f) {
+            igText("Just-in-time: %.1f ms before the frame", d->render_shown.frame_delay_ms);
+        }
+        static const char *window_states[APP_WINDOW_STATE_COUNT] = {"focused", "unfocused", "minimized"};
+        const app_render_stats_t *r = &d->render_shown;
+        if (r->paused) {
+            igText("Window %s, paused", window_states[r->window_state]);
+        } else if (r->frame_rate_cap > 0) {
+            igText("Window %s, capped at %d fps", window_states[r->window_state], r->frame_rate_cap);
+        } else {
+            igText("Window %s", window_states[r->window_state]);
+        }
+        for (i32 i = 0; i < APP_WINDOW_STATE_COUNT; i++) {
+            if (r->wall_seconds[i] > 0.0) {
+                igText("CPU %s: %.0f ms per minute over %.0f s", window_states[i],
+                       r->cpu_seconds[i] / r->wall_seconds[i] * 60000.0, r->wall_seconds[i]);
+            }
+        }
+        const latency_stats_t *l = latency_stats();
+        igText("Key to present: p50 %.1f ms, p99 %.1f ms, max %.1f ms, %llu keys", l->p50, l->p99, l->max,
+               (unsigned long long)l->count);
+        f32 histogram[LATENCY_BUCKETS];
+        for (i32 i = 0; i < LATENCY_BUCKETS; i++) {
+            histogram[i] = (f32)l->histogram[i];
+        }
+        igPlotHistogram_FloatPtr("##latency", histogram, LATENCY_BUCKETS, 0, "0 to 50 ms", 0.0f, FLT_MAX,
+                                 (ImVec2){0.0f, 50.0f}, sizeof(f32));
+        igSeparator();
+        const alloc_stats_t *a = alloc_stats();
+        igText("Heap: %u app, %u imgui, %u sokol", a->last.count[ALLOC_APP], a->last.count[ALLOC_IMGUI],
+               a->last.count[ALLOC_SOKOL]);
+        igText("Allocating frames: %llu of %llu", (unsigned long long)a->allocating_frames,
+               (unsigned long long)a->frames);
+        igText("Frame arena: %zu / %zu KB", a->arena_peak / 1024, a->arena_cap / 1024);
+        for (i32 i = 0; i < min(a->log_count, ALLOC_LOG_SIZE); i++) {
+            const alloc_frame_t *f = &a->log[(a->log_count - 1 - i) % ALLOC_LOG_SIZE];
+            igText("  #%llu: %u app, %u imgui, %u sokol, %llu B", (unsigned long long)f->frame, f->count[ALLOC_APP],
+                   f->count[ALLOC_IMGUI], f->count[ALLOC_SOKOL], (unsigned long long)f->bytes);
+        }
+    }
+    igEnd();
+    if (prof_draw_overlay(&state.debug.profiler) && !prof_dump_chrome("afaire_trace.json")) {
+        snprintf(state.error_message, sizeof(state.error_message), "Could not write afaire_trace.json");
+    }
+}
+
+void app_frame(void) {
+    prof_begin("input");
+    jobs_poll();
+    workspace_poll(&state.file_pane.workspace);
+    share_poll();
+    ctl_poll(ctl_command, ctl_finish, NULL);
+    ctl_rewake();
+
+    ImGuiViewport *viewport = igGetMainViewport();
+    igSetNextWindowPos(viewport->Pos, ImGuiCond_Always, (ImVec2){0, 0});
+    igSetNextWindowSize(viewport->Size, ImGuiCond_Always);
+
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_N)) {
+        state.file_pane.new_file_popup = true;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_P)) {
+        state.file_pane.fuzzy_finder_popup = true;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_S)) {
+        save_file(current_editor);
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_H)) {
+        state.history_view.display = !state.history_view.display;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_Q)) {
+        state.quit = true;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_B)) {
+        state.file_pane.display = !state.file_pane.display;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_V)) {
+        state.markdown_renderer.display = !state.markdown_renderer.display;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_D)) {
+        state.debug.display = !state.debug.display;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_P)) {
+        state.debug.profiler = !state.debug.profiler;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_D)) {
+        state.diff_view.display = !state.diff_view.display;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_Equal)) {
+        ImGuiIO *io = igGetIO();
+        io->FontGlobalScale += 0.1f;
+    }
+    if (igIsKeyChordPressed_Nil(ImGuiMod_Ctrl | ImGuiKey_Minus)) {
+        ImGuiIO *io = igGetIO();
+        io->FontGlobalScale -= 0.1f;
+    }
+
+    igBegin("afaire", 0, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_MenuBar);
+    igBeginMenuBar();
+    if (igBeginMenu("File", true)) {
+        if (igMenuItem_Bool("New", "Ctrl+N", false, true)) {
+            state.file_pane.new_file_popup = true;
+        }
+        if (igMenuItem_Bool("Open", "Ctrl+P", false, true)) {
+            state.file_pane.fuzzy_finder_popup = true;
+        }
+        if (igMenuItem_Bool("Save", "Ctrl+S", false, true)) {
+            save_file(current_editor);
+        }
+        if (igMenuItem_Bool("History", "Ctrl+H", state.history_view.display, true)) {
+            state.history_view.display = !state.history_view.display;
+        }
+        if (igMenuItem_Bool("Quit", "Ctrl+Q", false, true)) {
+            state.quit = true;
+        }
+        igEndMenu();
+    }
+    if (igBeginMenu("View", true)) {
+        if (igMenuItem_Bool("File Pane", "Ctrl+B", state.file_pane.display, true)) {
+            state.file_pane.display = !state.file_pane.display;
+        }
+        if (igMenuItem_Bool("Markdown Preview", "Ctrl+V", state.markdown_renderer.display, true)) {
+            state.markdown_renderer.display = !state.markdown_renderer.display;
+        }
+        if (igMenuItem_Bool("Diff", "Ctrl+Shift+D", state.diff_view.display, true)) {
+            state.diff_view.display = !state.diff_view.display;
+        }
+        if (igMenuItem_Bool("Debug", "Ctrl+D", state.debug.display, true)) {
+            state.debug.display = !state.debug.display;
+        }
+        if (igMenuItem_Bool("Profiler", "Ctrl+Shift+P", state.debug.profiler, true)) {
+            state.debug.profiler = !state.debug.profiler;
+        }
+        igEndMenu();
+    }
+    igEndMenuBar();
+    prof_end();
+
+    if (state.file_pane.display) {
+        prof_begin("file pane");
+        igBeginChild_Str(
+            "files_pane", (ImVec2){DEFAULT_FILE_PANE_SIZE, -1},
+            ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX,
+            false);
+        file_pane_t *pane = &state.file_pane;
+        if (pane->rows_dirty || pane->rows_generation != pane->workspace.generation) {
+            rebuild_rows(pane);
+        }
+        // on the stack: cimgui's constructor heap-allocates, and the constructor only zeroes the struct
+        ImGuiListClipper clipper = {0};
+        ImGuiListClipper_Begin(&clipper, pane->row_count, -1.0f);
+        while (ImGuiListClipper_Step(&clipper)) {
+            for (i32 i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                draw_file_row(&pane->rows[i]);
+            }
+        }
+        ImGuiListClipper_End(&clipper);
+        igEndChild();
+        igSameLine(0, 0);
+        prof_end();
+    }
+    prof_begin("tabs");
+    ImVec2 avail;
+    igGetContentRegionAvail(&avail);
+    igBeginGroup();
+    if (igBeginTabBar("## tabs", ImGuiTabBarFlags_None)) {
+        for (u8 i = 0; i < MAX_EDITORS; i++) {
+            if (igBeginTabItem(state.editor[i].filename, &state.editor[i].active, 0)) {
+                if (igIsItemClicked(0)) {
+                    current_editor = &state.editor[i];
+                }
+                prof_begin("editor");
+                text_edit("## editor", &current_editor->text, &current_editor->edit, &current_editor->highlight,
+                          (ImVec2){avail.x, -1}, &editor_callback, current_editor);
+                prof_end();
+                igEndTabItem();
+            }
+        }
+        igEndTabBar();
+        igEndGroup();
+    }
+    prof_end();
+    if (state.markdown_renderer.display) {
+        prof_begin("preview");
+        igSameLine(0, 0);
+        igBeginChild_Str(
+            "files_pane2", (ImVec2){avail.x, -1},
+            ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX,
+            false);
+        igText("Markdown Preview");
+        igEndChild();
+        prof_end();
+    }
+    prof_begin("popups");
+    if (igBeginPopupModal("new_file", NULL, 0)) {
+        igText("New filename:");
+        igSameLine(0, 0);
+        char new_filename[MAX_STRING_LENGTH] = {'\0'};
+        bool enter = igInputText("##new_filename", new_filename, sizeof(new_filename),
+                                 ImGuiInputTextFlags_EnterReturnsTrue, NULL, NULL);
+        if (enter || igButton("Create", (ImVec2){0, 0})) {
+            new_file(new_filename);
+            new_filename[0] = '\0';
+            igCloseCurrentPopup();
+        }
+        igSameLine(0, 0);
+        if (igIsKeyPressed_Bool(ImGuiKey_Escape, 0) || igButton("Cancel", (ImVec2){0, 0})) {
+            new_filename[0] = '\0';
+            igCloseCurrentPopup();
+        }
+        igEndPopup();
+    }
+    if (state.file_pane.new_file_popup) {
+        igOpenPopup_Str("new_file", 0);
+        state.file_pane.new_file_popup = false;
+    }
+    static bool focus = true;
+    static i32 selected = -1;
+    if (state.file_pane.fuzzy_finder_popup) {
+        igBegin("## fuzzy_finder", 0, 0);
+        static ImGuiTextFilter filter;
+        workspace_t *ws = &state.file_pane.workspace;
+        // one pass over the tree per frame, shared by the list and the Enter key
+        i32 *matches = frame_alloc((usize)max(ws->node_count, 1) * sizeof(i32));
+        i32 match_count = 0;
+        for (i32 i = 0; matches && i < ws->node_count; i++) {
+            if (workspace_is_file(ws, i) && ImGuiTextFilter_PassFilter(&filter, workspace_display(ws, i), NULL)) {
+                matches[match_count++] = i;
+            }
+        }
+
+        // the likeliest picks: the selection and the first results
+        if (selected >= 0 && selected < match_count) {
+            prefetch_node(matches[selected]);
+        }
+        for (i32 j = 0; j < min(match_count, FINDER_PREFETCH); j++) {
+            prefetch_node(matches[j]);
+        }
+
+        if (igBeginListBox("## search_results", (ImVec2){0, 0})) {
+            for (i32 j = 0; j < match_count; j++) {
+                if (igSelectable_Bool(workspace_display(ws, matches[j]), selected == j, 0, (ImVec2){0, 0})) {
+                    open_file_handler(matches[j]);
+                    state.file_pane.fuzzy_finder_popup = false;
+                }
+                if (igIsItemHovered(ImGuiHoveredFlags_None)) {
+                    prefetch_node(matches[j]);
+                }
+            }
+            igEndListBox();
+        }
+        if (igIsKeyPressed_Bool(ImGuiKey_UpArrow, 0)) {
+            selected = max(0, selected - 1);
+        }
+        if (igIsKeyPressed_Bool(ImGuiKey_DownArrow, 0)) {
+            selected = min(match_count - 1, selected + 1);
+        }
+        if (igIsKeyPressed_Bool(ImGuiKey_Enter, 0) && selected >= 0 && selected < match_count) {
+            open_file_handler(matches[selected]);
+            state.file_pane.fuzzy_finder_popup = false;
+        }
+        if (igIsKeyPressed_Bool(ImGuiKey_Escape, 0)) {
+            state.file_pane.fuzzy_finder_popup = false;
+        }
+
+        ImGuiTextFilter_Draw(&filter, "##search", MAX_STRING_LENGTH);
+        if (focus) {
+            igSetKeyboardFocusHere(-1);
+            focus = false;
+        }
+        igEnd();
+    } else {
+        focus = true;
+        selected = -1;
+    }
+    if (igBeginPopupModal("## error", NULL, 0)) {
+        igText("Error: %s", state.error_message);
+        if (igIsKeyPressed_Bool(ImGuiKey_Escape, 0) || igButton("Close", (ImVec2){0, 0})) {
+            igCloseCurrentPopup();
+            state.error_message[0] = '\0';
+        }
+        igEndPopup();
+    }
+    if (state.error_message[0] != '\0') {
+        igOpenPopup_Str("## error", 0);
+    }
+
+    igEnd();
+    draw_history();
+    draw_diff();
+    draw_debug_panel();
+    prof_end();
+}
+
+void app_shutdown(void) {
+    scan_stop(&state.file_pane.workspace.scanner);
+    // saves still in flight finish before the editors and their roots go away
+    jobs_shutdown();
+    prefetch_clear();
+    workspace_free(&state.file_pane.workspace);
+    mem_free(state.file_pane.rows);
+    for (i32 i = 0; i < SCAN_MAX_ROOTS; i++) {
+        history_close(state.history[i]);
+        state.history[i] = NULL;
+    }
+    mem_free(state.history_view.versions);
+    mem_free(state.history_view.text);
+    diff_clear(&state.diff_view);
+    while (state.ctl.file_count > 0) {
+        ctl_remove(&state.ctl.files[0]);
+    }
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        share_stop(&state.editor[i]);
+        text_free(&state.editor[i].text);
+        edit_state_free(&state.editor[i].edit);
+        highlight_free(&state.editor[i].highlight);
+    }
+}
+
+bool app_quit_requested(void) {
+    return state.quit;
+}
+
+app_render_stats_t *app_render_stats(void) {
+    return &state.render;
+}
+
+u64 app_draw_fingerprint(void) {
+    ImDrawData *draw_data = igGetDrawData();
+    if (!draw_data || !draw_data->Valid) {
+        return 0;
+    }
+    ImVec2 view[3] = {draw_data->DisplayPos, draw_data->DisplaySize, draw_data->FramebufferScale};
+    u64 h = hash64(view, sizeof(view), 0);
+    for (i32 i = 0; i < draw_data->CmdListsCount; i++) {
+        const ImDrawList *list = draw_data->CmdLists.Data[i];
+        h = hash64(list->VtxBuffer.Data, (usize)list->VtxBuffer.Size * sizeof(ImDrawVert), h);
+        h = hash64(list->IdxBuffer.Data, (usize)list->IdxBuffer.Size * sizeof(ImDrawIdx), h);
+        for (i32 j = 0; j < list->CmdBuffer.Size; j++) {
+            // field by field: ImDrawCmd has padding, copied uninitialized from the stack
+            const ImDrawCmd *c = &list->CmdBuffer.Data[j];
+            struct {
+                ImVec4 clip;
+                u64 texture;
+                u64 callback;
+                u32 vtx_offset;
+                u32 idx_offset;
+                u32 elem_count;
+                u32 pad;
+            } cmd = {c->ClipRect, (u64)(uintptr_t)c->TextureId, (u64)(uintptr_t)c->UserCallback, c->VtxOffset,
+                     c->IdxOffset, c->ElemCount, 0};
+            h = hash64(&cmd, sizeof(cmd), h);
+        }
+    }
+    return h;
+}
+
+bool app_scanning(void) {
+    return state.file_pane.workspace.scanning;
+}
+
+bool app_io_pending(void) {
+    for (u8 i = 0; i < MAX_EDITORS; i++) {
+        if (state.editor[i].io_busy) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool app_diff_pending(void) {
+    return state.diff_view.job != NULL;
+}
+
+const char *app_text(i32 *len) {
+    *len = current_editor->text.len;
+    return current_editor->text.data;
+}
+
+i32 app_open_path(const char *path) {
+    i32 node = workspace_find(&state.file_pane.workspace, path);
+    open_file_handler(node);
+    return workspace_is_file(&state.file_pane.workspace, node) ? node : WS_NONE;
+}
@@ -0,0 +1,60 @@
+#ifndef AFAIRE_APP_H
+#define AFAIRE_APP_H
+
+#include "base.h"
+#include "vfs.h"
+
+// The UI and file handling, independent of the window and renderer: app_frame() builds one ImGui frame between the
+// platform's NewFrame and Render, so the same code runs under sokol and in the headless benchmark. Each root is read
+// through its `vfs` (NULL if it couldn't be opened), which the app closes on shutdown.
+void app_init(const char *const *roots, vfs_t *const *vfs, i32 root_count);
+void app_frame(void);
+void app_shutdown(void);
+bool app_quit_requested(void);
+
+// Throttled by the platform layer when the window isn't focused.
+typedef enum {
+    APP_WINDOW_FOCUSED,
+    APP_WINDOW_UNFOCUSED,
+    APP_WINDOW_MINIMIZED,
+    APP_WINDOW_STATE_COUNT,
+} app_window_state_t;
+
+// Renderer counters, kept by the platform layer and shown in the debug panel.
+typedef struct {
+    u64 frames;
+    u64 skipped_frames;  // draw data identical to the previous frame: no upload, draw or present
+    // of the last drawn frame
+    i32 draw_lists;
+    i32 uploaded_draw_lists;  // draw lists only reach the GPU when their content changed
+    u64 uploaded_bytes;
+    i32 vertices;
+    i32 peak_vertices;    // since startup, to size the shared vertex buffer
+    i32 vertex_capacity;  // of the shared vertex buffer, which grows to fit
+    // CPU time of the last frame: building the UI, and uploading and drawing it. Pipelined, the two overlap.
+    bool pipelined;
+    f32 build_ms;
+    f32 submit_ms;
+    f32 frame_delay_ms;  // just-in-time frames: sleep between the present and the next frame
+    app_window_state_t window_state;
+    i32 frame_rate_cap;  // frames per second in the current state, 0 when uncapped
+    bool paused;         // nothing is drawn, frames only tick for background work
+    // process CPU time, and wall time, spent in each window state
+    f64 cpu_seconds[APP_WINDOW_STATE_COUNT];
+    f64 wall_seconds[APP_WINDOW_STATE_COUNT];
+} app_render_stats_t;
+
+app_render_stats_t *app_render_stats(void);
+
+// Hash of the draw data built by the last igRender(); frames with equal fingerprints draw the same pixels.
+u64 app_draw_fingerprint(void);
+
+// For scripted runs.
+bool app_scanning(void);
+bool app_io_pending(void);  // a file is being read or saved
+bool app_diff_pending(void);  // the diff view is being worked out
+i32 app_open_path(const char *path);
+// The buffer of the current editor.
+const char *app_text(i32 *len);
+
+#endif
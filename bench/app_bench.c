@@ -0,0 +1,732 @@
+// Scripted sessions of the whole app against ImGui with no renderer: scan a synthetic folder tree, run afaire-cli on it
+// while the app holds its index, open a note, type, edit it along with another instance, save it a few times, scroll,
+// open a note from the fuzzy finder, switch tabs, take commands on the control socket and idle. Writes per-frame CPU
+// time, allocations and draw calls as JSON, with per-phase percentiles, the prefetch hit rate, whether afaire-cli
+// found every task, whether the shared edits converged, what the saves added to the version history, the diff view and
+// the control socket's throughput, to the file given as argument or to stdout.
+#define _GNU_SOURCE
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include <ftw.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "app.h"
+#include "base.h"
+#include "cimgui.h"
+#include "crdt.h"
+#include "ctl.h"
+#include "diff.h"
+#include "fileio.h"
+#include "history.h"
+#include "prefetch.h"
+#include "share.h"
+#include "vfs.h"
+
+#define DIRS 50
+#define FILES_PER_DIR 40
+#define NOTE_LINES 20000
+#define MAX_FRAMES 8192
+#define MAX_SCAN_FRAMES 5000
+// Control socket commands, sent CTL_BATCH per write like a script piping into afaire-ctl
+#define CTL_COMMANDS 20000
+#define CTL_BATCH 500
+// Characters typed by each of the app and another instance editing todo.md with it
+#define SHARED_EDITS 300
+// Saves of todo.md, a character typed before each
+#define HISTORY_SAVES 20
+// Lines of the pair of texts diffed outside the app, and the lines changed between them
+#define DIFF_LINES 100000
+#define DIFF_EDITS 50
+
+typedef struct {
+    const char *phase;
+    f64 cpu_ms;
+    f64 wall_ms;
+    u64 allocs;
+    u64 alloc_bytes;
+    i32 draw_calls;
+    i32 vertices;
+    bool unchanged;  // same draw data as the previous frame, which the app doesn't upload or present
+} sample_t;
+
+static sample_t samples[MAX_FRAMES];
+static i32 sample_count;
+
+// A script on the control socket: adds to the open todo.md, toggles and lists the tasks of a note no editor holds.
+static struct {
+    char path[108];
+    i32 commands;
+    i32 errors;
+    f64 wall_ms;
+    bool failed;
+    atomic_bool done;
+    sem_t wake;  // posted when commands arrive, as sapp_wake() ends the app's frame wait
+} script;
+
+// afaire-cli, run next to the bench, answering from the index the app shares rather than scanning.
+static struct {
+    i32 tasks;  // of the notes', all tagged #bench
+    f64 wall_ms;
+    bool ran;
+} cli;
+
+// The other instance: joins todo.md's edit log and types near the top of the note while the app types at its caret,
+// catching up with the app's edits every few characters, as a window polling less often would. Halfway, it starts the
+// log over from its state, which the app has to rejoin.
+static struct {
+    share_log_t *log;
+    crdt_t crdt;
+    i32 edits;
+    i32 items;
+    i32 len;
+    bool restarted;
+    bool converged;
+} peer;
+
+// The version history the saves fill, as another instance sees it.
+static struct {
+    i32 saves;
+    i32 versions;
+    f64 bytes_per_save;  // the pack's growth, after the first save stored the whole file
+    f64 save_ms;         // mean, from the key to the save applied
+    f64 read_ms;         // reading back the version before the first save
+    bool restored;       // which matched the file
+} hist;
+
+// The diff view over the unsaved edits to todo.md, then diff_lines() alone on a larger pair.
+static struct {
+    f64 view_ms;  // from opening the view to the diff shown
+    i32 lines;
+    f64 ms;
+    i32 rows;
+    i32 hunks;
+    i32 added;
+    i32 removed;
+} diff;
+
+static void peer_emit(void *user, const u8 *op, i32 len) {
+    (void)user;
+    share_log_append(peer.log, op, (u32)len);
+}
+
+static void peer_record(void *user, const u8 *rec, u32 len) {
+    (void)user;
+    // the app's saves are records too, which aren't operations
+    crdt_apply(&peer.crdt, rec, (i32)len, NULL, NULL);
+}
+
+// Catches up with the app's edits, from the start of the log when it was started over.
+static void peer_read(void) {
+    if (share_log_read(peer.log, peer_record, NULL) == SHARE_LOG_RESTARTED) {
+        u32 clock = peer.crdt.clock;
+        crdt_free(&peer.crdt);
+        crdt_init(&peer.crdt, share_log_client(peer.log));
+        peer.crdt.clock = clock;
+        share_log_replay(peer.log, peer_record, NULL);
+    }
+}
+
+static void script_wake(void) {
+    sem_post(&script.wake);
+}
+
+// Only the UI thread's allocations are counted; the scanner workers allocate on their own.
+static _Thread_local u64 alloc_count;
+static _Thread_local u64 alloc_bytes;
+
+#if defined(BENCH_WRAP_MALLOC)
+// linked with -Wl,--wrap, so this sees the app's and ImGui's mallocs alike
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t count, size_t n);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n) {
+    alloc_count++;
+    alloc_bytes += n;
+    return __real_malloc(n);
+}
+
+void *__wrap_calloc(size_t count, size_t n) {
+    alloc_count++;
+    alloc_bytes += count * n;
+    return __real_calloc(count, n);
+}
+
+void *__wrap_realloc(void *p, size_t n) {
+    alloc_count++;
+    alloc_bytes += n;
+    return __real_realloc(p, n);
+}
+
+void __wrap_free(void *p) {
+    __real_free(p);
+}
+#else
+static void *imgui_alloc(size_t n, void *user) {
+    (void)user;
+    alloc_count++;
+    alloc_bytes += n;
+    return malloc(n);
+}
+
+static void imgui_free(void *p, void *user) {
+    (void)user;
+    free(p);
+}
+#endif
+
+static f64 clock_ms(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (f64)ts.tv_sec * 1e3 + (f64)ts.tv_nsec * 1e-6;
+}
+
+static void run_frame(const char *phase) {
+    static u64 last_fingerprint;
+    u64 allocs = alloc_count, bytes = alloc_bytes;
+    f64 cpu = clock_ms(CLOCK_THREAD_CPUTIME_ID);
+    f64 wall = clock_ms(CLOCK_MONOTONIC);
+    alloc_frame_begin();
+    igNewFrame();
+    app_frame();
+    igRender();
+    u64 fingerprint = app_draw_fingerprint();
+    alloc_frame_end();
+    sample_t s = {
+        .phase = phase, .cpu_ms = clock_ms(CLOCK_THREAD_CPUTIME_ID) - cpu, .wall_ms = clock_ms(CLOCK_MONOTONIC) - wall};
+    s.unchanged = fingerprint == last_fingerprint;
+    last_fingerprint = fingerprint;
+    s.allocs = alloc_count - allocs;
+    s.alloc_bytes = alloc_bytes - bytes;
+    ImDrawData *draw_data = igGetDrawData();
+    for (i32 i = 0; i < draw_data->CmdListsCount; i++) {
+        s.draw_calls += draw_data->CmdLists.Data[i]->CmdBuffer.Size;
+    }
+    s.vertices = draw_data->TotalVtxCount;
+    if (sample_count < MAX_FRAMES) {
+        samples[sample_count++] = s;
+    }
+}
+
+static void key(ImGuiKey k, bool down) {
+    ImGuiIO_AddKeyEvent(igGetIO(), k, down);
+}
+
+static void chord(ImGuiKey mod, ImGuiKey k, const char *phase) {
+    key(mod, true);
+    key(k, true);
+    run_frame(phase);
+    key(k, false);
+    key(mod, false);
+    run_frame(phase);
+}
+
+static void click(f32 x, f32 y, const char *phase) {
+    ImGuiIO *io = igGetIO();
+    ImGuiIO_AddMousePosEvent(io, x, y);
+    run_frame(phase);
+    ImGuiIO_AddMouseButtonEvent(io, ImGuiMouseButton_Left, true);
+    run_frame(phase);
+    ImGuiIO_AddMouseButtonEvent(io, ImGuiMouseButton_Left, false);
+    run_frame(phase);
+}
+
+static bool write_file(const char *path, const char *data, usize len) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+// DIRS folders of FILES_PER_DIR short notes, plus one long note at the root to edit.
+static bool make_tree(const char *root, char *note_path, usize note_size) {
+    char path[1024];
+    char body[256];
+    for (i32 d = 0; d < DIRS; d++) {
+        snprintf(path, sizeof(path), "%s/project %02d", root, d);
+        if (mkdir(path, 0755) != 0) {
+            return false;
+        }
+        for (i32 f = 0; f < FILES_PER_DIR; f++) {
+            snprintf(path, sizeof(path), "%s/project %02d/note %03d.md", root, d, f);
+            i32 n = snprintf(body, sizeof(body), "# note %d\n\n- [ ] task %d #bench due:2024-03-%02d\n- [x] done\n", f,
+                             f, f % 28 + 1);
+            if (!write_file(path, body, (usize)n)) {
+                return false;
+            }
+        }
+    }
+    usize cap = (usize)NOTE_LINES * 64, len = 0;
+    char *note = malloc(cap);
+    for (i32 i = 0; i < NOTE_LINES && note; i++) {
+        len += (usize)snprintf(note + len, cap - len, "- [ ] task number %d #tag due:2024-01-%02d\n", i, i % 28 + 1);
+    }
+    snprintf(note_path, note_size, "%s/todo.md", root);
+    bool ok = note && write_file(note_path, note, len);
+    free(note);
+    return ok;
+}
+
+static char *read_file(const char *path, usize *len) {
+    FILE *f = fopen(path, "rb");
+    char *data = NULL;
+    if (f && fseek(f, 0, SEEK_END) == 0) {
+        long size = ftell(f);
+        data = size >= 0 && fseek(f, 0, SEEK_SET) == 0 ? malloc((usize)size + 1) : NULL;
+        *len = data ? fread(data, 1, (usize)size, f) : 0;
+    }
+    if (f) {
+        fclose(f);
+    }
+    return data;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+static void *script_thread(void *arg) {
+    (void)arg;
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", script.path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    static char batch[CTL_BATCH * 64];
+    static char reply[1 << 16];
+    f64 start = clock_ms(CLOCK_MONOTONIC);
+    script.failed = fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0;
+    for (i32 sent = 0; sent < CTL_COMMANDS && !script.failed; sent += CTL_BATCH) {
+        i32 len = 0, lines = 0;
+        for (i32 i = sent; i < sent + CTL_BATCH; i++) {
+            if (i % 4 == 0) {
+                len += snprintf(batch + len, sizeof(batch) - (usize)len, "add todo.md script task %d\n", i);
+            } else if (i % 4 == 3) {
+                len += snprintf(batch + len, sizeof(batch) - (usize)len, "tasks \"project 49/note 039.md\"\n");
+            } else {
+                len += snprintf(batch + len, sizeof(batch) - (usize)len, "toggle \"project 49/note 039.md\" 3\n");
+            }
+        }
+        script.failed = write(fd, batch, (usize)len) != len;
+        // every command ends with an "ok" or "error" line
+        bool line_start = true;
+        while (!script.failed && lines < CTL_BATCH) {
+            ssize_t n = read(fd, reply, sizeof(reply));
+            script.failed = n <= 0;
+            for (ssize_t i = 0; i < n; i++) {
+                if (line_start && (reply[i] == 'o' || reply[i] == 'e')) {
+                    lines++;
+                    script.errors += reply[i] == 'e';
+                }
+                line_start = reply[i] == '\n';
+            }
+        }
+        script.commands += lines;
+    }
+    script.wall_ms = clock_ms(CLOCK_MONOTONIC) - start;
+    if (fd >= 0) {
+        close(fd);
+    }
+    atomic_store(&script.done, true);
+    script_wake();
+    return NULL;
+}
+
+// Two texts of DIFF_LINES lines, the second with DIFF_EDITS lines changed, added or removed, diffed on this thread.
+static void diff_pair(void) {
+    usize cap = (usize)DIFF_LINES * 48;
+    char *old = malloc(cap), *new = malloc(cap);
+    i32 old_len = 0, new_len = 0;
+    for (i32 i = 0; old && new && i < DIFF_LINES; i++) {
+        i32 every = DIFF_LINES / DIFF_EDITS;
+        i32 edit = i % every == every / 2 ? i / every % 3 : -1;
+        i32 n = snprintf(old + old_len, cap - (usize)old_len, "- [ ] task %d of the list #tag%d\n", i, i % 7);
+        // -1 kept, 0 replaced, 1 followed by a new line, 2 removed
+        if (edit == -1 || edit == 1) {
+            memcpy(new + new_len, old + old_len, (usize)n);
+            new_len += n;
+        }
+        if (edit >= 0 && edit != 2) {
+            new_len += snprintf(new + new_len, cap - (usize)new_len, "- [x] task %d, edited\n", i);
+        }
+        old_len += n;
+    }
+    if (old && new) {
+        f64 start = clock_ms(CLOCK_MONOTONIC);
+        diff_t d;
+        atomic_bool cancel = false;
+        if (diff_lines(old, old_len, new, new_len, &cancel, &d)) {
+            diff.ms = clock_ms(CLOCK_MONOTONIC) - start;
+            diff.lines = DIFF_LINES;
+            diff.rows = d.row_count;
+            diff.hunks = d.hunk_count;
+            diff.added = d.added;
+            diff.removed = d.removed;
+            diff_free(&d);
+        }
+    }
+    free(old);
+    free(new);
+}
+
+// Runs the afaire-cli built next to the bench on `root`, counting the tasks it lists.
+static void run_cli(const char *bench, const char *root) {
+    const char *slash = strrchr(bench, '/');
+    char command[2048];
+    // left not run when the paths don't fit
+    if (snprintf(command, sizeof(command), "'%.*safaire-cli' --tag '#bench' '%s'", slash ? (int)(slash - bench + 1) : 0,
+                 bench, root) >= (i32)sizeof(command)) {
+        return;
+    }
+    f64 start = clock_ms(CLOCK_MONOTONIC);
+    FILE *out = popen(command, "r");
+    char line[512];
+    while (out && fgets(line, sizeof(line), out)) {
+        cli.tasks += strstr(line, "#bench") != NULL;
+    }
+    cli.ran = out && pclose(out) == 0;
+    cli.wall_ms = clock_ms(CLOCK_MONOTONIC) - start;
+}
+
+static int compare_f64(const void *a, const void *b) {
+    f64 x = *(const f64 *)a, y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+static void write_json(FILE *out, i32 files) {
+#if defined(BENCH_WRAP_MALLOC)
+    const char *counted = "malloc";
+#else
+    const char *counted = "imgui";
+#endif
+    fprintf(out, "{\n\"files\": %d,\n\"allocations_counted\": \"%s\",\n\"frames\": [\n", files, counted);
+    for (i32 i = 0; i < sample_count; i++) {
+        const sample_t *s = &samples[i];
+        fprintf(out,
+                "{\"phase\":\"%s\",\"cpu_ms\":%.4f,\"wall_ms\":%.4f,\"allocs\":%llu,\"alloc_bytes\":%llu,"
+                "\"draw_calls\":%d,\"vertices\":%d,\"unchanged\":%s}%s\n",
+                s->phase, s->cpu_ms, s->wall_ms, (unsigned long long)s->allocs, (unsigned long long)s->alloc_bytes,
+                s->draw_calls, s->vertices, s->unchanged ? "true" : "false", i + 1 < sample_count ? "," : "");
+    }
+    fprintf(out, "],\n\"phases\": {\n");
+    static f64 cpu[MAX_FRAMES];
+    for (i32 i = 0; i < sample_count;) {
+        const char *phase = samples[i].phase;
+        i32 n = 0, draw_calls = 0, unchanged = 0;
+        u64 allocs = 0;
+        for (; i < sample_count && strcmp(samples[i].phase, phase) == 0; i++, n++) {
+            cpu[n] = samples[i].cpu_ms;
+            allocs += samples[i].allocs;
+            draw_calls = max(draw_calls, samples[i].draw_calls);
+            unchanged += samples[i].unchanged;
+        }
+        qsort(cpu, (usize)n, sizeof(f64), compare_f64);
+        f64 p50 = cpu[n / 2], p99 = cpu[min(n - 1, n * 99 / 100)];
+        fprintf(out,
+                "\"%s\": {\"frames\":%d,\"cpu_ms_p50\":%.4f,\"cpu_ms_p99\":%.4f,\"cpu_ms_max\":%.4f,"
+                "\"allocs_per_frame\":%.2f,\"draw_calls_max\":%d,\"skipped_ratio\":%.3f}%s\n",
+                phase, n, p50, p99, cpu[n - 1], (f64)allocs / n, draw_calls, (f64)unchanged / n,
+                i < sample_count ? "," : "");
+        fprintf(stderr,
+                "%-8s %5d frames  cpu p50 %7.3f ms  p99 %7.3f ms  %8.2f allocs/frame  %4d draw calls  %3.0f%% skipped\n",
+                phase, n, p50, p99, (f64)allocs / n, draw_calls, 100.0 * unchanged / n);
+    }
+    const prefetch_stats_t *p = prefetch_stats();
+    fprintf(out,
+            "},\n\"prefetch\": {\"requests\":%llu,\"opens\":%llu,\"hits\":%llu,\"late\":%llu,\"wasted\":%llu},\n"
+            "\"cli\": {\"ran\":%s,\"tasks\":%d,\"expected\":%d,\"wall_ms\":%.2f},\n"
+            "\"shared\": {\"edits\":%d,\"restarted\":%s,\"converged\":%s,\"items\":%d,\"bytes\":%d},\n"
+            "\"history\": {\"saves\":%d,\"versions\":%d,\"bytes_per_save\":%.0f,\"save_ms\":%.2f,\"read_ms\":%.2f,"
+            "\"restored\":%s},\n"
+            "\"diff\": {\"view_ms\":%.2f,\"lines\":%d,\"ms\":%.2f,\"rows\":%d,\"hunks\":%d,\"added\":%d,"
+            "\"removed\":%d},\n"
+            "\"ctl\": {\"commands\":%d,\"errors\":%d,\"wall_ms\":%.2f}\n"
+            "}\n",
+            (unsigned long long)p->requests, (unsigned long long)p->opens, (unsigned long long)p->hits,
+            (unsigned long long)p->late, (unsigned long long)p->wasted, cli.ran ? "true" : "false", cli.tasks,
+            DIRS * FILES_PER_DIR, cli.wall_ms, peer.edits, peer.restarted ? "true" : "false",
+            peer.converged ? "true" : "false", peer.items, peer.len, hist.saves, hist.versions, hist.bytes_per_save,
+            hist.save_ms, hist.read_ms, hist.restored ? "true" : "false", diff.view_ms, diff.lines, diff.ms, diff.rows,
+            diff.hunks, diff.added, diff.removed, script.commands, script.errors, script.wall_ms);
+    fprintf(stderr, "prefetch %llu of %llu opens hit, %llu late, %llu of %llu reads wasted\n",
+            (unsigned long long)p->hits, (unsigned long long)p->opens, (unsigned long long)p->late,
+            (unsigned long long)p->wasted, (unsigned long long)p->requests);
+    fprintf(stderr, "cli %d of %d tasks from the shared index in %.1f ms%s\n", cli.tasks, DIRS * FILES_PER_DIR,
+            cli.wall_ms, !cli.ran ? ", NOT RUN" : cli.tasks != DIRS * FILES_PER_DIR ? ", MISSING TASKS" : "");
+    fprintf(stderr, "shared %d edits each way, log %s halfway, %s, %d items for %d bytes\n", peer.edits,
+            peer.restarted ? "restarted" : "NOT RESTARTED", peer.converged ? "converged" : "DIVERGED", peer.items,
+            peer.len);
+    fprintf(stderr, "history %d saves, %d versions, %.0f B per save, save %.2f ms, read back %.2f ms, %s\n",
+            hist.saves, hist.versions, hist.bytes_per_save, hist.save_ms, hist.read_ms,
+            hist.restored ? "restored" : "NOT RESTORED");
+    fprintf(stderr, "diff view %.2f ms, %d lines diffed in %.2f ms: %d hunks, %d added, %d removed\n", diff.view_ms,
+            diff.lines, diff.ms, diff.hunks, diff.added, diff.removed);
+    fprintf(stderr, "ctl %d commands in %.1f ms (%.0f/s), %d errors\n", script.commands, script.wall_ms,
+            script.wall_ms > 0 ? 1e3 * script.commands / script.wall_ms : 0.0, script.errors);
+}
+
+int main(int argc, char **argv) {
+    const char *tmp = getenv("TMPDIR");
+    char root[512];
+    snprintf(root, sizeof(root), "%s/afaire_bench_XXXXXX", tmp && tmp[0] ? tmp : "/tmp");
+    char note[1024];
+    if (!mkdtemp(root) || !make_tree(root, note, sizeof(note))) {
+        fprintf(stderr, "could not create the synthetic tree in %s\n", root);
+        return 1;
+    }
+
+#if !defined(BENCH_WRAP_MALLOC)
+    igSetAllocatorFunctions(imgui_alloc, imgui_free, NULL);
+#endif
+    igCreateContext(NULL);
+    ImGuiIO *io = igGetIO();
+    io->DisplaySize = (ImVec2){1280, 720};
+    io->DeltaTime = 1.0f / 60.0f;
+    io->IniFilename = NULL;
+    unsigned char *pixels;
+    int width, height, bpp;
+    ImFontAtlas_GetTexDataAsRGBA32(io->Fonts, &pixels, &width, &height, &bpp);
+
+    // the version history goes with the tree, hidden from the scan
+    char data_home[600];
+    snprintf(data_home, sizeof(data_home), "%s/.data", root);
+    setenv("XDG_DATA_HOME", data_home, 1);
+
+    const char *roots[] = {root};
+    fileio_init(false);
+    vfs_t *vfs[] = {vfs_open(root)};
+    app_init(roots, vfs, 1);
+    for (i32 i = 0; i < MAX_SCAN_FRAMES && app_scanning(); i++) {
+        run_frame("scan");
+    }
+    // the scan is in and published: afaire-cli copies the app's index instead of scanning
+    run_cli(argv[0], root);
+
+    // the file is read on the job pool: the typing below must land in its contents
+    app_open_path(note);
+    for (i32 i = 0; i < MAX_SCAN_FRAMES && app_io_pending(); i++) {
+        run_frame("open");
+    }
+    for (i32 i = 0; i < 10; i++) {
+        run_frame("open");
+    }
+
+    click(640.0f, 360.0f, "type");
+    for (i32 i = 0; i < 400; i++) {
+        if (i % 40 == 39) {
+            // down and up in one frame: ImGui trickles them over two
+            key(ImGuiKey_Enter, true);
+            key(ImGuiKey_Enter, false);
+        } else {
+            ImGuiIO_AddInputCharacter(io, 'a' + (unsigned int)(i % 26));
+        }
+        run_frame("type");
+    }
+
+    // the app opened the note's log, so the peer joins it rather than starting another
+    bool created;
+    peer.log = share_log_open(note, NULL, 0, &created);
+    if (peer.log) {
+        crdt_init(&peer.crdt, share_log_client(peer.log));
+        share_log_replay(peer.log, peer_record, NULL);
+    }
+    if (peer.log && !created) {
+        for (i32 i = 0; i < SHARED_EDITS; i++) {
+            if (i % 8 == 0) {
+                peer_read();
+            }
+            if (i == SHARED_EDITS / 2) {
+                peer_read();
+                peer.restarted = crdt_save(&peer.crdt) &&
+                                 share_log_restart(peer.log, peer.crdt.op, (u32)peer.crdt.op_len);
+            }
+            char c = (char)('A' + i % 26);
+            crdt_replace(&peer.crdt, min(peer.crdt.len, 64 + i), 0, &c, 1, peer_emit, NULL);
+            ImGuiIO_AddInputCharacter(io, 'a' + (unsigned int)(i % 26));
+            run_frame("shared");
+            peer.edits++;
+        }
+        run_frame("shared");
+        peer_read();
+        i32 len;
+        const char *text = app_text(&len);
+        char *merged = malloc((usize)peer.crdt.len + 1);
+        if (merged) {
+            crdt_text(&peer.crdt, merged);
+            peer.converged = len == peer.crdt.len && memcmp(merged, text, (usize)len) == 0;
+        }
+        free(merged);
+        peer.items = peer.crdt.count;
+        peer.len = peer.crdt.len;
+    } else {
+        fprintf(stderr, "the note isn't shared, skipping the shared editing phase\n");
+    }
+    crdt_free(&peer.crdt);
+    share_log_close(peer.log);
+
+    // the first save also keeps the file it overwrites, read back at the end
+    usize original_len = 0;
+    char *original = read_file(note, &original_len);
+    history_t *store = history_open(root);
+    history_version_t *versions = NULL;
+    history_stats_t first = {0}, last = {0};
+    for (i32 i = 0; i < HISTORY_SAVES && store; i++) {
+        ImGuiIO_AddInputCharacter(io, 'a' + (unsigned int)i);
+        run_frame("history");
+        f64 start = clock_ms(CLOCK_MONOTONIC);
+        chord(ImGuiMod_Ctrl, ImGuiKey_S, "history");
+        for (i32 j = 0; j < MAX_SCAN_FRAMES && app_io_pending(); j++) {
+            run_frame("history");
+        }
+        hist.save_ms += clock_ms(CLOCK_MONOTONIC) - start;
+        hist.saves++;
+        // listing catches up with what the app appended
+        mem_free(versions);
+        hist.versions = history_list(store, "todo.md", &versions);
+        history_stats(store, i == 0 ? &first : &last);
+    }
+    chord(ImGuiMod_Ctrl, ImGuiKey_H, "history");
+    for (i32 i = 0; i < 10; i++) {
+        run_frame("history");
+    }
+    chord(ImGuiMod_Ctrl, ImGuiKey_H, "history");
+    if (hist.saves > 1 && hist.versions > 0) {
+        hist.save_ms /= hist.saves;
+        hist.bytes_per_save = (f64)(last.pack_bytes - first.pack_bytes) / (hist.saves - 1);
+        f64 start = clock_ms(CLOCK_MONOTONIC);
+        i32 len;
+        char *text = history_read(store, versions[hist.versions - 1].id, &len);
+        hist.read_ms = clock_ms(CLOCK_MONOTONIC) - start;
+        hist.restored = text && original && (usize)len == original_len && memcmp(text, original, original_len) == 0;
+        mem_free(text);
+    } else {
+        fprintf(stderr, "no version history, skipping the history phase\n");
+    }
+    mem_free(versions);
+    history_close(store);
+    free(original);
+
+    // unsaved edits against the file just saved; the view takes the focus, so they're typed first
+    click(640.0f, 360.0f, "diff");
+    for (i32 i = 0; i < 20; i++) {
+        if (i % 10 == 9) {
+            key(ImGuiKey_Enter, true);
+            key(ImGuiKey_Enter, false);
+        } else {
+            ImGuiIO_AddInputCharacter(io, 'a' + (unsigned int)i);
+        }
+        run_frame("diff");
+    }
+    f64 diff_start = clock_ms(CLOCK_MONOTONIC);
+    key(ImGuiMod_Ctrl, true);
+    chord(ImGuiMod_Shift, ImGuiKey_D, "diff");
+    key(ImGuiMod_Ctrl, false);
+    for (i32 i = 0; i < MAX_SCAN_FRAMES && app_diff_pending(); i++) {
+        run_frame("diff");
+    }
+    diff.view_ms = clock_ms(CLOCK_MONOTONIC) - diff_start;
+    ImGuiIO_AddMousePosEvent(io, 400.0f, 300.0f);
+    for (i32 i = 0; i < 100; i++) {
+        ImGuiIO_AddMouseWheelEvent(io, 0.0f, i < 60 ? -5.0f : 5.0f);
+        run_frame("diff");
+    }
+    key(ImGuiMod_Ctrl, true);
+    chord(ImGuiMod_Shift, ImGuiKey_D, "diff");
+    key(ImGuiMod_Ctrl, false);
+    run_frame("diff");
+    diff_pair();
+
+    ImGuiIO_AddMousePosEvent(io, 640.0f, 360.0f);
+    for (i32 i = 0; i < 300; i++) {
+        ImGuiIO_AddMouseWheelEvent(io, 0.0f, i < 200 ? -3.0f : 5.0f);
+        run_frame("scroll");
+    }
+
+    chord(ImGuiMod_Ctrl, ImGuiKey_P, "finder");
+    const char *query = "project 1 note 02";
+    for (const char *c = query; *c; c++) {
+        ImGuiIO_AddInputCharacter(io, (unsigned int)*c);
+        run_frame("finder");
+    }
+    for (i32 i = 0; i < 50; i++) {
+        run_frame("finder");
+    }
+    // back to "project 1", which matches; its first result is read ahead while the query settles
+    for (i32 i = 0; i < 8; i++) {
+        key(ImGuiKey_Backspace, true);
+        run_frame("finder");
+        key(ImGuiKey_Backspace, false);
+        run_frame("finder");
+    }
+    for (i32 i = 0; i < 20; i++) {
+        run_frame("finder");
+    }
+    key(ImGuiKey_DownArrow, true);
+    run_frame("finder");
+    key(ImGuiKey_DownArrow, false);
+    key(ImGuiKey_Enter, true);
+    run_frame("finder");
+    key(ImGuiKey_Enter, false);
+    run_frame("finder");
+
+    char tabs[4][1024];
+    for (i32 i = 0; i < 4; i++) {
+        snprintf(tabs[i], sizeof(tabs[i]), "%s/project %02d/note %03d.md", root, i * 7, i * 5);
+        app_open_path(tabs[i]);
+        run_frame("tabs");
+    }
+    for (i32 i = 0; i < 200; i++) {
+        app_open_path(i % 5 == 4 ? note : tabs[i % 4]);
+        run_frame("tabs");
+    }
+
+    // a frame per wakeup, each running the commands that arrived since the last
+    bool fits = snprintf(script.path, sizeof(script.path), "%s.sock", root) < (i32)sizeof(script.path);
+    sem_init(&script.wake, 0, 0);
+    pthread_t client;
+    if (fits && ctl_start(script.path, script_wake) && pthread_create(&client, NULL, script_thread, NULL) == 0) {
+        while (!atomic_load(&script.done)) {
+            sem_wait(&script.wake);
+            run_frame("ctl");
+        }
+        pthread_join(client, NULL);
+        if (script.failed) {
+            fprintf(stderr, "the control socket script stopped early\n");
+        }
+    } else {
+        fprintf(stderr, "could not start the control socket on %s\n", script.path);
+    }
+    ctl_stop();
+    sem_destroy(&script.wake);
+
+    for (i32 i = 0; i < 300; i++) {
+        run_frame("idle");
+    }
+
+    FILE *out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (out) {
+        write_json(out, DIRS * FILES_PER_DIR + 1);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    app_shutdown();
+    igDestroyContext(NULL);
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return out ? 0 : 1;
+}
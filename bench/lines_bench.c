@@ -0,0 +1,172 @@
+// Idle frame cost of the editor on a 100k-line note: ImGui's multiline widget (which rescans the whole buffer
+// every frame) against a visible-range layout driven by the line index, then text_edit on a 50 MB note.
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base.h"
+#include "cimgui.h"
+#include "text.h"
+#include "text_edit.h"
+
+#define LINES 100000
+#define FRAMES 200
+
+static f64 now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+static f32 measure(const char *begin, const char *end, void *user) {
+    (void)user;
+    ImVec2 size;
+    igCalcTextSize(&size, begin, end, false, -1.0f);
+    return size.x;
+}
+
+static int resize_callback(ImGuiInputTextCallbackData *data) {
+    text_t *text = data->UserData;
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        text_reserve(text, data->BufSize);
+        data->Buf = text->data;
+        data->BufSize = text->cap;
+    }
+    return 0;
+}
+
+static void begin_frame(void) {
+    igNewFrame();
+    igSetNextWindowPos((ImVec2){0, 0}, ImGuiCond_Always, (ImVec2){0, 0});
+    igSetNextWindowSize(igGetIO()->DisplaySize, ImGuiCond_Always);
+    igBegin("bench", NULL, ImGuiWindowFlags_NoDecoration);
+}
+
+static void end_frame(void) {
+    igEnd();
+    igRender();
+}
+
+static f64 bench_input_text(text_t *text, bool active) {
+    f64 total = 0.0;
+    for (i32 frame = 0; frame < FRAMES + 3; frame++) {
+        f64 start = now();
+        begin_frame();
+        if (active && frame == 0) {
+            igSetKeyboardFocusHere(0);
+        }
+        igInputTextMultiline("##editor", text->data, (usize)text->cap, (ImVec2){-1, -1},
+                             ImGuiInputTextFlags_AllowTabInput | ImGuiInputTextFlags_CallbackResize, resize_callback,
+                             text);
+        end_frame();
+        if (frame >= 3) {
+            total += now() - start;
+        }
+    }
+    return total / FRAMES;
+}
+
+static f64 bench_line_index(text_t *text) {
+    f64 total = 0.0;
+    f32 scroll_y = (f32)(LINES / 2) * igGetTextLineHeight();
+    for (i32 frame = 0; frame < FRAMES + 3; frame++) {
+        f64 start = now();
+        begin_frame();
+        ImDrawList *draw_list = igGetWindowDrawList();
+        ImVec2 origin, avail;
+        igGetCursorScreenPos(&origin);
+        igGetContentRegionAvail(&avail);
+        f32 line_height = igGetTextLineHeight();
+        i32 first = (i32)(scroll_y / line_height);
+        i32 last = min(text_line_count(text), first + (i32)(avail.y / line_height) + 1);
+        for (i32 line = first; line < last; line++) {
+            text_line_width(text, line, igGetFontSize(), measure, NULL);
+            ImDrawList_AddText_Vec2(draw_list, (ImVec2){origin.x, origin.y + (f32)(line - first) * line_height},
+                                    0xffffffff, text->data + text_line_start(text, line),
+                                    text->data + text_line_end(text, line));
+        }
+        igDummy((ImVec2){text->lines.max_width, (f32)text_line_count(text) * line_height});
+        end_frame();
+        if (frame >= 3) {
+            total += now() - start;
+        }
+    }
+    return total / FRAMES;
+}
+
+static f64 bench_text_edit(text_t *text, highlight_t *hl, bool typing) {
+    edit_state_t st;
+    memset(&st, 0, sizeof(st));
+    edit_state_reset(&st);
+    st.cursor = st.anchor = text_line_start(text, text_line_count(text) / 2);
+    f64 total = 0.0;
+    for (i32 frame = 0; frame < FRAMES + 3; frame++) {
+        // a click activates the editor, like in the app
+        ImGuiIO_AddMousePosEvent(igGetIO(), 400.0f, 300.0f);
+        ImGuiIO_AddMouseButtonEvent(igGetIO(), ImGuiMouseButton_Left, frame == 1);
+        if (typing && frame >= 3) {
+            ImGuiIO_AddInputCharacter(igGetIO(), 'a' + (unsigned int)(frame % 26));
+        }
+        f64 start = now();
+        begin_frame();
+        text_edit("##editor", text, &st, hl, (ImVec2){-1, -1}, NULL, NULL);
+        end_frame();
+        if (frame >= 3) {
+            total += now() - start;
+        }
+    }
+    edit_state_free(&st);
+    return total / FRAMES;
+}
+
+int main(void) {
+    igCreateContext(NULL);
+    ImGuiIO *io = igGetIO();
+    io->DisplaySize = (ImVec2){1280, 720};
+    io->DeltaTime = 1.0f / 60.0f;
+    io->IniFilename = NULL;
+    unsigned char *pixels;
+    int width, height, bpp;
+    ImFontAtlas_GetTexDataAsRGBA32(io->Fonts, &pixels, &width, &height, &bpp);
+
+    text_t text;
+    text_init(&text);
+    char line[128];
+    for (i32 i = 0; i < LINES; i++) {
+        i32 n = snprintf(line, sizeof(line), "- [ ] task number %d #tag due:2024-01-%02d\n", i, i % 28 + 1);
+        text_replace(&text, text.len, 0, line, n);
+    }
+
+    printf("lines: %d, bytes: %d\n", text_line_count(&text), text.len);
+    printf("InputTextMultiline idle (inactive): %8.3f ms/frame\n", bench_input_text(&text, false) * 1e3);
+    printf("InputTextMultiline idle (active):   %8.3f ms/frame\n", bench_input_text(&text, true) * 1e3);
+    printf("line index, visible lines only:     %8.3f ms/frame\n", bench_line_index(&text) * 1e3);
+    printf("text_edit idle:                     %8.3f ms/frame\n", bench_text_edit(&text, NULL, false) * 1e3);
+    highlight_t hl = {0};
+    highlight_reset(&hl, &text);
+    printf("text_edit idle, highlighted:        %8.3f ms/frame\n", bench_text_edit(&text, &hl, false) * 1e3);
+    i32 cmds = 0;
+    for (i32 i = 0; i < igGetDrawData()->CmdListsCount; i++) {
+        cmds += igGetDrawData()->CmdLists.Data[i]->CmdBuffer.Size;
+    }
+    printf("draw commands per frame:            %8d\n", cmds);
+
+    char *copy = malloc((usize)text.len);
+    i32 copy_len = text.len;
+    memcpy(copy, text.data, (usize)copy_len);
+    while (text.len < 50 * 1024 * 1024) {
+        text_replace(&text, text.len, 0, copy, copy_len);
+    }
+    free(copy);
+    printf("lines: %d, bytes: %d\n", text_line_count(&text), text.len);
+    printf("text_edit idle:                     %8.3f ms/frame\n", bench_text_edit(&text, NULL, false) * 1e3);
+    highlight_reset(&hl, &text);
+    printf("text_edit typing, highlighted:      %8.3f ms/frame\n", bench_text_edit(&text, &hl, true) * 1e3);
+    highlight_free(&hl);
+
+    text_free(&text);
+    igDestroyContext(NULL);
+    return 0;
+}
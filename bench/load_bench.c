@@ -0,0 +1,243 @@
+// Cold load of a synthetic 20k-file folder with each file I/O backend and each vfs: every file is stat'ed and read
+// whole, on one thread and spread over the job pool. The same notes are also packed into a tar archive and copied into
+// memory. The page cache is dropped for the tree's files and the archive before each run with posix_fadvise, which
+// needs no privileges; on filesystems that ignore it the runs are warm.
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "base.h"
+#include "fileio.h"
+#include "jobs.h"
+#include "vfs.h"
+
+#define DIRS 200
+#define FILES_PER_DIR 100
+#define FILES (DIRS * FILES_PER_DIR)
+#define RUNS 3
+
+typedef enum {
+    SOURCE_DIR,
+    SOURCE_TAR,
+    SOURCE_MEMORY,
+    SOURCE_COUNT,
+} source_t;
+
+typedef struct {
+    const char *name;
+    source_t source;
+    fileio_backend_t backend;
+    bool pool;
+    i32 batch;  // requests per vfs_run()
+} config_t;
+
+static const config_t configs[] = {
+    {"posix, 1 thread", SOURCE_DIR, FILEIO_POSIX, false, 256},
+    {"posix, job pool", SOURCE_DIR, FILEIO_POSIX, true, 32},
+    {"io_uring, 1 thread", SOURCE_DIR, FILEIO_URING, false, 256},
+    {"io_uring, job pool", SOURCE_DIR, FILEIO_URING, true, 256},
+    {"tar, 1 thread", SOURCE_TAR, FILEIO_POSIX, false, 256},
+    {"tar, job pool", SOURCE_TAR, FILEIO_POSIX, true, 256},
+    {"memory, 1 thread", SOURCE_MEMORY, FILEIO_POSIX, false, 256},
+    {"memory, job pool", SOURCE_MEMORY, FILEIO_POSIX, true, 256},
+};
+
+static char paths[FILES][32];
+static fileio_req_t reqs[FILES];
+static i32 root_fd;
+static char archive[600];
+static vfs_t *sources[SOURCE_COUNT];
+
+static f64 now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec * 1e3 + (f64)ts.tv_nsec * 1e-6;
+}
+
+static int compare_f64(const void *a, const void *b) {
+    f64 x = *(const f64 *)a, y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+// One ustar entry: header, then the contents padded to a block.
+static bool tar_write(FILE *tar, const char *path, const char *data, i32 len) {
+    char header[512] = {0};
+    // longer names need a GNU or pax record, which the bench doesn't write
+    if (snprintf(header, 100, "%s", path) >= 100) {
+        return false;
+    }
+    snprintf(header + 100, 8, "%07o", 0644);
+    snprintf(header + 108, 8, "%07o", 0);
+    snprintf(header + 116, 8, "%07o", 0);
+    snprintf(header + 124, 12, "%011o", (unsigned)len);
+    snprintf(header + 136, 12, "%011o", 0u);
+    header[156] = '0';
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    memset(header + 148, ' ', 8);
+    unsigned sum = 0;
+    for (i32 i = 0; i < 512; i++) {
+        sum += (u8)header[i];
+    }
+    snprintf(header + 148, 8, "%06o", sum);
+    static const char zeros[512];
+    return fwrite(header, 1, 512, tar) == 512 && fwrite(data, 1, (usize)len, tar) == (usize)len &&
+           fwrite(zeros, 1, (usize)(-len & 511), tar) == (usize)(-len & 511);
+}
+
+// Notes of a few hundred bytes to a few KB, as a notes folder holds.
+static bool make_tree(const char *root, FILE *tar, vfs_t *memory) {
+    char path[1024];
+    char body[8192];
+    for (i32 d = 0; d < DIRS; d++) {
+        snprintf(path, sizeof(path), "%s/d%03d", root, d);
+        if (mkdir(path, 0755) != 0) {
+            return false;
+        }
+        for (i32 f = 0; f < FILES_PER_DIR; f++) {
+            i32 i = d * FILES_PER_DIR + f;
+            snprintf(paths[i], sizeof(paths[i]), "d%03d/n%03d.md", d, f);
+            if (snprintf(path, sizeof(path), "%s/%s", root, paths[i]) >= (i32)sizeof(path)) {
+                return false;
+            }
+            i32 len = snprintf(body, sizeof(body), "# note %d\n\n", i);
+            for (i32 t = 0; t < 4 + (i * 7) % 60; t++) {
+                len += snprintf(body + len, sizeof(body) - (usize)len, "- [ ] task %d #bench due:2024-03-%02d\n", t,
+                                t % 28 + 1);
+            }
+            FILE *file = fopen(path, "wb");
+            if (!file) {
+                return false;
+            }
+            bool ok = fwrite(body, 1, (usize)len, file) == (usize)len;
+            if (fclose(file) != 0 || !ok || !tar_write(tar, paths[i], body, len) ||
+                vfs_memory_put(memory, paths[i], body, len) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void drop_file(i32 dir_fd, const char *path) {
+    i32 fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static void drop_cache(void) {
+    for (i32 i = 0; i < FILES; i++) {
+        drop_file(root_fd, paths[i]);
+    }
+    drop_file(AT_FDCWD, archive);
+}
+
+typedef struct {
+    vfs_t *vfs;
+    fileio_req_t *reqs;
+    i32 count;
+} batch_t;
+
+static void load_job(void *data) {
+    batch_t *b = data;
+    vfs_run(b->vfs, b->reqs, b->count);
+}
+
+static f64 run(const config_t *c, u64 *bytes, i32 *failed) {
+    for (i32 i = 0; i < FILES; i++) {
+        reqs[i] = (fileio_req_t){.op = FILEIO_READ, .path = paths[i]};
+    }
+    static batch_t batches[FILES];
+    f64 start = now_ms();
+    // the archive is mapped and indexed when opened, so that counts as part of the load
+    vfs_t *vfs = c->source == SOURCE_TAR ? vfs_tar_open(archive) : sources[c->source];
+    for (i32 i = 0, n = 0; i < FILES; i += c->batch, n++) {
+        batches[n] = (batch_t){vfs, &reqs[i], min(c->batch, FILES - i)};
+        if (!c->pool || !jobs_submit(JOB_PREFETCH, load_job, NULL, &batches[n])) {
+            load_job(&batches[n]);
+        }
+    }
+    while (jobs_pending() > 0) {
+        nanosleep(&(struct timespec){0, 20000}, NULL);
+    }
+    f64 ms = now_ms() - start;
+    if (c->source == SOURCE_TAR) {
+        vfs_close(vfs);
+    }
+    *bytes = 0;
+    *failed = 0;
+    for (i32 i = 0; i < FILES; i++) {
+        *bytes += (u64)reqs[i].len;
+        *failed += reqs[i].error != 0;
+        mem_free(reqs[i].data);
+    }
+    return ms;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+int main(void) {
+    const char *tmp = getenv("TMPDIR");
+    char root[512];
+    snprintf(root, sizeof(root), "%s/afaire_load_XXXXXX", tmp && tmp[0] ? tmp : "/tmp");
+    bool made = mkdtemp(root) != NULL;
+    snprintf(archive, sizeof(archive), "%s.tar", root);
+    FILE *tar = made ? fopen(archive, "wb") : NULL;
+    sources[SOURCE_MEMORY] = vfs_memory_open();
+    made = tar && sources[SOURCE_MEMORY] && make_tree(root, tar, sources[SOURCE_MEMORY]);
+    static const char end[1024];
+    if (tar && (fwrite(end, 1, sizeof(end), tar) != sizeof(end) || fclose(tar) != 0)) {
+        made = false;
+    }
+    sources[SOURCE_DIR] = made ? vfs_posix_open(root) : NULL;
+    if (!sources[SOURCE_DIR]) {
+        fprintf(stderr, "could not create the synthetic tree in %s\n", root);
+        return 1;
+    }
+    root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    fileio_init(false);
+    jobs_init();
+    printf("%d files, %d job workers, io_uring %s\n", FILES, jobs_worker_count(),
+           fileio_backend() == FILEIO_URING ? "available" : "unavailable");
+
+    for (usize c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        fileio_set_backend(configs[c].backend);
+        if (fileio_backend() != configs[c].backend) {
+            printf("%-20s skipped\n", configs[c].name);
+            continue;
+        }
+        f64 ms[RUNS];
+        u64 bytes = 0;
+        i32 failed = 0;
+        for (i32 r = 0; r < RUNS; r++) {
+            drop_cache();
+            ms[r] = run(&configs[c], &bytes, &failed);
+        }
+        qsort(ms, RUNS, sizeof(f64), compare_f64);
+        printf("%-20s median %8.1f ms  best %8.1f ms  %8.0f files/s  %6.1f MB  %d failed\n", configs[c].name,
+               ms[RUNS / 2], ms[0], FILES / ms[RUNS / 2] * 1e3, (f64)bytes / (1024.0 * 1024.0), failed);
+    }
+
+    jobs_shutdown();
+    vfs_close(sources[SOURCE_DIR]);
+    vfs_close(sources[SOURCE_MEMORY]);
+    close(root_fd);
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    remove(archive);
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Upload latency of SG_USAGE_STREAM buffers under each GL stream mode: every frame rewrites a UI-sized vertex and
+// index buffer and draws from them, as simgui_render() does, then reports the CPU time spent in sg_update_buffer()
+// and the frame interval per mode. Needs a GL window; the persistent mode needs GL 4.4 or GL_ARB_buffer_storage.
+#define SOKOL_IMPL
+#define SOKOL_GLCORE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+
+#define WARMUP_FRAMES 60
+#define FRAMES 600
+#define QUADS (16 * 1024)
+
+typedef struct {
+    f32 x, y;
+    u32 color;
+} vertex_t;
+
+static const struct {
+    sg_gl_stream_mode mode;
+    const char *name;
+} modes[] = {
+    {SG_GL_STREAMMODE_SUBDATA, "subdata"},
+    {SG_GL_STREAMMODE_ORPHAN, "orphan"},
+    {SG_GL_STREAMMODE_PERSISTENT, "persistent"},
+};
+
+static struct {
+    i32 mode;
+    i32 frame;
+    f64 last_frame;
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    sg_pipeline pip;
+    vertex_t vertices[QUADS * 4];
+    u16 indices[QUADS * 6];
+    f64 upload_us[FRAMES];
+    f64 frame_ms[FRAMES];
+    u32 stream_waits;
+} state;
+
+static f64 now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec * 1e3 + (f64)ts.tv_nsec * 1e-6;
+}
+
+static int compare_f64(const void *a, const void *b) {
+    f64 x = *(const f64 *)a, y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+static void setup_mode(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+        .gl_stream_mode = modes[state.mode].mode,
+    });
+    sg_enable_frame_stats();
+    state.vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .usage = SG_USAGE_STREAM,
+        .size = sizeof(state.vertices),
+    });
+    state.ibuf = sg_make_buffer(&(sg_buffer_desc){
+        .type = SG_BUFFERTYPE_INDEXBUFFER,
+        .usage = SG_USAGE_STREAM,
+        .size = sizeof(state.indices),
+    });
+    sg_shader shd = sg_make_shader(&(sg_shader_desc){
+        .attrs = {[0].name = "pos", [1].name = "color0"},
+        .vs.source = "#version 410\n"
+                     "layout(location=0) in vec2 pos;\n"
+                     "layout(location=1) in vec4 color0;\n"
+                     "out vec4 color;\n"
+                     "void main() { gl_Position = vec4(pos, 0.0, 1.0); color = color0; }\n",
+        .fs.source = "#version 410\n"
+                     "in vec4 color;\n"
+                     "out vec4 frag_color;\n"
+                     "void main() { frag_color = color; }\n",
+    });
+    state.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = shd,
+        .layout.attrs = {[0].format = SG_VERTEXFORMAT_FLOAT2, [1].format = SG_VERTEXFORMAT_UBYTE4N},
+        .index_type = SG_INDEXTYPE_UINT16,
+    });
+    state.frame = 0;
+    state.stream_waits = 0;
+}
+
+static void report_mode(void) {
+    const char *name = modes[state.mode].name;
+    if (sg_gl_query_stream_mode() != modes[state.mode].mode) {
+        printf("%-10s not supported, skipped\n", name);
+        return;
+    }
+    i32 n = FRAMES - WARMUP_FRAMES;
+    f64 *upload = state.upload_us + WARMUP_FRAMES, *frame = state.frame_ms + WARMUP_FRAMES;
+    qsort(upload, (usize)n, sizeof(f64), compare_f64);
+    qsort(frame, (usize)n, sizeof(f64), compare_f64);
+    printf("%-10s upload p50 %8.1f us  p99 %8.1f us  max %8.1f us   frame p50 %6.2f ms  p99 %6.2f ms   %u waits\n",
+           name, upload[n / 2], upload[n * 99 / 100], upload[n - 1], frame[n / 2], frame[n * 99 / 100],
+           state.stream_waits);
+}
+
+static void init(void) {
+    // quads in a 128x128 grid; the upload cost doesn't depend on what's drawn
+    for (i32 i = 0; i < QUADS; i++) {
+        f32 x = (f32)(i % 128) / 64.0f - 1.0f, y = (f32)(i / 128) / 64.0f - 1.0f, d = 1.0f / 80.0f;
+        vertex_t *v = &state.vertices[i * 4];
+        v[0] = (vertex_t){x, y, 0xff808080};
+        v[1] = (vertex_t){x + d, y, 0xff808080};
+        v[2] = (vertex_t){x + d, y + d, 0xff808080};
+        v[3] = (vertex_t){x, y + d, 0xff808080};
+        u16 base = (u16)(i * 4);
+        u16 *idx = &state.indices[i * 6];
+        idx[0] = base, idx[1] = (u16)(base + 1), idx[2] = (u16)(base + 2);
+        idx[3] = base, idx[4] = (u16)(base + 2), idx[5] = (u16)(base + 3);
+    }
+    printf("%d vertices, %zu KB uploaded per frame\n", QUADS * 4,
+           (sizeof(state.vertices) + sizeof(state.indices)) / 1024);
+    setup_mode();
+    state.last_frame = now_ms();
+}
+
+static void frame(void) {
+    // change the data every frame, as a typing user does
+    for (i32 i = 0; i < QUADS * 4; i += 97) {
+        state.vertices[i].color = 0xff000000u | (u32)(state.frame * 2654435761u);
+    }
+    f64 start = now_ms();
+    sg_update_buffer(state.vbuf, &SG_RANGE(state.vertices));
+    sg_update_buffer(state.ibuf, &SG_RANGE(state.indices));
+    state.upload_us[state.frame] = (now_ms() - start) * 1e3;
+
+    sg_begin_pass(&(sg_pass){.swapchain = sglue_swapchain()});
+    sg_apply_pipeline(state.pip);
+    sg_apply_bindings(&(sg_bindings){.vertex_buffers[0] = state.vbuf, .index_buffer = state.ibuf});
+    sg_draw(0, QUADS * 6, 1);
+    sg_end_pass();
+    sg_commit();
+    state.stream_waits += sg_query_frame_stats().gl.num_stream_waits;
+
+    f64 t = now_ms();
+    state.frame_ms[state.frame] = t - state.last_frame;
+    state.last_frame = t;
+    if (++state.frame < FRAMES) {
+        return;
+    }
+    report_mode();
+    sg_shutdown();
+    if (++state.mode < (i32)(sizeof(modes) / sizeof(modes[0]))) {
+        setup_mode();
+    } else {
+        sapp_quit();
+    }
+}
+
+sapp_desc sokol_main(int argc, char *argv[]) {
+    // "novsync" measures the uploads with the GPU as far behind as the driver lets it get
+    bool vsync = !(argc > 1 && strcmp(argv[1], "novsync") == 0);
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .window_title = "afaire stream bench",
+        .width = 1280,
+        .height = 720,
+        .swap_interval = vsync ? 1 : 0,
+        .gl_major_version = 4,
+        .gl_minor_version = 4,
+        .logger.func = slog_func,
+    };
+}
@@ -0,0 +1,425 @@
+#include "crdt.h"
+
+#include <string.h>
+
+#include "alloc.h"
+
+// Operations, little-endian like the machines sharing them:
+//   insert: 'i', id, origin, right (client and clock each), length, then the bytes
+//   delete: 'd', then a (client, clock, length) range per run of deleted characters
+//   state: 's', the item count, each item's id, origin, right, length and whether it's deleted, then the bytes of
+//          the visible ones
+#define OP_INSERT 'i'
+#define OP_DELETE 'd'
+#define OP_STATE 's'
+#define INSERT_HEADER (1 + 7 * 4)
+#define DELETE_RANGE (3 * 4)
+#define STATE_HEADER (1 + 4)
+#define STATE_ITEM (8 * 4)
+
+static bool id_eq(crdt_id_t a, crdt_id_t b) {
+    return a.client == b.client && a.clock == b.clock;
+}
+
+static bool grow(void **data, i32 *cap, i32 need, usize item) {
+    if (need <= *cap) {
+        return true;
+    }
+    i32 cap2 = max(need, max(64, *cap * 2));
+    void *p = mem_realloc(*data, (usize)cap2 * item);
+    if (!p) {
+        return false;
+    }
+    *data = p;
+    *cap = cap2;
+    return true;
+}
+
+// Room for `extra` more items, so the splits that follow can't fail.
+static bool reserve_items(crdt_t *c, i32 extra) {
+    return grow((void **)&c->items, &c->cap, c->count + extra, sizeof(crdt_item_t));
+}
+
+void crdt_init(crdt_t *c, u32 client) {
+    *c = (crdt_t){.client = client};
+}
+
+void crdt_free(crdt_t *c) {
+    mem_free(c->items);
+    mem_free(c->chars);
+    mem_free(c->op);
+    *c = (crdt_t){0};
+}
+
+// The item holding character `id` among items [from, to), -1 if none does.
+static i32 find_in(const crdt_t *c, crdt_id_t id, i32 from, i32 to) {
+    for (i32 i = from; i < to; i++) {
+        const crdt_item_t *it = &c->items[i];
+        if (it->id.client == id.client && id.clock >= it->id.clock && id.clock - it->id.clock < (u32)it->len) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static i32 find(const crdt_t *c, crdt_id_t id) {
+    return id_eq(id, CRDT_NONE) ? -1 : find_in(c, id, 0, c->count);
+}
+
+static i32 visible_before(const crdt_t *c, i32 index) {
+    i32 pos = 0;
+    for (i32 i = 0; i < index; i++) {
+        pos += c->items[i].deleted ? 0 : c->items[i].len;
+    }
+    return pos;
+}
+
+// Cuts item `i` before its character `at`; the second half is a run typed right after the first. Needs a reserved
+// item.
+static void split(crdt_t *c, i32 i, i32 at) {
+    crdt_item_t *it = &c->items[i];
+    if (at <= 0 || at >= it->len) {
+        return;
+    }
+    crdt_item_t rest = {
+        .id = {it->id.client, it->id.clock + (u32)at},
+        .origin = {it->id.client, it->id.clock + (u32)at - 1},
+        .right = it->right,
+        .len = it->len - at,
+        .text = it->text + at,
+        .deleted = it->deleted,
+    };
+    it->len = at;
+    memmove(&c->items[i + 2], &c->items[i + 1], (usize)(c->count - i - 1) * sizeof(crdt_item_t));
+    c->items[i + 1] = rest;
+    c->count++;
+}
+
+// Joins items `i` and `i + 1` back into one when the second continues the first, as split() leaves them.
+static void merge(crdt_t *c, i32 i) {
+    if (i < 0 || i + 1 >= c->count) {
+        return;
+    }
+    crdt_item_t *a = &c->items[i], *b = &c->items[i + 1];
+    crdt_id_t last = {a->id.client, a->id.clock + (u32)a->len - 1};
+    if (b->id.client == a->id.client && b->id.clock == a->id.clock + (u32)a->len && id_eq(b->origin, last) &&
+        id_eq(b->right, a->right) && b->deleted == a->deleted && b->text == a->text + a->len) {
+        a->len += b->len;
+        memmove(b, b + 1, (usize)(c->count - i - 2) * sizeof(crdt_item_t));
+        c->count--;
+    }
+}
+
+// Places a run between `origin` and `right`, after the concurrent runs that win over it: those from replicas with a
+// lower id, and everything that was typed after them. Sets `pos` to where it landed in the visible text.
+static bool integrate(crdt_t *c, crdt_id_t id, crdt_id_t origin, crdt_id_t right, const char *text, i32 len,
+                      i32 *pos) {
+    if (!reserve_items(c, 3) || !grow((void **)&c->chars, &c->chars_cap, c->chars_len + len, 1)) {
+        return false;
+    }
+    i32 left = -1;
+    if (!id_eq(origin, CRDT_NONE)) {
+        if ((left = find(c, origin)) < 0) {
+            return false;
+        }
+        split(c, left, (i32)(origin.clock - c->items[left].id.clock) + 1);
+    }
+    i32 end = c->count;
+    if (!id_eq(right, CRDT_NONE)) {
+        if ((end = find(c, right)) < 0) {
+            return false;
+        }
+        i32 at = (i32)(right.clock - c->items[end].id.clock);
+        split(c, end, at);
+        end += at > 0;
+    }
+    i32 at = left + 1;
+    for (i32 o = left + 1; o < end; o++) {
+        const crdt_item_t *it = &c->items[o];
+        if (id_eq(it->origin, origin)) {
+            if (it->id.client < id.client) {
+                at = o + 1;
+            } else if (id_eq(it->right, right)) {
+                break;
+            }
+        } else {
+            // typed after something between our origin and here: it goes with that, unless that lost to us
+            i32 p = id_eq(it->origin, CRDT_NONE) ? -1 : find_in(c, it->origin, left + 1, o);
+            if (p < 0) {
+                break;
+            }
+            if (p < at) {
+                at = o + 1;
+            }
+        }
+    }
+    memmove(&c->items[at + 1], &c->items[at], (usize)(c->count - at) * sizeof(crdt_item_t));
+    c->items[at] = (crdt_item_t){id, origin, right, len, c->chars_len, false};
+    c->count++;
+    memcpy(c->chars + c->chars_len, text, (usize)len);
+    c->chars_len += len;
+    c->len += len;
+    *pos = visible_before(c, at);
+    // typing extends the run it continues rather than adding an item per keystroke
+    merge(c, at - 1);
+    return true;
+}
+
+static bool op_reserve(crdt_t *c, i32 len) {
+    return grow((void **)&c->op, &c->op_cap, c->op_len + len, 1);
+}
+
+static void op_u32(crdt_t *c, u32 v) {
+    memcpy(c->op + c->op_len, &v, 4);
+    c->op_len += 4;
+}
+
+static u32 get_u32(const u8 *p) {
+    u32 v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static crdt_id_t get_id(const u8 *p) {
+    return (crdt_id_t){get_u32(p), get_u32(p + 4)};
+}
+
+// Deletes the visible bytes [pos, pos + len), encoding the ranges of ids they had into `op`.
+static bool local_delete(crdt_t *c, i32 pos, i32 len) {
+    c->op_len = 0;
+    if (!op_reserve(c, 1)) {
+        return false;
+    }
+    c->op[c->op_len++] = OP_DELETE;
+    i32 first = -1, last = -1;
+    for (i32 i = 0; i < c->count && len > 0; i++) {
+        crdt_item_t *it = &c->items[i];
+        if (it->deleted) {
+            continue;
+        }
+        if (pos >= it->len) {
+            pos -= it->len;
+            continue;
+        }
+        if (!reserve_items(c, 1) || !op_reserve(c, DELETE_RANGE)) {
+            return false;
+        }
+        if (pos > 0) {
+            // the part from `pos` on is the next item
+            split(c, i, pos);
+            pos = 0;
+            continue;
+        }
+        it = &c->items[i];
+        i32 n = min(len, it->len);
+        split(c, i, n);
+        it->deleted = true;
+        c->len -= n;
+        len -= n;
+        u8 *prev = c->op + c->op_len - DELETE_RANGE;
+        if (c->op_len > 1 && get_u32(prev) == it->id.client && get_u32(prev + 4) + get_u32(prev + 8) == it->id.clock) {
+            u32 joined = get_u32(prev + 8) + (u32)n;
+            memcpy(prev + 8, &joined, 4);
+        } else {
+            op_u32(c, it->id.client);
+            op_u32(c, it->id.clock);
+            op_u32(c, (u32)n);
+        }
+        first = first < 0 ? i : first;
+        last = i;
+    }
+    for (i32 i = last; first >= 0 && i >= first - 1; i--) {
+        merge(c, i);
+    }
+    return true;
+}
+
+// Deletes the characters `id` to `id + len`, wherever splits put them.
+static bool delete_ids(crdt_t *c, crdt_id_t id, u32 len, crdt_change_fn change, void *user) {
+    while (len > 0) {
+        i32 i = find(c, id);
+        if (i < 0 || !reserve_items(c, 2)) {
+            return false;
+        }
+        i32 at = (i32)(id.clock - c->items[i].id.clock);
+        split(c, i, at);
+        i += at > 0;
+        crdt_item_t *it = &c->items[i];
+        i32 n = (i32)min(len, (u32)it->len);
+        split(c, i, n);
+        if (!it->deleted) {
+            it->deleted = true;
+            c->len -= n;
+            if (change) {
+                change(user, visible_before(c, i), n, NULL, 0);
+            }
+        }
+        merge(c, i);
+        merge(c, i - 1);
+        id.clock += (u32)n;
+        len -= (u32)n;
+    }
+    return true;
+}
+
+bool crdt_replace(crdt_t *c, i32 pos, i32 removed, const char *ins, i32 ins_len, crdt_emit_fn emit, void *user) {
+    if (removed > 0) {
+        if (!local_delete(c, pos, removed)) {
+            return false;
+        }
+        if (emit) {
+            emit(user, c->op, c->op_len);
+        }
+    }
+    if (ins_len <= 0) {
+        return true;
+    }
+    // between the visible byte before `pos` and whatever follows it, tombstones included
+    i32 i = 0;
+    for (i32 skip = pos; i < c->count && skip > 0; i++) {
+        if (c->items[i].deleted) {
+            continue;
+        }
+        if (skip < c->items[i].len) {
+            if (!reserve_items(c, 1)) {
+                return false;
+            }
+            split(c, i, skip);
+        }
+        skip -= min(skip, c->items[i].len);
+    }
+    crdt_id_t id = {c->client, c->clock};
+    crdt_id_t origin = CRDT_NONE, right = i < c->count ? c->items[i].id : CRDT_NONE;
+    if (i > 0) {
+        const crdt_item_t *left = &c->items[i - 1];
+        origin = (crdt_id_t){left->id.client, left->id.clock + (u32)left->len - 1};
+    }
+    c->op_len = 0;
+    if (!op_reserve(c, INSERT_HEADER + ins_len)) {
+        return false;
+    }
+    c->op[c->op_len++] = OP_INSERT;
+    crdt_id_t ids[3] = {id, origin, right};
+    for (i32 k = 0; k < 3; k++) {
+        op_u32(c, ids[k].client);
+        op_u32(c, ids[k].clock);
+    }
+    op_u32(c, (u32)ins_len);
+    memcpy(c->op + c->op_len, ins, (usize)ins_len);
+    c->op_len += ins_len;
+    i32 at;
+    if (!integrate(c, id, origin, right, ins, ins_len, &at)) {
+        return false;
+    }
+    c->clock += (u32)ins_len;
+    if (emit) {
+        emit(user, c->op, c->op_len);
+    }
+    return true;
+}
+
+i32 crdt_saved_size(const crdt_t *c) {
+    return STATE_HEADER + c->count * STATE_ITEM + c->len;
+}
+
+bool crdt_save(crdt_t *c) {
+    i32 size = crdt_saved_size(c);
+    c->op_len = 0;
+    if (!op_reserve(c, size)) {
+        return false;
+    }
+    c->op[c->op_len++] = OP_STATE;
+    op_u32(c, (u32)c->count);
+    for (i32 i = 0; i < c->count; i++) {
+        const crdt_item_t *it = &c->items[i];
+        crdt_id_t ids[3] = {it->id, it->origin, it->right};
+        for (i32 k = 0; k < 3; k++) {
+            op_u32(c, ids[k].client);
+            op_u32(c, ids[k].clock);
+        }
+        op_u32(c, (u32)it->len);
+        op_u32(c, it->deleted);
+    }
+    crdt_text(c, (char *)c->op + c->op_len);
+    c->op_len += c->len;
+    return true;
+}
+
+// Takes a saved state into an empty replica. Deleted items keep no text: nothing reads it.
+static bool load_state(crdt_t *c, const u8 *op, i32 len, crdt_change_fn change, void *user) {
+    u32 count = get_u32(op + 1);
+    if (c->count > 0 || count > (u32)(len - STATE_HEADER) / STATE_ITEM) {
+        return false;
+    }
+    const u8 *p = op + STATE_HEADER;
+    i32 text_len = len - STATE_HEADER - (i32)count * STATE_ITEM;
+    if (!reserve_items(c, (i32)count) || !grow((void **)&c->chars, &c->chars_cap, c->chars_len + text_len, 1)) {
+        return false;
+    }
+    i32 visible = 0;
+    for (u32 i = 0; i < count; i++, p += STATE_ITEM) {
+        i32 n = (i32)get_u32(p + 24);
+        bool deleted = get_u32(p + 28) != 0;
+        if (n <= 0 || (!deleted && n > text_len - visible)) {
+            return false;
+        }
+        c->items[i] = (crdt_item_t){get_id(p), get_id(p + 8), get_id(p + 16), n, c->chars_len + visible, deleted};
+        visible += deleted ? 0 : n;
+    }
+    if (visible != text_len) {
+        return false;
+    }
+    c->count = (i32)count;
+    memcpy(c->chars + c->chars_len, p, (usize)text_len);
+    c->chars_len += text_len;
+    c->len = text_len;
+    if (change && text_len > 0) {
+        change(user, 0, 0, (const char *)p, text_len);
+    }
+    return true;
+}
+
+bool crdt_apply(crdt_t *c, const u8 *op, i32 len, crdt_change_fn change, void *user) {
+    if (len >= STATE_HEADER && op[0] == OP_STATE) {
+        return load_state(c, op, len, change, user);
+    }
+    if (len >= INSERT_HEADER && op[0] == OP_INSERT) {
+        crdt_id_t id = get_id(op + 1);
+        u32 n = get_u32(op + 25);
+        if (n != (u32)(len - INSERT_HEADER)) {
+            return false;
+        }
+        // already here: the replica's own, or a replay
+        if (n == 0 || find(c, id) >= 0) {
+            return true;
+        }
+        i32 pos;
+        const char *text = (const char *)op + INSERT_HEADER;
+        if (!integrate(c, id, get_id(op + 9), get_id(op + 17), text, (i32)n, &pos)) {
+            return false;
+        }
+        if (change) {
+            change(user, pos, 0, text, (i32)n);
+        }
+        return true;
+    }
+    if (len >= 1 && op[0] == OP_DELETE && (len - 1) % DELETE_RANGE == 0) {
+        for (i32 at = 1; at < len; at += DELETE_RANGE) {
+            if (!delete_ids(c, get_id(op + at), get_u32(op + at + 8), change, user)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void crdt_text(const crdt_t *c, char *out) {
+    for (i32 i = 0; i < c->count; i++) {
+        const crdt_item_t *it = &c->items[i];
+        if (!it->deleted) {
+            memcpy(out, c->chars + it->text, (usize)it->len);
+            out += it->len;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef AFAIRE_CRDT_H
+#define AFAIRE_CRDT_H
+
+#include "base.h"
+
+// A character's identity: the replica that typed it, and how many characters that replica had typed before it.
+typedef struct {
+    u32 client;
+    u32 clock;
+} crdt_id_t;
+
+#define CRDT_NONE ((crdt_id_t){UINT32_MAX, UINT32_MAX})
+
+// Characters typed in one go by one replica: a single item however long the run, split where another edit lands
+// inside it. Deleted characters stay as tombstones, which later operations may still refer to.
+typedef struct {
+    crdt_id_t id;      // of the first character, the others follow by clock
+    crdt_id_t origin;  // the character left of the first one when it was typed, CRDT_NONE at the start
+    crdt_id_t right;   // the character right of the run when it was typed, CRDT_NONE at the end
+    i32 len;
+    i32 text;  // offset into `chars`
+    bool deleted;
+} crdt_item_t;
+
+// A text several replicas edit at once (YATA, as in Yjs). Each edit becomes an operation the others apply; any
+// replica that has applied the same operations holds the same text, whatever order concurrent ones came in, as long
+// as an operation comes after those it builds on. Offsets are UTF-8 bytes, like text_t's.
+typedef struct {
+    u32 client;  // unique among the replicas
+    u32 clock;
+    crdt_item_t *items;  // in document order
+    i32 count;
+    i32 cap;
+    char *chars;  // every item's text, deleted ones included
+    i32 chars_len;
+    i32 chars_cap;
+    i32 len;  // of the visible text
+    u8 *op;   // the operation being encoded or applied
+    i32 op_len;
+    i32 op_cap;
+} crdt_t;
+
+// An operation made by crdt_replace(), to hand to crdt_apply() on every other replica. `op` is valid until the next
+// call.
+typedef void (*crdt_emit_fn)(void *user, const u8 *op, i32 len);
+// A change to the visible text made by another replica's operation, in offsets of the text before it.
+typedef void (*crdt_change_fn)(void *user, i32 pos, i32 removed, const char *ins, i32 ins_len);
+
+void crdt_init(crdt_t *c, u32 client);
+void crdt_free(crdt_t *c);
+// Replaces `removed` bytes at `pos` of the visible text with `ins`, emitting an operation for the deletion and one for
+// the insertion. Returns false when out of memory.
+bool crdt_replace(crdt_t *c, i32 pos, i32 removed, const char *ins, i32 ins_len, crdt_emit_fn emit, void *user);
+// Encodes the whole replica into `op`, tombstones and ids included, as one operation that an empty replica applies to
+// become the same text: operations made against this one, or before it, still apply after it. False when out of
+// memory.
+bool crdt_save(crdt_t *c);
+i32 crdt_saved_size(const crdt_t *c);
+// Applies another replica's operation, reporting the visible changes to `change` when not NULL. Returns false for one
+// that doesn't decode or refers to characters not seen yet, and for a saved state given to a replica that isn't empty.
+bool crdt_apply(crdt_t *c, const u8 *op, i32 len, crdt_change_fn change, void *user);
+// Copies the visible text, `c->len` bytes, to `out`.
+void crdt_text(const crdt_t *c, char *out);
+
+#endif
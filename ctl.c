@@ -0,0 +1,495 @@
+#define _GNU_SOURCE
+#include "ctl.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "prof.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define TAG_LISTEN UINT64_MAX
+#define TAG_EVENT (UINT64_MAX - 1)
+
+// Complete lines from one read of one client; travels to the UI thread and comes back with the replies.
+typedef struct ctl_chunk {
+    u64 client;
+    char *lines;  // each '\n'-terminated
+    i32 len;
+    i32 done;  // bytes of lines that have run
+    ctl_reply_t reply;
+    struct ctl_chunk *next;
+} ctl_chunk_t;
+
+typedef struct {
+    i32 fd;  // -1 when the slot is free
+    u64 id;  // never reused, so replies can't reach a later connection in the same slot
+    i32 chunks;  // sent to the UI thread and not answered yet
+    bool eof;  // the client is done sending: close once everything is answered
+    char *in;  // the start of a line still being received
+    i32 in_len;
+    i32 in_cap;
+    char *out;  // replies the socket didn't take yet
+    i32 out_len;
+    i32 out_cap;
+    i32 out_sent;
+} client_t;
+
+typedef struct {
+    ctl_chunk_t *head;
+    ctl_chunk_t *tail;
+} chunk_list_t;
+
+static struct {
+    bool running;
+    pthread_t thread;
+    i32 listen_fd;
+    i32 epoll_fd;
+    i32 event_fd;  // the UI thread posted replies, or ctl_stop() wants the thread to exit
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    void (*wake)(void);
+    atomic_bool stop;
+    // socket thread only
+    client_t clients[CTL_MAX_CLIENTS];
+    u64 next_id;
+    pthread_mutex_t lock;
+    chunk_list_t inbox;   // commands, for the UI thread
+    chunk_list_t outbox;  // replies, for the socket thread
+    // UI thread only: chunks stopped at a command that asked to wait, oldest first, and chunks answered while what
+    // their commands changed is still being written back
+    chunk_list_t held;
+    chunk_list_t unsent;
+} ctl = {.listen_fd = -1, .epoll_fd = -1, .event_fd = -1};
+
+static void list_push(chunk_list_t *list, ctl_chunk_t *chunk) {
+    chunk->next = NULL;
+    if (list->tail) {
+        list->tail->next = chunk;
+    } else {
+        list->head = chunk;
+    }
+    list->tail = chunk;
+}
+
+static void list_append(chunk_list_t *list, chunk_list_t *more) {
+    if (!more->head) {
+        return;
+    }
+    if (list->tail) {
+        list->tail->next = more->head;
+    } else {
+        list->head = more->head;
+    }
+    list->tail = more->tail;
+    *more = (chunk_list_t){0};
+}
+
+static void chunks_free(ctl_chunk_t *chunk) {
+    while (chunk) {
+        ctl_chunk_t *next = chunk->next;
+        mem_free(chunk->lines);
+        mem_free(chunk->reply.data);
+        mem_free(chunk);
+        chunk = next;
+    }
+}
+
+static bool grow(char **data, i32 *cap, i32 need) {
+    if (need <= *cap) {
+        return true;
+    }
+    i32 cap2 = max(need, max(4096, *cap * 2));
+    char *p = mem_realloc(*data, (usize)cap2);
+    if (!p) {
+        return false;
+    }
+    *data = p;
+    *cap = cap2;
+    return true;
+}
+
+void ctl_printf(ctl_reply_t *reply, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    i32 n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (n < 0 || !grow(&reply->data, &reply->cap, reply->len + n + 1)) {
+        return;
+    }
+    va_start(args, fmt);
+    vsnprintf(reply->data + reply->len, (usize)n + 1, fmt, args);
+    va_end(args);
+    reply->len += n;
+}
+
+//=== Socket thread
+
+static void client_close(client_t *c) {
+    epoll_ctl(ctl.epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    mem_free(c->in);
+    mem_free(c->out);
+    // replies still on their way find no client with their id and are dropped
+    *c = (client_t){.fd = -1};
+}
+
+// Once the client is done sending, a readable socket would only report the end over and over.
+static void client_watch(client_t *c, bool writable) {
+    u32 events = (c->eof ? 0 : EPOLLIN) | (writable ? EPOLLOUT : 0);
+    struct epoll_event ev = {.events = events, .data.u64 = (u64)(c - ctl.clients)};
+    epoll_ctl(ctl.epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// Writes what the socket takes; returns false once the client is closed.
+static bool client_flush(client_t *c) {
+    while (c->out_sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_sent, (usize)(c->out_len - c->out_sent), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            client_watch(c, true);
+            return true;
+        }
+        if (n <= 0) {
+            client_close(c);
+            return false;
+        }
+        c->out_sent += (i32)n;
+    }
+    if (c->out_len > 0) {
+        c->out_len = c->out_sent = 0;
+        client_watch(c, false);
+    }
+    if (c->eof && c->chunks == 0) {
+        client_close(c);
+        return false;
+    }
+    return true;
+}
+
+// Moves the complete lines received into a chunk for the UI thread; returns whether one was queued.
+static bool client_read(client_t *c) {
+    for (;;) {
+        if (!grow(&c->in, &c->in_cap, c->in_len + 4096)) {
+            client_close(c);
+            return false;
+        }
+        ssize_t n = recv(c->fd, c->in + c->in_len, (usize)(c->in_cap - c->in_len), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n <= 0) {
+            c->eof = true;
+            break;
+        }
+        c->in_len += (i32)n;
+    }
+    char *end = c->in_len > 0 ? memrchr(c->in, '\n', (usize)c->in_len) : NULL;
+    i32 len = end ? (i32)(end - c->in) + 1 : 0;
+    if (c->in_len - len > CTL_MAX_LINE) {
+        client_close(c);
+        return false;
+    }
+    ctl_chunk_t *chunk = len > 0 ? mem_alloc(sizeof(*chunk)) : NULL;
+    char *lines = chunk ? mem_alloc((usize)len) : NULL;
+    if (lines) {
+        memcpy(lines, c->in, (usize)len);
+        memmove(c->in, c->in + len, (usize)(c->in_len - len));
+        c->in_len -= len;
+        *chunk = (ctl_chunk_t){.client = c->id, .lines = lines, .len = len};
+        c->chunks++;
+        pthread_mutex_lock(&ctl.lock);
+        list_push(&ctl.inbox, chunk);
+        pthread_mutex_unlock(&ctl.lock);
+    } else {
+        mem_free(chunk);
+    }
+    if (c->eof) {
+        // a last line without its newline is dropped, as is anything after a failed allocation
+        client_watch(c, c->out_sent < c->out_len);
+        client_flush(c);
+    }
+    return lines != NULL;
+}
+
+static void accept_clients(void) {
+    for (;;) {
+        i32 fd = accept4(ctl.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        client_t *c = NULL;
+        for (i32 i = 0; i < CTL_MAX_CLIENTS && !c; i++) {
+            c = ctl.clients[i].fd < 0 ? &ctl.clients[i] : NULL;
+        }
+        struct epoll_event ev = {.events = EPOLLIN, .data.u64 = c ? (u64)(c - ctl.clients) : 0};
+        if (!c || epoll_ctl(ctl.epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        *c = (client_t){.fd = fd, .id = ++ctl.next_id};
+    }
+}
+
+static void deliver_replies(void) {
+    u64 value;
+    if (read(ctl.event_fd, &value, sizeof(value)) < 0) {
+        // nothing posted
+    }
+    pthread_mutex_lock(&ctl.lock);
+    ctl_chunk_t *chunks = ctl.outbox.head;
+    ctl.outbox = (chunk_list_t){0};
+    pthread_mutex_unlock(&ctl.lock);
+    for (ctl_chunk_t *chunk = chunks; chunk; chunk = chunk->next) {
+        for (i32 i = 0; i < CTL_MAX_CLIENTS; i++) {
+            client_t *c = &ctl.clients[i];
+            if (c->fd < 0 || c->id != chunk->client) {
+                continue;
+            }
+            c->chunks--;
+            if (grow(&c->out, &c->out_cap, c->out_len + chunk->reply.len)) {
+                memcpy(c->out + c->out_len, chunk->reply.data, (usize)chunk->reply.len);
+                c->out_len += chunk->reply.len;
+            }
+            break;
+        }
+    }
+    chunks_free(chunks);
+    for (i32 i = 0; i < CTL_MAX_CLIENTS; i++) {
+        client_t *c = &ctl.clients[i];
+        if (c->fd >= 0 && (c->out_len > 0 || (c->eof && c->chunks == 0))) {
+            client_flush(c);
+        }
+    }
+}
+
+static void *ctl_thread(void *arg) {
+    (void)arg;
+    prof_thread_name("ctl");
+    struct epoll_event events[64];
+    while (!atomic_load(&ctl.stop)) {
+        i32 n = epoll_wait(ctl.epoll_fd, events, 64, -1);
+        bool received = false;
+        for (i32 i = 0; i < n; i++) {
+            u64 tag = events[i].data.u64;
+            if (tag == TAG_LISTEN) {
+                accept_clients();
+            } else if (tag == TAG_EVENT) {
+                deliver_replies();
+            } else if (tag < CTL_MAX_CLIENTS && ctl.clients[tag].fd >= 0) {
+                client_t *c = &ctl.clients[tag];
+                if ((events[i].events & EPOLLOUT) && !client_flush(c)) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    received |= client_read(c);
+                }
+                // gone for good: what it sent still runs, the replies are dropped
+                if (c->fd >= 0 && (events[i].events & (EPOLLHUP | EPOLLERR))) {
+                    client_close(c);
+                }
+            }
+        }
+        if (received && ctl.wake) {
+            ctl.wake();
+        }
+    }
+    return NULL;
+}
+
+//=== UI thread
+
+bool ctl_start(const char *path, void (*wake)(void)) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (ctl.running || strlen(path) >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    snprintf(ctl.path, sizeof(ctl.path), "%s", path);
+    ctl.wake = wake;
+    atomic_init(&ctl.stop, false);
+    for (i32 i = 0; i < CTL_MAX_CLIENTS; i++) {
+        ctl.clients[i] = (client_t){.fd = -1};
+    }
+    ctl.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ctl.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ctl.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool ok = ctl.listen_fd >= 0 && ctl.epoll_fd >= 0 && ctl.event_fd >= 0;
+    if (ok && bind(ctl.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 && errno == EADDRINUSE) {
+        // left behind by an instance that died, unless something still answers on it
+        i32 probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        if (probe >= 0) {
+            close(probe);
+        }
+        ok = !live && unlink(path) == 0 && bind(ctl.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    }
+    struct epoll_event listen_ev = {.events = EPOLLIN, .data.u64 = TAG_LISTEN};
+    struct epoll_event event_ev = {.events = EPOLLIN, .data.u64 = TAG_EVENT};
+    ok = ok && listen(ctl.listen_fd, 64) == 0 &&
+         epoll_ctl(ctl.epoll_fd, EPOLL_CTL_ADD, ctl.listen_fd, &listen_ev) == 0 &&
+         epoll_ctl(ctl.epoll_fd, EPOLL_CTL_ADD, ctl.event_fd, &event_ev) == 0;
+    if (ok) {
+        pthread_mutex_init(&ctl.lock, NULL);
+        ok = pthread_create(&ctl.thread, NULL, ctl_thread, NULL) == 0;
+        if (!ok) {
+            pthread_mutex_destroy(&ctl.lock);
+        }
+    }
+    if (!ok) {
+        if (ctl.listen_fd >= 0) {
+            close(ctl.listen_fd);
+        }
+        if (ctl.epoll_fd >= 0) {
+            close(ctl.epoll_fd);
+        }
+        if (ctl.event_fd >= 0) {
+            close(ctl.event_fd);
+        }
+        ctl.listen_fd = ctl.epoll_fd = ctl.event_fd = -1;
+        return false;
+    }
+    ctl.running = true;
+    return true;
+}
+
+static void post_event(void) {
+    u64 one = 1;
+    if (write(ctl.event_fd, &one, sizeof(one)) < 0) {
+        // the counter is already nonzero: the thread will look anyway
+    }
+}
+
+void ctl_stop(void) {
+    if (!ctl.running) {
+        return;
+    }
+    atomic_store(&ctl.stop, true);
+    post_event();
+    pthread_join(ctl.thread, NULL);
+    for (i32 i = 0; i < CTL_MAX_CLIENTS; i++) {
+        if (ctl.clients[i].fd >= 0) {
+            client_close(&ctl.clients[i]);
+        }
+    }
+    close(ctl.listen_fd);
+    close(ctl.epoll_fd);
+    close(ctl.event_fd);
+    unlink(ctl.path);
+    chunks_free(ctl.inbox.head);
+    chunks_free(ctl.outbox.head);
+    chunks_free(ctl.held.head);
+    chunks_free(ctl.unsent.head);
+    ctl.inbox = ctl.outbox = ctl.held = ctl.unsent = (chunk_list_t){0};
+    pthread_mutex_destroy(&ctl.lock);
+    ctl.listen_fd = ctl.epoll_fd = ctl.event_fd = -1;
+    ctl.running = false;
+}
+
+bool ctl_running(void) {
+    return ctl.running;
+}
+
+void ctl_wake(void) {
+    if (ctl.running && ctl.wake) {
+        ctl.wake();
+    }
+}
+
+i32 ctl_poll(ctl_handler_fn handler, bool (*finish)(void *user), void *user) {
+    if (!ctl.running) {
+        return 0;
+    }
+    pthread_mutex_lock(&ctl.lock);
+    list_append(&ctl.held, &ctl.inbox);
+    pthread_mutex_unlock(&ctl.lock);
+
+    i32 ran = 0;
+    u64 waiting[CTL_MAX_CLIENTS];  // clients whose earlier commands wait: theirs run in order or not at all
+    i32 waiting_count = 0;
+    chunk_list_t answered = {0}, held = {0};
+    ctl_chunk_t *next;
+    for (ctl_chunk_t *chunk = ctl.held.head; chunk; chunk = next) {
+        next = chunk->next;
+        bool wait = false;
+        for (i32 i = 0; i < waiting_count && !wait; i++) {
+            wait = waiting[i] == chunk->client;
+        }
+        while (!wait && chunk->done < chunk->len) {
+            char *line = chunk->lines + chunk->done;
+            char *end = memchr(line, '\n', (usize)(chunk->len - chunk->done));
+            bool crlf = end > line && end[-1] == '\r';
+            end[-crlf] = '\0';
+            wait = !handler(line, &chunk->reply, user);
+            if (!wait) {
+                chunk->done = (i32)(end - chunk->lines) + 1;
+                ran++;
+                continue;
+            }
+            // run again next time, from the same bytes
+            end[-crlf] = crlf ? '\r' : '\n';
+            end[0] = '\n';
+            if (waiting_count < CTL_MAX_CLIENTS) {
+                waiting[waiting_count++] = chunk->client;
+            }
+        }
+        list_push(wait ? &held : &answered, chunk);
+    }
+    ctl.held = held;
+    list_append(&ctl.unsent, &answered);
+    bool written = true;
+    if ((ran > 0 || ctl.unsent.head) && finish) {
+        written = finish(user);
+    }
+    if (ctl.unsent.head && written) {
+        pthread_mutex_lock(&ctl.lock);
+        list_append(&ctl.outbox, &ctl.unsent);
+        pthread_mutex_unlock(&ctl.lock);
+        post_event();
+    }
+    return ran;
+}
+
+#else
+
+bool ctl_start(const char *path, void (*wake)(void)) {
+    (void)path;
+    (void)wake;
+    return false;
+}
+
+void ctl_stop(void) {
+}
+
+bool ctl_running(void) {
+    return false;
+}
+
+void ctl_wake(void) {
+}
+
+i32 ctl_poll(ctl_handler_fn handler, bool (*finish)(void *user), void *user) {
+    (void)handler;
+    (void)finish;
+    (void)user;
+    return 0;
+}
+
+void ctl_printf(ctl_reply_t *reply, const char *fmt, ...) {
+    (void)reply;
+    (void)fmt;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef AFAIRE_CTL_H
+#define AFAIRE_CTL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "base.h"
+
+#define CTL_MAX_CLIENTS 64
+#define CTL_MAX_LINE 8192  // a longer line closes the connection
+
+// What one command answers: any number of lines, the last starting with "ok" or "error".
+typedef struct {
+    char *data;
+    i32 len;
+    i32 cap;
+} ctl_reply_t;
+
+// Runs one command, given without its newline. Returns false to leave it, and everything the same client sent after
+// it, for the next ctl_poll().
+typedef bool (*ctl_handler_fn)(char *line, ctl_reply_t *reply, void *user);
+
+// Control socket for scripts: a Unix domain socket taking newline-separated commands, any number per write, and
+// answering each in order. One epoll thread does the socket I/O; the commands run on the UI thread, in ctl_poll(), so
+// they see and change the same state as the editor. `wake` is called from the socket thread when commands arrive,
+// for a throttled frame loop to get to them. Linux only: elsewhere ctl_start() fails.
+bool ctl_start(const char *path, void (*wake)(void));
+void ctl_stop(void);
+bool ctl_running(void);
+// Calls `wake`, from any thread: work the commands wait on finished.
+void ctl_wake(void);
+// Runs the commands received so far and returns how many ran. `finish`, when set, is called after a batch that ran
+// anything, to start writing back what it changed, and returns false while writes are in flight: the replies wait,
+// and it's called again on the next polls, so a script that reads the file after its reply finds the change.
+i32 ctl_poll(ctl_handler_fn handler, bool (*finish)(void *user), void *user);
+void ctl_printf(ctl_reply_t *reply, const char *fmt, ...);
+
+// Where afaire and afaire-ctl meet unless told otherwise: $XDG_RUNTIME_DIR/afaire.sock, else one per user in /tmp.
+static inline void ctl_default_path(char *path, usize size) {
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    if (dir && dir[0]) {
+        snprintf(path, size, "%s/afaire.sock", dir);
+    } else {
+        snprintf(path, size, "/tmp/afaire-%u.sock", (unsigned)getuid());
+    }
+}
+
+#endif
@@ -0,0 +1,421 @@
+#include "diff.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "alloc.h"
+#include "hash.h"
+
+// Past this many differences, or the square root of the lines compared when that's more, a split settles for the
+// furthest point reached rather than the middle of a shortest path (as xdiff does).
+#define MIN_COST 256
+
+i32 diff_prefix(const char *a, const char *b, i32 n) {
+    i32 i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        u32 same = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (same != 0xffff) {
+            return i + __builtin_ctz(~same);
+        }
+    }
+#else
+    for (; i + 8 <= n; i += 8) {
+        u64 x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if (x != y) {
+            break;
+        }
+    }
+#endif
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+i32 diff_suffix(const char *a_end, const char *b_end, i32 n) {
+    i32 i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a_end - i - 16));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b_end - i - 16));
+        u32 differ = ~(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+        if (differ) {
+            // the bytes above the highest difference match
+            return i + __builtin_clz(differ) - 16;
+        }
+    }
+#else
+    for (; i + 8 <= n; i += 8) {
+        u64 x, y;
+        memcpy(&x, a_end - i - 8, 8);
+        memcpy(&y, b_end - i - 8, 8);
+        if (x != y) {
+            break;
+        }
+    }
+#endif
+    while (i < n && a_end[-1 - i] == b_end[-1 - i]) {
+        i++;
+    }
+    return i;
+}
+
+// The start of every line and, last, one past the end of the last, which is len + 1 when it has no '\n'.
+static i32 *split_lines(const char *text, i32 len, i32 *count) {
+    i32 lines = 0;
+    for (const char *p = text, *end = text + len; (p = memchr(p, '\n', (usize)(end - p))); p++) {
+        lines++;
+    }
+    bool tail = len > 0 && text[len - 1] != '\n';
+    i32 *starts = mem_alloc((usize)(lines + tail + 1) * sizeof(i32));
+    if (!starts) {
+        return NULL;
+    }
+    i32 k = 0;
+    starts[k++] = 0;
+    for (const char *p = text, *end = text + len; (p = memchr(p, '\n', (usize)(end - p))); p++) {
+        starts[k++] = (i32)(p - text) + 1;
+    }
+    if (tail) {
+        starts[k++] = len + 1;
+    }
+    *count = k - 1;
+    return starts;
+}
+
+// The first index in [lo, hi) whose value is at least `value`, `hi` if none is.
+static i32 lower_bound(const i32 *values, i32 lo, i32 hi, i32 value) {
+    while (lo < hi) {
+        i32 mid = lo + (hi - lo) / 2;
+        if (values[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Lines that are equal, '\n' included, get the same id.
+typedef struct {
+    const char *text;
+    i32 len;  // without the '\n'
+    bool newline;
+    bool in_old;
+    bool in_new;
+    u64 hash;
+} line_class_t;
+
+typedef struct {
+    line_class_t *classes;
+    i32 count;
+    u32 *table;  // class + 1 by hash, open addressing
+    u32 mask;
+} interner_t;
+
+static u32 intern(interner_t *in, const char *text, const i32 *starts, i32 line, i32 text_len, bool old) {
+    i32 start = starts[line], len = starts[line + 1] - 1 - start;
+    bool newline = starts[line + 1] <= text_len;
+    u64 hash = hash64(text + start, (usize)len, newline);
+    for (u32 i = (u32)hash & in->mask;; i = (i + 1) & in->mask) {
+        if (in->table[i] == 0) {
+            in->table[i] = (u32)++in->count;
+            in->classes[in->count - 1] = (line_class_t){text + start, len, newline, false, false, hash};
+        }
+        line_class_t *c = &in->classes[in->table[i] - 1];
+        if (c->hash == hash && c->len == len && c->newline == newline && !memcmp(c->text, text + start, (usize)len)) {
+            c->in_old |= old;
+            c->in_new |= !old;
+            return in->table[i] - 1;
+        }
+    }
+}
+
+typedef struct {
+    const u32 *a;
+    const u32 *b;
+    u8 *a_changed;
+    u8 *b_changed;
+    i32 *v1;  // furthest x on each diagonal, forward from the start and back from the end
+    i32 *v2;
+    i32 max_cost;
+    const atomic_bool *cancel;
+    bool cancelled;
+} myers_t;
+
+static void compare(myers_t *m, i32 a_lo, i32 a_hi, i32 b_lo, i32 b_hi);
+
+static void split(myers_t *m, i32 a_lo, i32 a_hi, i32 b_lo, i32 b_hi, i32 x, i32 y) {
+    if ((x == 0 && y == 0) || (x == a_hi - a_lo && y == b_hi - b_lo)) {
+        // no progress: all changed rather than loop
+        memset(m->a_changed + a_lo, 1, (usize)(a_hi - a_lo));
+        memset(m->b_changed + b_lo, 1, (usize)(b_hi - b_lo));
+        return;
+    }
+    compare(m, a_lo, a_lo + x, b_lo, b_lo + y);
+    compare(m, a_lo + x, a_hi, b_lo + y, b_hi);
+}
+
+// Walks forward from the start and back from the end, a difference more each step, until the two paths meet; the
+// halves on either side of the meeting point are compared in turn. Both ranges are non-empty and differ at both ends.
+static void bisect(myers_t *m, i32 a_lo, i32 a_hi, i32 b_lo, i32 b_hi) {
+    const u32 *a = m->a + a_lo, *b = m->b + b_lo;
+    i32 n = a_hi - a_lo, mm = b_hi - b_lo;
+    i32 max_d = (n + mm + 1) / 2, offset = max_d;
+    // diagonals further than `reach` from the middle are never visited
+    i32 reach = min(max_d, m->max_cost + 1);
+    i32 *v1 = m->v1, *v2 = m->v2;
+    for (i32 i = offset - reach; i <= offset + reach; i++) {
+        v1[i] = v2[i] = -1;
+    }
+    v1[offset + 1] = v2[offset + 1] = 0;
+    i32 delta = n - mm;
+    bool front = delta & 1;  // the forward path is the one to meet the other
+    i32 k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+    for (i32 d = 0; d < max_d; d++) {
+        if (atomic_load_explicit(m->cancel, memory_order_relaxed)) {
+            m->cancelled = true;
+            return;
+        }
+        if (d > m->max_cost) {
+            // too far apart: split where the forward paths got furthest
+            i32 best = -1, best_x = 0, best_y = 0;
+            for (i32 i = offset - reach; i <= offset + reach; i++) {
+                i32 x = v1[i], y = x - (i - offset);
+                if (x >= 0 && x <= n && y >= 0 && y <= mm && x + y > best) {
+                    best = x + y;
+                    best_x = x;
+                    best_y = y;
+                }
+            }
+            split(m, a_lo, a_hi, b_lo, b_hi, best_x, best_y);
+            return;
+        }
+        for (i32 k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+            i32 i = offset + k1;
+            i32 x1 = k1 == -d || (k1 != d && v1[i - 1] < v1[i + 1]) ? v1[i + 1] : v1[i - 1] + 1;
+            i32 y1 = x1 - k1;
+            while (x1 < n && y1 < mm && a[x1] == b[y1]) {
+                x1++;
+                y1++;
+            }
+            v1[i] = x1;
+            if (x1 > n) {
+                k1_end += 2;
+            } else if (y1 > mm) {
+                k1_start += 2;
+            } else if (front) {
+                i32 j = offset + delta - k1;
+                if (j >= offset - reach && j <= offset + reach && v2[j] != -1 && x1 >= n - v2[j]) {
+                    split(m, a_lo, a_hi, b_lo, b_hi, x1, y1);
+                    return;
+                }
+            }
+        }
+        for (i32 k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+            i32 i = offset + k2;
+            i32 x2 = k2 == -d || (k2 != d && v2[i - 1] < v2[i + 1]) ? v2[i + 1] : v2[i - 1] + 1;
+            i32 y2 = x2 - k2;
+            while (x2 < n && y2 < mm && a[n - x2 - 1] == b[mm - y2 - 1]) {
+                x2++;
+                y2++;
+            }
+            v2[i] = x2;
+            if (x2 > n) {
+                k2_end += 2;
+            } else if (y2 > mm) {
+                k2_start += 2;
+            } else if (!front) {
+                i32 j = offset + delta - k2;
+                if (j >= offset - reach && j <= offset + reach && v1[j] != -1) {
+                    i32 x1 = v1[j], y1 = offset + x1 - j;
+                    if (x1 >= n - x2) {
+                        split(m, a_lo, a_hi, b_lo, b_hi, x1, y1);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+    split(m, a_lo, a_hi, b_lo, b_hi, 0, 0);
+}
+
+static void compare(myers_t *m, i32 a_lo, i32 a_hi, i32 b_lo, i32 b_hi) {
+    while (a_lo < a_hi && b_lo < b_hi && m->a[a_lo] == m->b[b_lo]) {
+        a_lo++;
+        b_lo++;
+    }
+    while (a_lo < a_hi && b_lo < b_hi && m->a[a_hi - 1] == m->b[b_hi - 1]) {
+        a_hi--;
+        b_hi--;
+    }
+    if (m->cancelled) {
+        return;
+    }
+    if (a_lo == a_hi) {
+        memset(m->b_changed + b_lo, 1, (usize)(b_hi - b_lo));
+    } else if (b_lo == b_hi) {
+        memset(m->a_changed + a_lo, 1, (usize)(a_hi - a_lo));
+    } else {
+        bisect(m, a_lo, a_hi, b_lo, b_hi);
+    }
+}
+
+static i32 isqrt(i32 n) {
+    i32 r = 1;
+    while ((i64)r * r < n) {
+        r *= 2;
+    }
+    while ((i64)r * r > n) {
+        r--;
+    }
+    return r;
+}
+
+// Marks the lines of [old_lo, old_hi) and [new_lo, new_hi) that aren't part of a longest common subsequence.
+static bool diff_middle(const char *old, i32 old_len, const char *new, i32 new_len, diff_t *d, i32 old_lo, i32 old_hi,
+                        i32 new_lo, i32 new_hi, u8 *old_changed, u8 *new_changed, const atomic_bool *cancel) {
+    i32 no = old_hi - old_lo, nn = new_hi - new_lo;
+    u32 cap = 16;
+    while (cap < (u32)(no + nn) * 2) {
+        cap *= 2;
+    }
+    interner_t in = {.classes = mem_alloc((usize)(no + nn) * sizeof(line_class_t)), .mask = cap - 1};
+    in.table = mem_alloc((usize)cap * sizeof(u32));
+    u32 *ids = mem_alloc((usize)(no + nn) * sizeof(u32));
+    // the lines left once those only one side has are set aside, and where they came from
+    u32 *a = mem_alloc((usize)(no + nn) * sizeof(u32));
+    i32 *map = mem_alloc((usize)(no + nn) * sizeof(i32));
+    u8 *changed = mem_alloc((usize)(no + nn));
+    i32 *v = mem_alloc((usize)(no + nn + 4) * 2 * sizeof(i32));
+    bool ok = in.classes && in.table && ids && a && map && changed && v;
+    if (ok) {
+        memset(in.table, 0, (usize)cap * sizeof(u32));
+        for (i32 i = 0; i < no; i++) {
+            ids[i] = intern(&in, old, d->old_starts, old_lo + i, old_len, true);
+        }
+        for (i32 i = 0; i < nn; i++) {
+            ids[no + i] = intern(&in, new, d->new_starts, new_lo + i, new_len, false);
+        }
+        i32 na = 0, nb = 0;
+        for (i32 i = 0; i < no; i++) {
+            if (in.classes[ids[i]].in_new) {
+                map[na] = old_lo + i;
+                a[na++] = ids[i];
+            } else {
+                old_changed[old_lo + i] = 1;
+            }
+        }
+        u32 *b = a + na;
+        i32 *b_map = map + na;
+        for (i32 i = 0; i < nn; i++) {
+            if (in.classes[ids[no + i]].in_old) {
+                b_map[nb] = new_lo + i;
+                b[nb++] = ids[no + i];
+            } else {
+                new_changed[new_lo + i] = 1;
+            }
+        }
+        memset(changed, 0, (usize)(na + nb));
+        myers_t m = {
+            .a = a,
+            .b = b,
+            .a_changed = changed,
+            .b_changed = changed + na,
+            .v1 = v,
+            .v2 = v + no + nn + 4,
+            .max_cost = max(MIN_COST, isqrt(na + nb)),
+            .cancel = cancel,
+        };
+        compare(&m, 0, na, 0, nb);
+        ok = !m.cancelled;
+        for (i32 i = 0; i < na + nb; i++) {
+            if (changed[i]) {
+                (i < na ? old_changed : new_changed)[map[i]] = 1;
+            }
+        }
+    }
+    mem_free(in.classes);
+    mem_free(in.table);
+    mem_free(ids);
+    mem_free(a);
+    mem_free(map);
+    mem_free(changed);
+    mem_free(v);
+    return ok;
+}
+
+bool diff_lines(const char *old, i32 old_len, const char *new, i32 new_len, const atomic_bool *cancel, diff_t *d) {
+    *d = (diff_t){0};
+    d->old_starts = split_lines(old, old_len, &d->old_count);
+    d->new_starts = split_lines(new, new_len, &d->new_count);
+    u8 *old_changed = d->old_starts && d->new_starts ? mem_alloc((usize)(d->old_count + d->new_count) + 1) : NULL;
+    if (!old_changed) {
+        diff_free(d);
+        return false;
+    }
+    u8 *new_changed = old_changed + d->old_count;
+    memset(old_changed, 0, (usize)(d->old_count + d->new_count));
+
+    // equal lines at both ends, found bytewise: those before the first byte that differs, and those after the last
+    i32 n = min(old_len, new_len);
+    i32 prefix = diff_prefix(old, new, n);
+    i32 head = lower_bound(d->old_starts + 1, 0, d->old_count, prefix + 1);
+    i32 suffix = diff_suffix(old + old_len, new + new_len, n - d->old_starts[head]);
+    // a line is shared when the '\n' before it is too
+    i32 tail = d->old_count - lower_bound(d->old_starts, head, d->old_count, old_len - suffix + 1);
+    tail = min(tail, d->new_count - head);
+
+    bool ok = diff_middle(old, old_len, new, new_len, d, head, d->old_count - tail, head, d->new_count - tail,
+                          old_changed, new_changed, cancel);
+    d->rows = ok ? mem_alloc((usize)(d->old_count + d->new_count + 1) * sizeof(diff_row_t)) : NULL;
+    if (d->rows) {
+        i32 i = 0, j = 0;
+        while (i < d->old_count || j < d->new_count) {
+            if (i < d->old_count && j < d->new_count && !old_changed[i] && !new_changed[j]) {
+                d->rows[d->row_count++] = (diff_row_t){i++, j++};
+                continue;
+            }
+            d->hunk_count++;
+            // a side out of lines has the rest of the other's as changes
+            while (i < d->old_count && (old_changed[i] || j == d->new_count)) {
+                d->rows[d->row_count++] = (diff_row_t){i++, -1};
+                d->removed++;
+            }
+            while (j < d->new_count && (new_changed[j] || i == d->old_count)) {
+                d->rows[d->row_count++] = (diff_row_t){-1, j++};
+                d->added++;
+            }
+        }
+        d->hunks = mem_alloc((usize)max(d->hunk_count, 1) * sizeof(i32));
+        for (i32 r = 0, h = 0; d->hunks && r < d->row_count && h < d->hunk_count; r++) {
+            bool change = d->rows[r].old_line < 0 || d->rows[r].new_line < 0;
+            bool prev = r > 0 && (d->rows[r - 1].old_line < 0 || d->rows[r - 1].new_line < 0);
+            if (change && !prev) {
+                d->hunks[h++] = r;
+            }
+        }
+    }
+    mem_free(old_changed);
+    if (!d->rows || !d->hunks) {
+        diff_free(d);
+        return false;
+    }
+    return true;
+}
+
+void diff_free(diff_t *d) {
+    mem_free(d->rows);
+    mem_free(d->hunks);
+    mem_free(d->old_starts);
+    mem_free(d->new_starts);
+    *d = (diff_t){0};
+}
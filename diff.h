@@ -0,0 +1,41 @@
+#ifndef AFAIRE_DIFF_H
+#define AFAIRE_DIFF_H
+
+#include <stdatomic.h>
+
+#include "base.h"
+
+// A line of the inline view: one both texts have, or one only the old or only the new has.
+typedef struct {
+    i32 old_line;  // -1 for an added line
+    i32 new_line;  // -1 for a removed line
+} diff_row_t;
+
+// Lines are numbered from 0. A line's text is [starts[i], starts[i + 1] - 1): the last line ends one byte past the
+// text, as if it had a '\n' too.
+typedef struct {
+    diff_row_t *rows;
+    i32 row_count;
+    i32 *hunks;  // first row of each run of changed lines
+    i32 hunk_count;
+    i32 *old_starts;  // old_count + 1
+    i32 old_count;
+    i32 *new_starts;
+    i32 new_count;
+    i32 added;
+    i32 removed;
+} diff_t;
+
+// Compares two texts line by line into `d`: the equal lines at both ends are trimmed bytewise, lines only one side
+// has are set aside by their hash, and Myers' O(ND) algorithm, in linear space, matches the rest. A minimal diff,
+// unless it would cost too much, where it settles for a longer one. Returns false when out of memory, or once
+// `cancel` is set, which is checked as it goes.
+bool diff_lines(const char *old, i32 old_len, const char *new, i32 new_len, const atomic_bool *cancel, diff_t *d);
+void diff_free(diff_t *d);
+
+// Bytes `a` and `b` have in common from the start, at most `n`; 16 at a time with SSE2.
+i32 diff_prefix(const char *a, const char *b, i32 n);
+// Bytes they have in common before `a_end` and `b_end`, at most `n`.
+i32 diff_suffix(const char *a_end, const char *b_end, i32 n);
+
+#endif
@@ -0,0 +1,101 @@
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include "draw_copy.h"
+
+#include <string.h>
+
+#include "alloc.h"
+#include "cimgui.h"
+
+// Copies into an ImVector's storage, grown with mem_realloc rather than ImGui's allocator: the copies are freed by
+// draw_copy_free, never by ImGui.
+static bool copy_vector(void **data, int *count, int *cap, const void *src, int src_count, usize item_size) {
+    if (src_count > *cap) {
+        int new_cap = max(src_count, *cap + *cap / 2);
+        void *p = mem_realloc(*data, (usize)new_cap * item_size);
+        if (!p) {
+            *count = 0;
+            return false;
+        }
+        *data = p;
+        *cap = new_cap;
+    }
+    if (src_count > 0) {
+        memcpy(*data, src, (usize)src_count * item_size);
+    }
+    *count = src_count;
+    return true;
+}
+
+#define COPY_VECTOR(dst, src) \
+    copy_vector((void **)&(dst).Data, &(dst).Size, &(dst).Capacity, (src).Data, (src).Size, sizeof(*(src).Data))
+
+static bool copy_list(ImDrawList *dst, const ImDrawList *src) {
+    dst->Flags = src->Flags;
+    // keys simgui's per-window buffers; window names live as long as the ImGui context
+    dst->_OwnerName = src->_OwnerName;
+    bool ok = COPY_VECTOR(dst->CmdBuffer, src->CmdBuffer) && COPY_VECTOR(dst->IdxBuffer, src->IdxBuffer) &&
+              COPY_VECTOR(dst->VtxBuffer, src->VtxBuffer);
+    if (!ok) {
+        dst->CmdBuffer.Size = 0;
+        dst->IdxBuffer.Size = 0;
+        dst->VtxBuffer.Size = 0;
+    }
+    return ok;
+}
+
+bool draw_copy_init(draw_copy_t *c) {
+    memset(c, 0, sizeof(*c));
+    c->data = mem_alloc(sizeof(ImDrawData));
+    if (!c->data) {
+        return false;
+    }
+    memset(c->data, 0, sizeof(ImDrawData));
+    return true;
+}
+
+void draw_copy_update(draw_copy_t *c, const ImDrawData *src) {
+    i32 count = src->Valid ? src->CmdListsCount : 0;
+    if (count > c->list_cap) {
+        ImDrawList **lists = mem_realloc(c->lists, (usize)count * sizeof(*lists));
+        if (lists) {
+            c->lists = lists;
+            for (; c->list_cap < count; c->list_cap++) {
+                lists[c->list_cap] = mem_alloc(sizeof(ImDrawList));
+                if (!lists[c->list_cap]) {
+                    break;
+                }
+                memset(lists[c->list_cap], 0, sizeof(ImDrawList));
+            }
+        }
+        count = min(count, c->list_cap);
+    }
+
+    ImDrawData *dst = c->data;
+    *dst = *src;
+    dst->OwnerViewport = NULL;
+    dst->TotalVtxCount = 0;
+    dst->TotalIdxCount = 0;
+    i32 copied = 0;
+    for (i32 i = 0; i < count; i++) {
+        ImDrawList *list = c->lists[copied];
+        if (copy_list(list, src->CmdLists.Data[i])) {
+            dst->TotalVtxCount += list->VtxBuffer.Size;
+            dst->TotalIdxCount += list->IdxBuffer.Size;
+            copied++;
+        }
+    }
+    dst->CmdListsCount = copied;
+    dst->CmdLists = (ImVector_ImDrawListPtr){.Size = copied, .Capacity = c->list_cap, .Data = c->lists};
+}
+
+void draw_copy_free(draw_copy_t *c) {
+    for (i32 i = 0; i < c->list_cap; i++) {
+        mem_free(c->lists[i]->CmdBuffer.Data);
+        mem_free(c->lists[i]->IdxBuffer.Data);
+        mem_free(c->lists[i]->VtxBuffer.Data);
+        mem_free(c->lists[i]);
+    }
+    mem_free(c->lists);
+    mem_free(c->data);
+    memset(c, 0, sizeof(*c));
+}
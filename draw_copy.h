@@ -0,0 +1,22 @@
+#ifndef AFAIRE_DRAW_COPY_H
+#define AFAIRE_DRAW_COPY_H
+
+#include "base.h"
+
+struct ImDrawData;
+struct ImDrawList;
+
+// A deep copy of one frame's ImDrawData that stays valid after the next igNewFrame, so the main thread can submit
+// it while the UI thread builds the following frame. Storage is reused from copy to copy and only grows.
+typedef struct {
+    struct ImDrawData *data;
+    struct ImDrawList **lists;
+    i32 list_cap;
+} draw_copy_t;
+
+bool draw_copy_init(draw_copy_t *c);
+// Draw lists that can't be allocated are left out of the copy.
+void draw_copy_update(draw_copy_t *c, const struct ImDrawData *src);
+void draw_copy_free(draw_copy_t *c);
+
+#endif
@@ -0,0 +1,520 @@
+// statx
+#define _GNU_SOURCE
+#include "fileio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FILEIO_HAVE_URING
+#endif
+#endif
+
+#if defined(FILEIO_HAVE_URING)
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Submission queue entries per ring; larger batches go through in several rounds.
+#define RING_ENTRIES 256
+// The result of an entry that didn't complete.
+#define RING_PENDING INT32_MIN
+#endif
+
+static struct {
+    fileio_backend_t backend;
+    bool have_uring;
+} io;
+
+static bool alloc_data(fileio_req_t *r) {
+    if (r->size >= INT32_MAX) {
+        r->error = EFBIG;
+        return false;
+    }
+    r->data = mem_alloc((usize)r->size + 1);
+    if (!r->data) {
+        r->error = ENOMEM;
+        return false;
+    }
+    return true;
+}
+
+static void set_stat(fileio_req_t *r, const struct stat *st) {
+    r->is_dir = S_ISDIR(st->st_mode);
+    r->is_file = S_ISREG(st->st_mode);
+    r->is_link = S_ISLNK(st->st_mode);
+#if defined(__APPLE__)
+    r->mtime = (i64)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    r->mtime = (i64)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+    r->size = (i64)st->st_size;
+}
+
+static void posix_stat(fileio_req_t *r) {
+    struct stat st;
+    if (fstatat(r->dir_fd, r->path, &st, r->no_follow ? AT_SYMLINK_NOFOLLOW : 0) != 0) {
+        r->error = errno;
+        return;
+    }
+    set_stat(r, &st);
+}
+
+static void posix_read(fileio_req_t *r) {
+    i32 fd = openat(r->dir_fd, r->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        r->error = errno;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        r->error = errno;
+    } else {
+        set_stat(r, &st);
+        alloc_data(r);
+    }
+    i64 done = 0;
+    while (r->error == 0 && done < r->size) {
+        ssize_t n = read(fd, r->data + done, (usize)(r->size - done));
+        if (n < 0 && errno != EINTR) {
+            r->error = errno;
+        } else if (n == 0) {
+            break;  // shrank since the stat
+        } else if (n > 0) {
+            done += n;
+        }
+    }
+    close(fd);
+    if (r->error != 0) {
+        mem_free(r->data);
+        r->data = NULL;
+        return;
+    }
+    r->data[done] = '\0';
+    r->len = (i32)done;
+}
+
+static void posix_write(fileio_req_t *r) {
+    i32 fd = openat(r->dir_fd, r->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        r->error = errno;
+        return;
+    }
+    i64 done = 0;
+    while (done < r->len) {
+        ssize_t n = write(fd, r->data + done, (usize)(r->len - done));
+        if (n < 0 && errno != EINTR) {
+            r->error = errno;
+            break;
+        }
+        done += n > 0 ? n : 0;
+    }
+    struct stat st;
+    if (r->error == 0 && fstat(fd, &st) == 0) {
+        set_stat(r, &st);
+    }
+    if (close(fd) != 0 && r->error == 0) {
+        r->error = errno;
+    }
+}
+
+static void posix_run(fileio_req_t *reqs, i32 count) {
+    for (i32 i = 0; i < count; i++) {
+        fileio_req_t *r = &reqs[i];
+        r->error = 0;
+        if (r->op == FILEIO_STAT) {
+            posix_stat(r);
+        } else if (r->op == FILEIO_READ) {
+            r->data = NULL;
+            r->len = 0;
+            posix_read(r);
+        } else {
+            posix_write(r);
+        }
+    }
+}
+
+#if defined(FILEIO_HAVE_URING)
+
+// The rings are mapped in, as liburing would, without depending on it.
+typedef struct {
+    i32 fd;
+    u32 entries;
+    u32 *sq_head;
+    u32 *sq_tail;
+    u32 *sq_mask;
+    u32 *sq_array;
+    struct io_uring_sqe *sqes;
+    u32 *cq_head;
+    u32 *cq_tail;
+    u32 *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    usize sq_ring_size;
+    void *cq_ring;
+    usize cq_ring_size;
+    usize sqes_size;
+} ring_t;
+
+static void ring_free(ring_t *r) {
+    if (r->sqes) {
+        munmap(r->sqes, r->sqes_size);
+    }
+    if (r->cq_ring && r->cq_ring != r->sq_ring) {
+        munmap(r->cq_ring, r->cq_ring_size);
+    }
+    if (r->sq_ring) {
+        munmap(r->sq_ring, r->sq_ring_size);
+    }
+    close(r->fd);
+}
+
+static bool ring_init(ring_t *r, u32 entries) {
+    *r = (ring_t){0};
+    struct io_uring_params p = {0};
+    r->fd = (i32)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) {
+        return false;
+    }
+    r->entries = p.sq_entries;
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(u32);
+    r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->sq_ring_size = r->cq_ring_size = max(r->sq_ring_size, r->cq_ring_size);
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+                      IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+        r->sq_ring = NULL;
+        ring_free(r);
+        return false;
+    }
+    r->cq_ring = r->sq_ring;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+                          IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            r->cq_ring = NULL;
+            ring_free(r);
+            return false;
+        }
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        ring_free(r);
+        return false;
+    }
+    u8 *sq = r->sq_ring, *cq = r->cq_ring;
+    r->sq_head = (u32 *)(sq + p.sq_off.head);
+    r->sq_tail = (u32 *)(sq + p.sq_off.tail);
+    r->sq_mask = (u32 *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (u32 *)(sq + p.sq_off.array);
+    r->cq_head = (u32 *)(cq + p.cq_off.head);
+    r->cq_tail = (u32 *)(cq + p.cq_off.tail);
+    r->cq_mask = (u32 *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return true;
+}
+
+// Pushes `count` prepared entries through the ring and stores each one's result, a value or -errno, in `res`;
+// RING_PENDING for those a failure left unfinished. No more than `entries` are ever in flight, so the completion
+// queue, twice as large, can't overflow.
+static bool ring_run(ring_t *r, const struct io_uring_sqe *ops, i32 count, i32 *res) {
+    for (i32 k = 0; k < count; k++) {
+        res[k] = RING_PENDING;
+    }
+    i32 next = 0, done = 0;
+    while (done < count) {
+        u32 tail = *r->sq_tail;
+        while (next < count && (u32)(next - done) < r->entries) {
+            u32 index = tail & *r->sq_mask;
+            r->sqes[index] = ops[next];
+            r->sqes[index].user_data = (u64)next;
+            r->sq_array[index] = index;
+            tail++;
+            next++;
+        }
+        __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+        u32 to_submit = tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        bool failed = syscall(__NR_io_uring_enter, r->fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+                      errno != EINTR && errno != EAGAIN && errno != EBUSY;
+        // what completed before a failure is still collected
+        u32 head = *r->cq_head;
+        u32 cq_tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail; head++) {
+            const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+            res[cqe->user_data] = cqe->res;
+            done++;
+        }
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+        if (failed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+
+static void ring_destroy(void *p) {
+    ring_free(p);
+    mem_free(p);
+}
+
+static void ring_key_init(void) {
+    pthread_key_create(&ring_key, ring_destroy);
+}
+
+// One ring per thread, closed when the thread exits.
+static ring_t *thread_ring(void) {
+    pthread_once(&ring_once, ring_key_init);
+    ring_t *r = pthread_getspecific(ring_key);
+    if (!r) {
+        r = mem_alloc(sizeof(*r));
+        if (!r || !ring_init(r, RING_ENTRIES)) {
+            mem_free(r);
+            return NULL;
+        }
+        pthread_setspecific(ring_key, r);
+    }
+    return r;
+}
+
+static void drop_ring(ring_t *r) {
+    pthread_setspecific(ring_key, NULL);
+    ring_destroy(r);
+}
+
+static struct io_uring_sqe sqe_openat(i32 dir_fd, const char *path, i32 flags) {
+    return (struct io_uring_sqe){
+        .opcode = IORING_OP_OPENAT, .fd = dir_fd, .addr = (u64)(uptr)path, .len = 0666, .open_flags = (u32)flags};
+}
+
+static struct io_uring_sqe sqe_statx(i32 dir_fd, const char *path, i32 flags, struct statx *sx) {
+    return (struct io_uring_sqe){.opcode = IORING_OP_STATX,
+                                 .fd = dir_fd,
+                                 .addr = (u64)(uptr)path,
+                                 .len = STATX_BASIC_STATS,
+                                 .off = (u64)(uptr)sx,
+                                 .statx_flags = (u32)flags};
+}
+
+static struct io_uring_sqe sqe_rw(u8 opcode, i32 fd, char *buf, i64 offset, i64 len) {
+    return (struct io_uring_sqe){
+        .opcode = opcode, .fd = fd, .addr = (u64)(uptr)buf, .len = (u32)len, .off = (u64)offset};
+}
+
+static void set_statx(fileio_req_t *r, const struct statx *sx) {
+    r->is_dir = S_ISDIR(sx->stx_mode);
+    r->is_file = S_ISREG(sx->stx_mode);
+    r->is_link = S_ISLNK(sx->stx_mode);
+    r->mtime = sx->stx_mtime.tv_sec * 1000000000 + sx->stx_mtime.tv_nsec;
+    r->size = (i64)sx->stx_size;
+}
+
+// Each step of every request goes out together: opens and stats, then reads and writes (again for short ones), then
+// closes and the stats of written files.
+static bool uring_run(ring_t *ring, fileio_req_t *reqs, i32 count) {
+    struct io_uring_sqe *ops = mem_alloc((usize)count * 2 * sizeof(*ops));
+    i32 *res = mem_alloc((usize)count * 2 * sizeof(*res));
+    i32 *owner = mem_alloc((usize)count * 2 * sizeof(*owner));  // request index * 2, + 1 for a stat
+    struct statx *sx = mem_alloc((usize)count * sizeof(*sx));
+    i32 *fds = mem_alloc((usize)count * sizeof(*fds));
+    i64 *done = mem_alloc((usize)count * sizeof(*done));
+    if (!ops || !res || !owner || !sx || !fds || !done) {
+        mem_free(ops);
+        mem_free(res);
+        mem_free(owner);
+        mem_free(sx);
+        mem_free(fds);
+        mem_free(done);
+        return false;
+    }
+    memset(done, 0, (usize)count * sizeof(*done));
+
+    bool ok = true;
+    i32 n = 0;
+    for (i32 i = 0; i < count; i++) {
+        fileio_req_t *r = &reqs[i];
+        r->error = 0;
+        fds[i] = -1;
+        if (r->op == FILEIO_READ) {
+            r->data = NULL;
+            r->len = 0;
+        }
+        if (r->op != FILEIO_WRITE) {
+            i32 flags = r->op == FILEIO_STAT && r->no_follow ? AT_SYMLINK_NOFOLLOW : 0;
+            ops[n] = sqe_statx(r->dir_fd, r->path, flags, &sx[i]);
+            owner[n++] = i * 2 + 1;
+        }
+        if (r->op != FILEIO_STAT) {
+            i32 flags = r->op == FILEIO_READ ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
+            ops[n] = sqe_openat(r->dir_fd, r->path, flags | O_CLOEXEC);
+            owner[n++] = i * 2;
+        }
+    }
+    ok = ring_run(ring, ops, n, res);
+    // the opens that went through before a failure still have a file to close
+    for (i32 k = 0; k < n; k++) {
+        fileio_req_t *r = &reqs[owner[k] / 2];
+        if (res[k] == RING_PENDING) {
+            continue;
+        } else if (res[k] < 0) {
+            r->error = r->error ? r->error : -res[k];
+        } else if (owner[k] % 2) {
+            set_statx(r, &sx[owner[k] / 2]);
+        } else {
+            fds[owner[k] / 2] = res[k];
+        }
+    }
+    for (i32 i = 0; ok && i < count; i++) {
+        if (reqs[i].op == FILEIO_READ && reqs[i].error == 0) {
+            alloc_data(&reqs[i]);
+        }
+    }
+
+    // reads stop at the size from the stat, or earlier if the file shrank
+    for (bool more = ok; more && ok;) {
+        n = 0;
+        for (i32 i = 0; i < count; i++) {
+            fileio_req_t *r = &reqs[i];
+            i64 want = r->op == FILEIO_READ ? r->size : r->len;
+            if (r->op == FILEIO_STAT || r->error != 0 || done[i] >= want) {
+                continue;
+            }
+            u8 opcode = r->op == FILEIO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+            ops[n] = sqe_rw(opcode, fds[i], r->data + done[i], done[i], min(want - done[i], (i64)INT32_MAX));
+            owner[n++] = i;
+        }
+        more = n > 0;
+        ok = ok && ring_run(ring, ops, n, res);
+        for (i32 k = 0; ok && k < n; k++) {
+            fileio_req_t *r = &reqs[owner[k]];
+            if (res[k] < 0 && res[k] != -EINTR && res[k] != -EAGAIN) {
+                r->error = -res[k];
+            } else if (res[k] == 0 && r->op == FILEIO_READ) {
+                r->size = done[owner[k]];
+            } else if (res[k] > 0) {
+                done[owner[k]] += res[k];
+            }
+        }
+    }
+
+    n = 0;
+    for (i32 i = 0; ok && i < count; i++) {
+        fileio_req_t *r = &reqs[i];
+        if (fds[i] >= 0) {
+            ops[n] = (struct io_uring_sqe){.opcode = IORING_OP_CLOSE, .fd = fds[i]};
+            owner[n++] = i * 2;
+        }
+        if (r->op == FILEIO_WRITE && r->error == 0) {
+            ops[n] = sqe_statx(r->dir_fd, r->path, 0, &sx[i]);
+            owner[n++] = i * 2 + 1;
+        }
+    }
+    ok = ok && ring_run(ring, ops, n, res);
+    for (i32 k = 0; k < n; k++) {
+        fileio_req_t *r = &reqs[owner[k] / 2];
+        if (res[k] == RING_PENDING) {
+            continue;
+        }
+        if (owner[k] % 2 == 0) {
+            fds[owner[k] / 2] = -1;
+        }
+        if (res[k] < 0) {
+            r->error = r->error ? r->error : -res[k];
+        } else if (owner[k] % 2) {
+            set_statx(r, &sx[owner[k] / 2]);
+        }
+    }
+    if (!ok) {
+        // requests may still be in flight, into the buffers below: only closing the ring cancels them
+        drop_ring(ring);
+        // then what they used can go
+        for (i32 i = 0; i < count; i++) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+    }
+    for (i32 i = 0; i < count; i++) {
+        fileio_req_t *r = &reqs[i];
+        if (r->op != FILEIO_READ) {
+            continue;
+        }
+        if (!ok || r->error != 0) {
+            mem_free(r->data);
+            r->data = NULL;
+        } else {
+            r->data[done[i]] = '\0';
+            r->len = (i32)done[i];
+        }
+    }
+    mem_free(ops);
+    mem_free(res);
+    mem_free(owner);
+    mem_free(sx);
+    mem_free(fds);
+    mem_free(done);
+    return ok;
+}
+
+static bool uring_probe(void) {
+    ring_t ring;
+    if (!ring_init(&ring, 4)) {
+        return false;
+    }
+    static const u8 used[] = {IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE};
+    usize size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    bool ok = probe && syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (usize i = 0; ok && i < sizeof(used); i++) {
+        ok = used[i] <= probe->last_op && (probe->ops[used[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    ring_free(&ring);
+    return ok;
+}
+
+#endif
+
+void fileio_init(bool posix) {
+#if defined(FILEIO_HAVE_URING)
+    io.have_uring = uring_probe();
+#endif
+    io.backend = io.have_uring && !posix ? FILEIO_URING : FILEIO_POSIX;
+}
+
+fileio_backend_t fileio_backend(void) {
+    return io.backend;
+}
+
+void fileio_set_backend(fileio_backend_t backend) {
+    io.backend = io.have_uring ? backend : FILEIO_POSIX;
+}
+
+const char *fileio_backend_name(fileio_backend_t backend) {
+    return backend == FILEIO_URING ? "io_uring" : "posix";
+}
+
+void fileio_run(fileio_req_t *reqs, i32 count) {
+#if defined(FILEIO_HAVE_URING)
+    ring_t *ring = io.backend == FILEIO_URING && count > 1 ? thread_ring() : NULL;
+    // out of memory, or the ring broke: the whole batch is redone the plain way
+    if (ring && uring_run(ring, reqs, count)) {
+        return;
+    }
+#endif
+    posix_run(reqs, count);
+}
@@ -0,0 +1,44 @@
+#ifndef AFAIRE_FILEIO_H
+#define AFAIRE_FILEIO_H
+
+#include "base.h"
+
+typedef enum {
+    FILEIO_STAT,
+    FILEIO_READ,   // the whole file
+    FILEIO_WRITE,  // replaces the file's contents
+} fileio_op_t;
+
+typedef struct {
+    fileio_op_t op;
+    i32 dir_fd;  // where a relative path starts, AT_FDCWD for the working directory
+    const char *path;
+    bool no_follow;  // stat: of a symlink itself rather than of what it points to
+    // read: the contents, NUL-terminated and allocated with mem_alloc; write: the bytes to write
+    char *data;
+    i32 len;
+    // the file as found, or for a write as left; symlinks are followed
+    bool is_dir;
+    bool is_file;
+    bool is_link;  // only with `no_follow`
+    i64 mtime;  // ns
+    i64 size;
+    i32 error;  // errno of the step that failed, 0 on success; EFBIG for files too large to read
+} fileio_req_t;
+
+typedef enum {
+    FILEIO_POSIX,  // one blocking call after the other; run batches on the job pool for parallelism
+    FILEIO_URING,  // a batch goes out in a few io_uring submissions, one per step, whatever its size (Linux 5.6+)
+} fileio_backend_t;
+
+// Picks io_uring when the kernel supports every operation used, unless `posix` is set.
+void fileio_init(bool posix);
+fileio_backend_t fileio_backend(void);
+void fileio_set_backend(fileio_backend_t backend);  // falls back to FILEIO_POSIX if io_uring is unavailable
+const char *fileio_backend_name(fileio_backend_t backend);
+
+// Runs the requests on the calling thread and fills in their results. A lone request always takes the POSIX path:
+// a ring only pays off when several requests share its submissions.
+void fileio_run(fileio_req_t *reqs, i32 count);
+
+#endif
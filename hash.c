@@ -0,0 +1,150 @@
+#include "hash.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define PRIME32_1 0x9E3779B1u
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+#define STRIPE 64
+#define STRIPES_PER_BLOCK 16
+
+static const u64 secret[8] = {
+    0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+    0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+};
+
+static inline u64 read64(const u8 *p) {
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u32 read32(const u8 *p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u64 rotl64(u64 x, i32 r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline u64 avalanche(u64 h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline u64 mix(u64 a, u64 b) {
+    a *= PRIME64_2;
+    a = rotl64(a, 31) * PRIME64_1;
+    return rotl64(a ^ b, 27) * PRIME64_1 + PRIME64_4;
+}
+
+#if defined(__SSE2__)
+static void accumulate(u64 *acc, const u8 *p, usize stripes) {
+    __m128i a[4];
+    __m128i k[4];
+    for (i32 i = 0; i < 4; i++) {
+        a[i] = _mm_loadu_si128((const __m128i *)(acc + 2 * i));
+        k[i] = _mm_loadu_si128((const __m128i *)(secret + 2 * i));
+    }
+    for (usize s = 0; s < stripes; s++, p += STRIPE) {
+        for (i32 i = 0; i < 4; i++) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+            __m128i dk = _mm_xor_si128(d, k[i]);
+            __m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (i32 i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i *)(acc + 2 * i), a[i]);
+    }
+}
+
+static void scramble(u64 *acc) {
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    for (i32 i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(acc + 2 * i));
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)(secret + 2 * i)));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        _mm_storeu_si128((__m128i *)(acc + 2 * i), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+#else
+static void accumulate(u64 *acc, const u8 *p, usize stripes) {
+    for (usize s = 0; s < stripes; s++, p += STRIPE) {
+        for (i32 i = 0; i < 8; i++) {
+            u64 d = read64(p + 8 * i);
+            u64 dk = d ^ secret[i];
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xffffffffu) * (dk >> 32);
+        }
+    }
+}
+
+static void scramble(u64 *acc) {
+    for (i32 i = 0; i < 8; i++) {
+        u64 a = acc[i];
+        a ^= a >> 47;
+        a ^= secret[i];
+        acc[i] = a * PRIME32_1;
+    }
+}
+#endif
+
+static u64 hash_short(const u8 *p, usize len, u64 seed) {
+    u64 h = seed + PRIME64_5 + len;
+    const u8 *end = p + len;
+    for (; p + 8 <= end; p += 8) {
+        h ^= rotl64(read64(p) * PRIME64_2, 31) * PRIME64_1;
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= (u64)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+    return avalanche(h);
+}
+
+u64 hash64(const void *data, usize len, u64 seed) {
+    const u8 *p = data;
+    if (len < STRIPE) {
+        return hash_short(p, len, seed);
+    }
+    u64 acc[8] = {PRIME32_1, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_1, PRIME64_5, PRIME64_1 + seed};
+    usize stripes = (len - 1) / STRIPE;
+    usize done = 0;
+    for (; done + STRIPES_PER_BLOCK <= stripes; done += STRIPES_PER_BLOCK) {
+        accumulate(acc, p + done * STRIPE, STRIPES_PER_BLOCK);
+        scramble(acc);
+    }
+    accumulate(acc, p + done * STRIPE, stripes - done);
+    // the last stripe always ends at the input's end, overlapping the previous one when len isn't a multiple of 64
+    accumulate(acc, p + len - STRIPE, 1);
+
+    u64 h = (u64)len * PRIME64_1 + seed;
+    for (i32 i = 0; i < 4; i++) {
+        h += mix(acc[2 * i], acc[2 * i + 1]);
+    }
+    return avalanche(h);
+}
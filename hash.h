@@ -0,0 +1,10 @@
+#ifndef AFAIRE_HASH_H
+#define AFAIRE_HASH_H
+
+#include "base.h"
+
+// 64-bit non-cryptographic hash in the style of XXH3: eight 64-bit lanes over 64-byte stripes, vectorized with
+// SSE2 where available. The scalar and SIMD paths produce the same value.
+u64 hash64(const void *data, usize len, u64 seed);
+
+#endif
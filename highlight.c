@@ -0,0 +1,193 @@
+#include "highlight.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "task.h"
+
+#define RGB(r, g, b) (0xff000000u | ((u32)(b) << 16) | ((u32)(g) << 8) | (u32)(r))
+
+enum { STATE_NORMAL, STATE_FENCE };
+
+const u32 highlight_colors[HL_COUNT] = {
+    [HL_TEXT] = RGB(255, 255, 255),  [HL_HEADING] = RGB(84, 171, 219), [HL_CHECKBOX] = RGB(229, 192, 123),
+    [HL_DONE] = RGB(128, 128, 128),  [HL_DATE] = RGB(152, 195, 121),    [HL_TAG] = RGB(198, 120, 221),
+    [HL_CODE] = RGB(209, 154, 102),
+};
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static u8 end_state(const text_t *text, i32 line, u8 state) {
+    const char *p = text->data + text_line_start(text, line);
+    const char *end = text->data + text_line_end(text, line);
+    if (task_is_fence(p, end)) {
+        return state == STATE_FENCE ? STATE_NORMAL : STATE_FENCE;
+    }
+    return state;
+}
+
+static bool reserve(highlight_t *hl, i32 count) {
+    if (count <= hl->cap) {
+        return true;
+    }
+    i32 cap = max(count, hl->cap * 2);
+    u8 *states = mem_realloc(hl->states, (usize)cap);
+    if (!states) {
+        return false;
+    }
+    hl->states = states;
+    hl->cap = cap;
+    return true;
+}
+
+void highlight_reset(highlight_t *hl, const text_t *text) {
+    hl->count = 0;
+    hl->valid = 0;
+    if (!reserve(hl, text_line_count(text))) {
+        return;
+    }
+    hl->count = text_line_count(text);
+    hl->states[0] = STATE_NORMAL;
+    hl->valid = 1;
+}
+
+void highlight_free(highlight_t *hl) {
+    mem_free(hl->states);
+    memset(hl, 0, sizeof(*hl));
+}
+
+void highlight_edit(highlight_t *hl, const text_t *text, i32 pos, i32 removed, i32 inserted) {
+    (void)removed;
+    i32 count = text_line_count(text);
+    if (hl->valid == 0 || !reserve(hl, count)) {
+        highlight_reset(hl, text);
+        return;
+    }
+    i32 delta = count - hl->count;
+    i32 first = text_line_of(text, pos);
+    i32 last = text_line_of(text, pos + inserted);
+    // old lines after the edited range keep their states, shifted by the change in line count
+    i32 old_tail = last - delta + 1;
+    if (old_tail < hl->count) {
+        memmove(&hl->states[last + 1], &hl->states[old_tail], (usize)(hl->count - old_tail));
+    }
+    hl->count = count;
+    if (hl->valid <= first) {
+        return;
+    }
+    hl->valid = min(count, max(first + 1, hl->valid + delta));
+    for (i32 line = first; line + 1 < hl->valid; line++) {
+        u8 next = end_state(text, line, hl->states[line]);
+        if (line >= last && hl->states[line + 1] == next) {
+            break;
+        }
+        hl->states[line + 1] = next;
+    }
+}
+
+static void push(hl_span_t *spans, i32 *n, i32 max_spans, i32 start, i32 end, hl_kind_t kind) {
+    if (end <= start) {
+        return;
+    }
+    if (*n > 0 && (spans[*n - 1].kind == kind || *n == max_spans)) {
+        spans[*n - 1].end = end;
+        return;
+    }
+    spans[(*n)++] = (hl_span_t){start, end, kind};
+}
+
+static bool is_date(const char *p, const char *end) {
+    static const char pattern[] = "dddd-dd-dd";
+    if (end - p < 10) {
+        return false;
+    }
+    for (i32 i = 0; i < 10; i++) {
+        if (pattern[i] == 'd' ? !is_digit(p[i]) : p[i] != pattern[i]) {
+            return false;
+        }
+    }
+    return end - p == 10 || !is_digit(p[10]);
+}
+
+i32 highlight_line(highlight_t *hl, const text_t *text, i32 line, hl_span_t *spans, i32 max_spans) {
+    if (hl->count != text_line_count(text) || hl->valid == 0) {
+        highlight_reset(hl, text);
+    }
+    const char *data = text->data;
+    const i32 start = text_line_start(text, line);
+    const i32 end = text_line_end(text, line);
+    i32 n = 0;
+    // out of memory for the line states: drawn plain until a later reset gets them
+    if (hl->valid == 0 || !hl->states) {
+        push(spans, &n, max_spans, start, end, HL_TEXT);
+        return n;
+    }
+    while (hl->valid <= line) {
+        hl->states[hl->valid] = end_state(text, hl->valid - 1, hl->states[hl->valid - 1]);
+        hl->valid++;
+    }
+
+    if (hl->states[line] == STATE_FENCE || task_is_fence(data + start, data + end)) {
+        push(spans, &n, max_spans, start, end, HL_CODE);
+        return n;
+    }
+
+    i32 i = start;
+    while (i < end && i - start < 6 && data[i] == '#') {
+        i++;
+    }
+    if (i > start && (i == end || data[i] == ' ')) {
+        push(spans, &n, max_spans, start, end, HL_HEADING);
+        return n;
+    }
+
+    hl_kind_t base = HL_TEXT;
+    i = start;
+    i32 mark = task_mark(data + start, end - start);
+    if (mark >= 0) {
+        i = start + mark - 3;  // the bullet
+        push(spans, &n, max_spans, start, i, HL_TEXT);
+        push(spans, &n, max_spans, i, i + 5, HL_CHECKBOX);
+        if (data[i + 3] != ' ') {
+            push(spans, &n, max_spans, i + 5, end, HL_DONE);
+            return n;
+        }
+        i += 5;
+    }
+
+    i32 run = i;
+    while (i < end) {
+        char c = data[i];
+        bool boundary = i == start || data[i - 1] == ' ' || data[i - 1] == '\t' || data[i - 1] == '(';
+        i32 token_end = i;
+        hl_kind_t kind = base;
+        if (c == '`') {
+            const char *close = memchr(data + i + 1, '`', (usize)(end - i - 1));
+            if (close) {
+                token_end = (i32)(close - data) + 1;
+                kind = HL_CODE;
+            }
+        } else if (c == '#' && boundary && i + 1 < end && task_is_tag_char(data[i + 1])) {
+            token_end = i + 1;
+            while (token_end < end && task_is_tag_char(data[token_end])) {
+                token_end++;
+            }
+            kind = HL_TAG;
+        } else if (is_digit(c) && (i == start || !is_digit(data[i - 1])) && is_date(data + i, data + end)) {
+            token_end = i + 10;
+            kind = HL_DATE;
+        }
+        if (kind == base) {
+            i++;
+            continue;
+        }
+        push(spans, &n, max_spans, run, i, base);
+        push(spans, &n, max_spans, i, token_end, kind);
+        i = run = token_end;
+    }
+    push(spans, &n, max_spans, run, end, base);
+    return n;
+}
@@ -0,0 +1,43 @@
+#ifndef AFAIRE_HIGHLIGHT_H
+#define AFAIRE_HIGHLIGHT_H
+
+#include "base.h"
+#include "text.h"
+
+typedef enum {
+    HL_TEXT,
+    HL_HEADING,
+    HL_CHECKBOX,
+    HL_DONE,
+    HL_DATE,
+    HL_TAG,
+    HL_CODE,
+    HL_COUNT,
+} hl_kind_t;
+
+// Packed like IM_COL32; HL_TEXT is drawn with the style's text color.
+extern const u32 highlight_colors[HL_COUNT];
+
+typedef struct {
+    i32 start;
+    i32 end;
+    hl_kind_t kind;
+} hl_span_t;
+
+// Lexer state at the start of every line. Only lines [0, valid) are known; the rest are lexed on demand when they
+// are drawn, and edits re-lex from the edited line until the stored states match again.
+typedef struct {
+    u8 *states;
+    i32 count;
+    i32 cap;
+    i32 valid;
+} highlight_t;
+
+void highlight_reset(highlight_t *hl, const text_t *text);
+void highlight_free(highlight_t *hl);
+// Must be called after every text_replace, with the same arguments in post-edit offsets.
+void highlight_edit(highlight_t *hl, const text_t *text, i32 pos, i32 removed, i32 inserted);
+// Fills `spans` covering the whole line in order and returns how many were written.
+i32 highlight_line(highlight_t *hl, const text_t *text, i32 line, hl_span_t *spans, i32 max_spans);
+
+#endif
@@ -0,0 +1,581 @@
+#define _GNU_SOURCE
+#include "history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "hash.h"
+
+#define CHUNK_MIN 512
+#define CHUNK_AVG 2048
+#define CHUNK_MAX 16384
+// Cut where the top bits of the rolling hash are zero: more of them before CHUNK_AVG, fewer after, so sizes bunch up
+// around it (FastCDC's normalized chunking). The top bits depend on the last 64 bytes.
+#define MASK_HARD (~0ull << (64 - 13))
+#define MASK_EASY (~0ull << (64 - 9))
+#define VERSION_MAGIC 0x31766661u  // "afv1"
+
+// The store is three append-only files: `pack` holds the chunks' bytes, `chunks` an entry per chunk, whose index is
+// the chunk's id, and `versions` a record per version. They're written in that order, so a crash leaves at worst a
+// torn record at the end of one, which the next writer cuts off.
+typedef struct {
+    u64 hash[2];
+    u64 offset;  // in the pack
+    u32 len;
+    u32 pad;
+} chunk_entry_t;
+
+// Followed by the path, padded to 4 bytes, and the ids of the chunks.
+typedef struct {
+    u32 magic;
+    u32 path_len;
+    u32 count;
+    u32 pad;
+    i64 time;
+    i64 size;
+    u64 hash;
+} version_header_t;
+
+typedef struct {
+    u64 path_hash;
+    u32 path;  // offset into `paths`
+    u32 count;
+    i64 time;
+    i64 size;
+    u64 hash;
+    u64 offset;  // of the record
+} version_t;
+
+struct history {
+    pthread_mutex_t lock;
+    i32 pack_fd;
+    i32 chunks_fd;
+    i32 versions_fd;  // flock()ed by the instance writing
+    chunk_entry_t *chunks;
+    u32 chunk_count;
+    u32 chunk_cap;
+    u32 *table;  // chunk id + 1 by hash, open addressing, 0 when free
+    u32 table_cap;
+    version_t *versions;
+    u32 version_count;
+    u32 version_cap;
+    char *paths;
+    u32 paths_len;
+    u32 paths_cap;
+    u64 versions_end;  // of the records read
+    history_stats_t stats;
+};
+
+static u64 gear[256];
+static pthread_once_t gear_once = PTHREAD_ONCE_INIT;
+
+// Any fixed random table will do, as long as every version of afaire cuts the same way.
+static void gear_init(void) {
+    u64 x = 0x6166616972650000ull;
+    for (i32 i = 0; i < 256; i++) {
+        u64 z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+// Length of the chunk starting at `p`.
+static i32 chunk_len(const u8 *p, i32 n) {
+    if (n <= CHUNK_MIN) {
+        return n;
+    }
+    i32 end = min(n, CHUNK_MAX), normal = min(end, CHUNK_AVG);
+    u64 h = 0;
+    i32 i = CHUNK_MIN;
+    for (; i < normal; i++) {
+        h = (h << 1) + gear[p[i]];
+        if (!(h & MASK_HARD)) {
+            return i + 1;
+        }
+    }
+    for (; i < end; i++) {
+        h = (h << 1) + gear[p[i]];
+        if (!(h & MASK_EASY)) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+static bool grow(void **data, u32 *cap, u32 need, usize item) {
+    if (need <= *cap) {
+        return true;
+    }
+    u32 cap2 = max(need, max(64u, *cap * 2));
+    void *p = mem_realloc(*data, (usize)cap2 * item);
+    if (!p) {
+        return false;
+    }
+    *data = p;
+    *cap = cap2;
+    return true;
+}
+
+static bool read_at(i32 fd, void *buf, usize len, u64 offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, (off_t)offset);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf = (char *)buf + n;
+        len -= (usize)n;
+        offset += (u64)n;
+    }
+    return true;
+}
+
+static bool write_at(i32 fd, const void *buf, usize len, u64 offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf = (const char *)buf + n;
+        len -= (usize)n;
+        offset += (u64)n;
+    }
+    return true;
+}
+
+static u64 file_size(i32 fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? (u64)st.st_size : 0;
+}
+
+static u32 table_find(const history_t *h, const u64 hash[2]) {
+    if (h->table_cap == 0) {
+        return UINT32_MAX;
+    }
+    for (u32 i = (u32)hash[0] & (h->table_cap - 1);; i = (i + 1) & (h->table_cap - 1)) {
+        u32 id = h->table[i];
+        if (id == 0) {
+            return UINT32_MAX;
+        }
+        const chunk_entry_t *c = &h->chunks[id - 1];
+        if (c->hash[0] == hash[0] && c->hash[1] == hash[1]) {
+            return id - 1;
+        }
+    }
+}
+
+static void table_put(history_t *h, u32 id) {
+    u32 i = (u32)h->chunks[id].hash[0] & (h->table_cap - 1);
+    while (h->table[i] != 0) {
+        i = (i + 1) & (h->table_cap - 1);
+    }
+    h->table[i] = id + 1;
+}
+
+// Indexes chunks [from, chunk_count), at most half full.
+static bool table_add(history_t *h, u32 from) {
+    if (h->chunk_count * 2 > h->table_cap) {
+        u32 cap = max(1024u, h->table_cap);
+        while (h->chunk_count * 2 > cap) {
+            cap *= 2;
+        }
+        u32 *table = mem_alloc((usize)cap * sizeof(u32));
+        if (!table) {
+            return false;
+        }
+        memset(table, 0, (usize)cap * sizeof(u32));
+        mem_free(h->table);
+        h->table = table;
+        h->table_cap = cap;
+        from = 0;
+    }
+    for (u32 id = from; id < h->chunk_count; id++) {
+        table_put(h, id);
+    }
+    return true;
+}
+
+static u32 pad4(u32 n) {
+    return (n + 3) & ~3u;
+}
+
+static bool add_version(history_t *h, const version_header_t *v, const char *path, u64 offset) {
+    if (!grow((void **)&h->versions, &h->version_cap, h->version_count + 1, sizeof(version_t)) ||
+        !grow((void **)&h->paths, &h->paths_cap, h->paths_len + v->path_len + 1, 1)) {
+        return false;
+    }
+    memcpy(h->paths + h->paths_len, path, v->path_len);
+    h->paths[h->paths_len + v->path_len] = '\0';
+    h->versions[h->version_count++] = (version_t){
+        .path_hash = hash64(path, v->path_len, 0),
+        .path = h->paths_len,
+        .count = v->count,
+        .time = v->time,
+        .size = v->size,
+        .hash = v->hash,
+        .offset = offset,
+    };
+    h->paths_len += v->path_len + 1;
+    return true;
+}
+
+// Reads what was appended since the last call, by this instance or another, cutting off a torn tail. Under the file
+// lock.
+static bool catch_up(history_t *h) {
+    u64 size = file_size(h->chunks_fd);
+    u32 count = (u32)(size / sizeof(chunk_entry_t));
+    if (size % sizeof(chunk_entry_t) != 0 && ftruncate(h->chunks_fd, (off_t)count * sizeof(chunk_entry_t)) != 0) {
+        return false;
+    }
+    if (count > h->chunk_count) {
+        u32 from = h->chunk_count;
+        if (!grow((void **)&h->chunks, &h->chunk_cap, count, sizeof(chunk_entry_t)) ||
+            !read_at(h->chunks_fd, h->chunks + from, (usize)(count - from) * sizeof(chunk_entry_t),
+                     (u64)from * sizeof(chunk_entry_t))) {
+            return false;
+        }
+        h->chunk_count = count;
+        if (!table_add(h, from)) {
+            h->chunk_count = from;
+            return false;
+        }
+    }
+
+    size = file_size(h->versions_fd);
+    if (size > h->versions_end) {
+        usize len = (usize)(size - h->versions_end);
+        char *buf = mem_alloc(len);
+        if (!buf || !read_at(h->versions_fd, buf, len, h->versions_end)) {
+            mem_free(buf);
+            return false;
+        }
+        usize at = 0;
+        while (len - at >= sizeof(version_header_t)) {
+            version_header_t v;
+            memcpy(&v, buf + at, sizeof(v));
+            // padded in usize, as pad4() would wrap on a bad length, then checked against what is left
+            usize rest = len - at - sizeof(v);
+            usize path = ((usize)v.path_len + 3) & ~(usize)3;
+            if (v.magic != VERSION_MAGIC || path > rest || (usize)v.count * sizeof(u32) > rest - path ||
+                !add_version(h, &v, buf + at + sizeof(v), h->versions_end + at)) {
+                break;
+            }
+            at += sizeof(v) + path + (usize)v.count * sizeof(u32);
+        }
+        mem_free(buf);
+        h->versions_end += at;
+        if (at < len && ftruncate(h->versions_fd, (off_t)h->versions_end) != 0) {
+            return false;
+        }
+    }
+    h->stats.chunks = h->chunk_count;
+    h->stats.versions = h->version_count;
+    h->stats.pack_bytes = file_size(h->pack_fd);
+    return true;
+}
+
+// Takes the store for this thread and instance, up to date; false, holding nothing, when it can't.
+static bool enter(history_t *h) {
+    pthread_mutex_lock(&h->lock);
+    while (flock(h->versions_fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            pthread_mutex_unlock(&h->lock);
+            return false;
+        }
+    }
+    if (!catch_up(h)) {
+        flock(h->versions_fd, LOCK_UN);
+        pthread_mutex_unlock(&h->lock);
+        return false;
+    }
+    return true;
+}
+
+static void leave(history_t *h) {
+    flock(h->versions_fd, LOCK_UN);
+    pthread_mutex_unlock(&h->lock);
+}
+
+static bool make_dirs(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            bool ok = mkdir(path, 0700) == 0 || errno == EEXIST;
+            *p = '/';
+            if (!ok) {
+                return false;
+            }
+        }
+    }
+    return mkdir(path, 0700) == 0 || errno == EEXIST;
+}
+
+history_t *history_open(const char *root) {
+    pthread_once(&gear_once, gear_init);
+    char real[PATH_MAX], dir[PATH_MAX];
+    const char *data = getenv("XDG_DATA_HOME"), *home = getenv("HOME");
+    if (!realpath(root, real)) {
+        return NULL;
+    }
+    unsigned long long key = (unsigned long long)hash64(real, strlen(real), 0);
+    i32 n = -1;
+    if (data && data[0] == '/') {
+        n = snprintf(dir, sizeof(dir), "%s/afaire/history/%016llx", data, key);
+    } else if (home && home[0] == '/') {
+        n = snprintf(dir, sizeof(dir), "%s/.local/share/afaire/history/%016llx", home, key);
+    }
+    if (n < 0 || (usize)n >= sizeof(dir) || !make_dirs(dir)) {
+        return NULL;
+    }
+    i32 dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    history_t *h = dir_fd >= 0 ? mem_alloc(sizeof(*h)) : NULL;
+    if (h) {
+        *h = (history_t){
+            .pack_fd = openat(dir_fd, "pack", O_RDWR | O_CREAT | O_CLOEXEC, 0600),
+            .chunks_fd = openat(dir_fd, "chunks", O_RDWR | O_CREAT | O_CLOEXEC, 0600),
+            .versions_fd = openat(dir_fd, "versions", O_RDWR | O_CREAT | O_CLOEXEC, 0600),
+        };
+        pthread_mutex_init(&h->lock, NULL);
+    }
+    if (dir_fd >= 0) {
+        close(dir_fd);
+    }
+    if (h && (h->pack_fd < 0 || h->chunks_fd < 0 || h->versions_fd < 0)) {
+        history_close(h);
+        return NULL;
+    }
+    return h;
+}
+
+void history_close(history_t *h) {
+    if (!h) {
+        return;
+    }
+    i32 fds[] = {h->pack_fd, h->chunks_fd, h->versions_fd};
+    for (i32 i = 0; i < 3; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    pthread_mutex_destroy(&h->lock);
+    mem_free(h->chunks);
+    mem_free(h->table);
+    mem_free(h->versions);
+    mem_free(h->paths);
+    mem_free(h);
+}
+
+// The newest version of `path`, -1 if there's none. Under the lock.
+static i32 newest(const history_t *h, const char *path) {
+    u64 path_hash = hash64(path, strlen(path), 0);
+    for (i32 i = (i32)h->version_count - 1; i >= 0; i--) {
+        const version_t *v = &h->versions[i];
+        if (v->path_hash == path_hash && strcmp(h->paths + v->path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool history_has(history_t *h, const char *path, u64 hash) {
+    if (!enter(h)) {
+        return false;
+    }
+    i32 v = newest(h, path);
+    bool has = v >= 0 && h->versions[v].hash == hash;
+    leave(h);
+    return has;
+}
+
+typedef struct {
+    u32 *ids;
+    u32 count;
+    u32 cap;
+    char *pack;  // the new chunks' bytes
+    u32 pack_len;
+    u32 pack_cap;
+} add_t;
+
+// Appends the new chunks and the version's record, then takes them in; on failure, the files are cut back.
+static bool add_locked(history_t *h, const char *path, const char *data, i32 len, add_t *a) {
+    u64 hash = hash64(data, (usize)len, 0);
+    i32 last = newest(h, path);
+    if (last >= 0 && h->versions[last].hash == hash && h->versions[last].size == len) {
+        return true;
+    }
+    u32 old_count = h->chunk_count;
+    u64 pack_end = file_size(h->pack_fd);
+    for (i32 at = 0; at < len;) {
+        i32 n = chunk_len((const u8 *)data + at, len - at);
+        u64 key[2] = {hash64(data + at, (usize)n, 0), hash64(data + at, (usize)n, 0x9E3779B97F4A7C15ull)};
+        u32 id = table_find(h, key);
+        if (id == UINT32_MAX) {
+            // new, possibly repeated further in this same file: indexed right away
+            if (!grow((void **)&h->chunks, &h->chunk_cap, h->chunk_count + 1, sizeof(chunk_entry_t)) ||
+                !grow((void **)&a->pack, &a->pack_cap, a->pack_len + (u32)n, 1)) {
+                return false;
+            }
+            id = h->chunk_count++;
+            h->chunks[id] = (chunk_entry_t){{key[0], key[1]}, pack_end + a->pack_len, (u32)n, 0};
+            memcpy(a->pack + a->pack_len, data + at, (usize)n);
+            a->pack_len += (u32)n;
+            if (!table_add(h, id)) {
+                return false;
+            }
+        }
+        if (!grow((void **)&a->ids, &a->cap, a->count + 1, sizeof(u32))) {
+            return false;
+        }
+        a->ids[a->count++] = id;
+        at += n;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    version_header_t v = {
+        .magic = VERSION_MAGIC,
+        .path_len = (u32)strlen(path),
+        .count = a->count,
+        .time = (i64)now.tv_sec * 1000000000 + now.tv_nsec,
+        .size = len,
+        .hash = hash,
+    };
+    usize record_len = sizeof(v) + pad4(v.path_len) + (usize)a->count * sizeof(u32);
+    char *record = mem_alloc(record_len);
+    if (!record) {
+        return false;
+    }
+    memset(record, 0, record_len);
+    memcpy(record, &v, sizeof(v));
+    memcpy(record + sizeof(v), path, v.path_len);
+    memcpy(record + sizeof(v) + pad4(v.path_len), a->ids, (usize)a->count * sizeof(u32));
+    u32 new_chunks = h->chunk_count - old_count;
+    bool ok = write_at(h->pack_fd, a->pack, a->pack_len, pack_end) &&
+              write_at(h->chunks_fd, h->chunks + old_count, (usize)new_chunks * sizeof(chunk_entry_t),
+                       (u64)old_count * sizeof(chunk_entry_t)) &&
+              write_at(h->versions_fd, record, record_len, h->versions_end) &&
+              add_version(h, &v, path, h->versions_end);
+    mem_free(record);
+    if (!ok) {
+        return false;
+    }
+    h->versions_end += record_len;
+    h->stats.chunks = h->chunk_count;
+    h->stats.versions = h->version_count;
+    h->stats.pack_bytes = pack_end + a->pack_len;
+    h->stats.last_added = a->pack_len + new_chunks * sizeof(chunk_entry_t) + record_len;
+    return true;
+}
+
+bool history_add(history_t *h, const char *path, const char *data, i32 len) {
+    if (!enter(h)) {
+        return false;
+    }
+    u32 old_count = h->chunk_count;
+    u64 pack_end = file_size(h->pack_fd);
+    add_t a = {0};
+    bool ok = add_locked(h, path, data, len, &a);
+    if (!ok) {
+        // nothing of it counts: the files go back to where they were, and the index with them
+        if (ftruncate(h->pack_fd, (off_t)pack_end) != 0 ||
+            ftruncate(h->chunks_fd, (off_t)old_count * sizeof(chunk_entry_t)) != 0 ||
+            ftruncate(h->versions_fd, (off_t)h->versions_end) != 0) {
+            ok = false;
+        }
+        h->chunk_count = old_count;
+        if (h->table) {
+            memset(h->table, 0, (usize)h->table_cap * sizeof(u32));
+            table_add(h, 0);
+        }
+    }
+    mem_free(a.ids);
+    mem_free(a.pack);
+    leave(h);
+    return ok;
+}
+
+i32 history_list(history_t *h, const char *path, history_version_t **out) {
+    *out = NULL;
+    if (!enter(h)) {
+        return -1;
+    }
+    u64 path_hash = hash64(path, strlen(path), 0);
+    i32 count = 0;
+    for (u32 i = 0; i < h->version_count; i++) {
+        count += h->versions[i].path_hash == path_hash && strcmp(h->paths + h->versions[i].path, path) == 0;
+    }
+    *out = mem_alloc((usize)max(count, 1) * sizeof(history_version_t));
+    if (!*out) {
+        leave(h);
+        return -1;
+    }
+    i32 n = 0;
+    for (i32 i = (i32)h->version_count - 1; i >= 0 && n < count; i--) {
+        const version_t *v = &h->versions[i];
+        if (v->path_hash == path_hash && strcmp(h->paths + v->path, path) == 0) {
+            (*out)[n++] = (history_version_t){(u32)i, v->time, v->size, v->hash};
+        }
+    }
+    leave(h);
+    return count;
+}
+
+char *history_read(history_t *h, u32 id, i32 *len) {
+    *len = 0;
+    pthread_mutex_lock(&h->lock);
+    if (id >= h->version_count) {
+        pthread_mutex_unlock(&h->lock);
+        return NULL;
+    }
+    // what's been read is never rewritten: no need for the file lock
+    version_t v = h->versions[id];
+    u64 ids_at = v.offset + sizeof(version_header_t) + pad4((u32)strlen(h->paths + v.path));
+    u32 *ids = mem_alloc((usize)max(v.count, 1u) * sizeof(u32));
+    char *data = v.size < INT32_MAX ? mem_alloc((usize)v.size + 1) : NULL;
+    bool ok = ids && data && read_at(h->versions_fd, ids, (usize)v.count * sizeof(u32), ids_at);
+    // chunks stored together are read together: a version's new chunks sit side by side in the pack
+    i64 at = 0;
+    for (u32 i = 0; ok && i < v.count;) {
+        u32 first = ids[i];
+        ok = first < h->chunk_count;
+        u64 offset = ok ? h->chunks[first].offset : 0;
+        u64 run = 0;
+        while (ok && i < v.count && ids[i] < h->chunk_count && h->chunks[ids[i]].offset == offset + run) {
+            run += h->chunks[ids[i]].len;
+            i++;
+        }
+        ok = ok && run > 0 && at + (i64)run <= v.size && read_at(h->pack_fd, data + at, (usize)run, offset);
+        at += (i64)run;
+    }
+    pthread_mutex_unlock(&h->lock);
+    mem_free(ids);
+    if (!ok || at != v.size || hash64(data, (usize)v.size, 0) != v.hash) {
+        mem_free(data);
+        return NULL;
+    }
+    data[v.size] = '\0';
+    *len = (i32)v.size;
+    return data;
+}
+
+void history_stats(history_t *h, history_stats_t *stats) {
+    pthread_mutex_lock(&h->lock);
+    *stats = h->stats;
+    pthread_mutex_unlock(&h->lock);
+}
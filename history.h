@@ -0,0 +1,40 @@
+#ifndef AFAIRE_HISTORY_H
+#define AFAIRE_HISTORY_H
+
+#include "base.h"
+
+typedef struct {
+    u32 id;      // for history_read()
+    i64 time;    // when it was saved, ns since the epoch
+    i64 size;
+    u64 hash;    // hash64() of the contents
+} history_version_t;
+
+typedef struct {
+    u32 chunks;
+    u32 versions;
+    u64 pack_bytes;
+    u64 last_added;  // bytes the last version added to the store, its own record included
+} history_stats_t;
+
+typedef struct history history_t;
+
+// The saved versions of every file under one root, kept in $XDG_DATA_HOME/afaire/history (~/.local/share by default),
+// in a folder named after the root's real path. A version is cut into content-defined chunks with a rolling hash, so
+// an edit only changes the chunks around it. Chunks are stored once, in an append-only pack, and a version is the list
+// of its chunks, so saving a small edit to a big file adds a few KB. The afaire instances open on the root share it:
+// each takes a lock to append and first catches up with what the others appended. Safe to call from several threads.
+// NULL when the store can't be created.
+history_t *history_open(const char *root);
+void history_close(history_t *h);
+// Whether `hash` is the newest version of `path` (within the root).
+bool history_has(history_t *h, const char *path, u64 hash);
+// Records `data` as the newest version of `path`, unless it already is. Returns false when it can't be written.
+bool history_add(history_t *h, const char *path, const char *data, i32 len);
+// The versions of `path`, newest first, into `out` allocated with mem_alloc. Returns the count, -1 on error.
+i32 history_list(history_t *h, const char *path, history_version_t **out);
+// The contents of version `id`, NUL-terminated and allocated with mem_alloc; NULL when it can't be read back whole.
+char *history_read(history_t *h, u32 id, i32 *len);
+void history_stats(history_t *h, history_stats_t *stats);
+
+#endif
@@ -0,0 +1,289 @@
+#include "jobs.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "prof.h"
+
+typedef struct job {
+    job_fn run;
+    job_done_fn done;
+    void *data;
+    struct job *next;  // in the completion list
+} job_t;
+
+// The owner pushes and pops at the tail, thieves take from the head.
+typedef struct {
+    pthread_mutex_t lock;
+    job_t **jobs;
+    i32 head;
+    i32 count;
+    i32 cap;
+} job_deque_t;
+
+typedef struct {
+    i32 index;
+    pthread_t thread;
+    job_deque_t deques[JOB_PRIORITY_COUNT];
+} worker_t;
+
+static struct {
+    worker_t workers[JOBS_MAX_WORKERS];
+    i32 worker_count;
+    atomic_uint next_worker;  // round robin for jobs submitted from outside the pool
+    atomic_int queued;        // in a deque, not yet picked up
+    atomic_int pending;
+    atomic_bool stop;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_cond;
+    job_t *done;
+    job_t *done_tail;
+    u32 finished;  // jobs run so far, wrapping; under done_lock
+} pool;
+
+static _Thread_local worker_t *current;
+
+static bool deque_push(job_deque_t *d, job_t *job) {
+    pthread_mutex_lock(&d->lock);
+    if (d->count == d->cap) {
+        i32 cap = max(64, d->cap * 2);
+        job_t **jobs = mem_alloc((usize)cap * sizeof(*jobs));
+        if (!jobs) {
+            pthread_mutex_unlock(&d->lock);
+            return false;
+        }
+        for (i32 i = 0; i < d->count; i++) {
+            jobs[i] = d->jobs[(d->head + i) % d->cap];
+        }
+        mem_free(d->jobs);
+        d->jobs = jobs;
+        d->head = 0;
+        d->cap = cap;
+    }
+    d->jobs[(d->head + d->count) % d->cap] = job;
+    d->count++;
+    pthread_mutex_unlock(&d->lock);
+    return true;
+}
+
+static job_t *deque_pop(job_deque_t *d) {
+    job_t *job = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->count > 0) {
+        d->count--;
+        job = d->jobs[(d->head + d->count) % d->cap];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+static job_t *deque_steal(job_deque_t *d) {
+    job_t *job = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->count > 0) {
+        job = d->jobs[d->head];
+        d->head = (d->head + 1) % d->cap;
+        d->count--;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+static void complete(job_t *job) {
+    if (job->done) {
+        job->next = NULL;
+    } else {
+        // before the signal, so a woken jobs_wait() caller sees it gone from jobs_pending()
+        mem_free(job);
+        atomic_fetch_sub(&pool.pending, 1);
+        job = NULL;
+    }
+    pthread_mutex_lock(&pool.done_lock);
+    if (job && pool.done_tail) {
+        pool.done_tail->next = job;
+        pool.done_tail = job;
+    } else if (job) {
+        pool.done = pool.done_tail = job;
+    }
+    pool.finished++;
+    pthread_cond_broadcast(&pool.done_cond);
+    pthread_mutex_unlock(&pool.done_lock);
+}
+
+static job_t *find_work(worker_t *w) {
+    for (i32 p = 0; p < JOB_PRIORITY_COUNT; p++) {
+        job_t *job = deque_pop(&w->deques[p]);
+        for (i32 i = 1; !job && i < pool.worker_count; i++) {
+            job = deque_steal(&pool.workers[(w->index + i) % pool.worker_count].deques[p]);
+        }
+        if (job) {
+            atomic_fetch_sub(&pool.queued, 1);
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void *worker(void *arg) {
+    worker_t *w = arg;
+    current = w;
+    char name[16];
+    snprintf(name, sizeof(name), "job %d", w->index);
+    prof_thread_name(name);
+    for (;;) {
+        job_t *job = find_work(w);
+        if (job) {
+            job->run(job->data);
+            complete(job);
+            continue;
+        }
+        // `queued` is raised before the signal, under the same lock, so a wakeup can't be missed
+        pthread_mutex_lock(&pool.idle_lock);
+        while (atomic_load(&pool.queued) == 0 && !atomic_load(&pool.stop)) {
+            pthread_cond_wait(&pool.idle_cond, &pool.idle_lock);
+        }
+        bool stopped = atomic_load(&pool.queued) == 0;
+        pthread_mutex_unlock(&pool.idle_lock);
+        if (stopped) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void jobs_init(void) {
+    pthread_mutex_init(&pool.idle_lock, NULL);
+    pthread_cond_init(&pool.idle_cond, NULL);
+    pthread_mutex_init(&pool.done_lock, NULL);
+    pthread_cond_init(&pool.done_cond, NULL);
+    pool.finished = 0;
+    atomic_init(&pool.next_worker, 0);
+    atomic_init(&pool.queued, 0);
+    atomic_init(&pool.pending, 0);
+    atomic_init(&pool.stop, false);
+    pool.done = pool.done_tail = NULL;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    i32 count = (i32)max(1, min(cpus, JOBS_MAX_WORKERS));
+    for (i32 i = 0; i < JOBS_MAX_WORKERS; i++) {
+        pool.workers[i] = (worker_t){.index = i};
+        for (i32 p = 0; p < JOB_PRIORITY_COUNT; p++) {
+            pthread_mutex_init(&pool.workers[i].deques[p].lock, NULL);
+        }
+    }
+    // set before the workers start, since they read it to pick whom to steal from
+    pool.worker_count = count;
+    for (i32 i = 0; i < count; i++) {
+        if (pthread_create(&pool.workers[i].thread, NULL, worker, &pool.workers[i]) != 0) {
+            // nothing was submitted yet, so the deques of workers that didn't start stay empty
+            pool.worker_count = i;
+            break;
+        }
+    }
+}
+
+void jobs_shutdown(void) {
+    pthread_mutex_lock(&pool.idle_lock);
+    atomic_store(&pool.stop, true);
+    pthread_cond_broadcast(&pool.idle_cond);
+    pthread_mutex_unlock(&pool.idle_lock);
+    for (i32 i = 0; i < pool.worker_count; i++) {
+        pthread_join(pool.workers[i].thread, NULL);
+    }
+    // completions may submit more work, which now runs inline
+    pool.worker_count = 0;
+    while (jobs_poll() > 0) {
+    }
+    for (i32 i = 0; i < JOBS_MAX_WORKERS; i++) {
+        for (i32 p = 0; p < JOB_PRIORITY_COUNT; p++) {
+            job_deque_t *d = &pool.workers[i].deques[p];
+            mem_free(d->jobs);
+            pthread_mutex_destroy(&d->lock);
+            *d = (job_deque_t){0};
+        }
+    }
+    pthread_mutex_destroy(&pool.idle_lock);
+    pthread_cond_destroy(&pool.idle_cond);
+    pthread_mutex_destroy(&pool.done_lock);
+    pthread_cond_destroy(&pool.done_cond);
+}
+
+bool jobs_submit(job_priority_t priority, job_fn run, job_done_fn done, void *data) {
+    job_t *job = mem_alloc(sizeof(*job));
+    if (!job) {
+        return false;
+    }
+    *job = (job_t){run, done, data, NULL};
+    atomic_fetch_add(&pool.pending, 1);
+    if (pool.worker_count == 0) {
+        // no threads could be started: run here, complete at the next poll
+        run(data);
+        complete(job);
+        return true;
+    }
+    worker_t *w = current ? current : &pool.workers[atomic_fetch_add(&pool.next_worker, 1) % (u32)pool.worker_count];
+    if (!deque_push(&w->deques[priority], job)) {
+        mem_free(job);
+        atomic_fetch_sub(&pool.pending, 1);
+        return false;
+    }
+    pthread_mutex_lock(&pool.idle_lock);
+    atomic_fetch_add(&pool.queued, 1);
+    pthread_cond_signal(&pool.idle_cond);
+    pthread_mutex_unlock(&pool.idle_lock);
+    return true;
+}
+
+i32 jobs_poll(void) {
+    pthread_mutex_lock(&pool.done_lock);
+    job_t *job = pool.done;
+    pool.done = pool.done_tail = NULL;
+    pthread_mutex_unlock(&pool.done_lock);
+    i32 count = 0;
+    while (job) {
+        job_t *next = job->next;
+        job->done(job->data);
+        mem_free(job);
+        atomic_fetch_sub(&pool.pending, 1);
+        count++;
+        job = next;
+    }
+    return count;
+}
+
+u32 jobs_finished(void) {
+    pthread_mutex_lock(&pool.done_lock);
+    u32 finished = pool.finished;
+    pthread_mutex_unlock(&pool.done_lock);
+    return finished;
+}
+
+void jobs_wait(u32 finished, i64 timeout_ns) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    i64 ns = until.tv_nsec + timeout_ns;
+    until.tv_sec += ns / 1000000000;
+    until.tv_nsec = ns % 1000000000;
+    pthread_mutex_lock(&pool.done_lock);
+    while (pool.finished == finished) {
+        if (pthread_cond_timedwait(&pool.done_cond, &pool.done_lock, &until) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool.done_lock);
+}
+
+i32 jobs_pending(void) {
+    return atomic_load(&pool.pending);
+}
+
+i32 jobs_worker_count(void) {
+    return pool.worker_count;
+}
@@ -0,0 +1,39 @@
+#ifndef AFAIRE_JOBS_H
+#define AFAIRE_JOBS_H
+
+#include "base.h"
+
+#define JOBS_MAX_WORKERS 8
+
+// Higher priorities run first; a worker steals higher-priority work from others before running its own lower one.
+typedef enum {
+    JOB_INTERACTIVE,  // the user is waiting: opening or saving a file
+    JOB_PREFETCH,
+    JOB_INDEXING,
+    JOB_PRIORITY_COUNT,
+} job_priority_t;
+
+// Runs on a worker thread.
+typedef void (*job_fn)(void *data);
+// Runs on the UI thread, from jobs_poll(), once `run` has returned.
+typedef void (*job_done_fn)(void *data);
+
+// Thread pool shared by all background work. Each worker owns one deque per priority: jobs submitted from a worker go
+// to its own deques and are popped newest first, idle workers steal the oldest from the others. Jobs submitted from
+// any other thread are spread over the workers. If no thread can be started, jobs run inline as they're submitted.
+void jobs_init(void);
+// Runs what is still queued, joins the workers and delivers the last completions.
+void jobs_shutdown(void);
+// Returns false when out of memory; neither callback is called then. `done` may be NULL.
+bool jobs_submit(job_priority_t priority, job_fn run, job_done_fn done, void *data);
+// Calls the completion callbacks of finished jobs, in the order they finished. Returns how many ran.
+i32 jobs_poll(void);
+// Jobs submitted and not yet completed, their completion callback included.
+i32 jobs_pending(void);
+// For a thread with nothing to do until a job is over: take jobs_finished() before looking for work, then, finding
+// none, jobs_wait() returns as soon as any job has finished since, or after `timeout_ns`.
+u32 jobs_finished(void);
+void jobs_wait(u32 finished, i64 timeout_ns);
+i32 jobs_worker_count(void);
+
+#endif
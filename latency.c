@@ -0,0 +1,58 @@
+#include "latency.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static latency_stats_t stats;
+
+void latency_input(latency_batch_t *b, f64 time) {
+    // a burst beyond the batch is represented by its first keys
+    if (b->count < LATENCY_MAX_PENDING && time > 0.0) {
+        b->times[b->count++] = time;
+    }
+}
+
+void latency_move(latency_batch_t *dst, latency_batch_t *src) {
+    for (i32 i = 0; i < src->count; i++) {
+        latency_input(dst, src->times[i]);
+    }
+    src->count = 0;
+}
+
+static int compare_f32(const void *a, const void *b) {
+    f32 x = *(const f32 *)a, y = *(const f32 *)b;
+    return (x > y) - (x < y);
+}
+
+static void update_percentiles(void) {
+    static f32 sorted[LATENCY_SAMPLES];
+    i32 n = (i32)min(stats.count, (u64)LATENCY_SAMPLES);
+    memcpy(sorted, stats.samples, (usize)n * sizeof(f32));
+    qsort(sorted, (usize)n, sizeof(f32), compare_f32);
+    stats.p50 = sorted[n / 2];
+    stats.p99 = sorted[n * 99 / 100];
+    stats.max = sorted[n - 1];
+}
+
+void latency_presented(latency_batch_t *b, f64 present_time) {
+    if (b->count == 0) {
+        return;
+    }
+    for (i32 i = 0; i < b->count; i++) {
+        f64 ms = (present_time - b->times[i]) * 1000.0;
+        if (ms < 0.0) {
+            // the present predates the key: not the frame that showed it
+            continue;
+        }
+        stats.histogram[min((i32)ms, LATENCY_BUCKETS - 1)]++;
+        stats.samples[stats.count++ % LATENCY_SAMPLES] = (f32)ms;
+    }
+    b->count = 0;
+    if (stats.count > 0) {
+        update_percentiles();
+    }
+}
+
+const latency_stats_t *latency_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,33 @@
+#ifndef AFAIRE_LATENCY_H
+#define AFAIRE_LATENCY_H
+
+#include "base.h"
+
+#define LATENCY_MAX_PENDING 32
+#define LATENCY_BUCKETS 50  // 1 ms each, the last one open-ended
+#define LATENCY_SAMPLES 512
+
+// Key presses on their way to the screen, as event timestamps in seconds. A batch follows the frame that read the
+// keys; it's recorded when that frame is presented, or dropped if the frame didn't change what's on screen.
+typedef struct {
+    f64 times[LATENCY_MAX_PENDING];
+    i32 count;
+} latency_batch_t;
+
+typedef struct {
+    u64 count;
+    u32 histogram[LATENCY_BUCKETS];
+    f32 samples[LATENCY_SAMPLES];  // ms, the most recent as a ring
+    f32 p50;                       // over samples
+    f32 p99;
+    f32 max;
+} latency_stats_t;
+
+void latency_input(latency_batch_t *b, f64 time);
+// Appends src to dst and empties src.
+void latency_move(latency_batch_t *dst, latency_batch_t *src);
+// Records keystroke-to-present latencies for the batch and empties it.
+void latency_presented(latency_batch_t *b, f64 present_time);
+const latency_stats_t *latency_stats(void);
+
+#endif
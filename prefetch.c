@@ -0,0 +1,177 @@
+#include "prefetch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "hash.h"
+#include "jobs.h"
+
+#define PREFETCH_PATH_SIZE 1024
+
+typedef enum {
+    SLOT_EMPTY,
+    SLOT_LOADING,
+    SLOT_READY,
+} slot_state_t;
+
+typedef struct {
+    slot_state_t state;
+    u32 serial;  // of the read filling the slot; a read that finds another serial was dropped
+    vfs_t *vfs;
+    char path[PREFETCH_PATH_SIZE];
+    prefetch_file_t file;
+    i64 loaded_at;
+    u64 used;  // last request, for LRU eviction
+} slot_t;
+
+// One background read, filled in by a worker.
+typedef struct {
+    i32 slot;
+    u32 serial;
+    vfs_t *vfs;
+    char path[PREFETCH_PATH_SIZE];
+    prefetch_file_t file;
+    bool failed;
+} read_t;
+
+static struct {
+    slot_t slots[PREFETCH_SLOTS];
+    u32 serial;
+    u64 tick;
+    prefetch_stats_t stats;
+} cache;
+
+static i64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (i64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static slot_t *find(vfs_t *vfs, const char *path) {
+    for (i32 i = 0; i < PREFETCH_SLOTS; i++) {
+        slot_t *s = &cache.slots[i];
+        if (s->state != SLOT_EMPTY && s->vfs == vfs && strcmp(s->path, path) == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// A read in flight for the slot is discarded when it completes.
+static void drop(slot_t *s, bool wasted) {
+    if (s->state == SLOT_READY) {
+        mem_free(s->file.data);
+        cache.stats.wasted += wasted;
+    }
+    s->state = SLOT_EMPTY;
+}
+
+static bool stale(const slot_t *s, i64 now) {
+    return s->state == SLOT_READY && now - s->loaded_at > PREFETCH_MAX_AGE_NS;
+}
+
+static void read_job(void *data) {
+    read_t *r = data;
+    fileio_req_t req = {.op = FILEIO_READ, .path = r->path};
+    vfs_run(r->vfs, &req, 1);
+    r->failed = req.error != 0;
+    r->file = (prefetch_file_t){req.data, req.len, req.data ? hash64(req.data, (usize)req.len, 0) : 0, req.mtime};
+}
+
+static void read_done(void *data) {
+    read_t *r = data;
+    slot_t *s = &cache.slots[r->slot];
+    if (s->state != SLOT_LOADING || s->serial != r->serial) {
+        cache.stats.wasted++;
+    } else if (r->failed) {
+        // opening the file reads it again and reports the error
+        s->state = SLOT_EMPTY;
+    } else {
+        s->state = SLOT_READY;
+        s->file = r->file;
+        s->loaded_at = now_ns();
+        r->file.data = NULL;
+    }
+    mem_free(r->file.data);
+    mem_free(r);
+}
+
+void prefetch_request(vfs_t *vfs, const char *path) {
+    // without workers, jobs run inline: a hover would block the frame on the disk
+    if (!vfs || strlen(path) >= PREFETCH_PATH_SIZE || jobs_worker_count() == 0) {
+        return;
+    }
+    i64 now = now_ns();
+    slot_t *s = find(vfs, path);
+    if (s && stale(s, now)) {
+        drop(s, true);
+        s = NULL;
+    }
+    if (s) {
+        s->used = ++cache.tick;
+        return;
+    }
+    // an empty slot, else the least recently requested parked file; reads in flight are left to finish
+    slot_t *victim = NULL;
+    for (i32 i = 0; i < PREFETCH_SLOTS && !(victim && victim->state == SLOT_EMPTY); i++) {
+        slot_t *c = &cache.slots[i];
+        if (c->state == SLOT_EMPTY || (c->state == SLOT_READY && (!victim || c->used < victim->used))) {
+            victim = c;
+        }
+    }
+    read_t *r = victim ? mem_alloc(sizeof(*r)) : NULL;
+    if (!r) {
+        return;
+    }
+    drop(victim, true);
+    *r = (read_t){.slot = (i32)(victim - cache.slots), .serial = ++cache.serial, .vfs = vfs};
+    snprintf(r->path, sizeof(r->path), "%s", path);
+    victim->state = SLOT_LOADING;
+    victim->serial = r->serial;
+    victim->vfs = vfs;
+    victim->used = ++cache.tick;
+    snprintf(victim->path, sizeof(victim->path), "%s", path);
+    if (!jobs_submit(JOB_PREFETCH, read_job, read_done, r)) {
+        mem_free(r);
+        victim->state = SLOT_EMPTY;
+        return;
+    }
+    cache.stats.requests++;
+}
+
+bool prefetch_take(vfs_t *vfs, const char *path, prefetch_file_t *file) {
+    cache.stats.opens++;
+    slot_t *s = find(vfs, path);
+    if (!s) {
+        return false;
+    }
+    if (s->state == SLOT_READY && !stale(s, now_ns())) {
+        *file = s->file;
+        s->state = SLOT_EMPTY;
+        cache.stats.hits++;
+        return true;
+    }
+    // the open reads the file itself, at interactive priority
+    cache.stats.late += s->state == SLOT_LOADING;
+    drop(s, true);
+    return false;
+}
+
+void prefetch_forget(vfs_t *vfs, const char *path) {
+    slot_t *s = vfs ? find(vfs, path) : NULL;
+    if (s) {
+        drop(s, false);
+    }
+}
+
+void prefetch_clear(void) {
+    for (i32 i = 0; i < PREFETCH_SLOTS; i++) {
+        drop(&cache.slots[i], false);
+    }
+}
+
+const prefetch_stats_t *prefetch_stats(void) {
+    return &cache.stats;
+}
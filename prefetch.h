@@ -0,0 +1,39 @@
+#ifndef AFAIRE_PREFETCH_H
+#define AFAIRE_PREFETCH_H
+
+#include "base.h"
+#include "vfs.h"
+
+#define PREFETCH_SLOTS 8
+// The cache doesn't watch the disk: opening a parked copy stats the file first and reads it again if its size or mtime
+// changed, and a copy parked longer than this is dropped unopened.
+#define PREFETCH_MAX_AGE_NS 10000000000ll
+
+typedef struct {
+    char *data;  // NUL-terminated, allocated with mem_alloc; whoever takes the file frees it
+    i32 len;
+    u64 hash;
+    i64 mtime;
+} prefetch_file_t;
+
+typedef struct {
+    u64 requests;  // reads issued
+    u64 opens;     // prefetch_take() calls
+    u64 hits;      // opens served from the cache
+    u64 late;      // opens whose file was still being read
+    u64 wasted;    // reads dropped or evicted before anything opened them
+} prefetch_stats_t;
+
+// Files likely to be opened next, finder results and hovered entries, are read at prefetch priority on the job pool
+// and parked in a small LRU cache, so opening one takes a stat rather than a read. UI thread only.
+void prefetch_request(vfs_t *vfs, const char *path);
+// Hands over the parked contents of `path`, if any, to check against the file's stat before use; counts towards the
+// hit rate either way.
+bool prefetch_take(vfs_t *vfs, const char *path, prefetch_file_t *file);
+// Drops a parked copy once the file is written or removed.
+void prefetch_forget(vfs_t *vfs, const char *path);
+// Frees the cache; reads still in flight must have completed.
+void prefetch_clear(void);
+const prefetch_stats_t *prefetch_stats(void);
+
+#endif
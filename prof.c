@@ -0,0 +1,292 @@
+#include "prof.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROF_RDTSC 1
+#endif
+
+// readers stay this far behind a ring's head so the owner can't overwrite what they are copying
+#define PROF_READ_MARGIN 1024
+
+typedef struct {
+    prof_event_t events[PROF_RING_SIZE];
+    atomic_uint head;  // events ever recorded, wrapping; PROF_RING_SIZE is a power of two
+    u32 depth;
+    const char *names[PROF_MAX_DEPTH];
+    u64 starts[PROF_MAX_DEPTH];
+    char name[32];
+} prof_thread_t;
+
+typedef struct {
+    const char *name;
+    f32 ms[PROF_HISTORY];
+} prof_stat_t;
+
+static struct {
+    _Atomic(prof_thread_t *) threads[PROF_MAX_THREADS];
+    atomic_int thread_count;
+    u64 base_ticks;
+    i64 base_ns;
+    f64 ns_per_tick;
+    // owned by the thread driving prof_frame_begin/end
+    prof_thread_t *ui;
+    u64 last_frame_end;
+    u32 frame_first;  // ui ring head when the frame began
+    u64 shown_start;  // the last complete frame, drawn in the flame graph
+    u64 shown_end;
+    u32 frame_count;
+    f32 frame_ms[PROF_HISTORY];
+    prof_stat_t stats[PROF_MAX_STATS];
+    i32 stat_count;
+} prof;
+
+static _Thread_local prof_thread_t *self;
+static _Thread_local bool self_failed;
+
+static i64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (i64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline u64 ticks(void) {
+#if PROF_RDTSC
+    return __rdtsc();
+#else
+    return (u64)now_ns();
+#endif
+}
+
+// The TSC rate is measured against the monotonic clock over the whole run, so it sharpens as time passes.
+static void calibrate(void) {
+#if PROF_RDTSC
+    u64 t = ticks();
+    i64 ns = now_ns();
+    if (t > prof.base_ticks && ns - prof.base_ns > 1000000) {
+        prof.ns_per_tick = (f64)(ns - prof.base_ns) / (f64)(t - prof.base_ticks);
+    }
+#endif
+}
+
+static f32 to_ms(u64 duration) {
+    return (f32)((f64)duration * prof.ns_per_tick * 1e-6);
+}
+
+static prof_thread_t *thread_state(void) {
+    if (self || self_failed) {
+        return self;
+    }
+    i32 slot = atomic_fetch_add(&prof.thread_count, 1);
+    prof_thread_t *t = slot < PROF_MAX_THREADS ? calloc(1, sizeof(*t)) : NULL;
+    if (!t) {
+        self_failed = true;
+        return NULL;
+    }
+    snprintf(t->name, sizeof(t->name), "thread %d", slot);
+    atomic_store(&prof.threads[slot], t);
+    self = t;
+    return t;
+}
+
+static void record(prof_thread_t *t, const char *name, u64 start, u64 end, u32 depth) {
+    u32 head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    t->events[head % PROF_RING_SIZE] = (prof_event_t){name, start, end, depth};
+    atomic_store_explicit(&t->head, head + 1, memory_order_release);
+}
+
+void prof_init(void) {
+    prof.base_ticks = ticks();
+    prof.base_ns = now_ns();
+    prof.ns_per_tick = 1.0;
+#if PROF_RDTSC
+    while (now_ns() - prof.base_ns < 2000000) {
+    }
+    calibrate();
+#endif
+}
+
+void prof_shutdown(void) {
+    i32 count = min(atomic_load(&prof.thread_count), PROF_MAX_THREADS);
+    for (i32 i = 0; i < count; i++) {
+        free(atomic_load(&prof.threads[i]));
+        atomic_store(&prof.threads[i], NULL);
+    }
+    atomic_store(&prof.thread_count, 0);
+    self = NULL;
+}
+
+void prof_thread_name(const char *name) {
+    prof_thread_t *t = thread_state();
+    if (t) {
+        snprintf(t->name, sizeof(t->name), "%s", name);
+    }
+}
+
+void prof_begin(const char *name) {
+    prof_thread_t *t = thread_state();
+    if (!t) {
+        return;
+    }
+    if (t->depth < PROF_MAX_DEPTH) {
+        t->names[t->depth] = name;
+        t->starts[t->depth] = ticks();
+    }
+    t->depth++;
+}
+
+void prof_end(void) {
+    prof_thread_t *t = self;
+    if (!t || t->depth == 0) {
+        return;
+    }
+    u64 end = ticks();
+    t->depth--;
+    if (t->depth < PROF_MAX_DEPTH) {
+        record(t, t->names[t->depth], t->starts[t->depth], end, t->depth);
+    }
+}
+
+void prof_frame_begin(void) {
+    prof_thread_t *t = thread_state();
+    if (!t) {
+        return;
+    }
+    prof.ui = t;
+    prof.frame_first = atomic_load_explicit(&t->head, memory_order_relaxed);
+    // vsync wait and event handling happen in sokol_app between two frame callbacks
+    if (prof.last_frame_end) {
+        record(t, "swap", prof.last_frame_end, ticks(), t->depth);
+    }
+    prof_begin("frame");
+}
+
+static prof_stat_t *find_stat(const char *name) {
+    for (i32 i = 0; i < prof.stat_count; i++) {
+        if (strcmp(prof.stats[i].name, name) == 0) {
+            return &prof.stats[i];
+        }
+    }
+    if (prof.stat_count == PROF_MAX_STATS) {
+        return NULL;
+    }
+    prof_stat_t *s = &prof.stats[prof.stat_count++];
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    return s;
+}
+
+void prof_frame_end(void) {
+    prof_thread_t *t = prof.ui;
+    if (!t || t != self) {
+        return;
+    }
+    prof_end();
+    calibrate();
+    u32 head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    // the frame zone closes last
+    const prof_event_t *frame = &t->events[(head - 1) % PROF_RING_SIZE];
+    u32 slot = prof.frame_count % PROF_HISTORY;
+    for (i32 i = 0; i < prof.stat_count; i++) {
+        prof.stats[i].ms[slot] = 0.0f;
+    }
+    u32 first = head - min(head - prof.frame_first, PROF_RING_SIZE);
+    for (u32 i = first; i != head; i++) {
+        const prof_event_t *e = &t->events[i % PROF_RING_SIZE];
+        prof_stat_t *s = find_stat(e->name);
+        if (s) {
+            s->ms[slot] += to_ms(e->end - e->start);
+        }
+    }
+    prof.frame_ms[slot] = to_ms(frame->end - frame->start);
+    prof.shown_start = frame->start;
+    prof.shown_end = frame->end;
+    prof.frame_count++;
+    prof.last_frame_end = ticks();
+}
+
+bool prof_dump_chrome(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    i32 count = min(atomic_load(&prof.thread_count), PROF_MAX_THREADS);
+    bool first = true;
+    for (i32 i = 0; i < count; i++) {
+        prof_thread_t *t = atomic_load(&prof.threads[i]);
+        if (!t) {
+            continue;
+        }
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", i, t->name);
+        first = false;
+        u32 head = atomic_load_explicit(&t->head, memory_order_acquire);
+        u32 n = min(head, PROF_RING_SIZE - PROF_READ_MARGIN);
+        for (u32 k = head - n; k != head; k++) {
+            prof_event_t e = t->events[k % PROF_RING_SIZE];
+            f64 ts = (f64)(e.start - prof.base_ticks) * prof.ns_per_tick * 1e-3;
+            f64 dur = (f64)(e.end - e.start) * prof.ns_per_tick * 1e-3;
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", e.name, i, ts,
+                    dur);
+        }
+    }
+    fputs("\n]}\n", f);
+    return fclose(f) == 0;
+}
+
+f32 prof_ticks_ms(u64 duration) {
+    return to_ms(duration);
+}
+
+const f32 *prof_frame_times(i32 *count, i32 *offset) {
+    *count = (i32)min(prof.frame_count, PROF_HISTORY);
+    *offset = *count < PROF_HISTORY ? 0 : (i32)(prof.frame_count % PROF_HISTORY);
+    return prof.frame_ms;
+}
+
+bool prof_last_frame(u64 *start, u64 *end) {
+    *start = prof.shown_start;
+    *end = prof.shown_end;
+    return prof.shown_end > prof.shown_start;
+}
+
+i32 prof_zone_count(void) {
+    return prof.stat_count;
+}
+
+const char *prof_zone_times(i32 zone, const f32 **ms) {
+    *ms = prof.stats[zone].ms;
+    return prof.stats[zone].name;
+}
+
+i32 prof_thread_count(void) {
+    return min(atomic_load(&prof.thread_count), PROF_MAX_THREADS);
+}
+
+const char *prof_zones_begin(prof_cursor_t *c, i32 thread) {
+    prof_thread_t *t = atomic_load(&prof.threads[thread]);
+    if (!t) {
+        return NULL;
+    }
+    c->thread = thread;
+    c->head = atomic_load_explicit(&t->head, memory_order_acquire);
+    c->left = min(c->head, PROF_RING_SIZE - PROF_READ_MARGIN);
+    return t->name;
+}
+
+bool prof_zones_next(prof_cursor_t *c, prof_event_t *e) {
+    if (c->left == 0) {
+        return false;
+    }
+    prof_thread_t *t = atomic_load(&prof.threads[c->thread]);
+    *e = t->events[(c->head - 1) % PROF_RING_SIZE];
+    c->head--;
+    c->left--;
+    return true;
+}
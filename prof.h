@@ -0,0 +1,53 @@
+#ifndef AFAIRE_PROF_H
+#define AFAIRE_PROF_H
+
+#include "base.h"
+
+#define PROF_RING_SIZE 16384
+#define PROF_MAX_THREADS 32
+#define PROF_MAX_DEPTH 32
+#define PROF_MAX_STATS 32
+#define PROF_HISTORY 256
+
+// Timing zones nest per thread: prof_begin()/prof_end() pairs are recorded into a ring buffer owned by the calling
+// thread, which the UI thread reads without locking. Zone names must be string literals.
+void prof_init(void);
+void prof_shutdown(void);
+void prof_thread_name(const char *name);
+void prof_begin(const char *name);
+void prof_end(void);
+
+// Brackets frame(); the gap since the previous frame_end is recorded as "swap".
+void prof_frame_begin(void);
+void prof_frame_end(void);
+
+bool prof_dump_chrome(const char *path);
+
+typedef struct {
+    const char *name;
+    u64 start;
+    u64 end;
+    u32 depth;
+} prof_event_t;
+
+typedef struct {
+    i32 thread;
+    u32 head;
+    u32 left;
+} prof_cursor_t;
+
+// What the overlay reads, on the thread driving the frames. Times are in ticks, prof_ticks_ms() converts them.
+f32 prof_ticks_ms(u64 duration);
+// The last frames' times as a ring of *count entries starting at *offset.
+const f32 *prof_frame_times(i32 *count, i32 *offset);
+// The span of the last complete frame, false before the first one.
+bool prof_last_frame(u64 *start, u64 *end);
+// A zone's time in each of the frames of prof_frame_times(), in the same slots.
+i32 prof_zone_count(void);
+const char *prof_zone_times(i32 zone, const f32 **ms);
+i32 prof_thread_count(void);
+// Walks a thread's recent zones back from the last one to close. Returns the thread name, NULL for a free slot.
+const char *prof_zones_begin(prof_cursor_t *c, i32 thread);
+bool prof_zones_next(prof_cursor_t *c, prof_event_t *e);
+
+#endif
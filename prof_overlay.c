@@ -0,0 +1,138 @@
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include "prof_overlay.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cimgui.h"
+#include "prof.h"
+
+static u32 zone_color(const char *name) {
+    u32 h = 2166136261u;
+    for (const char *c = name; *c; c++) {
+        h = (h ^ (u8)*c) * 16777619u;
+    }
+    u32 r = 90 + h % 110, g = 90 + (h >> 8) % 110, b = 90 + (h >> 16) % 110;
+    return 0xff000000u | (b << 16) | (g << 8) | r;
+}
+
+// One lane per thread with zones overlapping the last frame, one row per nesting level.
+static void draw_flame_graph(void) {
+    u64 shown_start, shown_end;
+    if (!prof_last_frame(&shown_start, &shown_end)) {
+        return;
+    }
+    ImVec2 origin, avail, mouse;
+    igGetCursorScreenPos(&origin);
+    igGetContentRegionAvail(&avail);
+    igGetMousePos(&mouse);
+    ImDrawList *draw_list = igGetWindowDrawList();
+    f32 row = igGetTextLineHeight() + 2.0f;
+    f64 scale = (f64)avail.x / (f64)(shown_end - shown_start);
+    f32 y = origin.y;
+    i32 count = prof_thread_count();
+    for (i32 i = 0; i < count; i++) {
+        prof_cursor_t cursor;
+        const char *name = prof_zones_begin(&cursor, i);
+        if (!name) {
+            continue;
+        }
+        u32 max_depth = 0;
+        bool any = false;
+        prof_event_t e;
+        // events are recorded as they close, so walking back stops at the first one ending before the frame
+        while (prof_zones_next(&cursor, &e)) {
+            if (e.end <= shown_start) {
+                break;
+            }
+            if (e.start >= shown_end) {
+                continue;
+            }
+            if (!any) {
+                ImDrawList_AddText_Vec2(draw_list, (ImVec2){origin.x, y}, 0xffffffffu, name, NULL);
+                y += row;
+                any = true;
+            }
+            u64 start = max(e.start, shown_start);
+            u64 end = min(e.end, shown_end);
+            ImVec2 p0 = {origin.x + (f32)((f64)(start - shown_start) * scale), y + (f32)e.depth * row};
+            ImVec2 p1 = {origin.x + (f32)((f64)(end - shown_start) * scale), p0.y + row - 1.0f};
+            p1.x = max(p1.x, p0.x + 1.0f);
+            ImDrawList_AddRectFilled(draw_list, p0, p1, zone_color(e.name), 0.0f, 0);
+            ImVec2 label;
+            igCalcTextSize(&label, e.name, NULL, false, -1.0f);
+            if (p1.x - p0.x > label.x + 4.0f) {
+                ImDrawList_AddText_Vec2(draw_list, (ImVec2){p0.x + 2.0f, p0.y}, 0xff000000u, e.name, NULL);
+            }
+            if (mouse.x >= p0.x && mouse.x < p1.x && mouse.y >= p0.y && mouse.y < p1.y) {
+                igSetTooltip("%s: %.3f ms", e.name, prof_ticks_ms(e.end - e.start));
+            }
+            max_depth = max(max_depth, e.depth);
+        }
+        if (any) {
+            y += (f32)(max_depth + 1) * row + 4.0f;
+        }
+    }
+    igDummy((ImVec2){avail.x, y - origin.y});
+}
+
+static int compare_ms(const void *a, const void *b) {
+    f32 x = *(const f32 *)a, y = *(const f32 *)b;
+    return (x > y) - (x < y);
+}
+
+static void draw_percentiles(i32 n) {
+    if (n == 0 || !igBeginTable("##zones", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV, (ImVec2){0, 0},
+                                0.0f)) {
+        return;
+    }
+    igTableSetupColumn("zone", ImGuiTableColumnFlags_WidthStretch, 0.0f, 0);
+    igTableSetupColumn("p50", ImGuiTableColumnFlags_WidthFixed, 60.0f, 0);
+    igTableSetupColumn("p95", ImGuiTableColumnFlags_WidthFixed, 60.0f, 0);
+    igTableSetupColumn("p99", ImGuiTableColumnFlags_WidthFixed, 60.0f, 0);
+    igTableSetupColumn("max", ImGuiTableColumnFlags_WidthFixed, 60.0f, 0);
+    igTableHeadersRow();
+    f32 sorted[PROF_HISTORY];
+    i32 zones = prof_zone_count();
+    for (i32 i = 0; i < zones; i++) {
+        const f32 *ms;
+        const char *name = prof_zone_times(i, &ms);
+        memcpy(sorted, ms, (usize)n * sizeof(f32));
+        qsort(sorted, (usize)n, sizeof(f32), compare_ms);
+        igTableNextRow(0, 0.0f);
+        igTableNextColumn();
+        igTextUnformatted(name, NULL);
+        const f32 ranks[] = {0.50f, 0.95f, 0.99f, 1.0f};
+        for (i32 r = 0; r < 4; r++) {
+            igTableNextColumn();
+            igText("%.3f", sorted[(i32)(ranks[r] * (f32)(n - 1) + 0.5f)]);
+        }
+    }
+    igEndTable();
+}
+
+bool prof_draw_overlay(bool *open) {
+    if (!*open) {
+        return false;
+    }
+    bool dump = false;
+    igSetNextWindowSize((ImVec2){560, 480}, ImGuiCond_FirstUseEver);
+    if (igBegin("Profiler", open, 0)) {
+        i32 n, offset;
+        const f32 *frame_ms = prof_frame_times(&n, &offset);
+        f32 last = n > 0 ? frame_ms[(offset + n - 1) % PROF_HISTORY] : 0.0f;
+        char overlay[32];
+        snprintf(overlay, sizeof(overlay), "frame %.2f ms", last);
+        ImVec2 avail;
+        igGetContentRegionAvail(&avail);
+        igPlotLines_FloatPtr("##frames", frame_ms, n, offset, overlay, 0.0f, FLT_MAX, (ImVec2){avail.x, 60.0f},
+                             sizeof(f32));
+        dump = igButton("Dump Chrome trace", (ImVec2){0, 0});
+        draw_flame_graph();
+        draw_percentiles(n);
+    }
+    igEnd();
+    return dump;
+}
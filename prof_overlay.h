@@ -0,0 +1,9 @@
+#ifndef AFAIRE_PROF_OVERLAY_H
+#define AFAIRE_PROF_OVERLAY_H
+
+#include "base.h"
+
+// Frame time graph, flame graph of the last frame and per-zone percentiles. Returns true when a trace dump was asked.
+bool prof_draw_overlay(bool *open);
+
+#endif
@@ -0,0 +1,231 @@
+#include "scan.h"
+
+#include <string.h>
+
+#include "alloc.h"
+#include "jobs.h"
+#include "prof.h"
+
+// One directory to list, the data of its job.
+typedef struct {
+    scanner_t *scanner;
+    u32 key;
+    u16 root;
+    char rel[];  // path relative to the root, "" for the root itself
+} scan_dir_t;
+
+static bool batch_add(scan_batch_t *b, u32 key, u32 parent, u16 root, bool is_dir, const char *name) {
+    i32 len = (i32)strlen(name) + 1;
+    if (b->count == b->cap) {
+        i32 cap = max(64, b->cap * 2);
+        scan_entry_t *entries = mem_realloc(b->entries, (usize)cap * sizeof(*entries));
+        if (!entries) {
+            return false;
+        }
+        b->entries = entries;
+        b->cap = cap;
+    }
+    if (b->names_len + len > b->names_cap) {
+        i32 cap = max(b->names_len + len, max(1024, b->names_cap * 2));
+        char *names = mem_realloc(b->names, (usize)cap);
+        if (!names) {
+            return false;
+        }
+        b->names = names;
+        b->names_cap = cap;
+    }
+    memcpy(b->names + b->names_len, name, (usize)len);
+    b->entries[b->count++] = (scan_entry_t){key, parent, root, is_dir, (u32)b->names_len};
+    b->names_len += len;
+    return true;
+}
+
+void scan_batch_free(scan_batch_t *batch) {
+    while (batch) {
+        scan_batch_t *next = batch->next;
+        mem_free(batch->entries);
+        mem_free(batch->names);
+        mem_free(batch);
+        batch = next;
+    }
+}
+
+static void publish(scanner_t *s, scan_batch_t *b) {
+    if (b->count == 0) {
+        scan_batch_free(b);
+        return;
+    }
+    pthread_mutex_lock(&s->results_lock);
+    if (s->results_tail) {
+        s->results_tail->next = b;
+    } else {
+        s->results = b;
+    }
+    s->results_tail = b;
+    pthread_mutex_unlock(&s->results_lock);
+}
+
+// What listing one directory collects.
+typedef struct {
+    scanner_t *scanner;
+    const scan_dir_t *item;
+    scan_batch_t *batch;
+    scan_dir_t **dirs;
+    i32 dir_count;
+    i32 dir_cap;
+} listing_t;
+
+static void add_entry(listing_t *l, const char *name, bool is_dir) {
+    scanner_t *s = l->scanner;
+    const scan_dir_t *item = l->item;
+    u32 key = atomic_fetch_add(&s->next_key, 1);
+    if (!batch_add(l->batch, key, item->key, item->root, is_dir, name) || !is_dir) {
+        return;
+    }
+    // out of memory, the directory is listed but not walked
+    if (l->dir_count == l->dir_cap) {
+        i32 cap = max(16, l->dir_cap * 2);
+        scan_dir_t **dirs = mem_realloc(l->dirs, (usize)cap * sizeof(*dirs));
+        if (!dirs) {
+            return;
+        }
+        l->dirs = dirs;
+        l->dir_cap = cap;
+    }
+    usize rel_len = strlen(item->rel);
+    usize name_len = strlen(name);
+    scan_dir_t *dir = mem_alloc(sizeof(*dir) + rel_len + name_len + 2);
+    if (!dir) {
+        return;
+    }
+    *dir = (scan_dir_t){s, key, item->root};
+    if (rel_len > 0) {
+        memcpy(dir->rel, item->rel, rel_len);
+        dir->rel[rel_len++] = '/';
+    }
+    memcpy(dir->rel + rel_len, name, name_len + 1);
+    l->dirs[l->dir_count++] = dir;
+}
+
+static void visit(void *user, const char *name, bool is_dir) {
+    if (name[0] != '.') {
+        add_entry(user, name, is_dir);
+    }
+}
+
+static void list_dir_job(void *data);
+
+static void finish_dir(scanner_t *s) {
+    // under the lock, so scan_stop() can't destroy it between the decrement and the signal
+    pthread_mutex_lock(&s->idle_lock);
+    if (atomic_fetch_sub(&s->pending, 1) == 1) {
+        pthread_cond_broadcast(&s->idle_cond);
+    }
+    pthread_mutex_unlock(&s->idle_lock);
+}
+
+static bool submit_dir(scanner_t *s, scan_dir_t *dir) {
+    atomic_fetch_add(&s->pending, 1);
+    if (!jobs_submit(JOB_INDEXING, list_dir_job, NULL, dir)) {
+        mem_free(dir);
+        finish_dir(s);
+        return false;
+    }
+    return true;
+}
+
+static void list_dir(scanner_t *s, const scan_dir_t *item) {
+    prof_begin("list_dir");
+    listing_t l = {.scanner = s, .item = item, .batch = mem_alloc(sizeof(scan_batch_t))};
+    if (!l.batch) {
+        prof_end();
+        return;
+    }
+    *l.batch = (scan_batch_t){0};
+    vfs_list(s->roots[item->root], item->rel, visit, &l);
+    // entries must be visible before anything below them gets listed
+    publish(s, l.batch);
+    for (i32 i = 0; i < l.dir_count; i++) {
+        submit_dir(s, l.dirs[i]);
+    }
+    mem_free(l.dirs);
+    prof_end();
+}
+
+static void list_dir_job(void *data) {
+    scan_dir_t *dir = data;
+    scanner_t *s = dir->scanner;
+    if (!atomic_load(&s->stop)) {
+        list_dir(s, dir);
+    }
+    mem_free(dir);
+    finish_dir(s);
+}
+
+bool scan_start(scanner_t *s, vfs_t *const *roots, const char *const *names, i32 count) {
+    memset(s, 0, sizeof(*s));
+    s->root_count = min(count, SCAN_MAX_ROOTS);
+    pthread_mutex_init(&s->idle_lock, NULL);
+    pthread_cond_init(&s->idle_cond, NULL);
+    pthread_mutex_init(&s->results_lock, NULL);
+    atomic_init(&s->next_key, (u32)s->root_count);
+    atomic_init(&s->pending, 0);
+    atomic_init(&s->stop, false);
+
+    scan_batch_t *batch = mem_alloc(sizeof(*batch));
+    if (!batch) {
+        return false;
+    }
+    *batch = (scan_batch_t){0};
+    bool queued = true;
+    for (i32 i = 0; i < s->root_count; i++) {
+        queued &= batch_add(batch, (u32)i, SCAN_NO_PARENT, (u16)i, true, names[i]);
+        s->roots[i] = roots[i];
+    }
+    // the roots go first, as their listings publish entries below them
+    publish(s, batch);
+    for (i32 i = 0; i < s->root_count; i++) {
+        scan_dir_t *dir = s->roots[i] ? mem_alloc(sizeof(*dir) + 1) : NULL;
+        if (dir) {
+            *dir = (scan_dir_t){s, (u32)i, (u16)i};
+            dir->rel[0] = '\0';
+            queued &= submit_dir(s, dir);
+        } else if (s->roots[i]) {
+            queued = false;
+        }
+    }
+    return queued;
+}
+
+scan_batch_t *scan_take(scanner_t *s) {
+    pthread_mutex_lock(&s->results_lock);
+    scan_batch_t *batch = s->results;
+    s->results = s->results_tail = NULL;
+    pthread_mutex_unlock(&s->results_lock);
+    return batch;
+}
+
+bool scan_done(scanner_t *s) {
+    return atomic_load(&s->pending) == 0;
+}
+
+u32 scan_alloc_key(scanner_t *s) {
+    return atomic_fetch_add(&s->next_key, 1);
+}
+
+void scan_stop(scanner_t *s) {
+    if (s->root_count == 0) {
+        return;
+    }
+    atomic_store(&s->stop, true);
+    pthread_mutex_lock(&s->idle_lock);
+    while (atomic_load(&s->pending) > 0) {
+        pthread_cond_wait(&s->idle_cond, &s->idle_lock);
+    }
+    pthread_mutex_unlock(&s->idle_lock);
+    s->root_count = 0;
+    scan_batch_free(scan_take(s));
+    pthread_mutex_destroy(&s->idle_lock);
+    pthread_cond_destroy(&s->idle_cond);
+    pthread_mutex_destroy(&s->results_lock);
+}
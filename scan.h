@@ -0,0 +1,61 @@
+#ifndef AFAIRE_SCAN_H
+#define AFAIRE_SCAN_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "base.h"
+#include "vfs.h"
+
+#define SCAN_MAX_ROOTS 16
+#define SCAN_NO_PARENT UINT32_MAX
+
+// One directory entry found by a worker. Keys are dense, so the consumer can use them as node indices; an entry is
+// always published before the entries of its children.
+typedef struct {
+    u32 key;
+    u32 parent;
+    u16 root;
+    bool is_dir;
+    u32 name;  // offset into the batch's names
+} scan_entry_t;
+
+typedef struct scan_batch {
+    scan_entry_t *entries;
+    i32 count;
+    i32 cap;
+    char *names;
+    i32 names_len;
+    i32 names_cap;
+    struct scan_batch *next;
+} scan_batch_t;
+
+// Recursive directory walker: each directory is listed by one job at indexing priority, which submits one job per
+// subdirectory, so the listing spreads over the job pool through its work stealing.
+typedef struct scanner {
+    vfs_t *roots[SCAN_MAX_ROOTS];  // borrowed
+    i32 root_count;
+    atomic_uint next_key;
+    atomic_int pending;  // directories queued or being listed
+    atomic_bool stop;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;  // signalled when `pending` drops to zero
+    pthread_mutex_t results_lock;
+    scan_batch_t *results;
+    scan_batch_t *results_tail;
+} scanner_t;
+
+// Starts scanning `roots`, whose entries are named `names`; they get keys [0, count) and are available right away from
+// scan_take(). A NULL root gets its entry but isn't listed. The roots must outlive scan_stop().
+bool scan_start(scanner_t *s, vfs_t *const *roots, const char *const *names, i32 count);
+// Detaches everything published so far, oldest first. Free with scan_batch_free().
+scan_batch_t *scan_take(scanner_t *s);
+void scan_batch_free(scan_batch_t *batch);
+bool scan_done(scanner_t *s);
+// Reserves a key for an entry created outside the scan (e.g. a new file).
+u32 scan_alloc_key(scanner_t *s);
+// Makes the queued listings return right away, waits for the running ones and drops unconsumed results. Calling it
+// again does nothing.
+void scan_stop(scanner_t *s);
+
+#endif
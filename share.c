@@ -0,0 +1,588 @@
+#define _GNU_SOURCE
+#include "share.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+void share_snapshot_free(share_snapshot_t *snap) {
+    mem_free(snap->entries);
+    mem_free(snap->names);
+    memset(snap, 0, sizeof(*snap));
+}
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hash.h"
+
+#define SHARE_MAGIC 0x65726166u  // "fare"
+#define SHARE_VERSION 1
+#define SHARE_MAX_NODES (1u << 19)
+#define SHARE_MAX_NAMES (32u << 20)
+// Byte-range locks on the segment, owned by the open file description so they fall with a crashed instance
+#define LOCK_WRITER 0  // exclusive: joining, leaving and writing
+#define LOCK_MEMBER 1  // shared, held by every instance using the index
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    atomic_uint seq;  // odd while a writer is in
+    atomic_uint next_key;
+    u32 ready;
+    u32 node_count;
+    u32 names_len;
+    u32 pad;
+} share_header_t;
+
+#define SHARE_SIZE (sizeof(share_header_t) + SHARE_MAX_NODES * sizeof(share_entry_t) + SHARE_MAX_NAMES)
+
+struct share {
+    i32 fd;
+    share_header_t *header;
+    share_entry_t *entries;
+    char *names;
+    char name[32];
+};
+
+static bool lock_byte(i32 fd, i32 type, i32 byte, bool wait) {
+    struct flock fl = {.l_type = (short)type, .l_whence = SEEK_SET, .l_start = byte, .l_len = 1};
+    while (fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool others_member(i32 fd) {
+    struct flock fl = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = LOCK_MEMBER, .l_len = 1};
+    return fcntl(fd, F_OFD_GETLK, &fl) != 0 || fl.l_type != F_UNLCK;
+}
+
+// The roots by real path, so `notes` and `~/notes` find the same index.
+static bool segment_name(const char *const *roots, i32 count, char *name, usize size) {
+    u64 h = (u64)count;
+    for (i32 i = 0; i < count; i++) {
+        char real[PATH_MAX];
+        if (!realpath(roots[i], real)) {
+            return false;
+        }
+        h = hash64(real, strlen(real) + 1, h);
+    }
+    snprintf(name, size, "/afaire-%016llx", (unsigned long long)h);
+    return true;
+}
+
+// Maps segment `name`, creating it, and holds the writer lock; NULL with nothing left open when that fails.
+static void *segment_open(const char *name, usize size, i32 *fd) {
+    *fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    struct stat st;
+    bool ok = *fd >= 0 && lock_byte(*fd, F_WRLCK, LOCK_WRITER, true) && fstat(*fd, &st) == 0 &&
+              ((usize)st.st_size >= size || ftruncate(*fd, (off_t)size) == 0);
+    void *base = ok ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0) : MAP_FAILED;
+    if (base == MAP_FAILED) {
+        if (*fd >= 0) {
+            close(*fd);
+        }
+        return NULL;
+    }
+    return base;
+}
+
+// Becomes a member if `ok` and lets the next instance in; otherwise unmaps and closes.
+static bool segment_join(i32 fd, void *base, usize size, bool ok) {
+    ok = ok && lock_byte(fd, F_RDLCK, LOCK_MEMBER, false);
+    lock_byte(fd, F_UNLCK, LOCK_WRITER, false);
+    if (!ok) {
+        munmap(base, size);
+        close(fd);
+    }
+    return ok;
+}
+
+// Removes the segment when nobody else is a member.
+static void segment_leave(i32 fd, void *base, usize size, const char *name) {
+    lock_byte(fd, F_UNLCK, LOCK_MEMBER, false);
+    if (lock_byte(fd, F_WRLCK, LOCK_WRITER, true)) {
+        if (!others_member(fd)) {
+            shm_unlink(name);
+        }
+        lock_byte(fd, F_UNLCK, LOCK_WRITER, false);
+    }
+    munmap(base, size);
+    close(fd);
+}
+
+share_t *share_open(const char *const *roots, i32 count) {
+    share_t *s = mem_alloc(sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    *s = (share_t){.fd = -1};
+    void *base = segment_name(roots, count, s->name, sizeof(s->name)) ? segment_open(s->name, SHARE_SIZE, &s->fd)
+                                                                       : NULL;
+    if (!base) {
+        mem_free(s);
+        return NULL;
+    }
+    s->header = base;
+    s->entries = (share_entry_t *)(s->header + 1);
+    s->names = (char *)(s->entries + SHARE_MAX_NODES);
+    share_header_t *h = s->header;
+    bool ok = true;
+    if (!others_member(s->fd)) {
+        // new, or left behind by instances that are gone: start over, this instance scans
+        h->magic = SHARE_MAGIC;
+        h->version = SHARE_VERSION;
+        atomic_store(&h->seq, 0);
+        atomic_store(&h->next_key, 0);
+        h->ready = 0;
+        h->node_count = 0;
+        h->names_len = 0;
+    } else {
+        // another version of afaire, or an index still being scanned
+        ok = h->magic == SHARE_MAGIC && h->version == SHARE_VERSION && h->ready;
+    }
+    if (!segment_join(s->fd, base, SHARE_SIZE, ok)) {
+        mem_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void share_close(share_t *s) {
+    if (s) {
+        segment_leave(s->fd, s->header, SHARE_SIZE, s->name);
+        mem_free(s);
+    }
+}
+
+bool share_ready(const share_t *s) {
+    return s && s->header->ready;
+}
+
+u32 share_seq(const share_t *s) {
+    return atomic_load_explicit(&s->header->seq, memory_order_acquire);
+}
+
+static bool grow(void **data, u32 *cap, u32 need, usize item) {
+    if (need <= *cap) {
+        return true;
+    }
+    u32 cap2 = max(need, max(1024u, *cap * 2));
+    void *p = mem_realloc(*data, (usize)cap2 * item);
+    if (!p) {
+        return false;
+    }
+    *data = p;
+    *cap = cap2;
+    return true;
+}
+
+bool share_read(share_t *s, share_snapshot_t *snap) {
+    share_header_t *h = s->header;
+    u32 seq = share_seq(s);
+    u32 count = h->node_count, names_len = h->names_len;
+    if ((seq & 1) || count > SHARE_MAX_NODES || names_len > SHARE_MAX_NAMES ||
+        !grow((void **)&snap->entries, &snap->entries_cap, max(count, 1u), sizeof(share_entry_t)) ||
+        !grow((void **)&snap->names, &snap->names_cap, names_len + 1, 1)) {
+        return false;
+    }
+    memcpy(snap->entries, s->entries, (usize)count * sizeof(share_entry_t));
+    memcpy(snap->names, s->names, names_len);
+    snap->names[names_len] = '\0';
+    atomic_thread_fence(memory_order_acquire);
+    if (share_seq(s) != seq) {
+        return false;
+    }
+    snap->seq = seq;
+    snap->count = count;
+    snap->names_len = names_len;
+    return true;
+}
+
+u32 share_alloc_key(share_t *s) {
+    return atomic_fetch_add(&s->header->next_key, 1);
+}
+
+void share_begin(share_t *s) {
+    lock_byte(s->fd, F_WRLCK, LOCK_WRITER, true);
+    // an odd number left by a writer that died inside: what it wrote is whole entries or nothing
+    u32 seq = atomic_load(&s->header->seq);
+    atomic_store(&s->header->seq, seq + ((seq & 1) ? 2 : 1));
+    atomic_thread_fence(memory_order_release);
+}
+
+bool share_put(share_t *s, u32 key, u32 parent, u16 root, bool is_dir, const char *name) {
+    share_header_t *h = s->header;
+    u32 len = (u32)strlen(name) + 1;
+    if (key >= SHARE_MAX_NODES || h->names_len + len > SHARE_MAX_NAMES) {
+        return false;
+    }
+    // the name first: the entry only counts once it's whole
+    memcpy(s->names + h->names_len, name, len);
+    s->entries[key] = (share_entry_t){parent, h->names_len, root, (u8)(SHARE_PRESENT | (is_dir ? SHARE_DIR : 0)), 0};
+    h->names_len += len;
+    for (u32 i = h->node_count; i < key; i++) {
+        s->entries[i].flags = 0;
+    }
+    h->node_count = max(h->node_count, key + 1);
+    return true;
+}
+
+void share_remove(share_t *s, u32 key) {
+    if (key < s->header->node_count) {
+        s->entries[key].flags = 0;
+    }
+}
+
+void share_publish(share_t *s, u32 next_key) {
+    atomic_store(&s->header->next_key, next_key);
+    s->header->ready = 1;
+}
+
+void share_end(share_t *s) {
+    atomic_thread_fence(memory_order_release);
+    atomic_fetch_add(&s->header->seq, 1);
+    lock_byte(s->fd, F_UNLCK, LOCK_WRITER, false);
+}
+
+//=== Edit logs
+
+#define LOG_VERSION 2
+#define LOG_SIZE (16u << 20)    // to start with; an append that doesn't fit grows the segment
+#define LOG_MAX_SIZE (1u << 30)
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    atomic_uint len;  // of the records, which are whole up to there
+    atomic_uint next_client;
+    atomic_uint generation;  // bumped when the log is started over from a saved state
+    u32 size;                // of the segment, which the members map again when it grew
+} log_header_t;
+
+// Each record: its length, the client that appended it, then the bytes, padded to 4.
+typedef struct {
+    u32 len;
+    u32 client;
+} log_record_t;
+
+struct share_log {
+    i32 fd;
+    log_header_t *header;
+    u8 *data;
+    u32 size;  // mapped
+    u32 read;  // offset of the next record to hand out
+    u32 generation;
+    u32 client;
+    char name[40];
+};
+
+static u32 record_size(u32 len) {
+    return (u32)sizeof(log_record_t) + ((len + 3) & ~3u);
+}
+
+// Follows a segment another member grew. Under the writer lock, or a reader's.
+static bool log_map(share_log_t *log) {
+    u32 size = log->header->size;
+    if (size <= log->size) {
+        return true;
+    }
+    void *base = mremap(log->header, log->size, size, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    log->header = base;
+    log->data = (u8 *)(log->header + 1);
+    log->size = size;
+    return true;
+}
+
+// Makes room for `need` bytes of records, growing the segment for every member. Under the writer lock.
+static bool log_reserve(share_log_t *log, u32 need) {
+    if (!log_map(log)) {
+        return false;
+    }
+    u32 size = log->size;
+    while (size - (u32)sizeof(log_header_t) < need) {
+        if (size >= LOG_MAX_SIZE) {
+            return false;
+        }
+        size *= 2;
+    }
+    if (size == log->size) {
+        return true;
+    }
+    if (ftruncate(log->fd, (off_t)size) != 0) {
+        return false;
+    }
+    log->header->size = size;
+    return log_map(log);
+}
+
+// Under the writer lock.
+static bool log_put(share_log_t *log, u32 client, const void *rec, u32 len) {
+    u32 at = atomic_load_explicit(&log->header->len, memory_order_relaxed);
+    if (len > LOG_MAX_SIZE || !log_reserve(log, at + record_size(len))) {
+        return false;
+    }
+    memcpy(log->data + at, &(log_record_t){len, client}, sizeof(log_record_t));
+    memcpy(log->data + at + sizeof(log_record_t), rec, len);
+    atomic_store_explicit(&log->header->len, at + record_size(len), memory_order_release);
+    return true;
+}
+
+share_log_t *share_log_open(const char *path, const void *first, u32 first_len, bool *created) {
+    *created = false;
+    char real[PATH_MAX];
+    share_log_t *log = realpath(path, real) ? mem_alloc(sizeof(*log)) : NULL;
+    if (!log) {
+        return NULL;
+    }
+    *log = (share_log_t){.fd = -1, .size = LOG_SIZE};
+    u64 h = hash64(real, strlen(real), 0);
+    snprintf(log->name, sizeof(log->name), "/afaire-edit-%016llx", (unsigned long long)h);
+    void *base = segment_open(log->name, LOG_SIZE, &log->fd);
+    if (!base) {
+        mem_free(log);
+        return NULL;
+    }
+    log->header = base;
+    log->data = (u8 *)(log->header + 1);
+    log_header_t *header = log->header;
+    bool ok = true;
+    *created = !others_member(log->fd);
+    if (*created) {
+        header->magic = SHARE_MAGIC;
+        header->version = LOG_VERSION;
+        atomic_store(&header->len, 0);
+        atomic_store(&header->next_client, 1);
+        atomic_store(&header->generation, 0);
+        header->size = LOG_SIZE;
+        ok = first_len == 0 || log_put(log, 0, first, first_len);
+    } else {
+        ok = header->magic == SHARE_MAGIC && header->version == LOG_VERSION && log_map(log);
+    }
+    log->client = atomic_fetch_add(&log->header->next_client, 1);
+    log->generation = atomic_load(&log->header->generation);
+    if (!segment_join(log->fd, log->header, log->size, ok)) {
+        mem_free(log);
+        return NULL;
+    }
+    return log;
+}
+
+void share_log_close(share_log_t *log) {
+    if (log) {
+        segment_leave(log->fd, log->header, log->size, log->name);
+        mem_free(log);
+    }
+}
+
+u32 share_log_client(const share_log_t *log) {
+    return log->client;
+}
+
+bool share_log_append(share_log_t *log, const void *rec, u32 len) {
+    if (!lock_byte(log->fd, F_WRLCK, LOCK_WRITER, true)) {
+        return false;
+    }
+    bool ok = log_put(log, log->client, rec, len);
+    lock_byte(log->fd, F_UNLCK, LOCK_WRITER, false);
+    return ok;
+}
+
+// Hands out the records from `read` on, this instance's too when `all`. Under a reader's lock.
+static i32 log_read(share_log_t *log, bool all, share_log_fn fn, void *user) {
+    u32 end = atomic_load_explicit(&log->header->len, memory_order_acquire);
+    i32 count = 0;
+    while (log->read < end) {
+        log_record_t r;
+        memcpy(&r, log->data + log->read, sizeof(r));
+        if (all || r.client != log->client) {
+            fn(user, log->data + log->read + sizeof(r), r.len);
+            count++;
+        }
+        log->read += record_size(r.len);
+    }
+    return count;
+}
+
+i32 share_log_read(share_log_t *log, share_log_fn fn, void *user) {
+    log_header_t *h = log->header;
+    if (atomic_load_explicit(&h->len, memory_order_acquire) == log->read &&
+        atomic_load_explicit(&h->generation, memory_order_relaxed) == log->generation) {
+        return 0;
+    }
+    // a restart rewrites the records in place: they're read under the lock, with the segment mapped whole
+    if (!lock_byte(log->fd, F_RDLCK, LOCK_WRITER, true)) {
+        return 0;
+    }
+    i32 count = SHARE_LOG_RESTARTED;
+    if (atomic_load(&h->generation) == log->generation && log_map(log)) {
+        count = log_read(log, false, fn, user);
+    }
+    lock_byte(log->fd, F_UNLCK, LOCK_WRITER, false);
+    return count;
+}
+
+i32 share_log_replay(share_log_t *log, share_log_fn fn, void *user) {
+    if (!lock_byte(log->fd, F_RDLCK, LOCK_WRITER, true)) {
+        return -1;
+    }
+    i32 count = -1;
+    if (log_map(log)) {
+        log->read = 0;
+        log->generation = atomic_load(&log->header->generation);
+        count = log_read(log, true, fn, user);
+    }
+    lock_byte(log->fd, F_UNLCK, LOCK_WRITER, false);
+    return count;
+}
+
+bool share_log_crowded(const share_log_t *log, u32 state_len) {
+    u32 len = atomic_load_explicit(&log->header->len, memory_order_relaxed);
+    return len > (log->size - (u32)sizeof(log_header_t)) / 2 && state_len < len / 4;
+}
+
+bool share_log_restart(share_log_t *log, const void *state, u32 len) {
+    if (!lock_byte(log->fd, F_WRLCK, LOCK_WRITER, true)) {
+        return false;
+    }
+    log_header_t *h = log->header;
+    // records this instance hasn't read aren't in its state
+    bool ok = atomic_load(&h->generation) == log->generation && atomic_load(&h->len) == log->read &&
+              len <= LOG_MAX_SIZE && log_reserve(log, record_size(len));
+    if (ok) {
+        atomic_store_explicit(&h->len, 0, memory_order_relaxed);
+        log_put(log, 0, state, len);
+        log->generation = atomic_fetch_add(&h->generation, 1) + 1;
+        log->read = atomic_load(&h->len);
+    }
+    lock_byte(log->fd, F_UNLCK, LOCK_WRITER, false);
+    return ok;
+}
+
+#else
+
+share_t *share_open(const char *const *roots, i32 count) {
+    (void)roots;
+    (void)count;
+    return NULL;
+}
+
+void share_close(share_t *s) {
+    (void)s;
+}
+
+bool share_ready(const share_t *s) {
+    (void)s;
+    return false;
+}
+
+u32 share_seq(const share_t *s) {
+    (void)s;
+    return 0;
+}
+
+bool share_read(share_t *s, share_snapshot_t *snap) {
+    (void)s;
+    (void)snap;
+    return false;
+}
+
+u32 share_alloc_key(share_t *s) {
+    (void)s;
+    return 0;
+}
+
+void share_begin(share_t *s) {
+    (void)s;
+}
+
+bool share_put(share_t *s, u32 key, u32 parent, u16 root, bool is_dir, const char *name) {
+    (void)s;
+    (void)key;
+    (void)parent;
+    (void)root;
+    (void)is_dir;
+    (void)name;
+    return false;
+}
+
+void share_remove(share_t *s, u32 key) {
+    (void)s;
+    (void)key;
+}
+
+void share_publish(share_t *s, u32 next_key) {
+    (void)s;
+    (void)next_key;
+}
+
+void share_end(share_t *s) {
+    (void)s;
+}
+
+share_log_t *share_log_open(const char *path, const void *first, u32 first_len, bool *created) {
+    (void)path;
+    (void)first;
+    (void)first_len;
+    *created = false;
+    return NULL;
+}
+
+void share_log_close(share_log_t *log) {
+    (void)log;
+}
+
+u32 share_log_client(const share_log_t *log) {
+    (void)log;
+    return 0;
+}
+
+bool share_log_append(share_log_t *log, const void *rec, u32 len) {
+    (void)log;
+    (void)rec;
+    (void)len;
+    return false;
+}
+
+i32 share_log_read(share_log_t *log, share_log_fn fn, void *user) {
+    (void)log;
+    (void)fn;
+    (void)user;
+    return 0;
+}
+
+i32 share_log_replay(share_log_t *log, share_log_fn fn, void *user) {
+    (void)log;
+    (void)fn;
+    (void)user;
+    return -1;
+}
+
+bool share_log_crowded(const share_log_t *log, u32 state_len) {
+    (void)log;
+    (void)state_len;
+    return false;
+}
+
+bool share_log_restart(share_log_t *log, const void *state, u32 len) {
+    (void)log;
+    (void)state;
+    (void)len;
+    return false;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef AFAIRE_SHARE_H
+#define AFAIRE_SHARE_H
+
+#include "base.h"
+
+// An entry of the shared index, at the node's key.
+typedef struct {
+    u32 parent;  // SCAN_NO_PARENT for a root
+    u32 name;    // offset into the names
+    u16 root;
+    u8 flags;  // SHARE_PRESENT, SHARE_DIR
+    u8 pad;
+} share_entry_t;
+
+enum {
+    SHARE_PRESENT = 1 << 0,
+    SHARE_DIR = 1 << 1,
+};
+
+// A consistent copy of the index, reused across reads.
+typedef struct {
+    u32 seq;
+    share_entry_t *entries;
+    u32 count;
+    u32 entries_cap;
+    char *names;
+    u32 names_len;
+    u32 names_cap;
+} share_snapshot_t;
+
+typedef struct share share_t;
+
+// The tree of a set of roots, shared in memory by every afaire open on them, so only the first one scans. The
+// segment is named after the roots' real paths. Whoever creates it, or finds it abandoned, is the indexer: it scans
+// and publishes the result, and from then on every instance's keys come from the index and each instance writes the
+// nodes it adds or removes, bumping a sequence number the others poll. Readers copy it under that number, as a
+// seqlock. Linux only: elsewhere, or when another instance is still scanning, share_open() returns NULL and the caller
+// scans on its own.
+share_t *share_open(const char *const *roots, i32 count);
+// Leaves the index, removing the segment when nobody else uses it.
+void share_close(share_t *s);
+// Whether the index was published, by this instance or before it joined.
+bool share_ready(const share_t *s);
+u32 share_seq(const share_t *s);
+// Copies the index; false when a writer got in the way, to try again on a later poll.
+bool share_read(share_t *s, share_snapshot_t *snap);
+void share_snapshot_free(share_snapshot_t *snap);
+u32 share_alloc_key(share_t *s);
+
+// Writers hold the index between share_begin() and share_end(), which bumps the sequence number.
+void share_begin(share_t *s);
+// Returns false when the index is full: the node stays local to this instance.
+bool share_put(share_t *s, u32 key, u32 parent, u16 root, bool is_dir, const char *name);
+void share_remove(share_t *s, u32 key);
+// The indexer's scan is in: keys continue from `next_key` and the others may join.
+void share_publish(share_t *s, u32 next_key);
+void share_end(share_t *s);
+
+typedef struct share_log share_log_t;
+typedef void (*share_log_fn)(void *user, const u8 *rec, u32 len);
+
+// What every afaire with one file open did to it, as records appended to a segment named after the file's real path,
+// for the others to read back. The first instance to open the log starts it with `first`, from client 0, and is told
+// so by `created`; the log goes away with the last one. The segment grows as records come, and an instance that read
+// them all may start it over from its own saved state when it gets crowded. NULL where shared memory isn't
+// available, or when the log was made by another version.
+share_log_t *share_log_open(const char *path, const void *first, u32 first_len, bool *created);
+void share_log_close(share_log_t *log);
+// This instance's id in the log: never 0, never given to another.
+u32 share_log_client(const share_log_t *log);
+// Returns false when the log can't grow to take the record.
+bool share_log_append(share_log_t *log, const void *rec, u32 len);
+// Hands out the other instances' records appended since the last call, in order; returns how many there were, or
+// SHARE_LOG_RESTARTED when the log was started over since, which share_log_replay() then reads.
+#define SHARE_LOG_RESTARTED (-1)
+i32 share_log_read(share_log_t *log, share_log_fn fn, void *user);
+// Hands out every record of the log from the start, this instance's included; -1 when it can't be read.
+i32 share_log_replay(share_log_t *log, share_log_fn fn, void *user);
+// Whether the records take more than half the segment, and a saved state of `state_len` bytes would free most of it.
+bool share_log_crowded(const share_log_t *log, u32 state_len);
+// Replaces the records with `state`, which must hold all of them: false, leaving the log as it was, when others
+// appended since this instance's last share_log_read().
+bool share_log_restart(share_log_t *log, const void *state, u32 len);
+
+#endif
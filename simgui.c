@@ -0,0 +1,21 @@
+// sokol_imgui implementation, built with the app instead of the sokol library so it can use prof.h and hash.h
+#include "sokol_backend.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include "cimgui.h"
+
+#include "hash.h"
+#include "prof.h"
+
+// time the vertex and index uploads done inside simgui_render()
+static void prof_sg_update_buffer(sg_buffer buf, const sg_range *data) {
+    prof_begin("sg_update_buffer");
+    sg_update_buffer(buf, data);
+    prof_end();
+}
+#define sg_update_buffer prof_sg_update_buffer
+// per-window draw list caching hashes each list's vertices every frame
+#define SIMGUI_HASH(ptr, size, seed) hash64(ptr, size, seed)
+#define SOKOL_IMGUI_IMPL
+#include "sokol_imgui.h"
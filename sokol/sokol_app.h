@@ -1468,6 +1468,7 @@ typedef struct sapp_event {
     int window_height;
     int framebuffer_width;              // = window_width * dpi_scale
     int framebuffer_height;             // = window_height * dpi_scale
+    double timestamp;                   // when the event happened, in seconds on the sapp_present_time() clock, 0.0 if unknown
 } sapp_event;
 
 /*
@@ -1828,6 +1829,16 @@ SOKOL_APP_API_DECL void sapp_cancel_quit(void);
 SOKOL_APP_API_DECL void sapp_quit(void);
 /* call from inside event callback to consume the current event (don't forward to platform) */
 SOKOL_APP_API_DECL void sapp_consume_event(void);
+/* call from inside frame callback when nothing was drawn, keeps the previous frame on screen (GL/D3D11 swap) */
+SOKOL_APP_API_DECL void sapp_skip_present(void);
+/* time the last present (swap) returned, in seconds since sapp started, 0.0 before the first one */
+SOKOL_APP_API_DECL double sapp_present_time(void);
+/* call from inside frame callback to sleep this many seconds after the present, before the next events and frame (X11 only) */
+SOKOL_APP_API_DECL void sapp_delay_next_frame(double seconds);
+/* call from inside frame callback to wait before the next frame until an event arrives, at most this many seconds (X11 and Win32) */
+SOKOL_APP_API_DECL void sapp_wait_event(double timeout);
+/* call from any thread to end a sapp_wait_event() wait early, or skip the next one (X11 only) */
+SOKOL_APP_API_DECL void sapp_wake(void);
 /* get the current frame counter (for comparison with sapp_event.frame_count) */
 SOKOL_APP_API_DECL uint64_t sapp_frame_count(void);
 /* get an averaged/smoothed frame duration in seconds */
@@ -2162,6 +2173,9 @@ inline void sapp_run(const sapp_desc& desc) { return sapp_run(&desc); }
     #include <limits.h> /* LONG_MAX */
     #include <pthread.h>    /* only used a linker-guard, search for _sapp_linux_run() and see first comment */
     #include <time.h>
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #endif
 
 #if defined(_SAPP_APPLE)
@@ -2761,6 +2775,8 @@ typedef struct {
     Atom NET_WM_STATE_FULLSCREEN;
     _sapp_xi_t xi;
     _sapp_xdnd_t xdnd;
+    int wake_fds[2];    /* pipe written by sapp_wake(), polled along with the display */
+    bool wake_valid;
 } _sapp_x11_t;
 
 #if defined(_SAPP_GLX)
@@ -2857,6 +2873,11 @@ typedef struct {
     bool quit_requested;
     bool quit_ordered;
     bool event_consumed;
+    bool skip_present;
+    double present_time;
+    double frame_delay;
+    double event_wait;
+    double event_timestamp;     // overrides the time _sapp_init_event() stamps, for events with a platform timestamp
     bool html5_ask_leave_site;
     bool onscreen_keyboard_shown;
     int window_width;
@@ -3170,9 +3191,18 @@ _SOKOL_PRIVATE void _sapp_discard_state(void) {
     _SAPP_CLEAR_ARC_STRUCT(_sapp_t, _sapp);
 }
 
+_SOKOL_PRIVATE double _sapp_now(void) {
+    #if defined(_SAPP_EMSCRIPTEN)
+        return 0.0;
+    #else
+        return _sapp_timestamp_now(&_sapp.timing.timestamp);
+    #endif
+}
+
 _SOKOL_PRIVATE void _sapp_init_event(sapp_event_type type) {
     _sapp_clear(&_sapp.event, sizeof(_sapp.event));
     _sapp.event.type = type;
+    _sapp.event.timestamp = (_sapp.event_timestamp > 0.0) ? _sapp.event_timestamp : _sapp_now();
     _sapp.event.frame_count = _sapp.frame_count;
     _sapp.event.mouse_button = SAPP_MOUSEBUTTON_INVALID;
     _sapp.event.window_width = _sapp.window_width;
@@ -3211,6 +3241,9 @@ _SOKOL_PRIVATE void _sapp_frame(void) {
         _sapp.first_frame = false;
         _sapp_call_init();
     }
+    _sapp.skip_present = false;
+    _sapp.frame_delay = 0.0;
+    _sapp.event_wait = 0.0;
     _sapp_call_frame();
     _sapp.frame_count++;
 }
@@ -4209,7 +4242,10 @@ _SOKOL_PRIVATE void _sapp_macos_poll_input_events(void) {
         _sapp_macos_frame();
     }
     #if defined(_SAPP_ANY_GL)
-    [[_sapp.macos.view openGLContext] flushBuffer];
+    if (!_sapp.skip_present) {
+        [[_sapp.macos.view openGLContext] flushBuffer];
+        _sapp.present_time = _sapp_now();
+    }
     #endif
 }
 
@@ -7540,6 +7576,7 @@ _SOKOL_PRIVATE LRESULT CALLBACK _sapp_win32_wndproc(HWND hWnd, UINT uMsg, WPARAM
             case WM_TIMER:
                 _sapp_win32_timing_measure();
                 _sapp_frame();
+                if (!_sapp.skip_present) {
                 #if defined(SOKOL_D3D11)
                     // present with DXGI_PRESENT_DO_NOT_WAIT
                     _sapp_d3d11_present(true);
@@ -7547,6 +7584,8 @@ _SOKOL_PRIVATE LRESULT CALLBACK _sapp_win32_wndproc(HWND hWnd, UINT uMsg, WPARAM
                 #if defined(SOKOL_GLCORE)
                     _sapp_wgl_swap_buffers();
                 #endif
+                    _sapp.present_time = _sapp_now();
+                }
                 /* NOTE: resizing the swap-chain during resize leads to a substantial
                    memory spike (hundreds of megabytes for a few seconds).
 
@@ -7967,6 +8006,11 @@ _SOKOL_PRIVATE void _sapp_win32_run(const sapp_desc* desc) {
     bool done = false;
     while (!(done || _sapp.quit_ordered)) {
         _sapp_win32_timing_measure();
+        if (_sapp.event_wait > 0.0) {
+            /* throttled or idle frame: any message ends the wait */
+            MsgWaitForMultipleObjects(0, NULL, FALSE, (DWORD)(_sapp.event_wait * 1000.0), QS_ALLINPUT);
+            _sapp.event_wait = 0.0;
+        }
         MSG msg;
         while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
             if (WM_QUIT == msg.message) {
@@ -7980,13 +8024,19 @@ _SOKOL_PRIVATE void _sapp_win32_run(const sapp_desc* desc) {
         }
         _sapp_frame();
         #if defined(SOKOL_D3D11)
-            _sapp_d3d11_present(false);
+            if (!_sapp.skip_present) {
+                _sapp_d3d11_present(false);
+                _sapp.present_time = _sapp_now();
+            }
             if (IsIconic(_sapp.win32.hwnd)) {
                 Sleep((DWORD)(16 * _sapp.swap_interval));
             }
         #endif
         #if defined(SOKOL_GLCORE)
-            _sapp_wgl_swap_buffers();
+            if (!_sapp.skip_present) {
+                _sapp_wgl_swap_buffers();
+                _sapp.present_time = _sapp_now();
+            }
         #endif
         /* check for window resized, this cannot happen in WM_SIZE as it explodes memory usage */
         if (_sapp_win32_update_dimensions()) {
@@ -8281,7 +8331,10 @@ _SOKOL_PRIVATE void _sapp_android_frame(void) {
     _sapp_timing_measure(&_sapp.timing);
     _sapp_android_update_dimensions(_sapp.android.current.window, false);
     _sapp_frame();
-    eglSwapBuffers(_sapp.android.display, _sapp.android.surface);
+    if (!_sapp.skip_present) {
+        eglSwapBuffers(_sapp.android.display, _sapp.android.surface);
+        _sapp.present_time = _sapp_now();
+    }
 }
 
 _SOKOL_PRIVATE bool _sapp_android_touch_event(const AInputEvent* e) {
@@ -10405,6 +10458,22 @@ _SOKOL_PRIVATE void _sapp_x11_scroll_event(float x, float y, uint32_t mods) {
     }
 }
 
+/* X server timestamps are milliseconds of CLOCK_MONOTONIC on Xorg and Xwayland, which gives the time an input event
+   sat in the queue before sokol_app read it; any other clock falls back to the time of reading
+*/
+_SOKOL_PRIVATE double _sapp_x11_event_timestamp(Time server_ms) {
+    const double now = _sapp_now();
+    struct timespec tspec;
+    clock_gettime(_SAPP_CLOCK_MONOTONIC, &tspec);
+    const uint32_t now_ms = (uint32_t)((uint64_t)tspec.tv_sec * 1000 + (uint64_t)tspec.tv_nsec / 1000000);
+    const uint32_t age_ms = now_ms - (uint32_t)server_ms;
+    if (age_ms < 1000) {
+        const double t = now - (double)age_ms / 1000.0;
+        return (t > 0.0) ? t : now;
+    }
+    return now;
+}
+
 _SOKOL_PRIVATE void _sapp_x11_key_event(sapp_event_type type, sapp_keycode key, bool repeat, uint32_t mods) {
     if (_sapp_events_enabled()) {
         _sapp_init_event(type);
@@ -10732,6 +10801,7 @@ _SOKOL_PRIVATE void _sapp_x11_process_event(XEvent* event) {
             break;
         case KeyPress:
             {
+                _sapp.event_timestamp = _sapp_x11_event_timestamp(event->xkey.time);
                 int keycode = (int)event->xkey.keycode;
                 const sapp_keycode key = _sapp_x11_translate_key(keycode);
                 bool repeat = _sapp_x11_keycodes[keycode & 0xFF];
@@ -10748,6 +10818,7 @@ _SOKOL_PRIVATE void _sapp_x11_process_event(XEvent* event) {
                 if (chr > 0) {
                     _sapp_x11_char_event((uint32_t)chr, repeat, mods);
                 }
+                _sapp.event_timestamp = 0.0;
             }
             break;
         case KeyRelease:
@@ -11153,8 +11224,33 @@ _SOKOL_PRIVATE void _sapp_linux_run(const sapp_desc* desc) {
     }
 
     XFlush(_sapp.x11.display);
+    if (pipe(_sapp.x11.wake_fds) == 0) {
+        fcntl(_sapp.x11.wake_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(_sapp.x11.wake_fds[1], F_SETFL, O_NONBLOCK);
+        _sapp.x11.wake_valid = true;
+    }
     while (!_sapp.quit_ordered) {
         _sapp_timing_measure(&_sapp.timing);
+        if (_sapp.frame_delay > 0.0) {
+            /* just-in-time frame: events arriving during the sleep still make it into this frame */
+            const double delay = _sapp.frame_delay;
+            _sapp.frame_delay = 0.0;
+            struct timespec ts = { (time_t)delay, (long)((delay - (double)(time_t)delay) * 1000000000.0) };
+            nanosleep(&ts, NULL);
+        }
+        if ((_sapp.event_wait > 0.0) && (XPending(_sapp.x11.display) == 0)) {
+            /* throttled or idle frame: any event, or sapp_wake(), ends the wait */
+            struct pollfd pfd[2] = {
+                { ConnectionNumber(_sapp.x11.display), POLLIN, 0 },
+                { _sapp.x11.wake_valid ? _sapp.x11.wake_fds[0] : -1, POLLIN, 0 },
+            };
+            poll(pfd, 2, (int)(_sapp.event_wait * 1000.0));
+        }
+        _sapp.event_wait = 0.0;
+        if (_sapp.x11.wake_valid) {
+            char drain[64];
+            while (read(_sapp.x11.wake_fds[0], drain, sizeof(drain)) > 0) {}
+        }
         int count = XPending(_sapp.x11.display);
         while (count--) {
             XEvent event;
@@ -11162,11 +11258,14 @@ _SOKOL_PRIVATE void _sapp_linux_run(const sapp_desc* desc) {
             _sapp_x11_process_event(&event);
         }
         _sapp_frame();
+        if (!_sapp.skip_present) {
 #if defined(_SAPP_GLX)
-        _sapp_glx_swap_buffers();
+            _sapp_glx_swap_buffers();
 #else
-        eglSwapBuffers(_sapp.egl.display, _sapp.egl.surface);
+            eglSwapBuffers(_sapp.egl.display, _sapp.egl.surface);
 #endif
+            _sapp.present_time = _sapp_now();
+        }
         XFlush(_sapp.x11.display);
         /* handle quit-requested, either from window or from sapp_request_quit() */
         if (_sapp.quit_requested && !_sapp.quit_ordered) {
@@ -11187,6 +11286,11 @@ _SOKOL_PRIVATE void _sapp_linux_run(const sapp_desc* desc) {
     _sapp_x11_destroy_window();
     _sapp_x11_destroy_cursors();
     XCloseDisplay(_sapp.x11.display);
+    if (_sapp.x11.wake_valid) {
+        _sapp.x11.wake_valid = false;
+        close(_sapp.x11.wake_fds[0]);
+        close(_sapp.x11.wake_fds[1]);
+    }
     _sapp_discard_state();
 }
 
@@ -11429,6 +11533,32 @@ SOKOL_API_IMPL void sapp_quit(void) {
     _sapp.quit_ordered = true;
 }
 
+SOKOL_API_IMPL void sapp_skip_present(void) {
+    _sapp.skip_present = true;
+}
+
+SOKOL_API_IMPL double sapp_present_time(void) {
+    return _sapp.present_time;
+}
+
+SOKOL_API_IMPL void sapp_delay_next_frame(double seconds) {
+    _sapp.frame_delay = seconds;
+}
+
+SOKOL_API_IMPL void sapp_wait_event(double timeout) {
+    _sapp.event_wait = timeout;
+}
+
+SOKOL_API_IMPL void sapp_wake(void) {
+    #if defined(_SAPP_LINUX)
+        if (_sapp.x11.wake_valid) {
+            const char c = 0;
+            /* a full pipe already has a wakeup pending */
+            if (write(_sapp.x11.wake_fds[1], &c, 1) < 0) {}
+        }
+    #endif
+}
+
 SOKOL_API_IMPL void sapp_consume_event(void) {
     _sapp.event_consumed = true;
 }
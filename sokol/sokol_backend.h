@@ -0,0 +1,13 @@
+// the sokol_gfx backend for the target platform, shared by sokol.c and the app's sokol_imgui implementation
+#if defined(__MINGW32__)
+#define SOKOL_GLCORE
+#elif defined(_WIN32)
+#define SOKOL_D3D11
+#elif defined(__EMSCRIPTEN__)
+#define SOKOL_GLES3
+#elif defined(__APPLE__)
+// NOTE: on macOS, sokol.c is compiled explicitely as ObjC
+#define SOKOL_METAL
+#else
+#define SOKOL_GLCORE
+#endif
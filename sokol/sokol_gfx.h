@@ -3377,6 +3377,7 @@ typedef struct sg_frame_stats_gl {
     uint32_t num_enable_vertex_attrib_array;
     uint32_t num_disable_vertex_attrib_array;
     uint32_t num_uniform;
+    uint32_t num_stream_waits;  // persistent stream buffer updates that waited on the GPU
 } sg_frame_stats_gl;
 
 typedef struct sg_frame_stats_d3d11_pass {
@@ -3525,6 +3526,8 @@ typedef struct sg_frame_stats {
     _SG_LOGITEM_XMACRO(OK, "Ok") \
     _SG_LOGITEM_XMACRO(MALLOC_FAILED, "memory allocation failed") \
     _SG_LOGITEM_XMACRO(GL_TEXTURE_FORMAT_NOT_SUPPORTED, "pixel format not supported for texture (gl)") \
+    _SG_LOGITEM_XMACRO(GL_PERSISTENT_STREAM_NOT_SUPPORTED, "persistent mapped stream buffers not supported, falling back to orphaning (gl)") \
+    _SG_LOGITEM_XMACRO(GL_STREAM_BUFFER_MAP_FAILED, "mapping a persistent stream buffer failed, falling back to orphaning (gl)") \
     _SG_LOGITEM_XMACRO(GL_3D_TEXTURES_NOT_SUPPORTED, "3d textures not supported (gl)") \
     _SG_LOGITEM_XMACRO(GL_ARRAY_TEXTURES_NOT_SUPPORTED, "array textures not supported (gl)") \
     _SG_LOGITEM_XMACRO(GL_SHADER_COMPILATION_FAILED, "shader compilation failed (gl)") \
@@ -3988,6 +3991,35 @@ typedef struct sg_logger {
     void* user_data;
 } sg_logger;
 
+/*
+    sg_gl_stream_mode
+
+    How the GL backend uploads SG_USAGE_STREAM buffers, see sg_desc.gl_stream_mode:
+
+    SG_GL_STREAMMODE_PERSISTENT:
+        vertex- and index-buffers are created with glBufferStorage() and stay
+        mapped (persistent and coherent, GL 4.4 or GL_ARB_buffer_storage),
+        each update writes the next of 3 ranges after waiting on the fence
+        of the frame which last used it
+    SG_GL_STREAMMODE_ORPHAN:
+        each update calls glBufferData(NULL) before glBufferSubData(), so the
+        driver hands out fresh storage instead of waiting for the GPU
+    SG_GL_STREAMMODE_SUBDATA:
+        glBufferSubData() into SG_NUM_INFLIGHT_FRAMES buffers used round-robin,
+        like SG_USAGE_DYNAMIC
+
+    The default is SG_GL_STREAMMODE_PERSISTENT where supported, and
+    SG_GL_STREAMMODE_ORPHAN otherwise.
+*/
+typedef enum sg_gl_stream_mode {
+    _SG_GL_STREAMMODE_DEFAULT,
+    SG_GL_STREAMMODE_PERSISTENT,
+    SG_GL_STREAMMODE_ORPHAN,
+    SG_GL_STREAMMODE_SUBDATA,
+    _SG_GL_STREAMMODE_NUM,
+    _SG_GL_STREAMMODE_FORCE_U32 = 0x7FFFFFFF
+} sg_gl_stream_mode;
+
 typedef struct sg_desc {
     uint32_t _start_canary;
     int buffer_pool_size;
@@ -4003,6 +4035,7 @@ typedef struct sg_desc {
     bool mtl_use_command_buffer_with_retained_references;    // Metal: use a managed MTLCommandBuffer which ref-counts used resources
     bool wgpu_disable_bindgroups_cache;  // set to true to disable the WebGPU backend BindGroup cache
     int wgpu_bindgroups_cache_size;      // number of slots in the WebGPU bindgroup cache (must be 2^N)
+    sg_gl_stream_mode gl_stream_mode;    // GL: how SG_USAGE_STREAM buffers are uploaded
     sg_allocator allocator;
     sg_logger logger; // optional log function override
     sg_environment environment;
@@ -4303,6 +4336,8 @@ SOKOL_GFX_API_DECL sg_wgpu_attachments_info sg_wgpu_query_attachments_info(sg_at
 
 // GL: get internal buffer resource objects
 SOKOL_GFX_API_DECL sg_gl_buffer_info sg_gl_query_buffer_info(sg_buffer buf);
+// GL: get the upload mode used for SG_USAGE_STREAM buffers
+SOKOL_GFX_API_DECL sg_gl_stream_mode sg_gl_query_stream_mode(void);
 // GL: get internal image resource objects
 SOKOL_GFX_API_DECL sg_gl_image_info sg_gl_query_image_info(sg_image img);
 // GL: get internal sampler resource objects
@@ -4554,6 +4589,13 @@ inline int sg_append_buffer(sg_buffer buf_id, const sg_range& data) { return sg_
         typedef int64_t  GLint64;
         typedef float  GLfloat;
         typedef int  GLint;
+        typedef struct __GLsync*  GLsync;
+        #define GL_MAP_WRITE_BIT 0x0002
+        #define GL_MAP_PERSISTENT_BIT 0x0040
+        #define GL_MAP_COHERENT_BIT 0x0080
+        #define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+        #define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+        #define GL_TIMEOUT_EXPIRED 0x911B
         #define GL_INT_2_10_10_10_REV 0x8D9F
         #define GL_R32F 0x822E
         #define GL_PROGRAM_POINT_SIZE 0x8642
@@ -5271,6 +5313,11 @@ typedef _sg_dummy_attachments_t _sg_attachments_t;
 #elif defined(_SOKOL_ANY_GL)
 
 #define _SG_GL_TEXTURE_SAMPLER_CACHE_SIZE (SG_MAX_SHADERSTAGE_IMAGESAMPLERPAIRS * SG_NUM_SHADER_STAGES)
+#define _SG_GL_STREAM_REGIONS (3)
+#define _SG_GL_STREAM_REGION_ALIGN (256)
+#if defined(SOKOL_GLCORE) && defined(GL_MAP_PERSISTENT_BIT)
+#define _SG_GL_PERSISTENT_STREAM (1)
+#endif
 #define _SG_GL_STORAGEBUFFER_STAGE_INDEX_PITCH (SG_MAX_SHADERSTAGE_STORAGEBUFFERS)
 
 typedef struct {
@@ -5279,6 +5326,11 @@ typedef struct {
     struct {
         GLuint buf[SG_NUM_INFLIGHT_FRAMES];
         bool injected;  // if true, external buffers were injected with sg_buffer_desc.gl_buffers
+        bool orphan;    // stream buffer re-specified with glBufferData(NULL) before each upload
+        uint8_t* mapped;    // persistent stream buffer: _SG_GL_STREAM_REGIONS ranges of region_size bytes
+        int region_size;
+        int region;         // the range drawn from
+        uint32_t region_frame[_SG_GL_STREAM_REGIONS];  // frame index which last wrote each range, 0 if none
     } gl;
 } _sg_gl_buffer_t;
 typedef _sg_gl_buffer_t _sg_buffer_t;
@@ -5437,6 +5489,11 @@ typedef struct {
     sg_store_action color_store_actions[SG_MAX_COLOR_ATTACHMENTS];
     sg_store_action depth_store_action;
     sg_store_action stencil_store_action;
+    sg_gl_stream_mode stream_mode;
+    bool persistent_stream_supported;
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+    GLsync frame_fences[_SG_GL_STREAM_REGIONS];  // of the last frames, indexed by frame index
+    #endif
     #if _SOKOL_USE_WIN32_GL_LOADER
     HINSTANCE opengl32_dll;
     #endif
@@ -6915,14 +6972,24 @@ _SOKOL_PRIVATE void _sg_dummy_update_image(_sg_image_t* img, const sg_image_data
     _SG_XMACRO(glDeleteSamplers,                  void, (GLsizei n, const GLuint* samplers)) \
     _SG_XMACRO(glBindBufferBase,                  void, (GLenum target, GLuint index, GLuint buffer))
 
+// functions only used for persistent stream buffers, which may be missing before GL 4.4
+#define _SG_GL_FUNCS_OPTIONAL \
+    _SG_XMACRO(glBufferStorage,                   void, (GLenum target, GLsizeiptr size, const void * data, GLbitfield flags)) \
+    _SG_XMACRO(glMapBufferRange,                  void *, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)) \
+    _SG_XMACRO(glFenceSync,                       GLsync, (GLenum condition, GLbitfield flags)) \
+    _SG_XMACRO(glClientWaitSync,                  GLenum, (GLsync sync, GLbitfield flags, GLuint64 timeout)) \
+    _SG_XMACRO(glDeleteSync,                      void, (GLsync sync))
+
 // generate GL function pointer typedefs
 #define _SG_XMACRO(name, ret, args) typedef ret (GL_APIENTRY* PFN_ ## name) args;
 _SG_GL_FUNCS
+_SG_GL_FUNCS_OPTIONAL
 #undef _SG_XMACRO
 
 // generate GL function pointers
 #define _SG_XMACRO(name, ret, args) static PFN_ ## name name;
 _SG_GL_FUNCS
+_SG_GL_FUNCS_OPTIONAL
 #undef _SG_XMACRO
 
 // helper function to lookup GL functions in GL DLL
@@ -6946,6 +7013,11 @@ _SOKOL_PRIVATE  void _sg_gl_load_opengl(void) {
     #define _SG_XMACRO(name, ret, args) name = (PFN_ ## name) _sg_gl_getprocaddr(#name, wgl_getprocaddress);
     _SG_GL_FUNCS
     #undef _SG_XMACRO
+    // wglGetProcAddress() may return small non-zero values for missing functions
+    #define _SG_XMACRO(name, ret, args) name = (PFN_ ## name) wgl_getprocaddress(#name); \
+        if ((uintptr_t)name <= 3 || (intptr_t)name == -1) { name = 0; }
+    _SG_GL_FUNCS_OPTIONAL
+    #undef _SG_XMACRO
 }
 
 _SOKOL_PRIVATE void _sg_gl_unload_opengl(void) {
@@ -7637,6 +7709,7 @@ _SOKOL_PRIVATE void _sg_gl_init_caps_glcore(void) {
     _sg.features.mrt_independent_blend_state = false;
     _sg.features.mrt_independent_write_mask = true;
     _sg.features.storage_buffer = version >= 430;
+    bool has_buffer_storage = version >= 440;
 
     // scan extensions
     bool has_s3tc = false;  // BC1..BC3
@@ -7664,9 +7737,19 @@ _SOKOL_PRIVATE void _sg_gl_init_caps_glcore(void) {
                 _sg.gl.ext_anisotropic = true;
             } else if (strstr(ext, "_texture_compression_astc_ldr")) {
                 has_astc = true;
+            } else if (strstr(ext, "_ARB_buffer_storage")) {
+                has_buffer_storage = true;
             }
         }
     }
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+        #if defined(_SOKOL_USE_WIN32_GL_LOADER)
+        has_buffer_storage = has_buffer_storage && glBufferStorage && glMapBufferRange && glFenceSync && glClientWaitSync && glDeleteSync;
+        #endif
+        _sg.gl.persistent_stream_supported = has_buffer_storage;
+    #else
+        _SOKOL_UNUSED(has_buffer_storage);
+    #endif
 
     // limits
     _sg_gl_init_limits();
@@ -8168,8 +8251,6 @@ _SOKOL_PRIVATE void _sg_gl_reset_state_cache(void) {
 }
 
 _SOKOL_PRIVATE void _sg_gl_setup_backend(const sg_desc* desc) {
-    _SOKOL_UNUSED(desc);
-
     // assumes that _sg.gl is already zero-initialized
     _sg.gl.valid = true;
 
@@ -8186,6 +8267,13 @@ _SOKOL_PRIVATE void _sg_gl_setup_backend(const sg_desc* desc) {
     #elif defined(SOKOL_GLES3)
         _sg_gl_init_caps_gles3();
     #endif
+    _sg.gl.stream_mode = desc->gl_stream_mode;
+    if (_sg.gl.stream_mode == _SG_GL_STREAMMODE_DEFAULT) {
+        _sg.gl.stream_mode = _sg.gl.persistent_stream_supported ? SG_GL_STREAMMODE_PERSISTENT : SG_GL_STREAMMODE_ORPHAN;
+    } else if ((_sg.gl.stream_mode == SG_GL_STREAMMODE_PERSISTENT) && !_sg.gl.persistent_stream_supported) {
+        _SG_WARN(GL_PERSISTENT_STREAM_NOT_SUPPORTED);
+        _sg.gl.stream_mode = SG_GL_STREAMMODE_ORPHAN;
+    }
 
     glGenVertexArrays(1, &_sg.gl.vao);
     glBindVertexArray(_sg.gl.vao);
@@ -8204,12 +8292,77 @@ _SOKOL_PRIVATE void _sg_gl_discard_backend(void) {
     if (_sg.gl.vao) {
         glDeleteVertexArrays(1, &_sg.gl.vao);
     }
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+    for (int i = 0; i < _SG_GL_STREAM_REGIONS; i++) {
+        if (_sg.gl.frame_fences[i]) {
+            glDeleteSync(_sg.gl.frame_fences[i]);
+        }
+    }
+    #endif
     #if defined(_SOKOL_USE_WIN32_GL_LOADER)
     _sg_gl_unload_opengl();
     #endif
     _sg.gl.valid = false;
 }
 
+//-- GL backend streaming buffers ----------------------------------------------
+// offset of the range a persistent stream buffer currently draws from
+_SOKOL_PRIVATE int _sg_gl_stream_offset(const _sg_buffer_t* buf) {
+    return buf->gl.mapped ? (buf->gl.region * buf->gl.region_size) : 0;
+}
+
+_SOKOL_PRIVATE void _sg_gl_client_wait(GLsync fence) {
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+    GLenum res = glClientWaitSync(fence, 0, 0);
+    if (res == GL_TIMEOUT_EXPIRED) {
+        _sg_stats_add(gl.num_stream_waits, 1);
+        do {
+            res = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (res == GL_TIMEOUT_EXPIRED);
+    }
+    #else
+    _SOKOL_UNUSED(fence);
+    #endif
+}
+
+// waits until the GPU is done with a frame, the fences of the last _SG_GL_STREAM_REGIONS
+// frames are kept, _sg_gl_commit() already waited for older ones
+_SOKOL_PRIVATE void _sg_gl_wait_frame(uint32_t frame_index) {
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+    if ((0 == frame_index) || ((_sg.frame_index - frame_index) > _SG_GL_STREAM_REGIONS)) {
+        return;
+    }
+    GLsync fence = _sg.gl.frame_fences[frame_index % _SG_GL_STREAM_REGIONS];
+    if (fence) {
+        _sg_gl_client_wait(fence);
+    }
+    #else
+    _SOKOL_UNUSED(frame_index);
+    #endif
+}
+
+// creates immutable storage for _SG_GL_STREAM_REGIONS ranges in the bound buffer and maps it for
+// the buffer's lifetime, returns false if the buffer isn't streamed that way or mapping failed
+_SOKOL_PRIVATE bool _sg_gl_map_stream_buffer(_sg_buffer_t* buf, GLenum gl_target) {
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+    if ((buf->cmn.usage != SG_USAGE_STREAM) || (buf->cmn.type == SG_BUFFERTYPE_STORAGEBUFFER) ||
+        (_sg.gl.stream_mode != SG_GL_STREAMMODE_PERSISTENT))
+    {
+        return false;
+    }
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    buf->gl.region_size = _sg_roundup(buf->cmn.size, _SG_GL_STREAM_REGION_ALIGN);
+    const GLsizeiptr size = (GLsizeiptr)buf->gl.region_size * _SG_GL_STREAM_REGIONS;
+    glBufferStorage(gl_target, size, 0, flags);
+    buf->gl.mapped = (uint8_t*) glMapBufferRange(gl_target, 0, size, flags);
+    return 0 != buf->gl.mapped;
+    #else
+    _SOKOL_UNUSED(buf);
+    _SOKOL_UNUSED(gl_target);
+    return false;
+    #endif
+}
+
 //-- GL backend resource creation and destruction ------------------------------
 _SOKOL_PRIVATE sg_resource_state _sg_gl_create_buffer(_sg_buffer_t* buf, const sg_buffer_desc* desc) {
     SOKOL_ASSERT(buf && desc);
@@ -8217,6 +8370,10 @@ _SOKOL_PRIVATE sg_resource_state _sg_gl_create_buffer(_sg_buffer_t* buf, const s
     buf->gl.injected = (0 != desc->gl_buffers[0]);
     const GLenum gl_target = _sg_gl_buffer_target(buf->cmn.type);
     const GLenum gl_usage  = _sg_gl_usage(buf->cmn.usage);
+    if ((buf->cmn.usage == SG_USAGE_STREAM) && !buf->gl.injected && (_sg.gl.stream_mode != SG_GL_STREAMMODE_SUBDATA)) {
+        // a single buffer, persistent ranges and orphaning take care of not overwriting data in flight
+        buf->cmn.num_slots = 1;
+    }
     for (int slot = 0; slot < buf->cmn.num_slots; slot++) {
         GLuint gl_buf = 0;
         if (buf->gl.injected) {
@@ -8227,6 +8384,21 @@ _SOKOL_PRIVATE sg_resource_state _sg_gl_create_buffer(_sg_buffer_t* buf, const s
             SOKOL_ASSERT(gl_buf);
             _sg_gl_cache_store_buffer_binding(gl_target);
             _sg_gl_cache_bind_buffer(gl_target, gl_buf);
+            if (_sg_gl_map_stream_buffer(buf, gl_target)) {
+                _sg_gl_cache_restore_buffer_binding(gl_target);
+                buf->gl.buf[slot] = gl_buf;
+                continue;
+            }
+            if (buf->gl.region_size > 0) {
+                // glBufferStorage() made the storage immutable, start over with a new buffer
+                _SG_WARN(GL_STREAM_BUFFER_MAP_FAILED);
+                _sg_gl_cache_invalidate_buffer(gl_buf);
+                glDeleteBuffers(1, &gl_buf);
+                glGenBuffers(1, &gl_buf);
+                _sg_gl_cache_bind_buffer(gl_target, gl_buf);
+                buf->gl.region_size = 0;
+            }
+            buf->gl.orphan = (buf->cmn.num_slots == 1) && (buf->cmn.usage == SG_USAGE_STREAM);
             glBufferData(gl_target, buf->cmn.size, 0, gl_usage);
             if (buf->cmn.usage == SG_USAGE_IMMUTABLE) {
                 SOKOL_ASSERT(desc->data.ptr);
@@ -9301,7 +9473,7 @@ _SOKOL_PRIVATE bool _sg_gl_apply_bindings(_sg_bindings_t* bnd) {
     // index buffer (can be 0)
     const GLuint gl_ib = bnd->ib ? bnd->ib->gl.buf[bnd->ib->cmn.active_slot] : 0;
     _sg_gl_cache_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, gl_ib);
-    _sg.gl.cache.cur_ib_offset = bnd->ib_offset;
+    _sg.gl.cache.cur_ib_offset = bnd->ib_offset + (bnd->ib ? _sg_gl_stream_offset(bnd->ib) : 0);
 
     // vertex attributes
     for (GLuint attr_index = 0; attr_index < (GLuint)_sg.limits.max_vertex_attrs; attr_index++) {
@@ -9316,7 +9488,7 @@ _SOKOL_PRIVATE bool _sg_gl_apply_bindings(_sg_bindings_t* bnd) {
             _sg_buffer_t* vb = bnd->vbs[attr->vb_index];
             SOKOL_ASSERT(vb);
             gl_vb = vb->gl.buf[vb->cmn.active_slot];
-            vb_offset = bnd->vb_offsets[attr->vb_index] + attr->offset;
+            vb_offset = bnd->vb_offsets[attr->vb_index] + attr->offset + _sg_gl_stream_offset(vb);
             if ((gl_vb != cache_attr->gl_vbuf) ||
                 (attr->size != cache_attr->gl_attr.size) ||
                 (attr->type != cache_attr->gl_attr.type) ||
@@ -9438,10 +9610,34 @@ _SOKOL_PRIVATE void _sg_gl_commit(void) {
     // "soft" clear bindings (only those that are actually bound)
     _sg_gl_cache_clear_buffer_bindings(false);
     _sg_gl_cache_clear_texture_sampler_bindings(false);
+    #if defined(_SG_GL_PERSISTENT_STREAM)
+    if (_sg.gl.stream_mode == SG_GL_STREAMMODE_PERSISTENT) {
+        // at most _SG_GL_STREAM_REGIONS frames in flight, so a persistent stream buffer's ranges are
+        // free again once their frame's fence signaled
+        GLsync* fence = &_sg.gl.frame_fences[_sg.frame_index % _SG_GL_STREAM_REGIONS];
+        if (*fence) {
+            _sg_gl_client_wait(*fence);
+            glDeleteSync(*fence);
+        }
+        *fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    #endif
+}
+
+// moves a persistent stream buffer to its next range, once the GPU is done reading it
+_SOKOL_PRIVATE void _sg_gl_next_stream_region(_sg_buffer_t* buf) {
+    buf->gl.region = (buf->gl.region + 1) % _SG_GL_STREAM_REGIONS;
+    _sg_gl_wait_frame(buf->gl.region_frame[buf->gl.region]);
+    buf->gl.region_frame[buf->gl.region] = _sg.frame_index;
 }
 
 _SOKOL_PRIVATE void _sg_gl_update_buffer(_sg_buffer_t* buf, const sg_range* data) {
     SOKOL_ASSERT(buf && data && data->ptr && (data->size > 0));
+    if (buf->gl.mapped) {
+        _sg_gl_next_stream_region(buf);
+        memcpy(buf->gl.mapped + _sg_gl_stream_offset(buf), data->ptr, data->size);
+        return;
+    }
     // only one update per buffer per frame allowed
     if (++buf->cmn.active_slot >= buf->cmn.num_slots) {
         buf->cmn.active_slot = 0;
@@ -9453,6 +9649,9 @@ _SOKOL_PRIVATE void _sg_gl_update_buffer(_sg_buffer_t* buf, const sg_range* data
     _SG_GL_CHECK_ERROR();
     _sg_gl_cache_store_buffer_binding(gl_tgt);
     _sg_gl_cache_bind_buffer(gl_tgt, gl_buf);
+    if (buf->gl.orphan) {
+        glBufferData(gl_tgt, buf->cmn.size, 0, _sg_gl_usage(buf->cmn.usage));
+    }
     glBufferSubData(gl_tgt, 0, (GLsizeiptr)data->size, data->ptr);
     _sg_gl_cache_restore_buffer_binding(gl_tgt);
     _SG_GL_CHECK_ERROR();
@@ -9460,6 +9659,13 @@ _SOKOL_PRIVATE void _sg_gl_update_buffer(_sg_buffer_t* buf, const sg_range* data
 
 _SOKOL_PRIVATE void _sg_gl_append_buffer(_sg_buffer_t* buf, const sg_range* data, bool new_frame) {
     SOKOL_ASSERT(buf && data && data->ptr && (data->size > 0));
+    if (buf->gl.mapped) {
+        if (new_frame) {
+            _sg_gl_next_stream_region(buf);
+        }
+        memcpy(buf->gl.mapped + _sg_gl_stream_offset(buf) + buf->cmn.append_pos, data->ptr, data->size);
+        return;
+    }
     if (new_frame) {
         if (++buf->cmn.active_slot >= buf->cmn.num_slots) {
             buf->cmn.active_slot = 0;
@@ -9472,6 +9678,9 @@ _SOKOL_PRIVATE void _sg_gl_append_buffer(_sg_buffer_t* buf, const sg_range* data
     _SG_GL_CHECK_ERROR();
     _sg_gl_cache_store_buffer_binding(gl_tgt);
     _sg_gl_cache_bind_buffer(gl_tgt, gl_buf);
+    if (buf->gl.orphan && new_frame) {
+        glBufferData(gl_tgt, buf->cmn.size, 0, _sg_gl_usage(buf->cmn.usage));
+    }
     glBufferSubData(gl_tgt, buf->cmn.append_pos, (GLsizeiptr)data->size, data->ptr);
     _sg_gl_cache_restore_buffer_binding(gl_tgt);
     _SG_GL_CHECK_ERROR();
@@ -19379,6 +19588,15 @@ SOKOL_API_IMPL sg_gl_buffer_info sg_gl_query_buffer_info(sg_buffer buf_id) {
     return res;
 }
 
+SOKOL_API_IMPL sg_gl_stream_mode sg_gl_query_stream_mode(void) {
+    SOKOL_ASSERT(_sg.valid);
+    #if defined(_SOKOL_ANY_GL)
+        return _sg.gl.stream_mode;
+    #else
+        return _SG_GL_STREAMMODE_DEFAULT;
+    #endif
+}
+
 SOKOL_API_IMPL sg_gl_image_info sg_gl_query_image_info(sg_image img_id) {
     SOKOL_ASSERT(_sg.valid);
     sg_gl_image_info res;
@@ -98,9 +98,10 @@
         Use the following simgui_desc_t members to configure behaviour:
 
             int max_vertices
-                The maximum number of vertices used for UI rendering, default is 65536.
+                The initial number of vertices used for UI rendering, default is 65536.
                 sokol-imgui will use this to compute the size of the vertex-
-                and index-buffers allocated via sokol_gfx.h
+                and index-buffers allocated via sokol_gfx.h, they grow to fit
+                the draw data and shrink back when it no longer needs the space
 
             int image_pool_size
                 Number of simgui_image_t objects which can be alive at the same time.
@@ -202,6 +203,23 @@
         This will first call ImGui::Render(), and then render ImGui's draw list
         through sokol_gfx.h
 
+        Optionally call simgui_prepare_render() before sg_begin_pass(), this
+        uploads the draw data (and grows the vertex- and index-buffers if
+        needed) outside the render pass, simgui_render() then only draws
+
+        To render draw data that isn't ImGui's current one, for instance a
+        copy made by a thread building the next frame while this one is
+        submitted, call instead:
+
+        simgui_prepare_render_draw_data(draw_data)
+        simgui_render_draw_data(draw_data)
+
+        ...where draw_data is an ImDrawData*. The draw lists must stay alive
+        until simgui_render_draw_data() returns, and their _OwnerName (which
+        keys the per-window buffer cache) must be copied along. Viewport
+        size and DPI scale are taken from the draw data, not from ImGuiIO,
+        so the ImGui context may already be building the next frame.
+
     --- if you're using sokol_app.h, from inside the sokol_app.h event callback,
         call:
 
@@ -453,6 +471,8 @@ typedef struct simgui_image_desc_t {
     _SIMGUI_LOGITEM_XMACRO(OK, "Ok") \
     _SIMGUI_LOGITEM_XMACRO(MALLOC_FAILED, "memory allocation failed") \
     _SIMGUI_LOGITEM_XMACRO(IMAGE_POOL_EXHAUSTED, "image pool exhausted") \
+    _SIMGUI_LOGITEM_XMACRO(BUFFER_RESIZED, "vertex- or index-buffer resized to fit the draw data") \
+    _SIMGUI_LOGITEM_XMACRO(BUFFER_CREATION_FAILED, "vertex- or index-buffer creation failed, draw lists are dropped") \
 
 #define _SIMGUI_LOGITEM_XMACRO(item,msg) SIMGUI_LOGITEM_##item,
 typedef enum simgui_log_item_t {
@@ -519,6 +539,26 @@ typedef struct simgui_frame_desc_t {
     float dpi_scale;
 } simgui_frame_desc_t;
 
+/*
+    simgui_stats_t
+
+    Returned by simgui_query_stats(), describes the last simgui_render() call.
+    Draw lists with an owner window keep their own vertex- and index-buffers
+    (up to SIMGUI_MAX_CACHED_DRAW_LISTS) which are only re-uploaded when
+    their content hash changes, the others are copied into the shared
+    stream buffers each frame.
+*/
+typedef struct simgui_stats_t {
+    int draw_lists;             // number of draw lists rendered
+    int cached_draw_lists;      // ...drawn from their own buffers
+    int uploaded_draw_lists;    // ...uploaded this frame, cached or not
+    size_t uploaded_bytes;      // vertex and index bytes uploaded this frame
+    int vertices;               // vertices drawn this frame
+    int peak_vertices;          // most vertices drawn in a frame since simgui_setup()
+    int vertex_capacity;        // current size of the shared stream buffers
+    int index_capacity;
+} simgui_stats_t;
+
 typedef struct simgui_font_tex_desc_t {
     sg_filter min_filter;
     sg_filter mag_filter;
@@ -526,7 +566,11 @@ typedef struct simgui_font_tex_desc_t {
 
 SOKOL_IMGUI_API_DECL void simgui_setup(const simgui_desc_t* desc);
 SOKOL_IMGUI_API_DECL void simgui_new_frame(const simgui_frame_desc_t* desc);
+SOKOL_IMGUI_API_DECL void simgui_prepare_render(void);
 SOKOL_IMGUI_API_DECL void simgui_render(void);
+SOKOL_IMGUI_API_DECL void simgui_prepare_render_draw_data(void* im_draw_data);
+SOKOL_IMGUI_API_DECL void simgui_render_draw_data(void* im_draw_data);
+SOKOL_IMGUI_API_DECL simgui_stats_t simgui_query_stats(void);
 SOKOL_IMGUI_API_DECL simgui_image_t simgui_make_image(const simgui_image_desc_t* desc);
 SOKOL_IMGUI_API_DECL void simgui_destroy_image(simgui_image_t img);
 SOKOL_IMGUI_API_DECL simgui_image_desc_t simgui_query_image_desc(simgui_image_t img);
@@ -581,6 +625,7 @@ inline void simgui_create_fonts_texture(const simgui_font_tex_desc_t& desc) { re
 
 #include <string.h> // memset
 #include <stdlib.h> // malloc/free
+#include <stdio.h>  // snprintf
 
 #if defined(__EMSCRIPTEN__) && !defined(SOKOL_DUMMY_BACKEND)
 #include <emscripten.h>
@@ -621,6 +666,22 @@ inline void simgui_create_fonts_texture(const simgui_font_tex_desc_t& desc) { re
 #define ImDrawCallback_ResetRenderState (ImDrawCallback)(-8)
 #endif
 
+#ifndef SIMGUI_MAX_CACHED_DRAW_LISTS
+#define SIMGUI_MAX_CACHED_DRAW_LISTS (32)
+#endif
+// cached buffers of windows that stopped drawing are released after that many rendered frames
+#ifndef SIMGUI_CACHE_EVICT_FRAMES
+#define SIMGUI_CACHE_EVICT_FRAMES (600)
+#endif
+// how often grown shared buffers are checked against their high-water mark, in rendered frames
+#ifndef SIMGUI_SHRINK_FRAMES
+#define SIMGUI_SHRINK_FRAMES (600)
+#endif
+// override with a faster 64-bit hash, e.g. #define SIMGUI_HASH(ptr,size,seed) XXH3_64bits_withSeed(ptr,size,seed)
+#ifndef SIMGUI_HASH
+#define SIMGUI_HASH(ptr,size,seed) _simgui_hash(ptr,size,seed)
+#endif
+
 typedef struct {
     ImVec2 disp_size;
     uint8_t _pad_8[8];
@@ -659,6 +720,17 @@ typedef struct {
     _simgui_image_t* items;
 } _simgui_image_pool_t;
 
+typedef struct {
+    uint64_t key;           // hash of the owner window's name, 0 for a free slot
+    uint64_t hash;          // content hash of the vertices and indices in vbuf/ibuf
+    uint64_t used_frame;
+    const ImDrawList* list; // the draw list using this slot in used_frame
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    size_t vbuf_size;
+    size_t ibuf_size;
+} _simgui_cached_list_t;
+
 typedef struct {
     uint32_t init_cookie;
     simgui_desc_t desc;
@@ -679,6 +751,14 @@ typedef struct {
     sg_range indices;
     bool is_osx;
     _simgui_image_pool_t image_pool;
+    uint64_t frame_index;
+    _simgui_cached_list_t cached_lists[SIMGUI_MAX_CACHED_DRAW_LISTS];
+    simgui_stats_t stats;
+    bool prepared;          // simgui_prepare_render() uploaded this frame's draw data
+    int cmd_list_count;     // draw lists uploaded, the rest didn't fit
+    size_t shared_vtx_peak; // high-water marks of the shared buffers since the last shrink check
+    size_t shared_idx_peak;
+    int peak_vertices;
 } _simgui_state_t;
 static _simgui_state_t _simgui;
 
@@ -2458,6 +2538,10 @@ SOKOL_API_IMPL void simgui_shutdown(void) {
     sg_destroy_image(_simgui.def_img);
     sg_destroy_buffer(_simgui.ibuf);
     sg_destroy_buffer(_simgui.vbuf);
+    for (int i = 0; i < SIMGUI_MAX_CACHED_DRAW_LISTS; i++) {
+        sg_destroy_buffer(_simgui.cached_lists[i].ibuf);
+        sg_destroy_buffer(_simgui.cached_lists[i].vbuf);
+    }
     sg_pop_debug_group();
     sg_push_debug_group("sokol-imgui");
     _simgui_destroy_all_images();
@@ -2531,6 +2615,9 @@ SOKOL_API_IMPL void simgui_new_frame(const simgui_frame_desc_t* desc) {
     }
     io->DisplaySize.x = ((float)desc->width) / _simgui.cur_dpi_scale;
     io->DisplaySize.y = ((float)desc->height) / _simgui.cur_dpi_scale;
+    // carried into ImDrawData::FramebufferScale, which simgui_render_draw_data() scales by
+    io->DisplayFramebufferScale.x = _simgui.cur_dpi_scale;
+    io->DisplayFramebufferScale.y = _simgui.cur_dpi_scale;
     io->DeltaTime = (float)desc->delta_time;
     #if !defined(SOKOL_IMGUI_NO_SOKOL_APP)
         if (io->WantTextInput && !sapp_keyboard_shown()) {
@@ -2588,38 +2675,232 @@ static ImDrawList* _simgui_imdrawlist_at(ImDrawData* draw_data, int cl_index) {
     #endif
 }
 
-SOKOL_API_IMPL void simgui_render(void) {
-    SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
-    #if defined(__cplusplus)
-        ImGui::Render();
-        ImDrawData* draw_data = ImGui::GetDrawData();
-        ImGuiIO* io = &ImGui::GetIO();
-    #else
-        igRender();
-        ImDrawData* draw_data = igGetDrawData();
-        ImGuiIO* io = igGetIO();
-    #endif
-    if (0 == draw_data) {
-        return;
+// FNV-1a over 8-byte words, used unless SIMGUI_HASH is overridden
+static uint64_t _simgui_hash(const void* ptr, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)ptr;
+    uint64_t h = 0xcbf29ce484222325ull ^ seed;
+    for (; size >= 8; size -= 8, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+    }
+    for (; size > 0; size--, p++) {
+        h = (h ^ *p) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+static sg_buffer _simgui_make_cached_buffer(sg_buffer_type type, size_t size) {
+    sg_buffer_desc desc;
+    _simgui_clear(&desc, sizeof(desc));
+    desc.type = type;
+    desc.usage = SG_USAGE_DYNAMIC;
+    desc.size = size;
+    desc.label = (type == SG_BUFFERTYPE_INDEXBUFFER) ? "sokol-imgui-cached-indices" : "sokol-imgui-cached-vertices";
+    return sg_make_buffer(&desc);
+}
+
+static void _simgui_release_cached_list(_simgui_cached_list_t* cached) {
+    sg_destroy_buffer(cached->vbuf);
+    sg_destroy_buffer(cached->ibuf);
+    _simgui_clear(cached, sizeof(_simgui_cached_list_t));
+}
+
+// find or claim the cache slot of a draw list by its owner window, returns 0 if there's none to spare
+static _simgui_cached_list_t* _simgui_cache_slot(const ImDrawList* cl) {
+    if ((0 == cl->_OwnerName) || (0 == cl->_OwnerName[0])) {
+        return 0;
+    }
+    uint64_t key = SIMGUI_HASH(cl->_OwnerName, strlen(cl->_OwnerName), 0);
+    key = key ? key : 1;
+    _simgui_cached_list_t* free_slot = 0;
+    _simgui_cached_list_t* oldest = 0;
+    for (int i = 0; i < SIMGUI_MAX_CACHED_DRAW_LISTS; i++) {
+        _simgui_cached_list_t* cached = &_simgui.cached_lists[i];
+        if (cached->key == key) {
+            // two lists with the same owner in one frame: the second one goes through the shared buffer
+            return (cached->used_frame == _simgui.frame_index) ? 0 : cached;
+        }
+        if (0 == cached->key) {
+            free_slot = free_slot ? free_slot : cached;
+        } else if ((cached->used_frame < _simgui.frame_index) && (!oldest || (cached->used_frame < oldest->used_frame))) {
+            oldest = cached;
+        }
+    }
+    _simgui_cached_list_t* cached = free_slot ? free_slot : oldest;
+    if (cached) {
+        if (cached == oldest) {
+            _simgui_release_cached_list(cached);
+        }
+        cached->key = key;
+    }
+    return cached;
+}
+
+// uploads the draw list into its own buffers if its content changed, returns false if it couldn't be cached
+static bool _simgui_cache_draw_list(const ImDrawList* cl) {
+    const size_t vtx_size = (size_t)cl->VtxBuffer.Size * sizeof(ImDrawVert);
+    const size_t idx_size = (size_t)cl->IdxBuffer.Size * sizeof(ImDrawIdx);
+    if ((0 == vtx_size) || (0 == idx_size)) {
+        return false;
+    }
+    _simgui_cached_list_t* cached = _simgui_cache_slot(cl);
+    if (0 == cached) {
+        return false;
+    }
+    uint64_t hash = SIMGUI_HASH(cl->VtxBuffer.Data, vtx_size, 0);
+    hash = SIMGUI_HASH(cl->IdxBuffer.Data, idx_size, hash);
+    bool upload = (hash != cached->hash);
+    // grow by half again, shrink once the list needs less than a quarter
+    if ((vtx_size > cached->vbuf_size) || ((vtx_size * 4) < cached->vbuf_size)) {
+        sg_destroy_buffer(cached->vbuf);
+        cached->vbuf_size = vtx_size + vtx_size / 2;
+        cached->vbuf = _simgui_make_cached_buffer(SG_BUFFERTYPE_VERTEXBUFFER, cached->vbuf_size);
+        upload = true;
+    }
+    if ((idx_size > cached->ibuf_size) || ((idx_size * 4) < cached->ibuf_size)) {
+        sg_destroy_buffer(cached->ibuf);
+        cached->ibuf_size = idx_size + idx_size / 2;
+        cached->ibuf = _simgui_make_cached_buffer(SG_BUFFERTYPE_INDEXBUFFER, cached->ibuf_size);
+        upload = true;
+    }
+    if ((sg_query_buffer_state(cached->vbuf) != SG_RESOURCESTATE_VALID) ||
+        (sg_query_buffer_state(cached->ibuf) != SG_RESOURCESTATE_VALID))
+    {
+        _simgui_release_cached_list(cached);
+        return false;
+    }
+    if (upload) {
+        sg_range vtx_data = { cl->VtxBuffer.Data, vtx_size };
+        sg_range idx_data = { cl->IdxBuffer.Data, idx_size };
+        sg_update_buffer(cached->vbuf, &vtx_data);
+        sg_update_buffer(cached->ibuf, &idx_data);
+        cached->hash = hash;
+        _simgui.stats.uploaded_draw_lists++;
+        _simgui.stats.uploaded_bytes += vtx_size + idx_size;
+    }
+    cached->used_frame = _simgui.frame_index;
+    cached->list = cl;
+    _simgui.stats.cached_draw_lists++;
+    return true;
+}
+
+static const _simgui_cached_list_t* _simgui_cached_draw_list(const ImDrawList* cl) {
+    for (int i = 0; i < SIMGUI_MAX_CACHED_DRAW_LISTS; i++) {
+        const _simgui_cached_list_t* cached = &_simgui.cached_lists[i];
+        if ((cached->key != 0) && (cached->used_frame == _simgui.frame_index) && (cached->list == cl)) {
+            return cached;
+        }
+    }
+    return 0;
+}
+
+static void _simgui_evict_cached_lists(void) {
+    for (int i = 0; i < SIMGUI_MAX_CACHED_DRAW_LISTS; i++) {
+        _simgui_cached_list_t* cached = &_simgui.cached_lists[i];
+        if ((cached->key != 0) && ((cached->used_frame + SIMGUI_CACHE_EVICT_FRAMES) < _simgui.frame_index)) {
+            _simgui_release_cached_list(cached);
+        }
+    }
+}
+
+// (re)creates a shared stream buffer and its staging memory with room for num_bytes
+static void _simgui_resize_shared_buffer(sg_buffer_type type, size_t num_bytes) {
+    const bool is_index = (type == SG_BUFFERTYPE_INDEXBUFFER);
+    sg_buffer* buf = is_index ? &_simgui.ibuf : &_simgui.vbuf;
+    sg_range* staging = is_index ? &_simgui.indices : &_simgui.vertices;
+    sg_destroy_buffer(*buf);
+    _simgui_free((void*)staging->ptr);
+    staging->ptr = _simgui_malloc(num_bytes);
+    staging->size = num_bytes;
+    sg_buffer_desc desc;
+    _simgui_clear(&desc, sizeof(desc));
+    desc.type = type;
+    desc.usage = SG_USAGE_STREAM;
+    desc.size = num_bytes;
+    desc.label = is_index ? "sokol-imgui-indices" : "sokol-imgui-vertices";
+    *buf = sg_make_buffer(&desc);
+    if (sg_query_buffer_state(*buf) != SG_RESOURCESTATE_VALID) {
+        // nothing fits anymore, the overflow check in _simgui_upload() drops the shared draw lists
+        _SIMGUI_ERROR(BUFFER_CREATION_FAILED);
+        staging->size = 0;
     }
-    if (draw_data->CmdListsCount == 0) {
+}
+
+// grows a shared buffer geometrically to hold num_bytes, or shrinks it once its high-water mark
+// stayed under a quarter of its size for SIMGUI_SHRINK_FRAMES rendered frames
+static void _simgui_fit_shared_buffer(sg_buffer_type type, size_t num_bytes, size_t elem_size, size_t min_bytes) {
+    const bool is_index = (type == SG_BUFFERTYPE_INDEXBUFFER);
+    const size_t cur_bytes = is_index ? _simgui.indices.size : _simgui.vertices.size;
+    size_t* peak = is_index ? &_simgui.shared_idx_peak : &_simgui.shared_vtx_peak;
+    *peak = (num_bytes > *peak) ? num_bytes : *peak;
+    size_t new_bytes = cur_bytes;
+    if (num_bytes > cur_bytes) {
+        new_bytes = cur_bytes ? cur_bytes : min_bytes;
+        while (new_bytes < num_bytes) {
+            new_bytes *= 2;
+        }
+    } else if ((_simgui.frame_index % SIMGUI_SHRINK_FRAMES) == 0) {
+        if ((cur_bytes > min_bytes) && ((*peak * 4) < cur_bytes)) {
+            new_bytes = min_bytes;
+            while (new_bytes < (*peak * 2)) {
+                new_bytes *= 2;
+            }
+        }
+        *peak = num_bytes;
+    }
+    if (new_bytes != cur_bytes) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "%s buffer %s from %d to %d %s (%d needed)",
+            is_index ? "index" : "vertex", (new_bytes > cur_bytes) ? "grown" : "shrunk",
+            (int)(cur_bytes / elem_size), (int)(new_bytes / elem_size),
+            is_index ? "indices" : "vertices", (int)(num_bytes / elem_size));
+        _SIMGUI_LOGMSG(BUFFER_RESIZED, msg);
+        _simgui_resize_shared_buffer(type, new_bytes);
+    }
+}
+
+/* updates the cached draw lists' buffers, and copies the other draw lists
+   into the shared stream buffers (grown to fit first), so that they can be
+   updated with a single sg_update_buffer() call each (sg_append_buffer()
+   has performance problems on some GL platforms), also keep track of
+   valid number of command lists in case the buffers couldn't grow
+*/
+static void _simgui_upload(ImDrawData* draw_data) {
+    _simgui.cmd_list_count = 0;
+    if ((0 == draw_data) || (0 == draw_data->CmdListsCount)) {
         return;
     }
-    /* copy vertices and indices into an intermediate buffer so that
-       they can be updated with a single sg_update_buffer() call each
-       (sg_append_buffer() has performance problems on some GL platforms),
-       also keep track of valid number of command lists in case of a
-       buffer overflow
-    */
+    _simgui.frame_index++;
+    _simgui_clear(&_simgui.stats, sizeof(_simgui.stats));
+    sg_push_debug_group("sokol-imgui");
+    _simgui_evict_cached_lists();
+
+    size_t shared_vtx_size = 0;
+    size_t shared_idx_size = 0;
+    for (int cl_index = 0; cl_index < draw_data->CmdListsCount; cl_index++) {
+        ImDrawList* cl = _simgui_imdrawlist_at(draw_data, cl_index);
+        if (!_simgui_cache_draw_list(cl)) {
+            shared_vtx_size += (size_t)cl->VtxBuffer.Size * sizeof(ImDrawVert);
+            shared_idx_size += (size_t)cl->IdxBuffer.Size * sizeof(ImDrawIdx);
+        }
+    }
+    const size_t min_vtx_bytes = (size_t)_simgui.desc.max_vertices * sizeof(ImDrawVert);
+    _simgui_fit_shared_buffer(SG_BUFFERTYPE_VERTEXBUFFER, shared_vtx_size, sizeof(ImDrawVert), min_vtx_bytes);
+    _simgui_fit_shared_buffer(SG_BUFFERTYPE_INDEXBUFFER, shared_idx_size, sizeof(ImDrawIdx), min_vtx_bytes / sizeof(ImDrawVert) * 3 * sizeof(ImDrawIdx));
+
     size_t all_vtx_size = 0;
     size_t all_idx_size = 0;
     int cmd_list_count = 0;
     for (int cl_index = 0; cl_index < draw_data->CmdListsCount; cl_index++, cmd_list_count++) {
         ImDrawList* cl = _simgui_imdrawlist_at(draw_data, cl_index);
+        if (_simgui_cached_draw_list(cl)) {
+            continue;
+        }
         const size_t vtx_size = (size_t)cl->VtxBuffer.Size * sizeof(ImDrawVert);
         const size_t idx_size = (size_t)cl->IdxBuffer.Size * sizeof(ImDrawIdx);
 
-        // check for buffer overflow
+        // check for buffer overflow, only if the buffers failed to grow
         if (((all_vtx_size + vtx_size) > _simgui.vertices.size) ||
             ((all_idx_size + idx_size) > _simgui.indices.size))
         {
@@ -2639,13 +2920,13 @@ SOKOL_API_IMPL void simgui_render(void) {
         }
         all_vtx_size += vtx_size;
         all_idx_size += idx_size;
+        if ((vtx_size + idx_size) > 0) {
+            _simgui.stats.uploaded_draw_lists++;
+        }
     }
-    if (0 == cmd_list_count) {
-        return;
-    }
+    _simgui.cmd_list_count = cmd_list_count;
 
     // update the sokol-gfx vertex- and index-buffer
-    sg_push_debug_group("sokol-imgui");
     if (all_vtx_size > 0) {
         sg_range vtx_data = _simgui.vertices;
         vtx_data.size = all_vtx_size;
@@ -2656,19 +2937,82 @@ SOKOL_API_IMPL void simgui_render(void) {
         idx_data.size = all_idx_size;
         sg_update_buffer(_simgui.ibuf, &idx_data);
     }
+    sg_pop_debug_group();
+
+    if (draw_data->TotalVtxCount > _simgui.peak_vertices) {
+        _simgui.peak_vertices = draw_data->TotalVtxCount;
+    }
+    _simgui.stats.draw_lists = cmd_list_count;
+    _simgui.stats.uploaded_bytes += all_vtx_size + all_idx_size;
+    _simgui.stats.vertices = draw_data->TotalVtxCount;
+    _simgui.stats.peak_vertices = _simgui.peak_vertices;
+    _simgui.stats.vertex_capacity = (int)(_simgui.vertices.size / sizeof(ImDrawVert));
+    _simgui.stats.index_capacity = (int)(_simgui.indices.size / sizeof(ImDrawIdx));
+}
+
+SOKOL_API_IMPL void simgui_prepare_render(void) {
+    SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
+    #if defined(__cplusplus)
+        ImGui::Render();
+        ImDrawData* draw_data = ImGui::GetDrawData();
+    #else
+        igRender();
+        ImDrawData* draw_data = igGetDrawData();
+    #endif
+    _simgui_upload(draw_data);
+    _simgui.prepared = true;
+}
+
+SOKOL_API_IMPL void simgui_prepare_render_draw_data(void* im_draw_data) {
+    SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
+    SOKOL_ASSERT(im_draw_data);
+    _simgui_upload((ImDrawData*)im_draw_data);
+    _simgui.prepared = true;
+}
+
+SOKOL_API_IMPL void simgui_render(void) {
+    SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
+    #if defined(__cplusplus)
+        ImGui::Render();
+        ImDrawData* draw_data = ImGui::GetDrawData();
+    #else
+        igRender();
+        ImDrawData* draw_data = igGetDrawData();
+    #endif
+    simgui_render_draw_data(draw_data);
+}
+
+SOKOL_API_IMPL void simgui_render_draw_data(void* im_draw_data) {
+    SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
+    SOKOL_ASSERT(im_draw_data);
+    ImDrawData* draw_data = (ImDrawData*)im_draw_data;
+    #if defined(__cplusplus)
+        ImGuiIO* io = &ImGui::GetIO();
+    #else
+        ImGuiIO* io = igGetIO();
+    #endif
+    if (!_simgui.prepared) {
+        _simgui_upload(draw_data);
+    }
+    _simgui.prepared = false;
+    const int cmd_list_count = _simgui.cmd_list_count;
+    if (0 == cmd_list_count) {
+        return;
+    }
+    sg_push_debug_group("sokol-imgui");
 
     // render the ImGui command list
-    const float dpi_scale = _simgui.cur_dpi_scale;
-    const int fb_width = (int) (io->DisplaySize.x * dpi_scale);
-    const int fb_height = (int) (io->DisplaySize.y * dpi_scale);
+    const float dpi_scale = draw_data->FramebufferScale.x;
+    const int fb_width = (int) (draw_data->DisplaySize.x * dpi_scale);
+    const int fb_height = (int) (draw_data->DisplaySize.y * dpi_scale);
     sg_apply_viewport(0, 0, fb_width, fb_height, true);
     sg_apply_scissor_rect(0, 0, fb_width, fb_height, true);
 
     sg_apply_pipeline(_simgui.def_pip);
     _simgui_vs_params_t vs_params;
     _simgui_clear((void*)&vs_params, sizeof(vs_params));
-    vs_params.disp_size.x = io->DisplaySize.x;
-    vs_params.disp_size.y = io->DisplaySize.y;
+    vs_params.disp_size.x = draw_data->DisplaySize.x;
+    vs_params.disp_size.y = draw_data->DisplaySize.y;
     sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, SG_RANGE_REF(vs_params));
     sg_bindings bind;
     _simgui_clear((void*)&bind, sizeof(bind));
@@ -2680,9 +3024,15 @@ SOKOL_API_IMPL void simgui_render(void) {
     int ib_offset = 0;
     for (int cl_index = 0; cl_index < cmd_list_count; cl_index++) {
         ImDrawList* cl = _simgui_imdrawlist_at(draw_data, cl_index);
-
-        bind.vertex_buffer_offsets[0] = vb_offset;
-        bind.index_buffer_offset = ib_offset;
+        const _simgui_cached_list_t* cached = _simgui_cached_draw_list(cl);
+        // offsets into the buffers bound for this list
+        const int list_vb_offset = cached ? 0 : vb_offset;
+        const int list_ib_offset = cached ? 0 : ib_offset;
+
+        bind.vertex_buffers[0] = cached ? cached->vbuf : _simgui.vbuf;
+        bind.index_buffer = cached ? cached->ibuf : _simgui.ibuf;
+        bind.vertex_buffer_offsets[0] = list_vb_offset;
+        bind.index_buffer_offset = list_ib_offset;
         sg_apply_bindings(&bind);
 
         #if defined(__cplusplus)
@@ -2716,7 +3066,7 @@ SOKOL_API_IMPL void simgui_render(void) {
                         sg_apply_pipeline(_simgui.def_pip);
                     }
                     sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, SG_RANGE_REF(vs_params));
-                    bind.vertex_buffer_offsets[0] = vb_offset + (int)(pcmd->VtxOffset * sizeof(ImDrawVert));
+                    bind.vertex_buffer_offsets[0] = list_vb_offset + (int)(pcmd->VtxOffset * sizeof(ImDrawVert));
                     sg_apply_bindings(&bind);
                 }
                 const int scissor_x = (int) (pcmd->ClipRect.x * dpi_scale);
@@ -2727,6 +3077,9 @@ SOKOL_API_IMPL void simgui_render(void) {
                 sg_draw((int)pcmd->IdxOffset, (int)pcmd->ElemCount, 1);
             }
         }
+        if (cached) {
+            continue;
+        }
         #if defined(__cplusplus)
             const size_t vtx_size = (size_t)cl->VtxBuffer.size() * sizeof(ImDrawVert);
             const size_t idx_size = (size_t)cl->IdxBuffer.size() * sizeof(ImDrawIdx);
@@ -2742,6 +3095,11 @@ SOKOL_API_IMPL void simgui_render(void) {
     sg_pop_debug_group();
 }
 
+SOKOL_API_IMPL simgui_stats_t simgui_query_stats(void) {
+    SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
+    return _simgui.stats;
+}
+
 SOKOL_API_IMPL void simgui_add_focus_event(bool focus) {
     SOKOL_ASSERT(_SIMGUI_INIT_COOKIE == _simgui.init_cookie);
     #if defined(__cplusplus)
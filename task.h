@@ -0,0 +1,47 @@
+#ifndef AFAIRE_TASK_H
+#define AFAIRE_TASK_H
+
+#include <string.h>
+
+#include "base.h"
+
+// Offset of the mark inside a task's checkbox ("- [ ] ", "* [x] ", "+ [X] ", indented or not), the syntax the
+// highlighter colors; -1 when the line isn't a task.
+static inline i32 task_mark(const char *line, i32 len) {
+    i32 i = 0;
+    while (i < len && (line[i] == ' ' || line[i] == '\t')) {
+        i++;
+    }
+    if (len - i >= 5 && (line[i] == '-' || line[i] == '*' || line[i] == '+') && line[i + 1] == ' ' &&
+        line[i + 2] == '[' && line[i + 4] == ']' && (line[i + 3] == ' ' || line[i + 3] == 'x' || line[i + 3] == 'X')) {
+        return i + 3;
+    }
+    return -1;
+}
+
+static inline bool task_is_tag_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+           c == '/' || (u8)c >= 0x80;
+}
+
+// A line opening or closing a fenced code block, whose lines are never tasks.
+static inline bool task_is_fence(const char *p, const char *end) {
+    for (i32 i = 0; i < 3 && p < end && *p == ' '; i++) {
+        p++;
+    }
+    return end - p >= 3 && p[0] == '`' && p[1] == '`' && p[2] == '`';
+}
+
+// Whether `text` holds the tag `tag` ("#ops"), as a whole token the way the highlighter colors tags.
+static inline bool task_has_tag(const char *text, i32 len, const char *tag, i32 tag_len) {
+    for (i32 i = 0; i + tag_len <= len; i++) {
+        bool boundary = i == 0 || text[i - 1] == ' ' || text[i - 1] == '\t' || text[i - 1] == '(';
+        if (boundary && memcmp(text + i, tag, (usize)tag_len) == 0 &&
+            (i + tag_len == len || !task_is_tag_char(text[i + tag_len]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
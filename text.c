@@ -0,0 +1,238 @@
+#include "text.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+static bool lines_reserve(line_index_t *li, i32 cap) {
+    if (cap <= li->cap) {
+        return true;
+    }
+    i32 new_cap = max(cap, li->cap * 2);
+    i32 *starts = mem_realloc(li->starts, (usize)new_cap * sizeof(*starts));
+    if (!starts) {
+        return false;
+    }
+    li->starts = starts;
+    f32 *widths = mem_realloc(li->widths, (usize)new_cap * sizeof(*widths));
+    if (!widths) {
+        return false;
+    }
+    li->widths = widths;
+    li->cap = new_cap;
+    return true;
+}
+
+static inline i32 lines_start(const line_index_t *li, i32 line) {
+    return li->starts[line] + (line > li->step_line ? li->step_len : 0);
+}
+
+// Moves the step so that every line up to `to` holds its real start.
+static void lines_apply_step(line_index_t *li, i32 to) {
+    if (li->step_len != 0) {
+        if (to > li->step_line) {
+            for (i32 i = li->step_line + 1; i <= to; i++) {
+                li->starts[i] += li->step_len;
+            }
+        } else {
+            for (i32 i = to + 1; i <= li->step_line; i++) {
+                li->starts[i] -= li->step_len;
+            }
+        }
+    }
+    li->step_line = to;
+}
+
+static bool lines_rebuild(text_t *t) {
+    line_index_t *li = &t->lines;
+    i32 count = 1;
+    for (const char *p = t->data; (p = memchr(p, '\n', (usize)(t->data + t->len - p))) != NULL; p++) {
+        count++;
+    }
+    if (!lines_reserve(li, count)) {
+        return false;
+    }
+    li->starts[0] = 0;
+    i32 line = 1;
+    for (const char *p = t->data; (p = memchr(p, '\n', (usize)(t->data + t->len - p))) != NULL; p++) {
+        li->starts[line++] = (i32)(p - t->data) + 1;
+    }
+    for (i32 i = 0; i < count; i++) {
+        li->widths[i] = -1.0f;
+    }
+    li->count = count;
+    li->step_line = 0;
+    li->step_len = 0;
+    li->max_width = 0.0f;
+    return true;
+}
+
+void text_init(text_t *t) {
+    memset(t, 0, sizeof(*t));
+    text_set(t, "", 0);
+}
+
+void text_free(text_t *t) {
+    mem_free(t->data);
+    mem_free(t->lines.starts);
+    mem_free(t->lines.widths);
+    memset(t, 0, sizeof(*t));
+}
+
+bool text_reserve(text_t *t, i32 cap) {
+    if (cap <= t->cap) {
+        return true;
+    }
+    i32 new_cap = max(cap, t->cap + t->cap / 2);
+    char *data = mem_realloc(t->data, (usize)new_cap);
+    if (!data) {
+        return false;
+    }
+    t->data = data;
+    t->cap = new_cap;
+    return true;
+}
+
+bool text_set(text_t *t, const char *src, i32 len) {
+    if (!text_reserve(t, len + 1)) {
+        return false;
+    }
+    memmove(t->data, src, (usize)len);
+    t->data[len] = '\0';
+    t->len = len;
+    return lines_rebuild(t);
+}
+
+bool text_replace(text_t *t, i32 pos, i32 remove_len, const char *ins, i32 ins_len) {
+    pos = max(0, min(pos, t->len));
+    remove_len = max(0, min(remove_len, t->len - pos));
+    i32 new_len = t->len - remove_len + ins_len;
+    if (!text_reserve(t, new_len + 1)) {
+        return false;
+    }
+    i32 inserted_lines = 0;
+    for (i32 i = 0; i < ins_len; i++) {
+        inserted_lines += ins[i] == '\n';
+    }
+    line_index_t *li = &t->lines;
+    if (!lines_reserve(li, li->count + inserted_lines)) {
+        return false;
+    }
+
+    i32 line = text_line_of(t, pos);
+    i32 last = text_line_of(t, pos + remove_len);
+    lines_apply_step(li, line);
+    li->widths[line] = -1.0f;
+
+    // drop the lines whose start fell inside the removed range
+    if (last > line) {
+        memmove(&li->starts[line + 1], &li->starts[last + 1], (usize)(li->count - last - 1) * sizeof(i32));
+        memmove(&li->widths[line + 1], &li->widths[last + 1], (usize)(li->count - last - 1) * sizeof(f32));
+        li->count -= last - line;
+    }
+    li->step_len -= remove_len;
+
+    // new starts go right after `line` and are stored as real values by moving the step past them
+    if (inserted_lines > 0) {
+        memmove(&li->starts[line + 1 + inserted_lines], &li->starts[line + 1],
+                (usize)(li->count - line - 1) * sizeof(i32));
+        memmove(&li->widths[line + 1 + inserted_lines], &li->widths[line + 1],
+                (usize)(li->count - line - 1) * sizeof(f32));
+        i32 j = line + 1;
+        for (i32 i = 0; i < ins_len; i++) {
+            if (ins[i] == '\n') {
+                li->starts[j] = pos + i + 1;
+                li->widths[j] = -1.0f;
+                j++;
+            }
+        }
+        li->count += inserted_lines;
+        li->step_line = line + inserted_lines;
+    }
+    li->step_len += ins_len;
+    if (li->step_line >= li->count - 1) {
+        li->step_line = li->count - 1;
+        li->step_len = 0;
+    }
+
+    memmove(t->data + pos + ins_len, t->data + pos + remove_len, (usize)(t->len - pos - remove_len));
+    memcpy(t->data + pos, ins, (usize)ins_len);
+    t->len = new_len;
+    t->data[new_len] = '\0';
+    return true;
+}
+
+bool text_sync(text_t *t, const char *next, i32 next_len) {
+    i32 n = min(t->len, next_len);
+    i32 prefix = 0;
+    while (prefix + 8 <= n) {
+        u64 a, b;
+        memcpy(&a, t->data + prefix, 8);
+        memcpy(&b, next + prefix, 8);
+        if (a != b) {
+            break;
+        }
+        prefix += 8;
+    }
+    while (prefix < n && t->data[prefix] == next[prefix]) {
+        prefix++;
+    }
+    if (prefix == t->len && prefix == next_len) {
+        return true;
+    }
+    i32 suffix = 0;
+    while (suffix < n - prefix && t->data[t->len - 1 - suffix] == next[next_len - 1 - suffix]) {
+        suffix++;
+    }
+    return text_replace(t, prefix, t->len - prefix - suffix, next + prefix, next_len - prefix - suffix);
+}
+
+i32 text_line_count(const text_t *t) {
+    return t->lines.count;
+}
+
+i32 text_line_start(const text_t *t, i32 line) {
+    return lines_start(&t->lines, max(0, min(line, t->lines.count - 1)));
+}
+
+i32 text_line_end(const text_t *t, i32 line) {
+    if (line + 1 >= t->lines.count) {
+        return t->len;
+    }
+    return lines_start(&t->lines, line + 1) - 1;
+}
+
+i32 text_line_of(const text_t *t, i32 pos) {
+    const line_index_t *li = &t->lines;
+    i32 lo = 0, hi = li->count - 1;
+    while (lo < hi) {
+        i32 mid = lo + (hi - lo + 1) / 2;
+        if (lines_start(li, mid) <= pos) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+f32 text_line_width(text_t *t, i32 line, f32 font_size, text_measure_fn measure, void *user) {
+    line_index_t *li = &t->lines;
+    if (li->width_key != font_size) {
+        text_invalidate_widths(t);
+        li->width_key = font_size;
+    }
+    if (li->widths[line] < 0.0f) {
+        li->widths[line] = measure(t->data + text_line_start(t, line), t->data + text_line_end(t, line), user);
+        li->max_width = max(li->max_width, li->widths[line]);
+    }
+    return li->widths[line];
+}
+
+void text_invalidate_widths(text_t *t) {
+    for (i32 i = 0; i < t->lines.count; i++) {
+        t->lines.widths[i] = -1.0f;
+    }
+    t->lines.max_width = 0.0f;
+}
@@ -0,0 +1,46 @@
+#ifndef AFAIRE_TEXT_H
+#define AFAIRE_TEXT_H
+
+#include "base.h"
+
+// Measures the rendered width of [begin, end), used to fill the line width cache.
+typedef f32 (*text_measure_fn)(const char *begin, const char *end, void *user);
+
+// Line-start table kept in sync with the buffer from edit deltas.
+// Starts after `step_line` are stored without the pending `step_len` offset, so consecutive
+// edits on the same line never touch the rest of the table (same trick as Scintilla's partitioning).
+typedef struct {
+    i32 *starts;
+    f32 *widths;  // cached pixel width per line, < 0 when unknown
+    i32 count;
+    i32 cap;
+    i32 step_line;
+    i32 step_len;
+    f32 max_width;  // upper bound over known widths, only reset on full invalidation
+    f32 width_key;  // font size the widths were measured with
+} line_index_t;
+
+// Growable, always NUL-terminated UTF-8 buffer.
+typedef struct {
+    char *data;
+    i32 len;
+    i32 cap;
+    line_index_t lines;
+} text_t;
+
+void text_init(text_t *t);
+void text_free(text_t *t);
+bool text_reserve(text_t *t, i32 cap);
+bool text_set(text_t *t, const char *src, i32 len);
+bool text_replace(text_t *t, i32 pos, i32 remove_len, const char *ins, i32 ins_len);
+// Applies the edit that turns the current contents into `next`, found by trimming the common prefix/suffix.
+bool text_sync(text_t *t, const char *next, i32 next_len);
+
+i32 text_line_count(const text_t *t);
+i32 text_line_start(const text_t *t, i32 line);
+i32 text_line_end(const text_t *t, i32 line);  // excludes the '\n'
+i32 text_line_of(const text_t *t, i32 pos);
+f32 text_line_width(text_t *t, i32 line, f32 font_size, text_measure_fn measure, void *user);
+void text_invalidate_widths(text_t *t);
+
+#endif
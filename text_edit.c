@@ -0,0 +1,656 @@
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include "text_edit.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "cimgui.h"
+
+#define MAX_UNDO 512
+#define MAX_LINE_SPANS 64
+#define MAX_RUNS 2048
+
+typedef struct {
+    ImVec2 pos;
+    i32 start;
+    i32 end;
+    hl_kind_t kind;
+} glyph_run_t;
+
+typedef struct {
+    text_t *text;
+    edit_state_t *st;
+    highlight_t *hl;
+    text_edit_fn on_edit;
+    void *user;
+    bool changed;
+} edit_ctx_t;
+
+static ImFont *font;
+static f32 font_size;
+
+static bool is_word_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || (u8)c >= 0x80;
+}
+
+static i32 next_char(const text_t *text, i32 pos) {
+    if (pos >= text->len) {
+        return text->len;
+    }
+    pos++;
+    while (pos < text->len && ((u8)text->data[pos] & 0xC0) == 0x80) {
+        pos++;
+    }
+    return pos;
+}
+
+static i32 prev_char(const text_t *text, i32 pos) {
+    if (pos <= 0) {
+        return 0;
+    }
+    pos--;
+    while (pos > 0 && ((u8)text->data[pos] & 0xC0) == 0x80) {
+        pos--;
+    }
+    return pos;
+}
+
+static i32 word_left(const text_t *text, i32 pos) {
+    while (pos > 0 && !is_word_char(text->data[pos - 1])) {
+        pos--;
+    }
+    while (pos > 0 && is_word_char(text->data[pos - 1])) {
+        pos--;
+    }
+    return pos;
+}
+
+static i32 word_right(const text_t *text, i32 pos) {
+    while (pos < text->len && is_word_char(text->data[pos])) {
+        pos++;
+    }
+    while (pos < text->len && !is_word_char(text->data[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+static f32 measure(const char *begin, const char *end, void *user) {
+    (void)user;
+    ImVec2 size;
+    ImFont_CalcTextSizeA(&size, font, font_size, FLT_MAX, -1.0f, begin, end, NULL);
+    return size.x;
+}
+
+static f32 x_of(text_t *text, i32 pos) {
+    i32 line = text_line_of(text, pos);
+    if (pos == text_line_end(text, line)) {
+        return text_line_width(text, line, font_size, measure, NULL);
+    }
+    return measure(text->data + text_line_start(text, line), text->data + pos, NULL);
+}
+
+static i32 pos_at_x(const text_t *text, i32 line, f32 x) {
+    f32 scale = font_size / font->FontSize;
+    const char *p = text->data + text_line_start(text, line);
+    const char *end = text->data + text_line_end(text, line);
+    f32 acc = 0.0f;
+    while (p < end) {
+        unsigned int c;
+        i32 n = igImTextCharFromUtf8(&c, p, end);
+        f32 advance = ImFont_GetCharAdvance(font, (ImWchar)c) * scale;
+        if (acc + advance * 0.5f > x) {
+            break;
+        }
+        acc += advance;
+        p += n;
+    }
+    return (i32)(p - text->data);
+}
+
+static void free_record(edit_record_t *r) {
+    mem_free(r->removed);
+    mem_free(r->inserted);
+}
+
+void edit_state_reset(edit_state_t *st) {
+    edit_state_free(st);
+    st->want_x = -1.0f;
+    st->scroll_to_cursor = true;
+}
+
+void edit_state_free(edit_state_t *st) {
+    for (i32 i = 0; i < st->undo_count; i++) {
+        free_record(&st->undo[i]);
+    }
+    mem_free(st->undo);
+    memset(st, 0, sizeof(*st));
+}
+
+static i32 shift_offset(i32 at, i32 pos, i32 removed, i32 inserted) {
+    if (at >= pos + removed) {
+        return at - removed + inserted;
+    }
+    return min(at, pos);
+}
+
+static void forget_history(edit_state_t *st) {
+    for (i32 i = 0; i < st->undo_count; i++) {
+        free_record(&st->undo[i]);
+    }
+    st->undo_count = 0;
+    st->undo_pos = 0;
+    st->undo_base = 0;
+}
+
+void edit_state_external(edit_state_t *st, i32 pos, i32 removed, i32 inserted) {
+    st->cursor = shift_offset(st->cursor, pos, removed, inserted);
+    st->anchor = shift_offset(st->anchor, pos, removed, inserted);
+    // the records' offsets were taken before the change
+    forget_history(st);
+}
+
+static char *copy_range(const char *src, i32 len) {
+    char *dst = mem_alloc((usize)len + 1);
+    if (dst) {
+        memcpy(dst, src, (usize)len);
+        dst[len] = '\0';
+    }
+    return dst;
+}
+
+// Takes `removed`, the text the edit replaced, copied before it was made.
+static void push_record(edit_state_t *st, i32 pos, char *removed, i32 remove_len, const char *ins, i32 ins_len) {
+    for (i32 i = st->undo_pos; i < st->undo_count; i++) {
+        free_record(&st->undo[i]);
+    }
+    st->undo_count = st->undo_pos;
+
+    // consecutive typing on one line collapses into a single record
+    if (st->undo_pos > 0 && st->undo_pos > st->undo_base && remove_len == 0 && !memchr(ins, '\n', (usize)ins_len)) {
+        edit_record_t *last = &st->undo[st->undo_pos - 1];
+        if (last->removed_len == 0 && last->pos + last->inserted_len == pos && ins_len < 8 &&
+            !memchr(last->inserted, '\n', (usize)last->inserted_len)) {
+            i32 need = last->inserted_len + ins_len + 1;
+            i32 cap = need > last->inserted_cap ? max(32, need * 2) : last->inserted_cap;
+            char *inserted = cap != last->inserted_cap ? mem_realloc(last->inserted, (usize)cap) : last->inserted;
+            if (inserted) {
+                memcpy(inserted + last->inserted_len, ins, (usize)ins_len);
+                last->inserted = inserted;
+                last->inserted_cap = cap;
+                last->inserted_len += ins_len;
+                last->inserted[last->inserted_len] = '\0';
+                mem_free(removed);
+                return;
+            }
+        }
+    }
+
+    if (st->undo_count == MAX_UNDO) {
+        free_record(&st->undo[0]);
+        memmove(&st->undo[0], &st->undo[1], (MAX_UNDO - 1) * sizeof(edit_record_t));
+        st->undo_count--;
+        st->undo_pos--;
+        st->undo_base = max(0, st->undo_base - 1);
+    }
+    if (st->undo_count == st->undo_cap) {
+        i32 cap = max(16, st->undo_cap * 2);
+        edit_record_t *undo = mem_realloc(st->undo, (usize)cap * sizeof(*undo));
+        if (!undo) {
+            // the older records' offsets don't hold without this one
+            mem_free(removed);
+            forget_history(st);
+            return;
+        }
+        st->undo = undo;
+        st->undo_cap = cap;
+    }
+    edit_record_t r = {
+        .pos = pos,
+        .removed = removed,
+        .removed_len = remove_len,
+        .inserted = copy_range(ins, ins_len),
+        .inserted_len = ins_len,
+        .inserted_cap = ins_len + 1,
+        .cursor_before = st->cursor,
+        .anchor_before = st->anchor,
+    };
+    if (!r.inserted) {
+        free_record(&r);
+        forget_history(st);
+        return;
+    }
+    st->undo[st->undo_count++] = r;
+    st->undo_pos = st->undo_count;
+}
+
+static void replace(edit_ctx_t *ctx, i32 pos, i32 remove_len, const char *ins, i32 ins_len, bool record) {
+    if (remove_len == 0 && ins_len == 0) {
+        return;
+    }
+    // the removed text is copied before the edit, and recorded only once the edit went through
+    char *removed = record ? copy_range(ctx->text->data + pos, remove_len) : NULL;
+    if (record && !removed) {
+        forget_history(ctx->st);
+        record = false;
+    }
+    if (!text_replace(ctx->text, pos, remove_len, ins, ins_len)) {
+        mem_free(removed);
+        return;
+    }
+    if (record) {
+        push_record(ctx->st, pos, removed, remove_len, ins, ins_len);
+    }
+    if (ctx->hl) {
+        highlight_edit(ctx->hl, ctx->text, pos, remove_len, ins_len);
+    }
+    ctx->changed = true;
+    ctx->st->blink = 0.0f;
+    ctx->st->scroll_to_cursor = true;
+    if (ctx->on_edit) {
+        ctx->on_edit(ctx->user, pos, remove_len, ins_len);
+    }
+}
+
+void text_edit_replace(text_t *text,
+                       edit_state_t *st,
+                       highlight_t *hl,
+                       i32 pos,
+                       i32 removed,
+                       const char *ins,
+                       i32 ins_len,
+                       text_edit_fn on_edit,
+                       void *user) {
+    edit_ctx_t ctx = {.text = text, .st = st, .hl = hl, .on_edit = on_edit, .user = user};
+    replace(&ctx, pos, removed, ins, ins_len, true);
+    st->cursor = st->anchor = pos + ins_len;
+    st->want_x = -1.0f;
+}
+
+static void insert(edit_ctx_t *ctx, const char *s, i32 n) {
+    edit_state_t *st = ctx->st;
+    i32 a = min(st->cursor, st->anchor);
+    i32 b = max(st->cursor, st->anchor);
+    replace(ctx, a, b - a, s, n, true);
+    st->cursor = st->anchor = a + n;
+    st->want_x = -1.0f;
+}
+
+static void undo(edit_ctx_t *ctx) {
+    edit_state_t *st = ctx->st;
+    if (st->undo_pos == 0) {
+        return;
+    }
+    edit_record_t *r = &st->undo[--st->undo_pos];
+    replace(ctx, r->pos, r->inserted_len, r->removed, r->removed_len, false);
+    st->cursor = r->cursor_before;
+    st->anchor = r->anchor_before;
+}
+
+static void redo(edit_ctx_t *ctx) {
+    edit_state_t *st = ctx->st;
+    if (st->undo_pos == st->undo_count) {
+        return;
+    }
+    edit_record_t *r = &st->undo[st->undo_pos++];
+    replace(ctx, r->pos, r->removed_len, r->inserted, r->inserted_len, false);
+    st->cursor = st->anchor = r->pos + r->inserted_len;
+}
+
+static void copy_selection(const text_t *text, const edit_state_t *st) {
+    i32 a = min(st->cursor, st->anchor);
+    i32 b = max(st->cursor, st->anchor);
+    char *s = frame_alloc((usize)(b - a) + 1);
+    if (s) {
+        memcpy(s, text->data + a, (usize)(b - a));
+        s[b - a] = '\0';
+        igSetClipboardText(s);
+    }
+}
+
+static void paste(edit_ctx_t *ctx) {
+    const char *clip = igGetClipboardText();
+    if (!clip) {
+        return;
+    }
+    i32 n = (i32)strlen(clip);
+    char *s = frame_alloc((usize)n + 1);
+    if (!s) {
+        return;
+    }
+    i32 j = 0;
+    for (i32 i = 0; i < n; i++) {
+        if (clip[i] != '\r') {
+            s[j++] = clip[i];
+        }
+    }
+    insert(ctx, s, j);
+}
+
+static void move_to(edit_state_t *st, i32 pos, bool shift) {
+    st->cursor = pos;
+    if (!shift) {
+        st->anchor = pos;
+    }
+    st->blink = 0.0f;
+    st->scroll_to_cursor = true;
+}
+
+static void move_lines(text_t *text, edit_state_t *st, i32 delta, bool shift) {
+    if (st->want_x < 0.0f) {
+        st->want_x = x_of(text, st->cursor);
+    }
+    i32 line = text_line_of(text, st->cursor) + delta;
+    if (line < 0) {
+        move_to(st, 0, shift);
+    } else if (line >= text_line_count(text)) {
+        move_to(st, text->len, shift);
+    } else {
+        move_to(st, pos_at_x(text, line, st->want_x), shift);
+    }
+}
+
+static void handle_keys(edit_ctx_t *ctx, ImGuiID id, i32 page_lines, f32 *scroll_y) {
+    ImGuiIO *io = igGetIO();
+    text_t *text = ctx->text;
+    edit_state_t *st = ctx->st;
+    const bool is_osx = io->ConfigMacOSXBehaviors;
+    const bool wordmove = is_osx ? io->KeyAlt : io->KeyCtrl;
+    const bool shift = io->KeyShift;
+    const bool has_selection = st->cursor != st->anchor;
+    const i32 sel_start = min(st->cursor, st->anchor);
+    const i32 sel_end = max(st->cursor, st->anchor);
+    const f32 line_height = igGetTextLineHeight();
+
+    if (igIsKeyPressed_Bool(ImGuiKey_LeftArrow, true)) {
+        st->want_x = -1.0f;
+        if (has_selection && !shift) {
+            move_to(st, sel_start, false);
+        } else {
+            move_to(st, wordmove ? word_left(text, st->cursor) : prev_char(text, st->cursor), shift);
+        }
+    } else if (igIsKeyPressed_Bool(ImGuiKey_RightArrow, true)) {
+        st->want_x = -1.0f;
+        if (has_selection && !shift) {
+            move_to(st, sel_end, false);
+        } else {
+            move_to(st, wordmove ? word_right(text, st->cursor) : next_char(text, st->cursor), shift);
+        }
+    } else if (igIsKeyPressed_Bool(ImGuiKey_UpArrow, true)) {
+        if (io->KeyCtrl) {
+            *scroll_y = max(*scroll_y - igGetFontSize(), 0.0f);
+        } else {
+            move_lines(text, st, -1, shift);
+        }
+    } else if (igIsKeyPressed_Bool(ImGuiKey_DownArrow, true)) {
+        if (io->KeyCtrl) {
+            *scroll_y += igGetFontSize();
+        } else {
+            move_lines(text, st, 1, shift);
+        }
+    } else if (igIsKeyPressed_Bool(ImGuiKey_PageUp, true)) {
+        move_lines(text, st, -page_lines, shift);
+        *scroll_y = max(*scroll_y - (f32)page_lines * line_height, 0.0f);
+    } else if (igIsKeyPressed_Bool(ImGuiKey_PageDown, true)) {
+        move_lines(text, st, page_lines, shift);
+        *scroll_y += (f32)page_lines * line_height;
+    } else if (igIsKeyPressed_Bool(ImGuiKey_Home, true)) {
+        st->want_x = -1.0f;
+        move_to(st, io->KeyCtrl ? 0 : text_line_start(text, text_line_of(text, st->cursor)), shift);
+    } else if (igIsKeyPressed_Bool(ImGuiKey_End, true)) {
+        st->want_x = -1.0f;
+        move_to(st, io->KeyCtrl ? text->len : text_line_end(text, text_line_of(text, st->cursor)), shift);
+    } else if (igIsKeyPressed_Bool(ImGuiKey_Delete, true)) {
+        if (shift && has_selection) {
+            copy_selection(text, st);
+        }
+        if (!has_selection) {
+            st->anchor = wordmove ? word_right(text, st->cursor) : next_char(text, st->cursor);
+        }
+        insert(ctx, "", 0);
+    } else if (igIsKeyPressed_Bool(ImGuiKey_Backspace, true)) {
+        if (!has_selection) {
+            st->anchor = wordmove ? word_left(text, st->cursor) : prev_char(text, st->cursor);
+        }
+        insert(ctx, "", 0);
+    } else if (igIsKeyPressed_Bool(ImGuiKey_Enter, true) || igIsKeyPressed_Bool(ImGuiKey_KeypadEnter, true)) {
+        insert(ctx, "\n", 1);
+    } else if (igShortcut(ImGuiKey_Tab, id, ImGuiInputFlags_Repeat)) {
+        insert(ctx, "\t", 1);
+    } else if (igShortcut(ImGuiMod_Shortcut | ImGuiKey_A, id, 0)) {
+        st->anchor = 0;
+        st->cursor = text->len;
+        st->want_x = -1.0f;
+    } else if (igShortcut(ImGuiMod_Shortcut | ImGuiKey_Z, id, ImGuiInputFlags_Repeat)) {
+        undo(ctx);
+    } else if (igShortcut(ImGuiMod_Shortcut | ImGuiKey_Y, id, ImGuiInputFlags_Repeat) ||
+               (is_osx && igShortcut(ImGuiMod_Shortcut | ImGuiMod_Shift | ImGuiKey_Z, id, ImGuiInputFlags_Repeat))) {
+        redo(ctx);
+    } else if (has_selection && (igShortcut(ImGuiMod_Shortcut | ImGuiKey_C, id, 0) ||
+                                 igShortcut(ImGuiMod_Ctrl | ImGuiKey_Insert, id, 0))) {
+        copy_selection(text, st);
+    } else if (has_selection && igShortcut(ImGuiMod_Shortcut | ImGuiKey_X, id, 0)) {
+        copy_selection(text, st);
+        insert(ctx, "", 0);
+    } else if (igShortcut(ImGuiMod_Shortcut | ImGuiKey_V, id, 0) ||
+               igShortcut(ImGuiMod_Shift | ImGuiKey_Insert, id, 0)) {
+        paste(ctx);
+    }
+
+    const bool ignore_chars = (io->KeyCtrl && !io->KeyAlt) || (is_osx && io->KeySuper);
+    if (!ignore_chars && io->InputQueueCharacters.Size > 0) {
+        char buf[256];
+        i32 n = 0;
+        for (i32 i = 0; i < io->InputQueueCharacters.Size && n + 4 < (i32)sizeof(buf); i++) {
+            unsigned int c = io->InputQueueCharacters.Data[i];
+            if (c < 0x20 || c == 0x7f) {
+                continue;
+            }
+            char utf8[5];
+            igImTextCharToUtf8(utf8, c);
+            i32 len = (i32)strlen(utf8);
+            memcpy(buf + n, utf8, (usize)len);
+            n += len;
+        }
+        if (n > 0) {
+            insert(ctx, buf, n);
+        }
+    }
+}
+
+// Runs are emitted grouped by color so same-colored vertices stay contiguous; they all share the font texture and
+// clip rect, so the whole editor remains a single ImDrawCmd.
+static void draw_runs(ImDrawList *draw_list, const text_t *text, const glyph_run_t *runs, i32 count, ImU32 text_col) {
+    for (i32 kind = 0; kind < HL_COUNT; kind++) {
+        ImU32 col = kind == HL_TEXT ? text_col : highlight_colors[kind];
+        for (i32 i = 0; i < count; i++) {
+            if (runs[i].kind == (hl_kind_t)kind) {
+                ImDrawList_AddText_Vec2(draw_list, runs[i].pos, col, text->data + runs[i].start,
+                                        text->data + runs[i].end);
+            }
+        }
+    }
+}
+
+bool text_edit(const char *label,
+               text_t *text,
+               edit_state_t *st,
+               highlight_t *hl,
+               ImVec2 size,
+               text_edit_fn on_edit,
+               void *user) {
+    static glyph_run_t runs[MAX_RUNS];
+    ImGuiContext *g = igGetCurrentContext();
+    ImGuiIO *io = igGetIO();
+    edit_ctx_t ctx = {.text = text, .st = st, .hl = hl, .on_edit = on_edit, .user = user};
+    font = igGetFont();
+    font_size = igGetFontSize();
+    const f32 line_height = igGetTextLineHeight();
+    st->cursor = max(0, min(st->cursor, text->len));
+    st->anchor = max(0, min(st->anchor, text->len));
+
+    igPushStyleColor_U32(ImGuiCol_ChildBg, igGetColorU32_Col(ImGuiCol_FrameBg, 1.0f));
+    igPushStyleVar_Vec2(ImGuiStyleVar_WindowPadding, igGetStyle()->FramePadding);
+    ImVec2 content = {text->lines.max_width + font_size, (f32)text_line_count(text) * line_height};
+    igSetNextWindowContentSize(content);
+    igBeginChild_Str(label, size, ImGuiChildFlags_Border,
+                     ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoMove);
+    igPopStyleVar(1);
+
+    ImGuiWindow *window = igGetCurrentWindow();
+    ImGuiID id = igGetID_Str("##text");
+    ImVec2 origin;
+    igGetCursorScreenPos(&origin);
+    ImRect bb = {origin, {origin.x + content.x, origin.y + content.y}};
+    igItemSize_Vec2(content, -1.0f);
+    igItemAdd(bb, id, NULL, 0);
+
+    const ImRect inner = window->InnerClipRect;
+    const f32 view_w = inner.Max.x - inner.Min.x;
+    const f32 view_h = inner.Max.y - inner.Min.y;
+    const bool hovered = igIsWindowHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem) &&
+                         igIsMouseHoveringRect(inner.Min, inner.Max, true);
+    if (hovered) {
+        igSetMouseCursor(ImGuiMouseCursor_TextInput);
+    }
+
+    ImVec2 mouse;
+    igGetMousePos(&mouse);
+    i32 mouse_line = max(0, min((i32)floorf((mouse.y - origin.y) / line_height), text_line_count(text) - 1));
+    i32 mouse_pos = pos_at_x(text, mouse_line, mouse.x - origin.x);
+
+    if (hovered && igIsMouseClicked_Bool(ImGuiMouseButton_Left, false)) {
+        if (g->ActiveId != id) {
+            igSetActiveID(id, window);
+            igSetFocusID(id, window);
+            igFocusWindow(window, 0);
+            st->undo_base = st->undo_pos;
+        }
+        igSetKeyOwner(ImGuiKey_MouseLeft, id, 0);
+        st->want_x = -1.0f;
+        if (igIsMouseDoubleClicked_Nil(ImGuiMouseButton_Left)) {
+            st->anchor = word_left(text, mouse_pos);
+            st->cursor = mouse_pos;
+            while (st->cursor < text->len && is_word_char(text->data[st->cursor])) {
+                st->cursor++;
+            }
+            st->selecting = false;
+        } else {
+            move_to(st, mouse_pos, io->KeyShift);
+            st->selecting = true;
+        }
+    } else if (st->selecting && igIsMouseDown_Nil(ImGuiMouseButton_Left)) {
+        move_to(st, mouse_pos, true);
+    } else {
+        st->selecting = false;
+    }
+
+    f32 scroll_x = window->Scroll.x;
+    f32 scroll_y = window->Scroll.y;
+    bool active = g->ActiveId == id;
+    if (active && io->MouseClicked[0] && !hovered) {
+        igClearActiveID();
+        active = false;
+    }
+    if (active) {
+        igKeepAliveID(id);
+        g->ActiveIdUsingNavDirMask |= (1 << ImGuiDir_Left) | (1 << ImGuiDir_Right) | (1 << ImGuiDir_Up) |
+                                      (1 << ImGuiDir_Down);
+        igSetKeyOwner(ImGuiKey_Home, id, 0);
+        igSetKeyOwner(ImGuiKey_End, id, 0);
+        igSetKeyOwner(ImGuiKey_PageUp, id, 0);
+        igSetKeyOwner(ImGuiKey_PageDown, id, 0);
+        igSetShortcutRouting(ImGuiKey_Tab, id, 0);
+
+        if (igShortcut(ImGuiKey_Escape, id, 0)) {
+            // like igInputTextMultiline, Escape reverts to the text the editor was activated with
+            while (st->undo_pos > st->undo_base) {
+                undo(&ctx);
+            }
+            igClearActiveID();
+            active = false;
+        } else {
+            handle_keys(&ctx, id, max(1, (i32)(view_h / line_height) - 1), &scroll_y);
+        }
+        st->blink += io->DeltaTime;
+        g->WantTextInputNextFrame = 1;
+    }
+
+    if (st->scroll_to_cursor) {
+        i32 line = text_line_of(text, st->cursor);
+        f32 y = (f32)line * line_height;
+        f32 x = x_of(text, st->cursor);
+        if (y < scroll_y) {
+            scroll_y = y;
+        } else if (y + line_height > scroll_y + view_h) {
+            scroll_y = y + line_height - view_h;
+        }
+        if (x < scroll_x) {
+            scroll_x = max(0.0f, x - view_w * 0.25f);
+        } else if (x + font_size > scroll_x + view_w) {
+            scroll_x = x + font_size - view_w * 0.75f;
+        }
+        st->scroll_to_cursor = false;
+    }
+    scroll_y = max(0.0f, min(scroll_y, max(0.0f, (f32)text_line_count(text) * line_height - view_h)));
+    origin.x += window->Scroll.x - scroll_x;
+    origin.y += window->Scroll.y - scroll_y;
+    window->Scroll.x = scroll_x;
+    window->Scroll.y = scroll_y;
+
+    ImDrawList *draw_list = igGetWindowDrawList();
+    const i32 first = max(0, (i32)(scroll_y / line_height));
+    const i32 last = min(text_line_count(text), first + (i32)(view_h / line_height) + 2);
+    const i32 sel_start = min(st->cursor, st->anchor);
+    const i32 sel_end = max(st->cursor, st->anchor);
+    const ImU32 text_col = igGetColorU32_Col(ImGuiCol_Text, 1.0f);
+    const ImU32 sel_col = igGetColorU32_Col(ImGuiCol_TextSelectedBg, 1.0f);
+    i32 run_count = 0;
+    for (i32 line = first; line < last; line++) {
+        i32 start = text_line_start(text, line);
+        i32 end = text_line_end(text, line);
+        f32 width = text_line_width(text, line, font_size, measure, NULL);
+        f32 y = origin.y + (f32)line * line_height;
+        if (sel_start != sel_end && sel_start <= end && sel_end > start) {
+            f32 x0 = sel_start > start ? x_of(text, sel_start) : 0.0f;
+            f32 x1 = sel_end <= end ? x_of(text, sel_end) : width + font_size * 0.4f;
+            ImDrawList_AddRectFilled(draw_list, (ImVec2){origin.x + x0, y}, (ImVec2){origin.x + x1, y + line_height},
+                                     sel_col, 0.0f, 0);
+        }
+        if (end == start) {
+            continue;
+        }
+        hl_span_t spans[MAX_LINE_SPANS];
+        i32 span_count = 1;
+        spans[0] = (hl_span_t){start, end, HL_TEXT};
+        if (hl) {
+            span_count = highlight_line(hl, text, line, spans, MAX_LINE_SPANS);
+        }
+        f32 x = origin.x;
+        for (i32 i = 0; i < span_count && x < inner.Max.x; i++) {
+            if (run_count == MAX_RUNS) {
+                draw_runs(draw_list, text, runs, run_count, text_col);
+                run_count = 0;
+            }
+            runs[run_count++] = (glyph_run_t){{x, y}, spans[i].start, spans[i].end, spans[i].kind};
+            if (i + 1 < span_count) {
+                x += measure(text->data + spans[i].start, text->data + spans[i].end, NULL);
+            }
+        }
+    }
+    draw_runs(draw_list, text, runs, run_count, text_col);
+    const bool caret_visible = !io->ConfigInputTextCursorBlink || st->blink <= 0.0f || fmodf(st->blink, 1.20f) <= 0.80f;
+    if (active && caret_visible) {
+        f32 x = origin.x + x_of(text, st->cursor);
+        f32 y = origin.y + (f32)text_line_of(text, st->cursor) * line_height;
+        ImDrawList_AddLine(draw_list, (ImVec2){x + 0.5f, y}, (ImVec2){x + 0.5f, y + line_height - 1.5f}, text_col,
+                           1.0f);
+    }
+
+    igEndChild();
+    igPopStyleColor(1);
+    return ctx.changed;
+}
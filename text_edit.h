@@ -0,0 +1,69 @@
+#ifndef AFAIRE_TEXT_EDIT_H
+#define AFAIRE_TEXT_EDIT_H
+
+#include "base.h"
+#include "highlight.h"
+#include "text.h"
+
+#ifndef CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#endif
+#include "cimgui.h"
+
+// Called after every change to the text with the replaced range, in post-edit byte offsets.
+typedef void (*text_edit_fn)(void *user, i32 pos, i32 removed, i32 inserted);
+
+typedef struct {
+    i32 pos;
+    char *removed;
+    i32 removed_len;
+    char *inserted;
+    i32 inserted_len;
+    i32 inserted_cap;  // merged typing appends in place
+    i32 cursor_before;
+    i32 anchor_before;
+} edit_record_t;
+
+// Caret, selection and undo history of one editor; offsets are UTF-8 byte positions into the text_t.
+typedef struct {
+    i32 cursor;
+    i32 anchor;  // other end of the selection, equals cursor when nothing is selected
+    f32 want_x;  // horizontal position kept across vertical moves, < 0 when unset
+    f32 blink;
+    bool scroll_to_cursor;
+    bool selecting;  // mouse drag in progress
+    edit_record_t *undo;
+    i32 undo_count;
+    i32 undo_cap;
+    i32 undo_pos;   // records [0, undo_pos) are applied, the rest can be redone
+    i32 undo_base;  // undo_pos when the editor was activated, Escape reverts to it
+} edit_state_t;
+
+void edit_state_reset(edit_state_t *st);
+void edit_state_free(edit_state_t *st);
+// Follows a change made to the text by something else: the caret and selection move with the text around them, and
+// the undo history, which no longer applies, is dropped.
+void edit_state_external(edit_state_t *st, i32 pos, i32 removed, i32 inserted);
+// Replaces `removed` bytes at `pos` as if typed in the editor: undoable, highlighted, and reported to `on_edit`. The
+// caret lands after the inserted text.
+void text_edit_replace(text_t *text,
+                       edit_state_t *st,
+                       highlight_t *hl,
+                       i32 pos,
+                       i32 removed,
+                       const char *ins,
+                       i32 ins_len,
+                       text_edit_fn on_edit,
+                       void *user);
+
+// Multiline editor rendering only the visible lines of `text`, colored by `hl` when not NULL.
+// Returns true when the text changed this frame.
+bool text_edit(const char *label,
+               text_t *text,
+               edit_state_t *st,
+               highlight_t *hl,
+               ImVec2 size,
+               text_edit_fn on_edit,
+               void *user);
+
+#endif
@@ -0,0 +1,644 @@
+#include "vfs.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc.h"
+
+#define TABLE_MAX_PATH 1024
+#define TAR_BLOCK 512
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+
+struct linux_dirent64 {
+    u64 d_ino;
+    i64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+static char *copy_string(const char *s, usize len) {
+    char *copy = mem_alloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+//=== POSIX: a directory on disk
+
+typedef struct {
+    vfs_t base;
+    i32 root_fd;
+} posix_vfs_t;
+
+// Entries getdents didn't type (some filesystems, symlinks), stat'ed together once the listing is read. An untyped
+// entry is stat'ed as itself, so a symlink among them is found out and looked through in a second round.
+typedef struct {
+    fileio_req_t *reqs;
+    u8 *types;
+    i32 count;
+    i32 cap;
+} untyped_t;
+
+static void posix_run(vfs_t *vfs, fileio_req_t *reqs, i32 count) {
+    posix_vfs_t *p = (posix_vfs_t *)vfs;
+    for (i32 i = 0; i < count; i++) {
+        reqs[i].dir_fd = p->root_fd;
+        if (reqs[i].path[0] == '\0') {
+            reqs[i].path = ".";
+        }
+    }
+    fileio_run(reqs, count);
+}
+
+static void posix_entry(untyped_t *u, i32 fd, const char *name, u8 d_type, vfs_entry_fn fn, void *user) {
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return;
+    }
+    if (d_type == DT_DIR || d_type == DT_REG) {
+        fn(user, name, d_type == DT_DIR);
+        return;
+    }
+    if (u->count == u->cap) {
+        i32 cap = max(16, u->cap * 2);
+        fileio_req_t *reqs = mem_realloc(u->reqs, (usize)cap * sizeof(*reqs));
+        if (reqs) {
+            u->reqs = reqs;
+        }
+        u8 *types = reqs ? mem_realloc(u->types, (usize)cap) : NULL;
+        if (!types) {
+            return;
+        }
+        u->types = types;
+        u->cap = cap;
+    }
+    char *path = copy_string(name, strlen(name));
+    if (path) {
+        u->types[u->count] = d_type;
+        u->reqs[u->count++] =
+            (fileio_req_t){.op = FILEIO_STAT, .dir_fd = fd, .path = path, .no_follow = d_type != DT_LNK};
+    }
+}
+
+static i32 posix_list(vfs_t *vfs, const char *dir, vfs_entry_fn fn, void *user) {
+    posix_vfs_t *p = (posix_vfs_t *)vfs;
+    i32 fd = openat(p->root_fd, dir[0] ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno;
+    }
+    untyped_t u = {0};
+#if defined(__linux__)
+    char buf[32 * 1024];
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        for (long off = 0; off < n;) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            posix_entry(&u, fd, d->d_name, d->d_type, fn, user);
+            off += d->d_reclen;
+        }
+    }
+#else
+    DIR *d = fdopendir(dup(fd));
+    if (d) {
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            posix_entry(&u, fd, e->d_name, e->d_type, fn, user);
+        }
+        closedir(d);
+    }
+#endif
+    fileio_run(u.reqs, u.count);
+    i32 links = 0;
+    for (i32 i = 0; i < u.count; i++) {
+        fileio_req_t r = u.reqs[i];
+        if (r.error == 0 && r.is_link) {
+            u.reqs[i] = u.reqs[links];
+            u.types[i] = u.types[links];
+            u.reqs[links] = (fileio_req_t){.op = FILEIO_STAT, .dir_fd = fd, .path = r.path};
+            u.types[links++] = DT_LNK;
+        }
+    }
+    fileio_run(u.reqs, links);
+    // directory symlinks are not followed: they can loop
+    for (i32 i = 0; i < u.count; i++) {
+        const fileio_req_t *r = &u.reqs[i];
+        if (r->error == 0 && (r->is_file || (r->is_dir && u.types[i] != DT_LNK))) {
+            fn(user, r->path, r->is_dir);
+        }
+        mem_free((char *)r->path);
+    }
+    mem_free(u.reqs);
+    mem_free(u.types);
+    close(fd);
+    return 0;
+}
+
+static i32 posix_remove(vfs_t *vfs, const char *path) {
+    posix_vfs_t *p = (posix_vfs_t *)vfs;
+    return unlinkat(p->root_fd, path, 0) == 0 ? 0 : errno;
+}
+
+// flock() locks belong to the open file, so the lock also keeps out the other threads of this process.
+static i32 posix_lock(vfs_t *vfs, const char *path) {
+    posix_vfs_t *p = (posix_vfs_t *)vfs;
+    // a file that doesn't exist has nothing to lock: creating it here would bring back one another process deleted
+    i32 fd = openat(p->root_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void posix_unlock(vfs_t *vfs, i32 lock) {
+    (void)vfs;
+    close(lock);
+}
+
+static void posix_close(vfs_t *vfs) {
+    posix_vfs_t *p = (posix_vfs_t *)vfs;
+    close(p->root_fd);
+    mem_free(p);
+}
+
+vfs_t *vfs_posix_open(const char *root) {
+    i32 fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    posix_vfs_t *p = fd >= 0 ? mem_alloc(sizeof(*p)) : NULL;
+    if (!p) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    *p = (posix_vfs_t){
+        .base = {"posix", false, posix_run, posix_list, posix_remove, posix_close, posix_lock, posix_unlock},
+        .root_fd = fd,
+    };
+    return &p->base;
+}
+
+//=== Files in a table sorted by path, for the memory and archive backends
+
+typedef struct {
+    char *path;
+    char *data;  // memory: owned; archive: inside the mapping
+    i32 len;
+    i64 mtime;
+    bool is_dir;  // an archive's explicit directory entry; other directories exist as long as they hold something
+} table_file_t;
+
+typedef struct {
+    table_file_t *files;
+    i32 count;
+    i32 cap;
+} table_t;
+
+// Byte order with '/' first, so a directory's entries sort together: "a", "a/b", "a.md" rather than "a", "a.md",
+// "a/b". Every prefix still covers one contiguous run.
+static i32 path_cmp(const char *a, const char *b) {
+    for (;; a++, b++) {
+        u8 x = *a == '/' ? 1 : (u8)*a, y = *b == '/' ? 1 : (u8)*b;
+        if (x != y || x == 0) {
+            return (i32)x - (i32)y;
+        }
+    }
+}
+
+static i32 table_lower_bound(const table_t *t, const char *path) {
+    i32 lo = 0, hi = t->count;
+    while (lo < hi) {
+        i32 mid = lo + (hi - lo) / 2;
+        if (path_cmp(t->files[mid].path, path) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static table_file_t *table_find(const table_t *t, const char *path) {
+    i32 i = table_lower_bound(t, path);
+    return i < t->count && path_cmp(t->files[i].path, path) == 0 ? &t->files[i] : NULL;
+}
+
+// "dir/", or "" for the root. Returns the length, or -1 if it doesn't fit.
+static i32 dir_prefix(const char *dir, char *prefix) {
+    i32 n = dir[0] ? snprintf(prefix, TABLE_MAX_PATH, "%s/", dir) : 0;
+    prefix[n < TABLE_MAX_PATH ? max(n, 0) : 0] = '\0';
+    return n < TABLE_MAX_PATH ? n : -1;
+}
+
+static bool table_has_children(const table_t *t, const char *dir) {
+    char prefix[TABLE_MAX_PATH];
+    i32 n = dir_prefix(dir, prefix);
+    i32 i = n >= 0 ? table_lower_bound(t, prefix) : t->count;
+    return i < t->count && strncmp(t->files[i].path, prefix, (usize)n) == 0;
+}
+
+static void table_stat(const table_t *t, fileio_req_t *r) {
+    r->error = 0;
+    const table_file_t *f = table_find(t, r->path);
+    if (f) {
+        r->is_dir = f->is_dir;
+        r->is_file = !f->is_dir;
+        r->mtime = f->mtime;
+        r->size = f->len;
+    } else if (r->path[0] == '\0' || table_has_children(t, r->path)) {
+        r->is_dir = true;
+        r->is_file = false;
+        r->mtime = 0;
+        r->size = 0;
+    } else {
+        r->error = ENOENT;
+    }
+}
+
+static void table_read(const table_t *t, fileio_req_t *r) {
+    r->data = NULL;
+    r->len = 0;
+    table_stat(t, r);
+    if (r->error == 0 && r->is_dir) {
+        r->error = EISDIR;
+    }
+    if (r->error != 0) {
+        return;
+    }
+    const table_file_t *f = table_find(t, r->path);
+    r->data = copy_string(f->data ? f->data : "", (usize)f->len);
+    r->len = r->data ? f->len : 0;
+    r->error = r->data ? 0 : ENOMEM;
+}
+
+static i32 table_list(const table_t *t, const char *dir, vfs_entry_fn fn, void *user) {
+    char prefix[TABLE_MAX_PATH], last[TABLE_MAX_PATH] = "";
+    i32 n = dir_prefix(dir, prefix);
+    if (n < 0) {
+        return ENAMETOOLONG;
+    }
+    bool found = dir[0] == '\0';
+    for (i32 i = table_lower_bound(t, prefix); i < t->count && strncmp(t->files[i].path, prefix, (usize)n) == 0; i++) {
+        found = true;
+        const char *name = t->files[i].path + n;
+        const char *slash = strchr(name, '/');
+        usize len = slash ? (usize)(slash - name) : strlen(name);
+        // whatever lies below one child follows it, so comparing with the previous name is enough
+        if (len == 0 || (strlen(last) == len && memcmp(last, name, len) == 0)) {
+            continue;
+        }
+        memcpy(last, name, len);
+        last[len] = '\0';
+        fn(user, last, slash != NULL || t->files[i].is_dir);
+    }
+    if (!found) {
+        const table_file_t *f = table_find(t, dir);
+        return !f ? ENOENT : f->is_dir ? 0 : ENOTDIR;
+    }
+    return 0;
+}
+
+//=== In memory
+
+typedef struct {
+    vfs_t base;
+    pthread_mutex_t lock;
+    table_t table;
+    i64 clock;  // stands in for mtimes: bumped on every write
+} memory_vfs_t;
+
+static i32 memory_put_locked(memory_vfs_t *m, const char *path, const char *data, i32 len) {
+    if (path[0] == '\0' || path[0] == '/' || strlen(path) >= TABLE_MAX_PATH || len < 0) {
+        return EINVAL;
+    }
+    table_t *t = &m->table;
+    i32 i = table_lower_bound(t, path);
+    bool exists = i < t->count && path_cmp(t->files[i].path, path) == 0;
+    if (exists ? t->files[i].is_dir : table_has_children(t, path)) {
+        return EISDIR;
+    }
+    char *copy = copy_string(data ? data : "", (usize)len);
+    if (!copy) {
+        return ENOMEM;
+    }
+    if (!exists) {
+        char *name = copy_string(path, strlen(path));
+        if (t->count == t->cap) {
+            i32 cap = max(64, t->cap * 2);
+            table_file_t *files = name ? mem_realloc(t->files, (usize)cap * sizeof(*files)) : NULL;
+            if (!files) {
+                mem_free(name);
+                mem_free(copy);
+                return ENOMEM;
+            }
+            t->files = files;
+            t->cap = cap;
+        }
+        memmove(&t->files[i + 1], &t->files[i], (usize)(t->count - i) * sizeof(*t->files));
+        t->files[i] = (table_file_t){.path = name};
+        t->count++;
+    }
+    table_file_t *f = &t->files[i];
+    mem_free(f->data);
+    f->data = copy;
+    f->len = len;
+    f->mtime = ++m->clock;
+    return 0;
+}
+
+static void memory_run(vfs_t *vfs, fileio_req_t *reqs, i32 count) {
+    memory_vfs_t *m = (memory_vfs_t *)vfs;
+    pthread_mutex_lock(&m->lock);
+    for (i32 i = 0; i < count; i++) {
+        fileio_req_t *r = &reqs[i];
+        if (r->op == FILEIO_STAT) {
+            table_stat(&m->table, r);
+        } else if (r->op == FILEIO_READ) {
+            table_read(&m->table, r);
+        } else {
+            r->error = memory_put_locked(m, r->path, r->data, r->len);
+            if (r->error == 0) {
+                table_stat(&m->table, r);
+            }
+        }
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+static i32 memory_list(vfs_t *vfs, const char *dir, vfs_entry_fn fn, void *user) {
+    memory_vfs_t *m = (memory_vfs_t *)vfs;
+    pthread_mutex_lock(&m->lock);
+    i32 error = table_list(&m->table, dir, fn, user);
+    pthread_mutex_unlock(&m->lock);
+    return error;
+}
+
+static i32 memory_remove(vfs_t *vfs, const char *path) {
+    memory_vfs_t *m = (memory_vfs_t *)vfs;
+    pthread_mutex_lock(&m->lock);
+    table_t *t = &m->table;
+    table_file_t *f = table_find(t, path);
+    i32 error = f ? 0 : ENOENT;
+    if (f) {
+        mem_free(f->path);
+        mem_free(f->data);
+        i32 i = (i32)(f - t->files);
+        memmove(&t->files[i], &t->files[i + 1], (usize)(t->count - i - 1) * sizeof(*t->files));
+        t->count--;
+    }
+    pthread_mutex_unlock(&m->lock);
+    return error;
+}
+
+static void memory_close(vfs_t *vfs) {
+    memory_vfs_t *m = (memory_vfs_t *)vfs;
+    for (i32 i = 0; i < m->table.count; i++) {
+        mem_free(m->table.files[i].path);
+        mem_free(m->table.files[i].data);
+    }
+    mem_free(m->table.files);
+    pthread_mutex_destroy(&m->lock);
+    mem_free(m);
+}
+
+vfs_t *vfs_memory_open(void) {
+    memory_vfs_t *m = mem_alloc(sizeof(*m));
+    if (!m) {
+        return NULL;
+    }
+    *m = (memory_vfs_t){.base = {"memory", false, memory_run, memory_list, memory_remove, memory_close}};
+    pthread_mutex_init(&m->lock, NULL);
+    return &m->base;
+}
+
+i32 vfs_memory_put(vfs_t *vfs, const char *path, const char *data, i32 len) {
+    memory_vfs_t *m = (memory_vfs_t *)vfs;
+    pthread_mutex_lock(&m->lock);
+    i32 error = memory_put_locked(m, path, data, len);
+    pthread_mutex_unlock(&m->lock);
+    return error;
+}
+
+//=== Tar archive, read-only
+
+typedef struct {
+    vfs_t base;
+    u8 *map;
+    usize size;
+    table_t table;
+} tar_vfs_t;
+
+static u64 tar_octal(const u8 *field, i32 len) {
+    u64 v = 0;
+    for (i32 i = 0; i < len && field[i]; i++) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            v = v * 8 + (u64)(field[i] - '0');
+        }
+    }
+    return v;
+}
+
+// Drops "./" and "/" in front and "/" behind. Returns NULL for the archive's root.
+static char *tar_path(const char *name, usize len) {
+    for (;;) {
+        if (len >= 2 && name[0] == '.' && name[1] == '/') {
+            name += 2, len -= 2;
+        } else if (len >= 1 && name[0] == '/') {
+            name++, len--;
+        } else {
+            break;
+        }
+    }
+    while (len > 0 && name[len - 1] == '/') {
+        len--;
+    }
+    if (len == 0 || (len == 1 && name[0] == '.') || len >= TABLE_MAX_PATH) {
+        return NULL;
+    }
+    return copy_string(name, len);
+}
+
+// The "path" record of a pax extended header: "<length> path=<value>\n".
+static char *tar_pax_path(const char *records, usize len) {
+    for (usize off = 0; off < len;) {
+        char *end;
+        unsigned long record = strtoul(records + off, &end, 10);
+        if (record == 0 || off + record > len) {
+            break;
+        }
+        const char *key = end + 1;
+        const char *stop = records + off + record - 1;  // the '\n'
+        if (stop > key + 5 && memcmp(key, "path=", 5) == 0) {
+            return tar_path(key + 5, (usize)(stop - key - 5));
+        }
+        off += record;
+    }
+    return NULL;
+}
+
+static int tar_file_cmp(const void *a, const void *b) {
+    const table_file_t *x = a, *y = b;
+    i32 c = path_cmp(x->path, y->path);
+    // a path stored twice keeps its last copy, which sorts last
+    return c != 0 ? c : (x->data > y->data) - (x->data < y->data);
+}
+
+static bool tar_add(table_t *t, char *path, const u8 *data, u64 size, i64 mtime, bool is_dir) {
+    if (t->count == t->cap) {
+        i32 cap = max(256, t->cap * 2);
+        table_file_t *files = mem_realloc(t->files, (usize)cap * sizeof(*files));
+        if (!files) {
+            return false;
+        }
+        t->files = files;
+        t->cap = cap;
+    }
+    t->files[t->count++] = (table_file_t){path, (char *)data, (i32)size, mtime, is_dir};
+    return true;
+}
+
+static void tar_parse(tar_vfs_t *a) {
+    char *long_name = NULL;  // from a GNU 'L' entry or a pax header, for the entry that follows
+    for (usize off = 0; off + TAR_BLOCK <= a->size;) {
+        const u8 *h = a->map + off;
+        if (h[0] == '\0') {
+            break;  // the zero blocks at the end
+        }
+        u64 size = tar_octal(h + 124, 12);
+        usize next = off + TAR_BLOCK + (usize)((size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK);
+        if (next > a->size || next < off || size >= INT32_MAX) {
+            break;  // truncated
+        }
+        const u8 *data = h + TAR_BLOCK;
+        char type = (char)h[156];
+        if (type == 'L' || type == 'x') {
+            mem_free(long_name);
+            long_name = type == 'L' ? tar_path((const char *)data, strnlen((const char *)data, (usize)size))
+                                    : tar_pax_path((const char *)data, (usize)size);
+        } else if (type == '0' || type == '\0' || type == '7' || type == '5') {
+            char *path = long_name;
+            long_name = NULL;
+            if (!path) {
+                char name[TABLE_MAX_PATH];
+                const char *prefix = (const char *)h + 345;
+                usize name_len = strnlen((const char *)h, 100);
+                if (memcmp(h + 257, "ustar", 5) == 0 && prefix[0]) {
+                    i32 n = snprintf(name, sizeof(name), "%.*s/%.*s", (int)strnlen(prefix, 155), prefix,
+                                     (int)name_len, (const char *)h);
+                    path = n > 0 && n < (i32)sizeof(name) ? tar_path(name, (usize)n) : NULL;
+                } else {
+                    path = tar_path((const char *)h, name_len);
+                }
+            }
+            i64 mtime = (i64)tar_octal(h + 136, 12) * 1000000000;
+            if (path && !tar_add(&a->table, path, type == '5' ? NULL : data, type == '5' ? 0 : size, mtime,
+                                 type == '5')) {
+                mem_free(path);
+                break;
+            }
+        } else {
+            // links, devices, global pax headers: not notes
+            mem_free(long_name);
+            long_name = NULL;
+        }
+        off = next;
+    }
+    mem_free(long_name);
+
+    table_t *t = &a->table;
+    qsort(t->files, (usize)t->count, sizeof(*t->files), tar_file_cmp);
+    i32 kept = 0;
+    for (i32 i = 0; i < t->count; i++) {
+        if (i + 1 < t->count && path_cmp(t->files[i].path, t->files[i + 1].path) == 0) {
+            mem_free(t->files[i].path);
+        } else {
+            t->files[kept++] = t->files[i];
+        }
+    }
+    t->count = kept;
+}
+
+static void tar_run(vfs_t *vfs, fileio_req_t *reqs, i32 count) {
+    tar_vfs_t *a = (tar_vfs_t *)vfs;
+    for (i32 i = 0; i < count; i++) {
+        if (reqs[i].op == FILEIO_STAT) {
+            table_stat(&a->table, &reqs[i]);
+        } else if (reqs[i].op == FILEIO_READ) {
+            table_read(&a->table, &reqs[i]);
+        } else {
+            reqs[i].error = EROFS;
+        }
+    }
+}
+
+static i32 tar_list(vfs_t *vfs, const char *dir, vfs_entry_fn fn, void *user) {
+    return table_list(&((tar_vfs_t *)vfs)->table, dir, fn, user);
+}
+
+static i32 tar_remove(vfs_t *vfs, const char *path) {
+    (void)vfs;
+    (void)path;
+    return EROFS;
+}
+
+static void tar_close(vfs_t *vfs) {
+    tar_vfs_t *a = (tar_vfs_t *)vfs;
+    for (i32 i = 0; i < a->table.count; i++) {
+        mem_free(a->table.files[i].path);
+    }
+    mem_free(a->table.files);
+    if (a->map) {
+        munmap(a->map, a->size);
+    }
+    mem_free(a);
+}
+
+vfs_t *vfs_tar_open(const char *path) {
+    i32 fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    tar_vfs_t *a = mem_alloc(sizeof(*a));
+    if (a) {
+        *a = (tar_vfs_t){.base = {"tar", true, tar_run, tar_list, tar_remove, tar_close}, .size = (usize)st.st_size};
+        void *map = a->size > 0 ? mmap(NULL, a->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        a->map = map == MAP_FAILED ? NULL : map;
+        tar_parse(a);
+    }
+    close(fd);
+    return a ? &a->base : NULL;
+}
+
+vfs_t *vfs_open(const char *root) {
+    usize len = strlen(root);
+    struct stat st;
+    if (len > 4 && strcmp(root + len - 4, ".tar") == 0 && stat(root, &st) == 0 && S_ISREG(st.st_mode)) {
+        return vfs_tar_open(root);
+    }
+    return vfs_posix_open(root);
+}
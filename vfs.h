@@ -0,0 +1,68 @@
+#ifndef AFAIRE_VFS_H
+#define AFAIRE_VFS_H
+
+#include "base.h"
+#include "fileio.h"
+
+// Called for each entry of a listed directory, "." and ".." excluded.
+typedef void (*vfs_entry_fn)(void *user, const char *name, bool is_dir);
+
+// A tree of files behind one workspace root. Paths are relative to that root, '/'-separated, "" for the root itself.
+// Every backend is safe to call from several threads at once. Backends embed this first.
+typedef struct vfs {
+    const char *kind;
+    bool read_only;
+    // Fills in the results of STAT, READ and WRITE requests; `dir_fd` is ignored. A batch may go out together.
+    void (*run)(struct vfs *vfs, fileio_req_t *reqs, i32 count);
+    // Returns 0 or an errno value. Symlinked directories are reported as neither, so walks can't loop.
+    i32 (*list)(struct vfs *vfs, const char *dir, vfs_entry_fn fn, void *user);
+    i32 (*remove)(struct vfs *vfs, const char *path);
+    void (*close)(struct vfs *vfs);
+    // Waits for the advisory lock every afaire takes on `path` around a save, so two instances don't write the same
+    // file at once; returns what unlock() takes, -1 if there was none to take, as for a file that doesn't exist yet.
+    // NULL where no other process writes.
+    i32 (*lock)(struct vfs *vfs, const char *path);
+    void (*unlock)(struct vfs *vfs, i32 lock);
+} vfs_t;
+
+// A directory on disk; reads and writes go through fileio, batched over io_uring where available.
+vfs_t *vfs_posix_open(const char *root);
+// Files held in memory, for tests and for builds without a filesystem. Starts empty; directories exist as long as
+// they hold a file.
+vfs_t *vfs_memory_open(void);
+i32 vfs_memory_put(vfs_t *vfs, const char *path, const char *data, i32 len);
+// A read-only uncompressed tar (ustar, GNU long names, pax paths), mapped rather than read.
+vfs_t *vfs_tar_open(const char *path);
+// The backend for a root given on the command line: a .tar file is opened as an archive, anything else as a
+// directory. NULL if it can't be opened.
+vfs_t *vfs_open(const char *root);
+
+static inline void vfs_run(vfs_t *vfs, fileio_req_t *reqs, i32 count) {
+    vfs->run(vfs, reqs, count);
+}
+
+static inline i32 vfs_list(vfs_t *vfs, const char *dir, vfs_entry_fn fn, void *user) {
+    return vfs->list(vfs, dir, fn, user);
+}
+
+static inline i32 vfs_remove(vfs_t *vfs, const char *path) {
+    return vfs->remove(vfs, path);
+}
+
+static inline i32 vfs_lock(vfs_t *vfs, const char *path) {
+    return vfs->lock ? vfs->lock(vfs, path) : -1;
+}
+
+static inline void vfs_unlock(vfs_t *vfs, i32 lock) {
+    if (vfs->unlock && lock >= 0) {
+        vfs->unlock(vfs, lock);
+    }
+}
+
+static inline void vfs_close(vfs_t *vfs) {
+    if (vfs) {
+        vfs->close(vfs);
+    }
+}
+
+#endif
@@ -0,0 +1,295 @@
+#include "workspace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+static bool reserve_nodes(workspace_t *ws, i32 count) {
+    if (count <= ws->node_cap) {
+        return true;
+    }
+    i32 cap = max(count, max(256, ws->node_cap * 2));
+    ws_node_t *nodes = mem_realloc(ws->nodes, (usize)cap * sizeof(*nodes));
+    if (!nodes) {
+        return false;
+    }
+    ws->nodes = nodes;
+    ws->node_cap = cap;
+    return true;
+}
+
+static i32 add_string(workspace_t *ws, const char *prefix, i32 prefix_len, const char *name) {
+    i32 name_len = (i32)strlen(name);
+    i32 len = prefix_len + (prefix_len > 0) + name_len + 1;
+    if (ws->strings_len + len > ws->strings_cap) {
+        i32 cap = max(ws->strings_len + len, max(4096, ws->strings_cap * 2));
+        char *strings = mem_realloc(ws->strings, (usize)cap);
+        if (!strings) {
+            return WS_NONE;
+        }
+        // `prefix` may point into the old pool
+        if (prefix >= ws->strings && prefix < ws->strings + ws->strings_len) {
+            prefix = strings + (prefix - ws->strings);
+        }
+        ws->strings = strings;
+        ws->strings_cap = cap;
+    }
+    i32 offset = ws->strings_len;
+    char *dst = ws->strings + offset;
+    if (prefix_len > 0) {
+        memcpy(dst, prefix, (usize)prefix_len);
+        dst[prefix_len] = '/';
+        dst += prefix_len + 1;
+    }
+    memcpy(dst, name, (usize)name_len + 1);
+    ws->strings_len += len;
+    return offset;
+}
+
+static void insert_node(workspace_t *ws, u32 key, u32 parent, u16 root, bool is_dir, const char *name) {
+    if (!reserve_nodes(ws, (i32)key + 1)) {
+        return;
+    }
+    for (i32 i = ws->node_count; i <= (i32)key; i++) {
+        ws->nodes[i] = (ws_node_t){.parent = WS_NONE, .first_child = WS_NONE, .next_sibling = WS_NONE};
+    }
+    ws->node_count = max(ws->node_count, (i32)key + 1);
+
+    ws_node_t node = {.parent = WS_NONE, .first_child = WS_NONE, .next_sibling = WS_NONE, .root = root};
+    node.flags = WS_PRESENT | (is_dir ? WS_DIR : 0);
+    if (parent == SCAN_NO_PARENT) {
+        i32 len = (i32)strlen(name);
+        while (len > 1 && name[len - 1] == '/') {
+            len--;
+        }
+        node.path = add_string(ws, NULL, 0, name);
+        if (node.path == WS_NONE) {
+            return;
+        }
+        ws->strings[node.path + len] = '\0';
+        const char *slash = strrchr(ws->strings + node.path, '/');
+        node.name = slash && slash[1] ? (i32)(slash + 1 - ws->strings) : node.path;
+        node.display = node.name;
+        node.flags |= WS_EXPANDED;
+    } else {
+        const ws_node_t *p = &ws->nodes[parent];
+        i32 parent_len = (i32)strlen(ws->strings + p->path);
+        node.path = add_string(ws, ws->strings + p->path, parent_len, name);
+        if (node.path == WS_NONE) {
+            return;
+        }
+        node.parent = (i32)parent;
+        node.name = node.path + parent_len + 1;
+        const ws_node_t *r = &ws->nodes[root];
+        i32 root_len = (i32)strlen(ws->strings + r->path);
+        node.display = ws->root_count > 1 ? node.path + (r->name - r->path) : node.path + root_len + 1;
+    }
+    ws->nodes[key] = node;
+    if (node.parent != WS_NONE) {
+        ws_node_t *p = &ws->nodes[node.parent];
+        ws->nodes[key].next_sibling = p->first_child;
+        p->first_child = (i32)key;
+        p->flags &= (u8)~WS_SORTED;
+    }
+    if (!is_dir) {
+        ws->file_count++;
+    }
+    ws->generation++;
+}
+
+static void unlink_node(workspace_t *ws, i32 node) {
+    ws_node_t *n = &ws->nodes[node];
+    if (n->parent != WS_NONE) {
+        i32 *link = &ws->nodes[n->parent].first_child;
+        while (*link != WS_NONE && *link != node) {
+            link = &ws->nodes[*link].next_sibling;
+        }
+        if (*link == node) {
+            *link = n->next_sibling;
+        }
+    }
+    if (!(n->flags & WS_DIR)) {
+        ws->file_count--;
+    }
+    n->flags = 0;
+    n->parent = n->next_sibling = WS_NONE;
+    ws->generation++;
+}
+
+// Brings the tree in line with the shared index: nodes another instance added are inserted, the ones it removed are
+// removed. Keys are the same everywhere, so an entry's parent is the local node with its key.
+static bool share_sync(workspace_t *ws) {
+    if (!ws->shared || share_seq(ws->share) == ws->share_seq || !share_read(ws->share, &ws->snapshot)) {
+        return false;
+    }
+    const share_snapshot_t *snap = &ws->snapshot;
+    u32 generation = ws->generation;
+    for (u32 key = 0; key < snap->count; key++) {
+        const share_entry_t *e = &snap->entries[key];
+        bool here = (i32)key < ws->node_count && (ws->nodes[key].flags & WS_PRESENT);
+        // a root's parent is SCAN_NO_PARENT, and roots are never added or removed here
+        bool parent_here = e->parent < key && (i32)e->parent < ws->node_count &&
+                           (ws->nodes[e->parent].flags & WS_PRESENT) && e->root < ws->root_count;
+        if ((e->flags & SHARE_PRESENT) && !here && parent_here && e->name < snap->names_len) {
+            insert_node(ws, key, e->parent, e->root, e->flags & SHARE_DIR, snap->names + e->name);
+        } else if (!(e->flags & SHARE_PRESENT) && here && ws->nodes[key].parent != WS_NONE) {
+            unlink_node(ws, (i32)key);
+        }
+    }
+    ws->share_seq = snap->seq;
+    return ws->generation != generation;
+}
+
+// The scan is in: the instances opening the same roots from now on copy the tree rather than scan it.
+static void share_index(workspace_t *ws) {
+    bool ok = true;
+    share_begin(ws->share);
+    for (i32 i = 0; i < ws->node_count && ok; i++) {
+        const ws_node_t *n = &ws->nodes[i];
+        if (n->flags & WS_PRESENT) {
+            u32 parent = n->parent == WS_NONE ? SCAN_NO_PARENT : (u32)n->parent;
+            ok = share_put(ws->share, (u32)i, parent, n->root, n->flags & WS_DIR, ws->strings + n->name);
+        }
+    }
+    if (ok) {
+        share_publish(ws->share, atomic_load(&ws->scanner.next_key));
+    }
+    share_end(ws->share);
+    if (!ok) {
+        // too large for the segment: nobody joined yet, keep the tree to this instance
+        share_close(ws->share);
+        ws->share = NULL;
+        return;
+    }
+    ws->shared = true;
+    ws->share_seq = share_seq(ws->share);
+}
+
+bool workspace_open(workspace_t *ws, const char *const *roots, vfs_t *const *vfs, i32 count, bool share) {
+    memset(ws, 0, sizeof(*ws));
+    ws->root_count = min(count, SCAN_MAX_ROOTS);
+    for (i32 i = 0; i < ws->root_count; i++) {
+        ws->vfs[i] = vfs[i];
+    }
+    ws->share = share && ws->root_count > 0 ? share_open(roots, ws->root_count) : NULL;
+    if (share_ready(ws->share)) {
+        // the roots have the keys the indexer's scan gave them; a writer holding the index is waited out a little,
+        // later polls catch up on the rest
+        for (i32 i = 0; i < ws->root_count; i++) {
+            insert_node(ws, (u32)i, SCAN_NO_PARENT, (u16)i, true, roots[i]);
+        }
+        ws->shared = true;
+        for (i32 tries = 0; tries < 1000 && ws->share_seq != share_seq(ws->share); tries++) {
+            share_sync(ws);
+        }
+        return true;
+    }
+    ws->scanning = scan_start(&ws->scanner, ws->vfs, roots, ws->root_count);
+    workspace_poll(ws);
+    return ws->scanning;
+}
+
+void workspace_free(workspace_t *ws) {
+    scan_stop(&ws->scanner);
+    share_close(ws->share);
+    share_snapshot_free(&ws->snapshot);
+    for (i32 i = 0; i < ws->root_count; i++) {
+        vfs_close(ws->vfs[i]);
+    }
+    mem_free(ws->nodes);
+    mem_free(ws->strings);
+    memset(ws, 0, sizeof(*ws));
+}
+
+bool workspace_poll(workspace_t *ws) {
+    if (!ws->scanning) {
+        return share_sync(ws);
+    }
+    // results published before the workers finished are still queued when scan_done() turns true
+    bool done = scan_done(&ws->scanner);
+    scan_batch_t *batches = scan_take(&ws->scanner);
+    for (scan_batch_t *b = batches; b; b = b->next) {
+        for (i32 i = 0; i < b->count; i++) {
+            const scan_entry_t *e = &b->entries[i];
+            insert_node(ws, e->key, e->parent, e->root, e->is_dir, b->names + e->name);
+        }
+    }
+    scan_batch_free(batches);
+    ws->scanning = !done;
+    if (done && ws->share) {
+        share_index(ws);
+    }
+    return batches != NULL;
+}
+
+i32 workspace_add(workspace_t *ws, i32 parent, const char *name, bool is_dir) {
+    u32 key = ws->shared ? share_alloc_key(ws->share) : scan_alloc_key(&ws->scanner);
+    u16 root = ws->nodes[parent].root;
+    insert_node(ws, key, (u32)parent, root, is_dir, name);
+    if ((i32)key >= ws->node_count || !(ws->nodes[key].flags & WS_PRESENT)) {
+        return WS_NONE;
+    }
+    if (ws->shared) {
+        share_begin(ws->share);
+        share_put(ws->share, key, (u32)parent, root, is_dir, name);
+        share_end(ws->share);
+    }
+    return (i32)key;
+}
+
+void workspace_remove(workspace_t *ws, i32 node) {
+    unlink_node(ws, node);
+    if (ws->shared) {
+        share_begin(ws->share);
+        share_remove(ws->share, (u32)node);
+        share_end(ws->share);
+    }
+}
+
+i32 workspace_find(const workspace_t *ws, const char *path) {
+    for (i32 i = 0; i < ws->node_count; i++) {
+        if ((ws->nodes[i].flags & WS_PRESENT) && strcmp(workspace_path(ws, i), path) == 0) {
+            return i;
+        }
+    }
+    return WS_NONE;
+}
+
+static const workspace_t *sort_ws;
+
+static int compare_nodes(const void *a, const void *b) {
+    const ws_node_t *na = &sort_ws->nodes[*(const i32 *)a];
+    const ws_node_t *nb = &sort_ws->nodes[*(const i32 *)b];
+    if ((na->flags & WS_DIR) != (nb->flags & WS_DIR)) {
+        return (na->flags & WS_DIR) ? -1 : 1;
+    }
+    return strcmp(sort_ws->strings + na->name, sort_ws->strings + nb->name);
+}
+
+void workspace_sort_children(workspace_t *ws, i32 node) {
+    ws_node_t *n = &ws->nodes[node];
+    if (n->flags & WS_SORTED) {
+        return;
+    }
+    i32 count = 0;
+    for (i32 c = n->first_child; c != WS_NONE; c = ws->nodes[c].next_sibling) {
+        count++;
+    }
+    i32 *children = frame_alloc((usize)max(count, 1) * sizeof(i32));
+    if (!children) {
+        return;
+    }
+    i32 i = 0;
+    for (i32 c = n->first_child; c != WS_NONE; c = ws->nodes[c].next_sibling) {
+        children[i++] = c;
+    }
+    sort_ws = ws;
+    qsort(children, (usize)count, sizeof(i32), compare_nodes);
+    n->first_child = count > 0 ? children[0] : WS_NONE;
+    for (i = 0; i < count; i++) {
+        ws->nodes[children[i]].next_sibling = i + 1 < count ? children[i + 1] : WS_NONE;
+    }
+    n->flags |= WS_SORTED;
+    ws->generation++;
+}
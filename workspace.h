@@ -0,0 +1,91 @@
+#ifndef AFAIRE_WORKSPACE_H
+#define AFAIRE_WORKSPACE_H
+
+#include <string.h>
+
+#include "base.h"
+#include "scan.h"
+#include "share.h"
+
+#define WS_NONE (-1)
+
+enum {
+    WS_PRESENT = 1 << 0,
+    WS_DIR = 1 << 1,
+    WS_EXPANDED = 1 << 2,
+    WS_SORTED = 1 << 3,  // children are linked in display order
+};
+
+// Node ids are the scanner's keys. Strings are offsets into `strings` because the pool moves when it grows.
+typedef struct {
+    i32 parent;
+    i32 first_child;
+    i32 next_sibling;
+    i32 path;     // full path on disk
+    i32 name;     // last component, inside `path`
+    i32 display;  // path shown in the UI: relative to the root, prefixed with the root's name when there are several
+    u16 root;
+    u8 flags;
+} ws_node_t;
+
+// Every folder given on the command line, scanned recursively in the background into one tree.
+typedef struct {
+    i32 root_count;
+    vfs_t *vfs[SCAN_MAX_ROOTS];  // owned; NULL for a root that couldn't be opened
+    ws_node_t *nodes;
+    i32 node_count;
+    i32 node_cap;
+    char *strings;
+    i32 strings_len;
+    i32 strings_cap;
+    i32 file_count;
+    u32 generation;  // bumped whenever nodes are added, removed or reordered
+    bool scanning;
+    scanner_t scanner;
+    share_t *share;  // the index other instances open on the same roots see, NULL when not shared
+    bool shared;     // the index is published: keys come from it and changes go to it
+    u32 share_seq;   // of the index as last copied into the tree
+    share_snapshot_t snapshot;
+} workspace_t;
+
+// Takes ownership of `vfs`, one per root, and closes them in workspace_free(). With `share`, the tree is taken from
+// another instance's index of the same roots when there is one, else scanned and published for the next ones.
+bool workspace_open(workspace_t *ws, const char *const *roots, vfs_t *const *vfs, i32 count, bool share);
+void workspace_free(workspace_t *ws);
+// Moves the scanner's results, or the other instances' changes to the shared index, into the tree; returns true when
+// something changed.
+bool workspace_poll(workspace_t *ws);
+i32 workspace_add(workspace_t *ws, i32 parent, const char *name, bool is_dir);
+void workspace_remove(workspace_t *ws, i32 node);
+i32 workspace_find(const workspace_t *ws, const char *path);
+// Relinks the children of `node` as directories first, then by name, sorting in frame scratch memory.
+void workspace_sort_children(workspace_t *ws, i32 node);
+
+static inline const char *workspace_path(const workspace_t *ws, i32 node) {
+    return ws->strings + ws->nodes[node].path;
+}
+
+static inline const char *workspace_name(const workspace_t *ws, i32 node) {
+    return ws->strings + ws->nodes[node].name;
+}
+
+static inline const char *workspace_display(const workspace_t *ws, i32 node) {
+    return ws->strings + ws->nodes[node].display;
+}
+
+static inline vfs_t *workspace_vfs(const workspace_t *ws, i32 node) {
+    return ws->vfs[ws->nodes[node].root];
+}
+
+// The path within the node's root, as its vfs takes it: "" for the root itself.
+static inline const char *workspace_rel_path(const workspace_t *ws, i32 node) {
+    const ws_node_t *n = &ws->nodes[node];
+    const ws_node_t *r = &ws->nodes[n->root];
+    return n->parent == WS_NONE ? "" : ws->strings + n->path + strlen(ws->strings + r->path) + 1;
+}
+
+static inline bool workspace_is_file(const workspace_t *ws, i32 node) {
+    return node >= 0 && node < ws->node_count && (ws->nodes[node].flags & (WS_PRESENT | WS_DIR)) == WS_PRESENT;
+}
+
+#endif